@@ -12,7 +12,8 @@ from setuptools import setup, find_packages, Extension
 settrie_ext = Extension(name				= 'settrie._py_settrie',
 						sources				= ['src/settrie/settrie.cpp', 'src/settrie/py_settrie_wrap.cpp'],
 						include_dirs		= ['src/settrie'],
-						extra_compile_args	= ['-std=c++11', '-c', '-fpic', '-O3'])
+						extra_compile_args	= ['-std=c++11', '-c', '-fpic', '-O3', '-pthread'],
+						extra_link_args		= ['-pthread'])
 
 setup_args = dict(
 	packages			 = find_packages(where = 'src'),
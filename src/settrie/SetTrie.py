@@ -20,18 +20,40 @@
 
 import re
 
+from array import array
+from base64 import b64decode
+
 from . import new_settrie
 from . import destroy_settrie
 from . import insert
+from . import stage_insert
+from . import insert_staged
 from . import find
 from . import supersets
 from . import subsets
+from . import find_idx
+from . import supersets_idx
+from . import subsets_idx
+from . import supersets_batch
+from . import subsets_batch
+from . import find_batch
+from . import count_supersets
+from . import count_subsets
+from . import supersets_cursor
+from . import subsets_cursor
+from . import cursor_next
+from . import destroy_cursor
 from . import elements
 from . import num_sets
 from . import next_set_id
 from . import set_name
 from . import remove
+from . import find_by_id
+from . import remove_by_id
 from . import purge
+from . import set_element_order
+from . import set_signatures
+from . import set_query_threads
 from . import iterator_size
 from . import iterator_next
 from . import destroy_iterator
@@ -40,6 +62,36 @@ from . import push_binary_image_block
 from . import binary_image_size
 from . import binary_image_next
 from . import destroy_binary_image
+from . import new_sharded_settrie
+from . import destroy_sharded_settrie
+from . import sharded_insert
+from . import sharded_stage_insert
+from . import sharded_insert_staged
+from . import sharded_find
+from . import sharded_find_idx
+from . import sharded_supersets
+from . import sharded_subsets
+from . import sharded_supersets_idx
+from . import sharded_subsets_idx
+from . import sharded_supersets_batch
+from . import sharded_subsets_batch
+from . import sharded_find_batch
+from . import sharded_count_supersets
+from . import sharded_count_subsets
+from . import sharded_elements
+from . import sharded_next_set_id
+from . import sharded_num_sets
+from . import sharded_num_shards
+from . import sharded_set_name
+from . import sharded_remove
+from . import sharded_find_by_id
+from . import sharded_remove_by_id
+from . import sharded_purge
+from . import sharded_set_element_order
+from . import sharded_set_signatures
+from . import sharded_set_query_threads
+from . import sharded_save_as_binary_image
+from . import sharded_push_binary_image_block
 
 from typing import Set
 
@@ -47,9 +99,14 @@ from typing import Set
 class Result:
     """ Container holding the results of several operations of SetTrie.
     It behaves, basically, like an iterator.
+
+    When created with a st_id, iter_id is a cursor that finds the results as they are read (see SetTrie.supersets() and
+    SetTrie.subsets() with lazy=True). Modifying the SetTrie while reading it raises a RuntimeError.
     """
-    def __init__(self, iter_id, auto_serialize = False):
+    def __init__(self, iter_id, auto_serialize = False, st_id = None, limit = None):
         self.iter_id = iter_id
+        self.st_id   = st_id
+        self.limit   = limit
         self.as_is   = True
         if auto_serialize:
             self.as_is     = False
@@ -57,15 +114,38 @@ class Result:
             self.to_float  = re.compile('^.*\\..*$')
 
     def __del__(self):
-        destroy_iterator(self.iter_id)
+        if self.st_id is None:
+            destroy_iterator(self.iter_id)
+        else:
+            destroy_cursor(self.iter_id)
 
     def __iter__(self):
         return self
 
     def __len__(self):
+        if self.st_id is not None:
+            raise TypeError('A lazy Result does not know its length, use count_supersets() or count_subsets().')
+
         return iterator_size(self.iter_id)
 
     def __next__(self):
+        if self.st_id is not None:
+            if self.limit is not None:
+                if self.limit <= 0:
+                    raise StopIteration
+
+                self.limit -= 1
+
+            set_id = cursor_next(self.iter_id)
+
+            if set_id == -2:
+                raise RuntimeError('SetTrie changed during iteration.')
+
+            if set_id < 0:
+                raise StopIteration
+
+            return set_name(self.st_id, set_id)
+
         if iterator_size(self.iter_id) > 0:
             if self.as_is:
                 return iterator_next(self.iter_id)
@@ -84,6 +164,35 @@ class Result:
             raise StopIteration
 
 
+class BatchResult:
+    """ The results of a batch of supersets() or subsets() queries, packed in a single array of set_ids with an offset per query.
+
+    result[i] is the array('i') of the set_ids found by query i and result.ids(i) their IDs.
+    """
+    def __init__(self, st_id, packed, num_queries):
+        if len(packed) < num_queries + 1:
+            packed = array('i', [0]*(num_queries + 1))
+
+        self.st_id   = st_id
+        self.offsets = packed[:num_queries + 1]
+        self.set_ids = packed[num_queries + 1:]
+
+    def __len__(self):
+        return len(self.offsets) - 1
+
+    def __getitem__(self, i):
+        if i < 0:
+            i += len(self)
+
+        if i < 0 or i >= len(self):
+            raise IndexError('BatchResult index out of range')
+
+        return self.set_ids[self.offsets[i]:self.offsets[i + 1]]
+
+    def ids(self, i) -> list:
+        return [set_name(self.st_id, set_id) for set_id in self[i]]
+
+
 class TreeSet:
     """ Class returned by the iterator of SetTrie to simplify iterating over the elements
     while not computing a list of strings (calling c++ elements()) unless it is required.
@@ -162,7 +271,6 @@ class SetTrie:
     def __init__(self, binary_image=None):
         self.st_id	 = new_settrie()
         self.set_id	 = -1
-        self.int_ids = None
         if binary_image is not None:
             self.load_from_binary_image(binary_image)
 
@@ -204,9 +312,25 @@ class SetTrie:
             set: Set to add
             id: String representing the ID for the test
         """
-        self.int_ids = None
         insert(self.st_id, str(set), id)
 
+    def insert_many(self, sets, ids, num_threads = 1) -> int:
+        """ Inserts many sets at once. The result is the same as calling insert() for each pair in order, but an empty SetTrie is
+        built in a single pass instead of searching the tree for each set, which is much faster for large batches.
+
+        Args:
+            sets: An iterable of sets to add.
+            ids: An iterable of the same length with the string representing the ID of each set.
+            num_threads (int): The number of threads hashing, sorting and building. The result does not depend on it.
+
+        Returns:
+            (int): The number of sets inserted.
+        """
+        for set, id in zip(sets, ids):
+            stage_insert(self.st_id, str(set), id)
+
+        return insert_staged(self.st_id, num_threads)
+
     def find(self, set) -> str:
         """ Finds the ID of the set matching the one provided.
 
@@ -217,39 +341,183 @@ class SetTrie:
         """
         return find(self.st_id, str(set))
 
-    def supersets(self, set) -> Result:
+    def supersets(self, set, limit: int = None, lazy: bool = False) -> Result:
         """ Find all the supersets of a given set.
 
         Args:
             set (set): set for which we want to find all the supersets
+            limit (int): If given, the search stops after finding this number of supersets.
+            lazy (bool): If True, the supersets are found as the result is read instead of all at once. This uses constant memory
+                and returns the first results immediately, but the SetTrie cannot be modified while reading the result.
 
         Returns:
             Iterator object with the IDs of the matching supersets.
         """
-        return Result(supersets(self.st_id, str(set)))
+        if lazy:
+            return Result(supersets_cursor(self.st_id, str(set)), st_id=self.st_id, limit=limit)
+
+        return Result(supersets(self.st_id, str(set), -1 if limit is None else limit))
 
-    def subsets(self, set) -> Result:
+    def subsets(self, set, limit: int = None, lazy: bool = False) -> Result:
         """ Find all the subsets for a given set.
 
         Args:
             set (set): set for which we want to find all the supersets
+            limit (int): If given, the search stops after finding this number of subsets.
+            lazy (bool): If True, the subsets are found as the result is read instead of all at once. This uses constant memory
+                and returns the first results immediately, but the SetTrie cannot be modified while reading the result.
 
         Returns:
             Iterator object with the IDs of the matching subsets.
         """
-        return Result(subsets(self.st_id, str(set)))
+        if lazy:
+            return Result(subsets_cursor(self.st_id, str(set)), st_id=self.st_id, limit=limit)
+
+        return Result(subsets(self.st_id, str(set), -1 if limit is None else limit))
+
+    def find_idx(self, set) -> int:
+        """ Finds the unique integer id of the set matching the one provided.
+
+        Args:
+            set (set): set to find
+
+        Returns:
+            (int): The unique integer id (the same used when iterating over the object) or -1 if not found.
+        """
+        return find_idx(self.st_id, str(set))
+
+    def supersets_idx(self, set, limit: int = None) -> array:
+        """ Find all the supersets of a given set and return their unique integer ids instead of their IDs.
+
+        This avoids building a string per result. The integer ids are the same used when iterating over the object (TreeSet) and
+        can be passed to remove(). They are valid until the next purge().
+
+        Args:
+            set (set): set for which we want to find all the supersets
+            limit (int): If given, the search stops after finding this number of supersets.
+
+        Returns:
+            (array): A contiguous array('i') with the unique integer ids of the matching supersets.
+        """
+        return array('i', b64decode(supersets_idx(self.st_id, str(set), -1 if limit is None else limit)))
+
+    def subsets_idx(self, set, limit: int = None) -> array:
+        """ Find all the subsets of a given set and return their unique integer ids instead of their IDs.
+
+        Args:
+            set (set): set for which we want to find all the subsets
+            limit (int): If given, the search stops after finding this number of subsets.
+
+        Returns:
+            (array): A contiguous array('i') with the unique integer ids of the matching subsets.
+        """
+        return array('i', b64decode(subsets_idx(self.st_id, str(set), -1 if limit is None else limit)))
+
+    def supersets_batch(self, sets, limit: int = None, num_threads: int = 1) -> BatchResult:
+        """ Find the supersets of many sets in a single call, running the queries on many threads.
+
+        The queries cross into c++ once, the repeated ones run only once and the results come back packed in a single array.
+
+        Args:
+            sets (list): The sets for which we want to find all the supersets.
+            limit (int): If given, each query stops after finding this number of supersets.
+            num_threads (int): The number of threads running the queries.
+
+        Returns:
+            (BatchResult): The set_ids found by each query, in the order of sets.
+        """
+        sets = list(sets)
+
+        if len(sets) == 0:
+            return BatchResult(self.st_id, array('i'), 0)
+
+        packed = supersets_batch(self.st_id, '\n'.join(str(s) for s in sets), -1 if limit is None else limit, num_threads)
+
+        return BatchResult(self.st_id, array('i', b64decode(packed)), len(sets))
+
+    def subsets_batch(self, sets, limit: int = None, num_threads: int = 1) -> BatchResult:
+        """ Find the subsets of many sets in a single call, running the queries on many threads.
+
+        Args:
+            sets (list): The sets for which we want to find all the subsets.
+            limit (int): If given, each query stops after finding this number of subsets.
+            num_threads (int): The number of threads running the queries.
+
+        Returns:
+            (BatchResult): The set_ids found by each query, in the order of sets.
+        """
+        sets = list(sets)
+
+        if len(sets) == 0:
+            return BatchResult(self.st_id, array('i'), 0)
+
+        packed = subsets_batch(self.st_id, '\n'.join(str(s) for s in sets), -1 if limit is None else limit, num_threads)
+
+        return BatchResult(self.st_id, array('i', b64decode(packed)), len(sets))
+
+    def find_batch(self, sets, num_threads: int = 1) -> array:
+        """ Find many sets in a single call and return their unique integer ids, as find_idx() does.
+
+        Args:
+            sets (list): The sets to find.
+            num_threads (int): The number of threads searching.
+
+        Returns:
+            (array): A contiguous array('i') with the integer id of each set, -1 for the ones not found.
+        """
+        sets = list(sets)
+
+        if len(sets) == 0:
+            return array('i')
+
+        return array('i', b64decode(find_batch(self.st_id, '\n'.join(str(s) for s in sets), num_threads)))
+
+    def count_supersets(self, set) -> int:
+        """ Counts the supersets of a given set without returning their IDs.
+
+        This is much faster than len(supersets()) when there are many results.
+
+        Args:
+            set (set): set for which we want to count the supersets
+
+        Returns:
+            (int): The number of supersets.
+        """
+        return count_supersets(self.st_id, str(set))
+
+    def count_subsets(self, set) -> int:
+        """ Counts the subsets of a given set without returning their IDs.
+
+        Args:
+            set (set): set for which we want to count the subsets
+
+        Returns:
+            (int): The number of subsets.
+        """
+        return count_subsets(self.st_id, str(set))
+
+    def find_by_id(self, id: str) -> int:
+        """ Finds a set by the string identifier it was inserted with.
+
+        Args:
+            id (str): The same string used as the id when the set was inserted via `insert()`.
+
+        Returns:
+            (int): The unique integer id of the set (the last one inserted if many sets share the id) or -1 if not found. It can
+                be passed to remove() and is valid until the next purge().
+        """
+        return find_by_id(self.st_id, id)
 
     def remove(self, id):
         """ Removes a set from the object either by string identifier or by its unique integer id.
 
-        If you need to remove multiple elements, it is more efficient to avoid inserting or purging between remove() calls. The
-        object needs to build a dictionary with all the unique integer ids. Since ids change by insert() and purge() calls, the
-        dictionary will be rebuilt each time, which requires iterating over the whole object.
+        The object keeps an index of the string identifiers, so both take constant time. If many sets share the same string
+        identifier, the last one inserted is removed.
 
         Args:
             id (str): Either the same string used as the id when the set was inserted via `insert()` or the unique integer id, if known.
-                The latter is faster. The unique integer id is the id used by the iterator when you iterate over the whole object
-                to identify the specific set.
+                The unique integer id is the id used by the iterator when you iterate over the whole object to identify the specific
+                set.
 
         Returns:
             (int): Zero if the set was removed, a negative integer code on error.
@@ -257,27 +525,15 @@ class SetTrie:
         self.set_id	= -1
 
         if type(id) is int:
-            self.int_ids = None
             return remove(self.st_id, id)
 
-        if self.int_ids is None:
-            self.int_ids = dict()
-            int_id = next_set_id(self.st_id, -1)
-            while int_id >= 0:
-                self.int_ids[set_name(self.st_id, int_id)] = int_id
-                int_id = next_set_id(self.st_id, int_id)
-
-        int_id = self.int_ids.pop(id, None)
-        if int_id is None:
-            return -1
-
-        return remove(self.st_id, int_id)
+        return remove_by_id(self.st_id, id)
 
     def purge(self):
         """ Purges (reassigns node integer ids and frees RAM) after a series of remove() calls.
 
-        If you need to remove multiple elements, it is more efficient to avoid inserting or purging between remove() calls.
-        Call purge() just once after you have finished removing.
+        Purging rebuilds the whole object. If you need to remove multiple elements, call purge() just once after you have finished
+        removing.
 
         Returns:
             (int): The number of tree nodes freed.
@@ -289,12 +545,61 @@ class SetTrie:
         if size == 0:
             return 0
 
-        self.int_ids = None
-
         purge(self.st_id, 0)
 
         return size
 
+    def set_element_order(self, order: str):
+        """ Sets the order of the elements inside the sets and rebuilds the tree in that order.
+
+        By default, the elements are ordered by the first time they were inserted. When a few elements are used by most of the sets
+        (e.g., Zipfian vocabularies) ranking them by frequency produces a much smaller tree ('frequent_first') or faster supersets()
+        queries ('rare_first'). The order is kept by insert(), reapplied by purge() and saved in the binary image.
+
+        Args:
+            order (str): One of 'insertion', 'frequent_first' or 'rare_first'.
+
+        Returns:
+            (int): Zero on success, a negative integer code on error.
+        """
+        orders = {'insertion' : 0, 'frequent_first' : 1, 'rare_first' : 2}
+
+        if order not in orders:
+            return -2
+
+        self.set_id	 = -1
+
+        return set_element_order(self.st_id, orders[order])
+
+    def set_signatures(self, enable: bool):
+        """ Enables or disables a 64 bit signature per node of the elements found in its subtree.
+
+        supersets() skips the subtrees whose signature proves they miss some queried element. This helps most with queries of
+        several elements on large trees and costs 8 bytes per node. The setting is saved in the binary image.
+
+        Args:
+            enable (bool): True to build and maintain the signatures, False to release them.
+
+        Returns:
+            (int): Zero on success, a negative integer code on error.
+        """
+        return set_signatures(self.st_id, 1 if enable else 0)
+
+    def set_query_threads(self, num_threads: int):
+        """ Sets the number of threads running each supersets() and subsets() query without a limit.
+
+        A single broad query on a large tree is split among the threads. The results are the same, but their order is not defined.
+        The queries with a limit, the counts, the iterators and the queries of small trees (under 16384 nodes) always run on a single
+        thread. The setting is not saved in the binary image.
+
+        Args:
+            num_threads (int): The number of threads, 1 (the default) runs the queries on the calling thread.
+
+        Returns:
+            (int): Zero on success, a negative integer code on error.
+        """
+        return set_query_threads(self.st_id, num_threads)
+
     def save_as_binary_image(self):
         """ Saves the state of the c++ SetTrie object as a Python
             list of strings referred to a binary_image.
@@ -328,8 +633,6 @@ class SetTrie:
         Returns:
             (bool): True on success, destroys, initializes and returns false on failure.
         """
-        self.int_ids = None
-
         failed = False
 
         for binary_image_block in binary_image:
@@ -351,3 +654,300 @@ class SetTrie:
 
     def __deepcopy__(self, memo):
         return SetTrie(binary_image=self.save_as_binary_image())
+
+
+class ShardedTreeSet(TreeSet):
+    """ Class returned by the iterator of ShardedSetTrie, the same as TreeSet.
+    """
+    @property
+    def id(self):
+        return sharded_set_name(self.st_id, self.set_id)
+
+    @property
+    def elements(self):
+        return Result(sharded_elements(self.st_id, self.set_id), auto_serialize=True)
+
+
+class ShardedBatchResult(BatchResult):
+    """ The results of a batch of queries of a ShardedSetTrie, the same as BatchResult.
+    """
+    def ids(self, i) -> list:
+        return [sharded_set_name(self.st_id, set_id) for set_id in self[i]]
+
+
+class ShardedSetTrie:
+    """ A SetTrie split in shards, with the same interface as SetTrie.
+
+    Each set goes to the shard given by a hash of its elements, so find() only searches one shard. insert_many() fills the shards
+    in parallel and supersets() and subsets() search all the shards at once on num_threads threads, merging their results shard after
+    shard. Use it for large collections queried by broad supersets() or subsets() queries.
+
+    The unique integer ids (find_idx(), supersets_idx(), ...) are not the ones a SetTrie with the same sets would give, and the
+    results are not in the same order. With a limit, the first results in shard order are returned. Within a shard the order is
+    the one of a SetTrie, not defined when set_query_threads() splits the queries.
+
+    Example:
+        ```python
+        >>> from settrie import ShardedSetTrie
+        >>>
+        >>> stt = ShardedSetTrie(num_shards=8, num_threads=8)
+        >>> stt.insert_many([{2, 3}, {2, 3, 4.4}, {'Mon', 'Tue'}], ['id1', 'id2', 'days'])
+        >>>
+        >>> for id in stt.supersets({2, 3}):
+        >>>     print(id)
+        ```
+    """
+    def __init__(self, num_shards: int = 4, num_threads: int = 4, binary_image=None):
+        self.num_threads = num_threads
+        self.st_id		 = new_sharded_settrie(num_shards, num_threads)
+        self.num_shards	 = sharded_num_shards(self.st_id)
+        self.set_id		 = -1
+        if binary_image is not None:
+            self.load_from_binary_image(binary_image)
+
+    def __iter__(self):
+        return self
+
+    def __len__(self):
+        return sharded_num_sets(self.st_id)
+
+    def __next__(self):
+        if self.set_id < 0:
+            self.set_id = -1
+
+        self.set_id = sharded_next_set_id(self.st_id, self.set_id)
+
+        if self.set_id < 0:
+            raise StopIteration
+
+        return ShardedTreeSet(self.st_id, self.set_id)
+
+    def __del__(self):
+        destroy_sharded_settrie(self.st_id)
+
+    def __getstate__(self):
+        """ Used by pickle.dump() (See https://docs.python.org/3/library/pickle.html)
+        """
+        return {'num_shards' : self.num_shards, 'num_threads' : self.num_threads, 'image' : self.save_as_binary_image()}
+
+    def __setstate__(self, state):
+        """ Used by pickle.load() (See https://docs.python.org/3/library/pickle.html)
+        """
+        self.num_shards	 = state['num_shards']
+        self.num_threads = state['num_threads']
+        self.st_id		 = new_sharded_settrie(self.num_shards, self.num_threads)
+        self.load_from_binary_image(state['image'])
+
+    def insert(self, set: Set, id: str):
+        """ Inserts a new set into its shard. See SetTrie.insert().
+
+        The unique integer ids are 32 bit, so a shard holds at most 2^31/num_shards nodes. Raises an OverflowError if the shard of
+        the set is full.
+        """
+        if sharded_insert(self.st_id, str(set), id) == -2:
+            raise OverflowError('The shard of the set is full.')
+
+    def insert_many(self, sets, ids) -> int:
+        """ Inserts many sets at once, each shard inserting its part on its own thread. See SetTrie.insert_many().
+
+        Returns:
+            (int): The number of sets inserted. A shard that is full (see insert()) inserts none of its part.
+        """
+        for set, id in zip(sets, ids):
+            sharded_stage_insert(self.st_id, str(set), id)
+
+        return sharded_insert_staged(self.st_id)
+
+    def find(self, set) -> str:
+        """ Finds the ID of the set matching the one provided, searching only its shard. See SetTrie.find().
+        """
+        return sharded_find(self.st_id, str(set))
+
+    def supersets(self, set, limit: int = None, lazy: bool = False) -> Result:
+        """ Find all the supersets of a given set in all the shards. See SetTrie.supersets().
+
+        The shards are searched at once, so lazy is accepted for compatibility but the result is always found eagerly.
+        """
+        return Result(sharded_supersets(self.st_id, str(set), -1 if limit is None else limit))
+
+    def subsets(self, set, limit: int = None, lazy: bool = False) -> Result:
+        """ Find all the subsets of a given set in all the shards. See SetTrie.subsets().
+
+        The shards are searched at once, so lazy is accepted for compatibility but the result is always found eagerly.
+        """
+        return Result(sharded_subsets(self.st_id, str(set), -1 if limit is None else limit))
+
+    def find_idx(self, set) -> int:
+        """ Finds the unique integer id of the set matching the one provided or -1 if not found. See SetTrie.find_idx().
+        """
+        return sharded_find_idx(self.st_id, str(set))
+
+    def supersets_idx(self, set, limit: int = None) -> array:
+        """ Find all the supersets of a given set and return their unique integer ids. See SetTrie.supersets_idx().
+        """
+        return array('i', b64decode(sharded_supersets_idx(self.st_id, str(set), -1 if limit is None else limit)))
+
+    def subsets_idx(self, set, limit: int = None) -> array:
+        """ Find all the subsets of a given set and return their unique integer ids. See SetTrie.subsets_idx().
+        """
+        return array('i', b64decode(sharded_subsets_idx(self.st_id, str(set), -1 if limit is None else limit)))
+
+    def supersets_batch(self, sets, limit: int = None) -> ShardedBatchResult:
+        """ Find the supersets of many sets in a single call, each shard running the whole batch. See SetTrie.supersets_batch().
+        """
+        sets = list(sets)
+
+        if len(sets) == 0:
+            return ShardedBatchResult(self.st_id, array('i'), 0)
+
+        packed = sharded_supersets_batch(self.st_id, '\n'.join(str(s) for s in sets), -1 if limit is None else limit)
+
+        return ShardedBatchResult(self.st_id, array('i', b64decode(packed)), len(sets))
+
+    def subsets_batch(self, sets, limit: int = None) -> ShardedBatchResult:
+        """ Find the subsets of many sets in a single call, each shard running the whole batch. See SetTrie.subsets_batch().
+        """
+        sets = list(sets)
+
+        if len(sets) == 0:
+            return ShardedBatchResult(self.st_id, array('i'), 0)
+
+        packed = sharded_subsets_batch(self.st_id, '\n'.join(str(s) for s in sets), -1 if limit is None else limit)
+
+        return ShardedBatchResult(self.st_id, array('i', b64decode(packed)), len(sets))
+
+    def find_batch(self, sets) -> array:
+        """ Find many sets in a single call and return their unique integer ids, -1 for the ones not found. See SetTrie.find_batch().
+        """
+        sets = list(sets)
+
+        if len(sets) == 0:
+            return array('i')
+
+        return array('i', b64decode(sharded_find_batch(self.st_id, '\n'.join(str(s) for s in sets))))
+
+    def count_supersets(self, set) -> int:
+        """ Counts the supersets of a given set in all the shards. See SetTrie.count_supersets().
+        """
+        return sharded_count_supersets(self.st_id, str(set))
+
+    def count_subsets(self, set) -> int:
+        """ Counts the subsets of a given set in all the shards. See SetTrie.count_subsets().
+        """
+        return sharded_count_subsets(self.st_id, str(set))
+
+    def find_by_id(self, id: str) -> int:
+        """ Finds a set by the string identifier it was inserted with. See SetTrie.find_by_id().
+
+        The identifiers do not decide the shard, if many sets share one, the set found is the last inserted in the first shard having it.
+        """
+        return sharded_find_by_id(self.st_id, id)
+
+    def remove(self, id):
+        """ Removes a set either by string identifier or by its unique integer id. See SetTrie.remove().
+
+        Returns:
+            (int): Zero if the set was removed, a negative integer code on error.
+        """
+        self.set_id	= -1
+
+        if type(id) is int:
+            return sharded_remove(self.st_id, id)
+
+        return sharded_remove_by_id(self.st_id, id)
+
+    def purge(self):
+        """ Purges all the shards after a series of remove() calls. See SetTrie.purge().
+
+        Returns:
+            (int): The number of tree nodes freed.
+        """
+        self.set_id	= -1
+
+        size = sharded_purge(self.st_id, 1) # dry run
+
+        if size == 0:
+            return 0
+
+        sharded_purge(self.st_id, 0)
+
+        return size
+
+    def set_element_order(self, order: str):
+        """ Sets the order of the elements in all the shards. See SetTrie.set_element_order().
+
+        Returns:
+            (int): Zero on success, a negative integer code on error.
+        """
+        orders = {'insertion' : 0, 'frequent_first' : 1, 'rare_first' : 2}
+
+        if order not in orders:
+            return -2
+
+        self.set_id	 = -1
+
+        return sharded_set_element_order(self.st_id, orders[order])
+
+    def set_signatures(self, enable: bool):
+        """ Enables or disables the signatures in all the shards. See SetTrie.set_signatures().
+
+        Returns:
+            (int): Zero on success, a negative integer code on error.
+        """
+        return sharded_set_signatures(self.st_id, 1 if enable else 0)
+
+    def set_query_threads(self, num_threads: int):
+        """ Sets the number of threads each shard splits a query among, on top of the threads searching the shards at once.
+        See SetTrie.set_query_threads().
+
+        Returns:
+            (int): Zero on success, a negative integer code on error.
+        """
+        return sharded_set_query_threads(self.st_id, num_threads)
+
+    def save_as_binary_image(self):
+        """ Saves the state of all the shards as a Python list of strings. See SetTrie.save_as_binary_image().
+        """
+        bi_idx = sharded_save_as_binary_image(self.st_id)
+        if bi_idx == 0:
+            return None
+
+        bi = []
+        bi_size = binary_image_size(bi_idx)
+        for t in range(bi_size):
+            bi.append(binary_image_next(bi_idx))
+
+        destroy_binary_image(bi_idx)
+
+        return bi
+
+    def load_from_binary_image(self, binary_image):
+        """ Load the state of all the shards from a binary_image returned by a previous save_as_binary_image() call. The number of
+            shards becomes the one saved in the image.
+
+        Returns:
+            (bool): True on success, destroys, initializes and returns false on failure.
+        """
+        failed = False
+
+        for binary_image_block in binary_image:
+            if not sharded_push_binary_image_block(self.st_id, binary_image_block):
+                failed = True
+                break
+
+        if not failed:
+            failed = not sharded_push_binary_image_block(self.st_id, '')
+
+        self.set_id = -1
+
+        if failed:
+            destroy_sharded_settrie(self.st_id)
+            self.st_id = new_sharded_settrie(self.num_shards, self.num_threads)
+            return False
+
+        self.num_shards = sharded_num_shards(self.st_id)
+
+        return True
+
+    def __deepcopy__(self, memo):
+        return ShardedSetTrie(self.num_shards, self.num_threads, binary_image=self.save_as_binary_image())
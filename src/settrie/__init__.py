@@ -68,14 +68,56 @@ def destroy_settrie(st_id):
 def insert(st_id, set, str_id):
     return _py_settrie.insert(st_id, set, str_id)
 
+def stage_insert(st_id, set, str_id):
+    return _py_settrie.stage_insert(st_id, set, str_id)
+
+def insert_staged(st_id, num_threads):
+    return _py_settrie.insert_staged(st_id, num_threads)
+
 def find(st_id, set):
     return _py_settrie.find(st_id, set)
 
-def supersets(st_id, set):
-    return _py_settrie.supersets(st_id, set)
+def supersets(st_id, set, limit):
+    return _py_settrie.supersets(st_id, set, limit)
+
+def subsets(st_id, set, limit):
+    return _py_settrie.subsets(st_id, set, limit)
+
+def find_idx(st_id, set):
+    return _py_settrie.find_idx(st_id, set)
+
+def supersets_idx(st_id, set, limit):
+    return _py_settrie.supersets_idx(st_id, set, limit)
+
+def subsets_idx(st_id, set, limit):
+    return _py_settrie.subsets_idx(st_id, set, limit)
+
+def supersets_batch(st_id, sets, limit, num_threads):
+    return _py_settrie.supersets_batch(st_id, sets, limit, num_threads)
+
+def subsets_batch(st_id, sets, limit, num_threads):
+    return _py_settrie.subsets_batch(st_id, sets, limit, num_threads)
+
+def find_batch(st_id, sets, num_threads):
+    return _py_settrie.find_batch(st_id, sets, num_threads)
+
+def count_supersets(st_id, set):
+    return _py_settrie.count_supersets(st_id, set)
+
+def count_subsets(st_id, set):
+    return _py_settrie.count_subsets(st_id, set)
+
+def supersets_cursor(st_id, set):
+    return _py_settrie.supersets_cursor(st_id, set)
+
+def subsets_cursor(st_id, set):
+    return _py_settrie.subsets_cursor(st_id, set)
 
-def subsets(st_id, set):
-    return _py_settrie.subsets(st_id, set)
+def cursor_next(cursor_id):
+    return _py_settrie.cursor_next(cursor_id)
+
+def destroy_cursor(cursor_id):
+    return _py_settrie.destroy_cursor(cursor_id)
 
 def elements(st_id, set_id):
     return _py_settrie.elements(st_id, set_id)
@@ -92,9 +134,24 @@ def set_name(st_id, set_id):
 def remove(st_id, set_id):
     return _py_settrie.remove(st_id, set_id)
 
+def find_by_id(st_id, str_id):
+    return _py_settrie.find_by_id(st_id, str_id)
+
+def remove_by_id(st_id, str_id):
+    return _py_settrie.remove_by_id(st_id, str_id)
+
 def purge(st_id, dry_run):
     return _py_settrie.purge(st_id, dry_run)
 
+def set_element_order(st_id, order):
+    return _py_settrie.set_element_order(st_id, order)
+
+def set_signatures(st_id, enable):
+    return _py_settrie.set_signatures(st_id, enable)
+
+def set_query_threads(st_id, num_threads):
+    return _py_settrie.set_query_threads(st_id, num_threads)
+
 def iterator_size(iter_id):
     return _py_settrie.iterator_size(iter_id)
 
@@ -119,6 +176,96 @@ def binary_image_next(image_id):
 def destroy_binary_image(image_id):
     return _py_settrie.destroy_binary_image(image_id)
 
+def new_sharded_settrie(num_shards, num_threads):
+    return _py_settrie.new_sharded_settrie(num_shards, num_threads)
+
+def destroy_sharded_settrie(sh_id):
+    return _py_settrie.destroy_sharded_settrie(sh_id)
+
+def sharded_insert(sh_id, set, str_id):
+    return _py_settrie.sharded_insert(sh_id, set, str_id)
+
+def sharded_stage_insert(sh_id, set, str_id):
+    return _py_settrie.sharded_stage_insert(sh_id, set, str_id)
+
+def sharded_insert_staged(sh_id):
+    return _py_settrie.sharded_insert_staged(sh_id)
+
+def sharded_find(sh_id, set):
+    return _py_settrie.sharded_find(sh_id, set)
+
+def sharded_find_idx(sh_id, set):
+    return _py_settrie.sharded_find_idx(sh_id, set)
+
+def sharded_supersets(sh_id, set, limit):
+    return _py_settrie.sharded_supersets(sh_id, set, limit)
+
+def sharded_subsets(sh_id, set, limit):
+    return _py_settrie.sharded_subsets(sh_id, set, limit)
+
+def sharded_supersets_idx(sh_id, set, limit):
+    return _py_settrie.sharded_supersets_idx(sh_id, set, limit)
+
+def sharded_subsets_idx(sh_id, set, limit):
+    return _py_settrie.sharded_subsets_idx(sh_id, set, limit)
+
+def sharded_supersets_batch(sh_id, sets, limit):
+    return _py_settrie.sharded_supersets_batch(sh_id, sets, limit)
+
+def sharded_subsets_batch(sh_id, sets, limit):
+    return _py_settrie.sharded_subsets_batch(sh_id, sets, limit)
+
+def sharded_find_batch(sh_id, sets):
+    return _py_settrie.sharded_find_batch(sh_id, sets)
+
+def sharded_count_supersets(sh_id, set):
+    return _py_settrie.sharded_count_supersets(sh_id, set)
+
+def sharded_count_subsets(sh_id, set):
+    return _py_settrie.sharded_count_subsets(sh_id, set)
+
+def sharded_elements(sh_id, set_id):
+    return _py_settrie.sharded_elements(sh_id, set_id)
+
+def sharded_next_set_id(sh_id, set_id):
+    return _py_settrie.sharded_next_set_id(sh_id, set_id)
+
+def sharded_num_sets(sh_id):
+    return _py_settrie.sharded_num_sets(sh_id)
+
+def sharded_num_shards(sh_id):
+    return _py_settrie.sharded_num_shards(sh_id)
+
+def sharded_set_name(sh_id, set_id):
+    return _py_settrie.sharded_set_name(sh_id, set_id)
+
+def sharded_remove(sh_id, set_id):
+    return _py_settrie.sharded_remove(sh_id, set_id)
+
+def sharded_find_by_id(sh_id, str_id):
+    return _py_settrie.sharded_find_by_id(sh_id, str_id)
+
+def sharded_remove_by_id(sh_id, str_id):
+    return _py_settrie.sharded_remove_by_id(sh_id, str_id)
+
+def sharded_purge(sh_id, dry_run):
+    return _py_settrie.sharded_purge(sh_id, dry_run)
+
+def sharded_set_element_order(sh_id, order):
+    return _py_settrie.sharded_set_element_order(sh_id, order)
+
+def sharded_set_signatures(sh_id, enable):
+    return _py_settrie.sharded_set_signatures(sh_id, enable)
+
+def sharded_set_query_threads(sh_id, num_threads):
+    return _py_settrie.sharded_set_query_threads(sh_id, num_threads)
+
+def sharded_save_as_binary_image(sh_id):
+    return _py_settrie.sharded_save_as_binary_image(sh_id)
+
+def sharded_push_binary_image_block(sh_id, p_block):
+    return _py_settrie.sharded_push_binary_image_block(sh_id, p_block)
+
 def cleanup_globals():
     return _py_settrie.cleanup_globals()
 
@@ -126,6 +273,7 @@ def cleanup_globals():
 __version__ = '1.5.1'
 from settrie.SetTrie import SetTrie
 from settrie.SetTrie import Result
+from settrie.SetTrie import ShardedSetTrie
 from settrie.create_tutorials import create_tutorials
 
 import atexit, weakref
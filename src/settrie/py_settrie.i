@@ -4,15 +4,34 @@
 	extern int new_settrie();
 	extern void destroy_settrie(int st_id);
 	extern void insert	(int st_id, char *set, char *str_id);
+	extern void stage_insert (int st_id, char *set, char *str_id);
+	extern int insert_staged (int st_id, int num_threads);
 	extern char *find (int st_id, char *set);
-	extern int supersets (int st_id, char *set);
-	extern int subsets (int st_id, char *set);
+	extern int supersets (int st_id, char *set, int limit);
+	extern int subsets (int st_id, char *set, int limit);
+	extern int find_idx (int st_id, char *set);
+	extern char *supersets_idx (int st_id, char *set, int limit);
+	extern char *subsets_idx (int st_id, char *set, int limit);
+	extern char *supersets_batch (int st_id, char *sets, int limit, int num_threads);
+	extern char *subsets_batch (int st_id, char *sets, int limit, int num_threads);
+	extern char *find_batch (int st_id, char *sets, int num_threads);
+	extern int count_supersets (int st_id, char *set);
+	extern int count_subsets (int st_id, char *set);
+	extern int supersets_cursor (int st_id, char *set);
+	extern int subsets_cursor (int st_id, char *set);
+	extern int cursor_next (int cursor_id);
+	extern void destroy_cursor (int cursor_id);
 	extern int elements (int st_id, int set_id);
 	extern int next_set_id (int st_id, int set_id);
 	extern int num_sets (int st_id);
 	extern char *set_name (int st_id, int set_id);
 	extern int remove (int st_id, int set_id);
+	extern int find_by_id (int st_id, char *str_id);
+	extern int remove_by_id (int st_id, char *str_id);
 	extern int purge (int st_id, int dry_run);
+	extern int set_element_order (int st_id, int order);
+	extern int set_signatures (int st_id, int enable);
+	extern int set_query_threads (int st_id, int num_threads);
 	extern int iterator_size (int iter_id);
 	extern char *iterator_next (int iter_id);
 	extern void destroy_iterator (int iter_id);
@@ -21,21 +40,70 @@
 	extern int binary_image_size (int image_id);
 	extern char *binary_image_next (int image_id);
 	extern void destroy_binary_image (int image_id);
+	extern int new_sharded_settrie (int num_shards, int num_threads);
+	extern void destroy_sharded_settrie (int sh_id);
+	extern int sharded_insert (int sh_id, char *set, char *str_id);
+	extern void sharded_stage_insert (int sh_id, char *set, char *str_id);
+	extern int sharded_insert_staged (int sh_id);
+	extern char *sharded_find (int sh_id, char *set);
+	extern int sharded_find_idx (int sh_id, char *set);
+	extern int sharded_supersets (int sh_id, char *set, int limit);
+	extern int sharded_subsets (int sh_id, char *set, int limit);
+	extern char *sharded_supersets_idx (int sh_id, char *set, int limit);
+	extern char *sharded_subsets_idx (int sh_id, char *set, int limit);
+	extern char *sharded_supersets_batch (int sh_id, char *sets, int limit);
+	extern char *sharded_subsets_batch (int sh_id, char *sets, int limit);
+	extern char *sharded_find_batch (int sh_id, char *sets);
+	extern int sharded_count_supersets (int sh_id, char *set);
+	extern int sharded_count_subsets (int sh_id, char *set);
+	extern int sharded_elements (int sh_id, int set_id);
+	extern int sharded_next_set_id (int sh_id, int set_id);
+	extern int sharded_num_sets (int sh_id);
+	extern int sharded_num_shards (int sh_id);
+	extern char *sharded_set_name (int sh_id, int set_id);
+	extern int sharded_remove (int sh_id, int set_id);
+	extern int sharded_find_by_id (int sh_id, char *str_id);
+	extern int sharded_remove_by_id (int sh_id, char *str_id);
+	extern int sharded_purge (int sh_id, int dry_run);
+	extern int sharded_set_element_order (int sh_id, int order);
+	extern int sharded_set_signatures (int sh_id, int enable);
+	extern int sharded_set_query_threads (int sh_id, int num_threads);
+	extern int sharded_save_as_binary_image (int sh_id);
+	extern bool sharded_push_binary_image_block (int sh_id, char *p_block);
 	extern void cleanup_globals();
 %}
 
 extern int new_settrie();
 extern void destroy_settrie(int st_id);
 extern void insert	(int st_id, char *set, char *str_id);
+extern void stage_insert (int st_id, char *set, char *str_id);
+extern int insert_staged (int st_id, int num_threads);
 extern char *find (int st_id, char *set);
-extern int supersets (int st_id, char *set);
-extern int subsets (int st_id, char *set);
+extern int supersets (int st_id, char *set, int limit);
+extern int subsets (int st_id, char *set, int limit);
+extern int find_idx (int st_id, char *set);
+extern char *supersets_idx (int st_id, char *set, int limit);
+extern char *subsets_idx (int st_id, char *set, int limit);
+extern char *supersets_batch (int st_id, char *sets, int limit, int num_threads);
+extern char *subsets_batch (int st_id, char *sets, int limit, int num_threads);
+extern char *find_batch (int st_id, char *sets, int num_threads);
+extern int count_supersets (int st_id, char *set);
+extern int count_subsets (int st_id, char *set);
+extern int supersets_cursor (int st_id, char *set);
+extern int subsets_cursor (int st_id, char *set);
+extern int cursor_next (int cursor_id);
+extern void destroy_cursor (int cursor_id);
 extern int elements (int st_id, int set_id);
 extern int next_set_id (int st_id, int set_id);
 extern int num_sets (int st_id);
 extern char *set_name (int st_id, int set_id);
 extern int remove (int st_id, int set_id);
+extern int find_by_id (int st_id, char *str_id);
+extern int remove_by_id (int st_id, char *str_id);
 extern int purge (int st_id, int dry_run);
+extern int set_element_order (int st_id, int order);
+extern int set_signatures (int st_id, int enable);
+extern int set_query_threads (int st_id, int num_threads);
 extern int iterator_size (int iter_id);
 extern char *iterator_next (int iter_id);
 extern void destroy_iterator (int iter_id);
@@ -44,4 +112,34 @@ extern bool push_binary_image_block (int st_id, char *p_block);
 extern int binary_image_size (int image_id);
 extern char *binary_image_next (int image_id);
 extern void destroy_binary_image (int image_id);
+extern int new_sharded_settrie (int num_shards, int num_threads);
+extern void destroy_sharded_settrie (int sh_id);
+extern int sharded_insert (int sh_id, char *set, char *str_id);
+extern void sharded_stage_insert (int sh_id, char *set, char *str_id);
+extern int sharded_insert_staged (int sh_id);
+extern char *sharded_find (int sh_id, char *set);
+extern int sharded_find_idx (int sh_id, char *set);
+extern int sharded_supersets (int sh_id, char *set, int limit);
+extern int sharded_subsets (int sh_id, char *set, int limit);
+extern char *sharded_supersets_idx (int sh_id, char *set, int limit);
+extern char *sharded_subsets_idx (int sh_id, char *set, int limit);
+extern char *sharded_supersets_batch (int sh_id, char *sets, int limit);
+extern char *sharded_subsets_batch (int sh_id, char *sets, int limit);
+extern char *sharded_find_batch (int sh_id, char *sets);
+extern int sharded_count_supersets (int sh_id, char *set);
+extern int sharded_count_subsets (int sh_id, char *set);
+extern int sharded_elements (int sh_id, int set_id);
+extern int sharded_next_set_id (int sh_id, int set_id);
+extern int sharded_num_sets (int sh_id);
+extern int sharded_num_shards (int sh_id);
+extern char *sharded_set_name (int sh_id, int set_id);
+extern int sharded_remove (int sh_id, int set_id);
+extern int sharded_find_by_id (int sh_id, char *str_id);
+extern int sharded_remove_by_id (int sh_id, char *str_id);
+extern int sharded_purge (int sh_id, int dry_run);
+extern int sharded_set_element_order (int sh_id, int order);
+extern int sharded_set_signatures (int sh_id, int enable);
+extern int sharded_set_query_threads (int sh_id, int num_threads);
+extern int sharded_save_as_binary_image (int sh_id);
+extern bool sharded_push_binary_image_block (int sh_id, char *p_block);
 extern void cleanup_globals();
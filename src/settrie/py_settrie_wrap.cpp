@@ -3183,15 +3183,34 @@ static swig_module_info swig_module = {swig_types, 1, 0, 0, 0, 0};
 	extern int new_settrie();
 	extern void destroy_settrie(int st_id);
 	extern void insert	(int st_id, char *set, char *str_id);
+	extern void stage_insert (int st_id, char *set, char *str_id);
+	extern int insert_staged (int st_id, int num_threads);
 	extern char *find (int st_id, char *set);
-	extern int supersets (int st_id, char *set);
-	extern int subsets (int st_id, char *set);
+	extern int supersets (int st_id, char *set, int limit);
+	extern int subsets (int st_id, char *set, int limit);
+	extern int find_idx (int st_id, char *set);
+	extern char *supersets_idx (int st_id, char *set, int limit);
+	extern char *subsets_idx (int st_id, char *set, int limit);
+	extern char *supersets_batch (int st_id, char *sets, int limit, int num_threads);
+	extern char *subsets_batch (int st_id, char *sets, int limit, int num_threads);
+	extern char *find_batch (int st_id, char *sets, int num_threads);
+	extern int count_supersets (int st_id, char *set);
+	extern int count_subsets (int st_id, char *set);
+	extern int supersets_cursor (int st_id, char *set);
+	extern int subsets_cursor (int st_id, char *set);
+	extern int cursor_next (int cursor_id);
+	extern void destroy_cursor (int cursor_id);
 	extern int elements (int st_id, int set_id);
 	extern int next_set_id (int st_id, int set_id);
 	extern int num_sets (int st_id);
 	extern char *set_name (int st_id, int set_id);
 	extern int remove (int st_id, int set_id);
+	extern int find_by_id (int st_id, char *str_id);
+	extern int remove_by_id (int st_id, char *str_id);
 	extern int purge (int st_id, int dry_run);
+	extern int set_element_order (int st_id, int order);
+	extern int set_signatures (int st_id, int enable);
+	extern int set_query_threads (int st_id, int num_threads);
 	extern int iterator_size (int iter_id);
 	extern char *iterator_next (int iter_id);
 	extern void destroy_iterator (int iter_id);
@@ -3200,6 +3219,36 @@ static swig_module_info swig_module = {swig_types, 1, 0, 0, 0, 0};
 	extern int binary_image_size (int image_id);
 	extern char *binary_image_next (int image_id);
 	extern void destroy_binary_image (int image_id);
+	extern int new_sharded_settrie (int num_shards, int num_threads);
+	extern void destroy_sharded_settrie (int sh_id);
+	extern int sharded_insert (int sh_id, char *set, char *str_id);
+	extern void sharded_stage_insert (int sh_id, char *set, char *str_id);
+	extern int sharded_insert_staged (int sh_id);
+	extern char *sharded_find (int sh_id, char *set);
+	extern int sharded_find_idx (int sh_id, char *set);
+	extern int sharded_supersets (int sh_id, char *set, int limit);
+	extern int sharded_subsets (int sh_id, char *set, int limit);
+	extern char *sharded_supersets_idx (int sh_id, char *set, int limit);
+	extern char *sharded_subsets_idx (int sh_id, char *set, int limit);
+	extern char *sharded_supersets_batch (int sh_id, char *sets, int limit);
+	extern char *sharded_subsets_batch (int sh_id, char *sets, int limit);
+	extern char *sharded_find_batch (int sh_id, char *sets);
+	extern int sharded_count_supersets (int sh_id, char *set);
+	extern int sharded_count_subsets (int sh_id, char *set);
+	extern int sharded_elements (int sh_id, int set_id);
+	extern int sharded_next_set_id (int sh_id, int set_id);
+	extern int sharded_num_sets (int sh_id);
+	extern int sharded_num_shards (int sh_id);
+	extern char *sharded_set_name (int sh_id, int set_id);
+	extern int sharded_remove (int sh_id, int set_id);
+	extern int sharded_find_by_id (int sh_id, char *str_id);
+	extern int sharded_remove_by_id (int sh_id, char *str_id);
+	extern int sharded_purge (int sh_id, int dry_run);
+	extern int sharded_set_element_order (int sh_id, int order);
+	extern int sharded_set_signatures (int sh_id, int enable);
+	extern int sharded_set_query_threads (int sh_id, int num_threads);
+	extern int sharded_save_as_binary_image (int sh_id);
+	extern bool sharded_push_binary_image_block (int sh_id, char *p_block);
 	extern void cleanup_globals();
 
 
@@ -3593,6 +3642,81 @@ fail:
 }
 
 
+SWIGINTERN PyObject *_wrap_stage_insert(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  char *arg3 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int res3 ;
+  char *buf3 = 0 ;
+  int alloc3 = 0 ;
+  PyObject *swig_obj[3] ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "stage_insert", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "stage_insert" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "stage_insert" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  res3 = SWIG_AsCharPtrAndSize(swig_obj[2], &buf3, NULL, &alloc3);
+  if (!SWIG_IsOK(res3)) {
+    SWIG_exception_fail(SWIG_ArgError(res3), "in method '" "stage_insert" "', argument " "3"" of type '" "char *""'");
+  }
+  arg3 = (char *)(buf3);
+  stage_insert(arg1,arg2,arg3);
+  resultobj = SWIG_Py_Void();
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  if (alloc3 == SWIG_NEWOBJ) free((char*)buf3);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  if (alloc3 == SWIG_NEWOBJ) free((char*)buf3);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_insert_staged(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "insert_staged", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "insert_staged" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "insert_staged" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)insert_staged(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
 SWIGINTERN PyObject *_wrap_find(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
@@ -3606,18 +3730,1606 @@ SWIGINTERN PyObject *_wrap_find(PyObject *self, PyObject *args) {
   char *result = 0 ;
 
   (void)self;
-  if (!SWIG_Python_UnpackTuple(args, "find", 2, 2, swig_obj)) SWIG_fail;
+  if (!SWIG_Python_UnpackTuple(args, "find", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "find" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "find" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (char *)find(arg1,arg2);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_supersets(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "supersets", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "supersets" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "supersets" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "supersets" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (int)supersets(arg1,arg2,arg3);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_subsets(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "subsets", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "subsets" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "subsets" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "subsets" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (int)subsets(arg1,arg2,arg3);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_find_idx(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "find_idx", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "find_idx" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "find_idx" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)find_idx(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_supersets_idx(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "supersets_idx", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "supersets_idx" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "supersets_idx" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "supersets_idx" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (char *)supersets_idx(arg1,arg2,arg3);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_subsets_idx(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "subsets_idx", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "subsets_idx" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "subsets_idx" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "subsets_idx" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (char *)subsets_idx(arg1,arg2,arg3);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_supersets_batch(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int arg4 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  int val4 ;
+  int ecode4 = 0 ;
+  PyObject *swig_obj[4] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "supersets_batch", 4, 4, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "supersets_batch" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "supersets_batch" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "supersets_batch" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  ecode4 = SWIG_AsVal_int(swig_obj[3], &val4);
+  if (!SWIG_IsOK(ecode4)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode4), "in method '" "supersets_batch" "', argument " "4"" of type '" "int""'");
+  }
+  arg4 = (int)(val4);
+  result = (char *)supersets_batch(arg1,arg2,arg3,arg4);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_subsets_batch(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int arg4 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  int val4 ;
+  int ecode4 = 0 ;
+  PyObject *swig_obj[4] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "subsets_batch", 4, 4, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "subsets_batch" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "subsets_batch" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "subsets_batch" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  ecode4 = SWIG_AsVal_int(swig_obj[3], &val4);
+  if (!SWIG_IsOK(ecode4)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode4), "in method '" "subsets_batch" "', argument " "4"" of type '" "int""'");
+  }
+  arg4 = (int)(val4);
+  result = (char *)subsets_batch(arg1,arg2,arg3,arg4);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_find_batch(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "find_batch", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "find_batch" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "find_batch" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "find_batch" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (char *)find_batch(arg1,arg2,arg3);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_count_supersets(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "count_supersets", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "count_supersets" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "count_supersets" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)count_supersets(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_count_subsets(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "count_subsets", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "count_subsets" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "count_subsets" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)count_subsets(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_supersets_cursor(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "supersets_cursor", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "supersets_cursor" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "supersets_cursor" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)supersets_cursor(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_subsets_cursor(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "subsets_cursor", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "subsets_cursor" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "subsets_cursor" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)subsets_cursor(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_cursor_next(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+  int result;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "cursor_next" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  result = (int)cursor_next(arg1);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_destroy_cursor(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "destroy_cursor" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  destroy_cursor(arg1);
+  resultobj = SWIG_Py_Void();
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_elements(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "elements", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "elements" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "elements" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)elements(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_next_set_id(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "next_set_id", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "next_set_id" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "next_set_id" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)next_set_id(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_num_sets(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+  int result;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "num_sets" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  result = (int)num_sets(arg1);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_set_name(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "set_name", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "set_name" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "set_name" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (char *)set_name(arg1,arg2);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_remove(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "remove", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "remove" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "remove" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)remove(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_find_by_id(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "find_by_id", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "find_by_id" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "find_by_id" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)find_by_id(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_remove_by_id(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "remove_by_id", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "remove_by_id" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "remove_by_id" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)remove_by_id(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_purge(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "purge", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "purge" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "purge" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)purge(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_set_element_order(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "set_element_order", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "set_element_order" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "set_element_order" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)set_element_order(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_set_signatures(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "set_signatures", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "set_signatures" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "set_signatures" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)set_signatures(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_set_query_threads(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "set_query_threads", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "set_query_threads" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "set_query_threads" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)set_query_threads(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_iterator_size(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+  int result;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "iterator_size" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  result = (int)iterator_size(arg1);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_iterator_next(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "iterator_next" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  result = (char *)iterator_next(arg1);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_destroy_iterator(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "destroy_iterator" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  destroy_iterator(arg1);
+  resultobj = SWIG_Py_Void();
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_save_as_binary_image(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+  int result;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "save_as_binary_image" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  result = (int)save_as_binary_image(arg1);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_push_binary_image_block(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  bool result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "push_binary_image_block", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "push_binary_image_block" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "push_binary_image_block" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (bool)push_binary_image_block(arg1,arg2);
+  resultobj = SWIG_From_bool((bool)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_binary_image_size(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+  int result;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "binary_image_size" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  result = (int)binary_image_size(arg1);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_binary_image_next(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "binary_image_next" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  result = (char *)binary_image_next(arg1);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_destroy_binary_image(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "destroy_binary_image" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  destroy_binary_image(arg1);
+  resultobj = SWIG_Py_Void();
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_new_sharded_settrie(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int arg2 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "new_sharded_settrie", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "new_sharded_settrie" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "new_sharded_settrie" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)new_sharded_settrie(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_destroy_sharded_settrie(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "destroy_sharded_settrie" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  destroy_sharded_settrie(arg1);
+  resultobj = SWIG_Py_Void();
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_insert(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  char *arg3 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int res3 ;
+  char *buf3 = 0 ;
+  int alloc3 = 0 ;
+  PyObject *swig_obj[3] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_insert", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_insert" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_insert" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  res3 = SWIG_AsCharPtrAndSize(swig_obj[2], &buf3, NULL, &alloc3);
+  if (!SWIG_IsOK(res3)) {
+    SWIG_exception_fail(SWIG_ArgError(res3), "in method '" "sharded_insert" "', argument " "3"" of type '" "char *""'");
+  }
+  arg3 = (char *)(buf3);
+  result = (int)sharded_insert(arg1,arg2,arg3);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  if (alloc3 == SWIG_NEWOBJ) free((char*)buf3);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  if (alloc3 == SWIG_NEWOBJ) free((char*)buf3);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_stage_insert(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  char *arg3 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int res3 ;
+  char *buf3 = 0 ;
+  int alloc3 = 0 ;
+  PyObject *swig_obj[3] ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_stage_insert", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_stage_insert" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_stage_insert" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  res3 = SWIG_AsCharPtrAndSize(swig_obj[2], &buf3, NULL, &alloc3);
+  if (!SWIG_IsOK(res3)) {
+    SWIG_exception_fail(SWIG_ArgError(res3), "in method '" "sharded_stage_insert" "', argument " "3"" of type '" "char *""'");
+  }
+  arg3 = (char *)(buf3);
+  sharded_stage_insert(arg1,arg2,arg3);
+  resultobj = SWIG_Py_Void();
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  if (alloc3 == SWIG_NEWOBJ) free((char*)buf3);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  if (alloc3 == SWIG_NEWOBJ) free((char*)buf3);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_insert_staged(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  PyObject *swig_obj[1] ;
+  int result;
+
+  (void)self;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_insert_staged" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  result = (int)sharded_insert_staged(arg1);
+  resultobj = SWIG_From_int((int)(result));
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_find(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_find", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_find" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_find" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (char *)sharded_find(arg1,arg2);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_find_idx(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_find_idx", 2, 2, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_find_idx" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_find_idx" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)sharded_find_idx(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_supersets(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_supersets", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_supersets" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_supersets" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "sharded_supersets" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (int)sharded_supersets(arg1,arg2,arg3);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_subsets(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  int result;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_subsets", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_subsets" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_subsets" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "sharded_subsets" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (int)sharded_subsets(arg1,arg2,arg3);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_supersets_idx(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_supersets_idx", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_supersets_idx" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_supersets_idx" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "sharded_supersets_idx" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (char *)sharded_supersets_idx(arg1,arg2,arg3);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_subsets_idx(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_subsets_idx", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_subsets_idx" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_subsets_idx" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "sharded_subsets_idx" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (char *)sharded_subsets_idx(arg1,arg2,arg3);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_supersets_batch(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_supersets_batch", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_supersets_batch" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_supersets_batch" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "sharded_supersets_batch" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (char *)sharded_supersets_batch(arg1,arg2,arg3);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_subsets_batch(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int arg3 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  PyObject *swig_obj[3] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_subsets_batch", 3, 3, swig_obj)) SWIG_fail;
+  ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+  if (!SWIG_IsOK(ecode1)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_subsets_batch" "', argument " "1"" of type '" "int""'");
+  }
+  arg1 = (int)(val1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_subsets_batch" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "sharded_subsets_batch" "', argument " "3"" of type '" "int""'");
+  }
+  arg3 = (int)(val3);
+  result = (char *)sharded_subsets_batch(arg1,arg2,arg3);
+  resultobj = SWIG_FromCharPtr((const char *)result);
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return resultobj;
+fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_sharded_find_batch(PyObject *self, PyObject *args) {
+  PyObject *resultobj = 0;
+  int arg1 ;
+  char *arg2 = (char *) 0 ;
+  int val1 ;
+  int ecode1 = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  char *result = 0 ;
+
+  (void)self;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_find_batch", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "find" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_find_batch" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
   res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
   if (!SWIG_IsOK(res2)) {
-    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "find" "', argument " "2"" of type '" "char *""'");
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_find_batch" "', argument " "2"" of type '" "char *""'");
   }
   arg2 = (char *)(buf2);
-  result = (char *)find(arg1,arg2);
+  result = (char *)sharded_find_batch(arg1,arg2);
   resultobj = SWIG_FromCharPtr((const char *)result);
   if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return resultobj;
@@ -3627,7 +5339,7 @@ fail:
 }
 
 
-SWIGINTERN PyObject *_wrap_supersets(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_count_supersets(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
   char *arg2 = (char *) 0 ;
@@ -3640,18 +5352,18 @@ SWIGINTERN PyObject *_wrap_supersets(PyObject *self, PyObject *args) {
   int result;
 
   (void)self;
-  if (!SWIG_Python_UnpackTuple(args, "supersets", 2, 2, swig_obj)) SWIG_fail;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_count_supersets", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "supersets" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_count_supersets" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
   res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
   if (!SWIG_IsOK(res2)) {
-    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "supersets" "', argument " "2"" of type '" "char *""'");
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_count_supersets" "', argument " "2"" of type '" "char *""'");
   }
   arg2 = (char *)(buf2);
-  result = (int)supersets(arg1,arg2);
+  result = (int)sharded_count_supersets(arg1,arg2);
   resultobj = SWIG_From_int((int)(result));
   if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return resultobj;
@@ -3661,7 +5373,7 @@ fail:
 }
 
 
-SWIGINTERN PyObject *_wrap_subsets(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_count_subsets(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
   char *arg2 = (char *) 0 ;
@@ -3674,18 +5386,18 @@ SWIGINTERN PyObject *_wrap_subsets(PyObject *self, PyObject *args) {
   int result;
 
   (void)self;
-  if (!SWIG_Python_UnpackTuple(args, "subsets", 2, 2, swig_obj)) SWIG_fail;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_count_subsets", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "subsets" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_count_subsets" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
   res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
   if (!SWIG_IsOK(res2)) {
-    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "subsets" "', argument " "2"" of type '" "char *""'");
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_count_subsets" "', argument " "2"" of type '" "char *""'");
   }
   arg2 = (char *)(buf2);
-  result = (int)subsets(arg1,arg2);
+  result = (int)sharded_count_subsets(arg1,arg2);
   resultobj = SWIG_From_int((int)(result));
   if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return resultobj;
@@ -3695,7 +5407,7 @@ fail:
 }
 
 
-SWIGINTERN PyObject *_wrap_elements(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_elements(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
   int arg2 ;
@@ -3707,18 +5419,18 @@ SWIGINTERN PyObject *_wrap_elements(PyObject *self, PyObject *args) {
   int result;
 
   (void)self;
-  if (!SWIG_Python_UnpackTuple(args, "elements", 2, 2, swig_obj)) SWIG_fail;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_elements", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "elements" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_elements" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
   ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
   if (!SWIG_IsOK(ecode2)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "elements" "', argument " "2"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "sharded_elements" "', argument " "2"" of type '" "int""'");
   }
   arg2 = (int)(val2);
-  result = (int)elements(arg1,arg2);
+  result = (int)sharded_elements(arg1,arg2);
   resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
@@ -3726,7 +5438,7 @@ fail:
 }
 
 
-SWIGINTERN PyObject *_wrap_next_set_id(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_next_set_id(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
   int arg2 ;
@@ -3738,18 +5450,18 @@ SWIGINTERN PyObject *_wrap_next_set_id(PyObject *self, PyObject *args) {
   int result;
 
   (void)self;
-  if (!SWIG_Python_UnpackTuple(args, "next_set_id", 2, 2, swig_obj)) SWIG_fail;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_next_set_id", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "next_set_id" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_next_set_id" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
   ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
   if (!SWIG_IsOK(ecode2)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "next_set_id" "', argument " "2"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "sharded_next_set_id" "', argument " "2"" of type '" "int""'");
   }
   arg2 = (int)(val2);
-  result = (int)next_set_id(arg1,arg2);
+  result = (int)sharded_next_set_id(arg1,arg2);
   resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
@@ -3757,7 +5469,7 @@ fail:
 }
 
 
-SWIGINTERN PyObject *_wrap_num_sets(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_num_sets(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
   int val1 ;
@@ -3770,10 +5482,10 @@ SWIGINTERN PyObject *_wrap_num_sets(PyObject *self, PyObject *args) {
   swig_obj[0] = args;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "num_sets" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_num_sets" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  result = (int)num_sets(arg1);
+  result = (int)sharded_num_sets(arg1);
   resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
@@ -3781,38 +5493,31 @@ fail:
 }
 
 
-SWIGINTERN PyObject *_wrap_set_name(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_num_shards(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
-  int arg2 ;
   int val1 ;
   int ecode1 = 0 ;
-  int val2 ;
-  int ecode2 = 0 ;
-  PyObject *swig_obj[2] ;
-  char *result = 0 ;
+  PyObject *swig_obj[1] ;
+  int result;
 
   (void)self;
-  if (!SWIG_Python_UnpackTuple(args, "set_name", 2, 2, swig_obj)) SWIG_fail;
+  if (!args) SWIG_fail;
+  swig_obj[0] = args;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "set_name" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_num_shards" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
-  if (!SWIG_IsOK(ecode2)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "set_name" "', argument " "2"" of type '" "int""'");
-  }
-  arg2 = (int)(val2);
-  result = (char *)set_name(arg1,arg2);
-  resultobj = SWIG_FromCharPtr((const char *)result);
+  result = (int)sharded_num_shards(arg1);
+  resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
   return NULL;
 }
 
 
-SWIGINTERN PyObject *_wrap_remove(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_set_name(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
   int arg2 ;
@@ -3821,29 +5526,29 @@ SWIGINTERN PyObject *_wrap_remove(PyObject *self, PyObject *args) {
   int val2 ;
   int ecode2 = 0 ;
   PyObject *swig_obj[2] ;
-  int result;
+  char *result = 0 ;
 
   (void)self;
-  if (!SWIG_Python_UnpackTuple(args, "remove", 2, 2, swig_obj)) SWIG_fail;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_set_name", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "remove" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_set_name" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
   ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
   if (!SWIG_IsOK(ecode2)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "remove" "', argument " "2"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "sharded_set_name" "', argument " "2"" of type '" "int""'");
   }
   arg2 = (int)(val2);
-  result = (int)remove(arg1,arg2);
-  resultobj = SWIG_From_int((int)(result));
+  result = (char *)sharded_set_name(arg1,arg2);
+  resultobj = SWIG_FromCharPtr((const char *)result);
   return resultobj;
 fail:
   return NULL;
 }
 
 
-SWIGINTERN PyObject *_wrap_purge(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_remove(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
   int arg2 ;
@@ -3855,18 +5560,18 @@ SWIGINTERN PyObject *_wrap_purge(PyObject *self, PyObject *args) {
   int result;
 
   (void)self;
-  if (!SWIG_Python_UnpackTuple(args, "purge", 2, 2, swig_obj)) SWIG_fail;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_remove", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "purge" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_remove" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
   ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
   if (!SWIG_IsOK(ecode2)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "purge" "', argument " "2"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "sharded_remove" "', argument " "2"" of type '" "int""'");
   }
   arg2 = (int)(val2);
-  result = (int)purge(arg1,arg2);
+  result = (int)sharded_remove(arg1,arg2);
   resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
@@ -3874,94 +5579,129 @@ fail:
 }
 
 
-SWIGINTERN PyObject *_wrap_iterator_size(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_find_by_id(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
+  char *arg2 = (char *) 0 ;
   int val1 ;
   int ecode1 = 0 ;
-  PyObject *swig_obj[1] ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
   int result;
 
   (void)self;
-  if (!args) SWIG_fail;
-  swig_obj[0] = args;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_find_by_id", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "iterator_size" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_find_by_id" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  result = (int)iterator_size(arg1);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_find_by_id" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)sharded_find_by_id(arg1,arg2);
   resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return resultobj;
 fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return NULL;
 }
 
 
-SWIGINTERN PyObject *_wrap_iterator_next(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_remove_by_id(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
+  char *arg2 = (char *) 0 ;
   int val1 ;
   int ecode1 = 0 ;
-  PyObject *swig_obj[1] ;
-  char *result = 0 ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
 
   (void)self;
-  if (!args) SWIG_fail;
-  swig_obj[0] = args;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_remove_by_id", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "iterator_next" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_remove_by_id" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  result = (char *)iterator_next(arg1);
-  resultobj = SWIG_FromCharPtr((const char *)result);
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_remove_by_id" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (int)sharded_remove_by_id(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return resultobj;
 fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return NULL;
 }
 
 
-SWIGINTERN PyObject *_wrap_destroy_iterator(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_purge(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
+  int arg2 ;
   int val1 ;
   int ecode1 = 0 ;
-  PyObject *swig_obj[1] ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
+  int result;
 
   (void)self;
-  if (!args) SWIG_fail;
-  swig_obj[0] = args;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_purge", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "destroy_iterator" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_purge" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  destroy_iterator(arg1);
-  resultobj = SWIG_Py_Void();
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "sharded_purge" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)sharded_purge(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
   return NULL;
 }
 
 
-SWIGINTERN PyObject *_wrap_save_as_binary_image(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_set_element_order(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
+  int arg2 ;
   int val1 ;
   int ecode1 = 0 ;
-  PyObject *swig_obj[1] ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
   int result;
 
   (void)self;
-  if (!args) SWIG_fail;
-  swig_obj[0] = args;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_set_element_order", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "save_as_binary_image" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_set_element_order" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  result = (int)save_as_binary_image(arg1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "sharded_set_element_order" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)sharded_set_element_order(arg1,arg2);
   resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
@@ -3969,57 +5709,61 @@ fail:
 }
 
 
-SWIGINTERN PyObject *_wrap_push_binary_image_block(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_set_signatures(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
-  char *arg2 = (char *) 0 ;
+  int arg2 ;
   int val1 ;
   int ecode1 = 0 ;
-  int res2 ;
-  char *buf2 = 0 ;
-  int alloc2 = 0 ;
+  int val2 ;
+  int ecode2 = 0 ;
   PyObject *swig_obj[2] ;
-  bool result;
+  int result;
 
   (void)self;
-  if (!SWIG_Python_UnpackTuple(args, "push_binary_image_block", 2, 2, swig_obj)) SWIG_fail;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_set_signatures", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "push_binary_image_block" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_set_signatures" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
-  if (!SWIG_IsOK(res2)) {
-    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "push_binary_image_block" "', argument " "2"" of type '" "char *""'");
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "sharded_set_signatures" "', argument " "2"" of type '" "int""'");
   }
-  arg2 = (char *)(buf2);
-  result = (bool)push_binary_image_block(arg1,arg2);
-  resultobj = SWIG_From_bool((bool)(result));
-  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
+  arg2 = (int)(val2);
+  result = (int)sharded_set_signatures(arg1,arg2);
+  resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
-  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return NULL;
 }
 
 
-SWIGINTERN PyObject *_wrap_binary_image_size(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_set_query_threads(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
+  int arg2 ;
   int val1 ;
   int ecode1 = 0 ;
-  PyObject *swig_obj[1] ;
+  int val2 ;
+  int ecode2 = 0 ;
+  PyObject *swig_obj[2] ;
   int result;
 
   (void)self;
-  if (!args) SWIG_fail;
-  swig_obj[0] = args;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_set_query_threads", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "binary_image_size" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_set_query_threads" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  result = (int)binary_image_size(arg1);
+  ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+  if (!SWIG_IsOK(ecode2)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "sharded_set_query_threads" "', argument " "2"" of type '" "int""'");
+  }
+  arg2 = (int)(val2);
+  result = (int)sharded_set_query_threads(arg1,arg2);
   resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
@@ -4027,49 +5771,60 @@ fail:
 }
 
 
-SWIGINTERN PyObject *_wrap_binary_image_next(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_save_as_binary_image(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
   int val1 ;
   int ecode1 = 0 ;
   PyObject *swig_obj[1] ;
-  char *result = 0 ;
+  int result;
 
   (void)self;
   if (!args) SWIG_fail;
   swig_obj[0] = args;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "binary_image_next" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_save_as_binary_image" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  result = (char *)binary_image_next(arg1);
-  resultobj = SWIG_FromCharPtr((const char *)result);
+  result = (int)sharded_save_as_binary_image(arg1);
+  resultobj = SWIG_From_int((int)(result));
   return resultobj;
 fail:
   return NULL;
 }
 
 
-SWIGINTERN PyObject *_wrap_destroy_binary_image(PyObject *self, PyObject *args) {
+SWIGINTERN PyObject *_wrap_sharded_push_binary_image_block(PyObject *self, PyObject *args) {
   PyObject *resultobj = 0;
   int arg1 ;
+  char *arg2 = (char *) 0 ;
   int val1 ;
   int ecode1 = 0 ;
-  PyObject *swig_obj[1] ;
+  int res2 ;
+  char *buf2 = 0 ;
+  int alloc2 = 0 ;
+  PyObject *swig_obj[2] ;
+  bool result;
 
   (void)self;
-  if (!args) SWIG_fail;
-  swig_obj[0] = args;
+  if (!SWIG_Python_UnpackTuple(args, "sharded_push_binary_image_block", 2, 2, swig_obj)) SWIG_fail;
   ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
   if (!SWIG_IsOK(ecode1)) {
-    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "destroy_binary_image" "', argument " "1"" of type '" "int""'");
+    SWIG_exception_fail(SWIG_ArgError(ecode1), "in method '" "sharded_push_binary_image_block" "', argument " "1"" of type '" "int""'");
   }
   arg1 = (int)(val1);
-  destroy_binary_image(arg1);
-  resultobj = SWIG_Py_Void();
+  res2 = SWIG_AsCharPtrAndSize(swig_obj[1], &buf2, NULL, &alloc2);
+  if (!SWIG_IsOK(res2)) {
+    SWIG_exception_fail(SWIG_ArgError(res2), "in method '" "sharded_push_binary_image_block" "', argument " "2"" of type '" "char *""'");
+  }
+  arg2 = (char *)(buf2);
+  result = (bool)sharded_push_binary_image_block(arg1,arg2);
+  resultobj = SWIG_From_bool((bool)(result));
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return resultobj;
 fail:
+  if (alloc2 == SWIG_NEWOBJ) free((char*)buf2);
   return NULL;
 }
 
@@ -4091,15 +5846,34 @@ static PyMethodDef SwigMethods[] = {
 	 { "new_settrie", _wrap_new_settrie, METH_NOARGS, NULL},
 	 { "destroy_settrie", _wrap_destroy_settrie, METH_O, NULL},
 	 { "insert", _wrap_insert, METH_VARARGS, NULL},
+	 { "stage_insert", _wrap_stage_insert, METH_VARARGS, NULL},
+	 { "insert_staged", _wrap_insert_staged, METH_VARARGS, NULL},
 	 { "find", _wrap_find, METH_VARARGS, NULL},
 	 { "supersets", _wrap_supersets, METH_VARARGS, NULL},
 	 { "subsets", _wrap_subsets, METH_VARARGS, NULL},
+	 { "find_idx", _wrap_find_idx, METH_VARARGS, NULL},
+	 { "supersets_idx", _wrap_supersets_idx, METH_VARARGS, NULL},
+	 { "subsets_idx", _wrap_subsets_idx, METH_VARARGS, NULL},
+	 { "supersets_batch", _wrap_supersets_batch, METH_VARARGS, NULL},
+	 { "subsets_batch", _wrap_subsets_batch, METH_VARARGS, NULL},
+	 { "find_batch", _wrap_find_batch, METH_VARARGS, NULL},
+	 { "count_supersets", _wrap_count_supersets, METH_VARARGS, NULL},
+	 { "count_subsets", _wrap_count_subsets, METH_VARARGS, NULL},
+	 { "supersets_cursor", _wrap_supersets_cursor, METH_VARARGS, NULL},
+	 { "subsets_cursor", _wrap_subsets_cursor, METH_VARARGS, NULL},
+	 { "cursor_next", _wrap_cursor_next, METH_O, NULL},
+	 { "destroy_cursor", _wrap_destroy_cursor, METH_O, NULL},
 	 { "elements", _wrap_elements, METH_VARARGS, NULL},
 	 { "next_set_id", _wrap_next_set_id, METH_VARARGS, NULL},
 	 { "num_sets", _wrap_num_sets, METH_O, NULL},
 	 { "set_name", _wrap_set_name, METH_VARARGS, NULL},
 	 { "remove", _wrap_remove, METH_VARARGS, NULL},
+	 { "find_by_id", _wrap_find_by_id, METH_VARARGS, NULL},
+	 { "remove_by_id", _wrap_remove_by_id, METH_VARARGS, NULL},
 	 { "purge", _wrap_purge, METH_VARARGS, NULL},
+	 { "set_element_order", _wrap_set_element_order, METH_VARARGS, NULL},
+	 { "set_signatures", _wrap_set_signatures, METH_VARARGS, NULL},
+	 { "set_query_threads", _wrap_set_query_threads, METH_VARARGS, NULL},
 	 { "iterator_size", _wrap_iterator_size, METH_O, NULL},
 	 { "iterator_next", _wrap_iterator_next, METH_O, NULL},
 	 { "destroy_iterator", _wrap_destroy_iterator, METH_O, NULL},
@@ -4108,6 +5882,36 @@ static PyMethodDef SwigMethods[] = {
 	 { "binary_image_size", _wrap_binary_image_size, METH_O, NULL},
 	 { "binary_image_next", _wrap_binary_image_next, METH_O, NULL},
 	 { "destroy_binary_image", _wrap_destroy_binary_image, METH_O, NULL},
+	 { "new_sharded_settrie", _wrap_new_sharded_settrie, METH_VARARGS, NULL},
+	 { "destroy_sharded_settrie", _wrap_destroy_sharded_settrie, METH_O, NULL},
+	 { "sharded_insert", _wrap_sharded_insert, METH_VARARGS, NULL},
+	 { "sharded_stage_insert", _wrap_sharded_stage_insert, METH_VARARGS, NULL},
+	 { "sharded_insert_staged", _wrap_sharded_insert_staged, METH_O, NULL},
+	 { "sharded_find", _wrap_sharded_find, METH_VARARGS, NULL},
+	 { "sharded_find_idx", _wrap_sharded_find_idx, METH_VARARGS, NULL},
+	 { "sharded_supersets", _wrap_sharded_supersets, METH_VARARGS, NULL},
+	 { "sharded_subsets", _wrap_sharded_subsets, METH_VARARGS, NULL},
+	 { "sharded_supersets_idx", _wrap_sharded_supersets_idx, METH_VARARGS, NULL},
+	 { "sharded_subsets_idx", _wrap_sharded_subsets_idx, METH_VARARGS, NULL},
+	 { "sharded_supersets_batch", _wrap_sharded_supersets_batch, METH_VARARGS, NULL},
+	 { "sharded_subsets_batch", _wrap_sharded_subsets_batch, METH_VARARGS, NULL},
+	 { "sharded_find_batch", _wrap_sharded_find_batch, METH_VARARGS, NULL},
+	 { "sharded_count_supersets", _wrap_sharded_count_supersets, METH_VARARGS, NULL},
+	 { "sharded_count_subsets", _wrap_sharded_count_subsets, METH_VARARGS, NULL},
+	 { "sharded_elements", _wrap_sharded_elements, METH_VARARGS, NULL},
+	 { "sharded_next_set_id", _wrap_sharded_next_set_id, METH_VARARGS, NULL},
+	 { "sharded_num_sets", _wrap_sharded_num_sets, METH_O, NULL},
+	 { "sharded_num_shards", _wrap_sharded_num_shards, METH_O, NULL},
+	 { "sharded_set_name", _wrap_sharded_set_name, METH_VARARGS, NULL},
+	 { "sharded_remove", _wrap_sharded_remove, METH_VARARGS, NULL},
+	 { "sharded_find_by_id", _wrap_sharded_find_by_id, METH_VARARGS, NULL},
+	 { "sharded_remove_by_id", _wrap_sharded_remove_by_id, METH_VARARGS, NULL},
+	 { "sharded_purge", _wrap_sharded_purge, METH_VARARGS, NULL},
+	 { "sharded_set_element_order", _wrap_sharded_set_element_order, METH_VARARGS, NULL},
+	 { "sharded_set_signatures", _wrap_sharded_set_signatures, METH_VARARGS, NULL},
+	 { "sharded_set_query_threads", _wrap_sharded_set_query_threads, METH_VARARGS, NULL},
+	 { "sharded_save_as_binary_image", _wrap_sharded_save_as_binary_image, METH_O, NULL},
+	 { "sharded_push_binary_image_block", _wrap_sharded_push_binary_image_block, METH_VARARGS, NULL},
 	 { "cleanup_globals", _wrap_cleanup_globals, METH_NOARGS, NULL},
 	 { NULL, NULL, 0, NULL }
 };
@@ -22,6 +22,10 @@
 #include <fstream>
 #include <sstream>
 #include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 
 #include "settrie.h"
@@ -136,6 +140,17 @@ inline bool image_put(pBinaryImage p_bi, void *p_data, int size) {
 }
 
 
+/** The node record of the images saved up to version 1.5.1, before the parent and the state were moved out of SetNode.
+*/
+struct LegacySetNode {
+	ElementHash value;
+
+	int idx_next, idx_child, idx_parent;
+
+	uint8_t state;
+};
+
+
 inline bool image_get(pBinaryImage p_bi, int &c_block, int &c_ofs, void *p_data, int size) {
 
 	while (size > 0) {
@@ -166,2854 +181,9216 @@ inline bool image_get(pBinaryImage p_bi, int &c_block, int &c_ofs, void *p_data,
 	return size == 0;
 }
 
-// -----------------------------------------------------------------------------------------------------------------------------------------
-//	SetTrie Implementation
-// -----------------------------------------------------------------------------------------------------------------------------------------
-
-void SetTrie::insert (StringSet set, String str_id) {
 
-	BinarySet b_set = {};
+/** Writes the text of many strings as a single block preceded by its size. The lengths of the strings are written apart.
+*/
+inline void image_put_text(pBinaryImage p_bi, std::vector<char> &text) {
 
-	int size = set.size();
+	int len = text.size();
 
-	if (size == 0) {
-		String empty = {""};
-		assign_hh_nam(0, empty);
+	image_put(p_bi, &len, sizeof(len));
+	image_put(p_bi, text.data(), len);
+}
 
-		id[insert(b_set)] = str_id;
 
-		return;
-	}
+/** Reads a block written by image_put_text(), checking that its size is the sum of the lengths of the strings.
+*/
+inline bool image_get_text(pBinaryImage p_bi, int &c_block, int &c_ofs, IdList &lengths, std::vector<char> &text) {
 
-	for (int i = 0; i < size; i++) {
-		ElementHash hh = MurmurHash64A(set[i].c_str(), set[i].length());
+	int64_t total = 0;
 
-		assign_hh_nam(hh, set[i]);
+	for (int i = 0; i < lengths.size(); i++) {
+		if (lengths[i] < 0)
+			return false;
 
-		b_set.push_back(hh);
+		total += lengths[i];
 	}
-	std::sort(b_set.begin(), b_set.end());
-
-	b_set.erase(unique(b_set.begin(), b_set.end()), b_set.end());
-
-	id[insert(b_set)] = str_id;
-}
 
+	int len;
 
-void SetTrie::insert (String str, String str_id, char split) {
-	StringSet set;
-	std::stringstream ss(str);
+	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len != total)
+		return false;
 
-	String elem;
-	while (std::getline(ss, elem, split))
-		set.push_back(elem);
+	text.resize(len);
 
-	insert(set, str_id);
+	return image_get(p_bi, c_block, c_ofs, text.data(), len);
 }
 
+/** Calls fun(lo, hi) for consecutive ranges of at most block items covering [0, size) on num_threads threads. Each thread takes the
+	next range until there are none left. A single thread makes one call for the whole range on the calling thread.
+*/
+void parallel_for(int num_threads, int size, int block, const std::function<void(int, int)> &fun) {
 
-String SetTrie::find (StringSet set) {
-	if (set.size() == 0) {
-		IdMap::iterator it;
-		if ((it = id.find(0)) != id.end())
-			return it->second;
+	if (num_threads <= 1) {
+		if (size > 0)
+			fun(0, size);
 
-		return "";
+		return;
 	}
 
-	BinarySet b_set = {};
-	int size = set.size();
+	std::atomic<int> next(0);
 
-	for (int i = 0; i < size; i++) {
-		ElementHash hh = MurmurHash64A(set[i].c_str(), set[i].length());
+	std::vector<std::thread> pool = {};
 
-		if (hh_nam.find(hh) == hh_nam.end())
-			return "";
+	for (int t = 0; t < num_threads; t++)
+		pool.push_back(std::thread([&]() {
+			for (int lo = next.fetch_add(block); lo < size; lo = next.fetch_add(block))
+				fun(lo, std::min(lo + block, size));
+		}));
 
-		b_set.push_back(hh);
-	}
-	std::sort(b_set.begin(), b_set.end());
+	for (int t = 0; t < num_threads; t++)
+		pool[t].join();
+}
 
-	b_set.erase(unique(b_set.begin(), b_set.end()), b_set.end());
+// -----------------------------------------------------------------------------------------------------------------------------------------
+//	SetTrie Implementation
+// -----------------------------------------------------------------------------------------------------------------------------------------
 
-	int idx = find(b_set);
+void SetTrie::insert (StringSet set, String str_id) {
 
-	if (idx == 0 || tree[idx].state != STATE_HAS_SET_ID)
-		return "";
+	RWGuard guard(rw_lock, true);
 
-	return id[idx];
-}
+	num_changes++;
 
+	id.set(insert(assign_set(set)), str_id);
+}
 
-String SetTrie::find (String str, char split) {
-	StringSet set;
-	std::stringstream ss(str);
 
-	String elem;
-	while (std::getline(ss, elem, split))
-		set.push_back(elem);
+/** Inserts a batch of sets, the same as calling insert() for each one in order (a set repeated in the batch keeps its last id).
 
-	return find(set);
-}
+	\param sets		The sets.
+	\param str_ids		The id of each set.
+	\param num_threads The number of threads hashing the elements, sorting the sets and building the tree.
 
+An empty SetTrie is built in a single pass by build() or, with more than one thread, by build_parallel(). Otherwise the sets are
+inserted in lexicographic order. The elements are always registered in the order of the batch, so the result does not depend on the
+number of threads.
+*/
+void SetTrie::insert_many (std::vector<StringSet> &sets, StringSet &str_ids, int num_threads) {
 
-StringSet SetTrie::supersets (StringSet set) {
+	RWGuard guard(rw_lock, true);
 
-	StringSet ret = {};
+	num_changes++;
 
-	int size = set.size();
+	int size = std::min(sets.size(), str_ids.size());
 
-	if (size == 0) {
-		// FIX (2024/02/28): All sets are the supersets of the empty set.
-		for (IdMap::iterator it = id.begin(); it != id.end(); ++it)
-			ret.push_back(it->second);
+	std::vector<BinarySet> b_sets(size);
 
-		return ret;
-	}
+	if (num_threads <= 1) {
+		for (int i = 0; i < size; i++)
+			b_sets[i] = assign_set(sets[i]);
+	} else {
+		std::vector<std::vector<ElementHash>> hashes(size);
 
-	query.clear();
+		parallel_for(num_threads, size, 4096, [&](int lo, int hi) {
+			for (int i = lo; i < hi; i++)
+				hash_set(sets[i], hashes[i]);
+		});
 
-	for (int i = 0; i < size; i++) {
-		ElementHash hh = MurmurHash64A(set[i].c_str(), set[i].length());
+		for (int i = 0; i < size; i++) {
+			b_sets[i] = assign_set(sets[i], hashes[i]);
 
-		if (hh_nam.find(hh) == hh_nam.end())
-			return ret;
+			std::vector<ElementHash>().swap(hashes[i]);
+		}
 
-		query.push_back(hh);
+		parallel_for(num_threads, size, 4096, [&](int lo, int hi) {
+			for (int i = lo; i < hi; i++)
+				sort_set(b_sets[i]);
+		});
 	}
-	std::sort(query.begin(), query.end());
-
-	query.erase(unique(query.begin(), query.end()), query.end());
-
-	last_query_idx = query.size() - 1;
 
-	result.clear();
+	if (tree.size() == 1 && state[0] != STATE_HAS_SET_ID) {
+		if (num_threads > 1)
+			build_parallel(b_sets, str_ids, num_threads);
+		else {
+			IdList order(size);
 
-	supersets(tree[0].idx_child, 0);
+			for (int i = 0; i < size; i++)
+				order[i] = i;
 
-	size = result.size();
-	for (int i = 0; i < size; i++)
-		ret.push_back(id[result[i]]);
+			build(b_sets, str_ids, order);
+		}
 
-	return ret;
-}
+		return;
+	}
 
+	IdList order(size);
 
-StringSet SetTrie::supersets (String str, char split) {
-	StringSet set;
-	std::stringstream ss(str);
+	for (int i = 0; i < size; i++)
+		order[i] = i;
 
-	String elem;
-	while (std::getline(ss, elem, split))
-		set.push_back(elem);
+	std::stable_sort(order.begin(), order.end(), [&b_sets](int a, int b) { return b_sets[a] < b_sets[b]; });
 
-	return supersets(set);
+	for (int i = 0; i < size; i++)
+		id.set(insert(b_sets[order[i]]), str_ids[order[i]]);
 }
 
 
-StringSet SetTrie::subsets (StringSet set) {
+/** Builds the tree of an empty SetTrie from a batch of sets whose elements are already registered.
 
-	StringSet ret = {};
+	\param sets	The sets as sorted ElementIds.
+	\param str_ids The id of each set.
+	\param order	The indices of the sets to build, in the order of the batch. It is sorted by the sets.
 
-	IdMap::iterator it;
-	if ((it = id.find(0)) != id.end())
-		ret.push_back(it->second);
+The sets are sorted lexicographically, so the sets below any node are a contiguous range, their common prefix is the common prefix of
+the first and the last one, and a set ending at the node comes first. The nodes are created in preorder, each one with its final run,
+with no search along the sibling chains and no split. The summaries and the signatures are computed at the end.
+*/
+void SetTrie::build (std::vector<BinarySet> &sets, StringSet &str_ids, IdList &order) {
 
-	query.clear();
+	int size = order.size();
 
-	int size = set.size();
+	// Stable, so the last of repeated sets is the last in its range and keeps its id.
+	std::stable_sort(order.begin(), order.end(), [&sets](int a, int b) { return sets[a] < sets[b]; });
 
-	for (int i = 0; i < size; i++) {
-		ElementHash hh = MurmurHash64A(set[i].c_str(), set[i].length());
+	int lo = 0;
 
-		if (hh_nam.find(hh) != hh_nam.end())
-			query.push_back(hh);
-	}
-	if (query.size() == 0)
-		return ret;
+	while (lo < size && sets[order[lo]].empty())
+		lo++;
 
-	std::sort(query.begin(), query.end());
+	if (lo > 0) {
+		state[0] = STATE_HAS_SET_ID;
+		id.set(0, str_ids[order[lo - 1]]);
+	}
 
-	query.erase(unique(query.begin(), query.end()), query.end());
+	// A frame is a range of sets that still need children of the node parent, after the sibling prev. They share their first
+	// depth values.
+	struct BuildFrame {
+		int lo, hi, depth, parent, prev;
+	};
 
-	last_query_idx = query.size() - 1;
+	std::vector<BuildFrame> frames = {{lo, size, 0, 0, 0}};
 
-	result.clear();
+	while (!frames.empty()) {
+		BuildFrame fr = frames.back();
 
-	subsets(tree[0].idx_child, 0);
+		frames.pop_back();
 
-	size = result.size();
-	for (int i = 0; i < size; i++)
-		ret.push_back(id[result[i]]);
+		if (fr.lo == fr.hi)
+			continue;
 
-	return ret;
-}
+		BinarySet &first = sets[order[fr.lo]];
+		ElementId  value = first[fr.depth];
 
+		int hi = fr.lo + 1;
 
-StringSet SetTrie::subsets (String str, char split) {
-	StringSet set;
-	std::stringstream ss(str);
+		while (hi < fr.hi && sets[order[hi]][fr.depth] == value)
+			hi++;
 
-	String elem;
-	while (std::getline(ss, elem, split))
-		set.push_back(elem);
+		int idx = new_node(value, 0, fr.parent);
 
-	return subsets(set);
-}
+		if (fr.prev == 0)
+			set_child(fr.parent, idx);
+		else
+			tree[fr.prev].idx_next = idx;
 
+		// The node takes the values shared by all the sets of the range. The first set is the shortest one.
+		BinarySet &last = sets[order[hi - 1]];
 
-StringSet SetTrie::elements	(int idx) {
+		int end = fr.depth + 1;
 
-	StringSet ret = {};
+		while (end < first.size() && end < last.size() && first[end] == last[end])
+			end++;
 
-	if (idx > 0 && idx < tree.size() && tree[idx].state == STATE_HAS_SET_ID) {
-		String elem;
-		while (idx > 0) {
-			ElementHash hh = tree[idx].value;
+		if (end > fr.depth + 1)
+			new_run(idx, first.begin() + fr.depth + 1, first.begin() + end);
 
-			StringName::iterator it = hh_nam.find(hh);
+		int lo = fr.lo;
 
-			if (it != hh_nam.end())
-				ret.push_back(it->second.name);
+		while (lo < hi && sets[order[lo]].size() == end)
+			lo++;
 
-			idx = tree[idx].idx_parent;
+		if (lo > fr.lo) {
+			state[idx] = STATE_HAS_SET_ID;
+			id.set(idx, str_ids[order[lo - 1]]);
 		}
+
+		// The siblings of idx are created after all its descendants.
+		frames.push_back({hi, fr.hi, fr.depth, fr.parent, idx});
+		frames.push_back({lo, hi, end, idx, 0});
 	}
 
-	return ret;
-}
+	build_summaries(child(0));
 
+	summary[0].num_sets = id.size();
 
-int SetTrie::remove	(int idx) {
+	if (use_signatures)
+		signature[0] = build_signatures(child(0));
+}
 
-	if (idx < 0 || idx >= tree.size() || tree[idx].state != STATE_HAS_SET_ID)
-		return -2;
 
-	IdMap::iterator it = id.find(idx);
+/** Builds the tree of an empty SetTrie like build(), on many threads.
 
-	if (it == id.end())
-		return -3;
+	\param sets		The sets as sorted ElementIds.
+	\param str_ids		The id of each set.
+	\param num_threads The number of threads.
 
-	id.erase(it);
+The sets are split by their first element in ranges holding about the same number of sets. Each range is a sequence of children of the
+root, built by its own thread into a SetTrie of its own. The parts are then appended in order, adding the offset of each part to its
+node and run indices, so the nodes are numbered exactly as build() would.
+*/
+void SetTrie::build_parallel (std::vector<BinarySet> &sets, StringSet &str_ids, int num_threads) {
 
-	if (idx == 0) {
-		tree[idx].state = STATE_IN_USE;
-		StringName::iterator it = hh_nam.begin();
-		if (it != hh_nam.end() && it->first == tree[0].value)
-			hh_nam.erase(it);
+	int size = std::min(sets.size(), str_ids.size()), num_elements = names.size();
 
-		return 0;
+	IdList count(num_elements, 0), empty = {};
+
+	for (int i = 0; i < size; i++) {
+		if (sets[i].empty())
+			empty.push_back(i);
+		else
+			count[sets[i][0]]++;
 	}
 
-	int i = idx;
-	while (i > 0) {
-		ElementHash hh = tree[i].value;
+	int num_parts = 4*num_threads, target = (size - empty.size())/num_parts + 1;
 
-		StringName::iterator it = hh_nam.find(hh);
+	IdList part_of(num_elements, 0);
 
-		if (it != hh_nam.end())
-			if (--it->second.count == 0)
-				hh_nam.erase(it);
+	for (int e = 0, p = 0, acc = 0; e < num_elements; e++) {
+		part_of[e] = p;
+		acc		  += count[e];
 
-		i = tree[i].idx_parent;
+		if (acc >= target*(p + 1) && p < num_parts - 1)
+			p++;
 	}
 
-	if (tree[idx].idx_child != 0)
-		tree[idx].state = STATE_IN_USE;
-	else {
-		int stop = false;
+	std::vector<IdList> orders(num_parts);
 
-		while (!stop) {
-			int lx = tree[idx].idx_parent, j;
+	for (int i = 0; i < size; i++)
+		if (!sets[i].empty())
+			orders[part_of[sets[i][0]]].push_back(i);
 
-			if ((j = tree[lx].idx_child) == idx) {
-				j = tree[idx].idx_next;
-				tree[lx].idx_child = j;
-				stop = (j != 0) || (tree[lx].state == STATE_HAS_SET_ID) || (lx == 0);
-			} else {
-				lx = j;
-				while ((j = tree[lx].idx_next) != idx) lx = j;
-				tree[lx].idx_next = tree[idx].idx_next;
-				stop = true;
-			}
+	// The empty sets end at the root, that builds no nodes.
+	build(sets, str_ids, empty);
 
-			tree[idx] = {0xbaadF00DbaadF00D, -1, -1, -1, STATE_IS_GARBAGE};
-			num_dirty_nodes++;
+	std::vector<SetTrie> part(num_parts);
 
-			idx = lx;
+	parallel_for(num_threads, num_parts, 1, [&](int lo, int hi) {
+		for (int k = lo; k < hi; k++) {
+			part[k].set_signatures(use_signatures);
+			part[k].build(sets, str_ids, orders[k]);
 		}
-	}
-
-	return 0;
-}
-
+	});
 
-int SetTrie::purge () {
-
-	if (num_dirty_nodes <= 0)
-		return -1;
+	int last = 0;
 
-	int ni = 0, size = tree.size();
-	std::map<int, int> is = {}, was = {};
+	for (int k = 0; k < num_parts; k++) {
+		SetTrie &pt = part[k];
 
-	for (int i = 0; i < size; i++) {
-		if (tree[i].state != STATE_IS_GARBAGE) {
-			was[ni] = i;
-			is [i]  = ni;
-			ni++;
-		}
-	}
+		int n = pt.tree.size(), off = tree.size() - 1, run_off = runs.size();
 
-	size = was.size();
-	for (int i = 0; i < size; i++) {
-		ni = was[i];
-		if (i != ni)
-			tree[i] = tree[ni];
-		tree[i].idx_child  = is[tree[i].idx_child];
-		tree[i].idx_next   = is[tree[i].idx_next];
-		tree[i].idx_parent = is[tree[i].idx_parent];
-	}
+		if (n == 1)
+			continue;
 
-	IdMap id2 = id;
-	id = {};
-	for (IdMap::iterator it = id2.begin(); it != id2.end(); ++it)
-		id[is[it->first]] = it->second;
+		for (int i = 1; i < n; i++) {
+			SetNode node = pt.tree[i];
 
-	tree.resize(size);
+			if (node.idx_next != 0)
+				node.idx_next += off;
 
-	num_dirty_nodes = 0;
+			if (node.idx_child > 0)
+				node.idx_child += off;
+			else if (node.idx_child < 0)
+				node.idx_child = ~(~node.idx_child + run_off);
 
-	return 0;
-}
+			tree.push_back(node);
+			parent.push_back(pt.parent[i] == 0 ? 0 : pt.parent[i] + off);
+			state.push_back(pt.state[i]);
+			summary.push_back(pt.summary[i]);
 
+			if (use_signatures)
+				signature.push_back(pt.signature[i]);
+		}
 
-bool SetTrie::load (pBinaryImage &p_bi) {
+		for (RunList::iterator it = pt.runs.begin(); it != pt.runs.end(); ++it) {
+			runs.push_back(*it);
 
-	int c_block = 0, c_ofs = 0;
+			if (runs.back().idx_child != 0)
+				runs.back().idx_child += off;
+		}
 
-	String		section = "tree";
-	ElementHash hs;
-	char		buffer[8192];
+		// The first child of the root in this part follows the last one of the previous part.
+		int ci = pt.child(0);
 
-	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
-		return false;
+		if (last == 0)
+			set_child(0, ci + off);
+		else
+			tree[last].idx_next = ci + off;
 
-	if ((hs != MurmurHash64A(section.c_str(), section.length())) || (tree.size() != 1))
-		return false;
+		while (pt.tree[ci].idx_next != 0)
+			ci = pt.tree[ci].idx_next;
 
-	int len;
+		last = ci + off;
 
-	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)))
-		return false;
+		for (IdTable::iterator it = pt.id.begin(); it != pt.id.end(); ++it)
+			id.set(it->first + off, it->second);
 
-	for (int i = 0; i < len; i++) {
-		SetNode sn;
-		if (!image_get(p_bi, c_block, c_ofs, &sn, sizeof(sn)))
-			return false;
+		if (use_signatures)
+			signature[0] |= pt.signature[0];
 
-		if (i == 0)
-			tree[0] = sn;
-		else
-			tree.push_back(sn);
+		pt = SetTrie();
 	}
 
-	section = "name";
+	summary[0].num_sets = id.size();
+}
 
-	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
-		return false;
 
-	if ((hs != MurmurHash64A(section.c_str(), section.length())) || (hh_nam.size() != 0))
-		return false;
+void SetTrie::insert (String str, String str_id, char split) {
+	StringSet set;
+	std::stringstream ss(str);
 
-	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)))
-		return false;
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
 
-	for (int i = 0; i < len; i++) {
-		ElementHash hh;
-		int			ll, count;
+	insert(set, str_id);
+}
 
-		if (!image_get(p_bi, c_block, c_ofs, &hh, sizeof(hh)))
-			return false;
 
-		if (!image_get(p_bi, c_block, c_ofs, &count, sizeof(count)))
-			return false;
+String SetTrie::find (StringSet set) const {
 
-		if (!image_get(p_bi, c_block, c_ofs, &ll, sizeof(ll)))
-			return false;
+	RWGuard guard(rw_lock, false);
 
-		if ((ll < 0) || (ll >= 8192))
-			return false;
+	int idx = find_set(set);
 
-		if (ll == 0) {
-			hh_nam[hh].count = count;
-			hh_nam[hh].name	 = (char *) "";
-		} else {
-			if (!image_get(p_bi, c_block, c_ofs, &buffer, ll))
-				return false;
+	if (idx < 0)
+		return "";
 
-			buffer[ll] = 0;
+	return id[idx];
+}
 
-			hh_nam[hh].count = count;
-			hh_nam[hh].name	 = buffer;
-		}
-	}
 
-	section = "id";
+/** Finds a set by its elements and returns its set_id (the index of its node) instead of its id string.
 
-	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
-		return false;
+	\param set The elements of the set.
 
-	if ((hs != MurmurHash64A(section.c_str(), section.length())) || (id.size() != 0))
-		return false;
+	\return	The set_id or -1 if the set is not in the tree.
+*/
+int SetTrie::find_idx (StringSet set) const {
 
-	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)))
-		return false;
+	RWGuard guard(rw_lock, false);
 
-	for (int i = 0; i < len; i++) {
-		int ii, ll;
+	return find_set(set);
+}
 
-		if (!image_get(p_bi, c_block, c_ofs, &ii, sizeof(ii)))
-			return false;
 
-		if (!image_get(p_bi, c_block, c_ofs, &ll, sizeof(ll)))
-			return false;
+/** Finds a set by its elements without taking the lock, the implementation of find_idx().
+*/
+int SetTrie::find_set (StringSet &set) const {
+	if (set.size() == 0)
+		return state[0] == STATE_HAS_SET_ID ? 0 : -1;
 
-		if ((ll < 0) || (ll >= 8192))
-			return false;
+	BinarySet b_set = {};
+	int size = set.size();
 
-		if (ll == 0)
-			id[ii] = (char *) "";
-		else {
-			if (!image_get(p_bi, c_block, c_ofs, &buffer, ll))
-				return false;
+	for (int i = 0; i < size; i++) {
+		ElementId e = hh_nam.get(MurmurHash64A(set[i].c_str(), set[i].length()));
 
-			buffer[ll] = 0;
+		if (e == ELEMENT_SLOT_EMPTY)
+			return -1;
 
-			id[ii] = buffer;
-		}
+		b_set.push_back(e);
 	}
+	std::sort(b_set.begin(), b_set.end());
 
-	section = "end";
+	b_set.erase(unique(b_set.begin(), b_set.end()), b_set.end());
 
-	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
-		return false;
+	int idx = find(b_set);
 
-	return hs == MurmurHash64A(section.c_str(), section.length());
+	if (idx == 0 || state[idx] != STATE_HAS_SET_ID)
+		return -1;
+
+	return idx;
 }
 
 
-bool SetTrie::save (pBinaryImage &p_bi) {
+int SetTrie::find_idx (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
 
-	String section = "tree";
-	ElementHash hs = MurmurHash64A(section.c_str(), section.length());
-
-	image_put(p_bi, &hs, sizeof(hs));
-
-	int len = tree.size();
-
-	image_put(p_bi, &len, sizeof(len));
-	image_put(p_bi, tree.data(), len*sizeof(SetNode));
-
-	section = "name";
-	hs		= MurmurHash64A(section.c_str(), section.length());
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
 
-	image_put(p_bi, &hs, sizeof(hs));
+	return find_idx(set);
+}
 
-	len = hh_nam.size();
 
-	image_put(p_bi, &len, sizeof(len));
+String SetTrie::find (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
 
-	for (StringName::iterator it = hh_nam.begin(); it != hh_nam.end(); ++it) {
-		ElementHash hh = it->first;
-		image_put(p_bi, &hh, sizeof(hh));
-		image_put(p_bi, &it->second.count, sizeof(int));
-		int ll = it->second.name.length();
-		image_put(p_bi, &ll, sizeof(ll));
-		image_put(p_bi, (void *) it->second.name.c_str(), ll);
-	}
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
 
-	section = "id";
-	hs		= MurmurHash64A(section.c_str(), section.length());
+	return find(set);
+}
 
-	image_put(p_bi, &hs, sizeof(hs));
 
-	len = id.size();
+/** Translates the elements of a query into the sorted list of their ids in QueryContext::query.
 
-	image_put(p_bi, &len, sizeof(len));
+	\param set	  The elements of the query.
+	\param strict True if all the elements must be known (supersets), false to ignore the unknown ones (subsets).
+	\param ctx	  The context of the query.
 
-	for (IdMap::iterator it = id.begin(); it != id.end(); ++it) {
-		int ii = it->first;
-		image_put(p_bi, &ii, sizeof(ii));
-		int ll = it->second.length();
-		image_put(p_bi, &ll, sizeof(ll));
-		image_put(p_bi, (void *) it->second.c_str(), ll);
-	}
+	\return	  False if there is nothing to search: an unknown element in strict mode or no known elements at all.
+*/
+bool SetTrie::prepare_query (StringSet &set, bool strict, QueryContext &ctx) const {
 
-	section = "end";
-	hs		= MurmurHash64A(section.c_str(), section.length());
+	if (!prepare_query(set, strict, ctx.query, ctx.query_mask))
+		return false;
 
-	image_put(p_bi, &hs, sizeof(hs));
+	ctx.last_query_idx = ctx.query.size() - 1;
 
 	return true;
 }
 
-// -----------------------------------------------------------------------------------------------------------------------------------------
-//	Python Implementation
-// -----------------------------------------------------------------------------------------------------------------------------------------
 
-typedef SetTrie		*pSetTrie;
-typedef StringSet	*pStringSet;
+/** Translates the elements of a query into the sorted list of their ids.
 
-typedef std::map<int, pSetTrie>		SetTrieServer;
-typedef std::map<int, pStringSet>	IterServer;
-typedef std::map<int, pBinaryImage>	BinaryImageServer;
+	\param set	  The elements of the query.
+	\param strict True if all the elements must be known (supersets), false to ignore the unknown ones (subsets).
+	\param q	  The sorted ids of the query.
+	\param mask	  The signature bits of the pending values, mask[s] for q[s..last] (only in strict mode with signatures).
 
-int instance_num  = 0;
-int instance_iter = 0;
+	\return	  False if there is nothing to search: an unknown element in strict mode or no known elements at all.
+*/
+bool SetTrie::prepare_query (StringSet &set, bool strict, BinarySet &q, SignatureList &mask) const {
 
-SetTrieServer	  instance = {};
-IterServer		  iterator = {};
-BinaryImageServer image	   = {};
+	q.clear();
 
-int max_id_length	= 1024;
-char *p_answer		= nullptr;
-char answer_block  [8208];	// 4K + final zero aligned to 16 bytes
+	int size = set.size();
 
-const char b64chars[]	   = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-uint8_t	   b64inverse[256] = {0};
+	for (int i = 0; i < size; i++) {
+		ElementId e = hh_nam.get(MurmurHash64A(set[i].c_str(), set[i].length()));
 
-char *image_block_as_string(uint8_t *p_in) {
+		if (e != ELEMENT_SLOT_EMPTY)
+			q.push_back(e);
+		else if (strict)
+			return false;
+	}
+	if (q.size() == 0)
+		return false;
 
-	char *p_out	  = (char *) &answer_block;
+	std::sort(q.begin(), q.end());
 
-	uint8_t v, w;
-	for (int i = 0; i < 2048; i++) {
-		v = *(p_in++);
-		*(p_out++) = b64chars[v >> 2];
+	q.erase(unique(q.begin(), q.end()), q.end());
 
-		w = *(p_in++);
-		*(p_out++) = b64chars[((v << 4) & 0x30) | w >> 4];
+	if (strict && use_signatures) {
+		int last = q.size() - 1;
 
-		v = *(p_in++);
-		*(p_out++) = b64chars[((w << 2) & 0x3c) | v >> 6];
-		*(p_out++) = b64chars[v & 0x3f];
+		mask.resize(q.size() + 1);
+		mask[q.size()] = 0;
+
+		for (int i = last; i >= 0; i--)
+			mask[i] = mask[i + 1] | signature_bit(q[i]);
 	}
-	*p_out = 0;
 
-	return (char *) &answer_block;
+	return true;
 }
 
 
-char *image_block_as_string(ImageBlock &blk) {
-	uint8_t *p_in = (uint8_t *) &blk;
+/** Finds the supersets of a set.
 
-	return image_block_as_string(p_in);
-}
+	\param set	  The elements of the set.
+	\param limit  The maximum number of results, the search stops when they are found. A negative value means no limit.
 
+	\return		  The ids of the sets stored in the tree that contain all the elements.
+*/
+StringSet SetTrie::supersets (StringSet set, int limit) const {
 
-bool string_as_image_block(ImageBlock &blk, char *p_in) {
+	RWGuard guard(rw_lock, false);
 
-	if (b64inverse[0] != 0xc0) {
-		// create the inverse of b64chars[] in b64inverse[] just once if not exists
-		memset(&b64inverse, 0xc0c0c0c0, sizeof(b64inverse));
+	StringSet ret = {};
 
-		for (int i = 0; i < 64; i++)
-			b64inverse[(int) b64chars[i]] = i;
-	}
-	uint8_t *p_out = (uint8_t *) &blk;
+	IdList result = supersets_idx(set, limit);
 
-	uint8_t v, w;
-	for (int i = 0; i < 2048; i++) {
-		v = b64inverse[(int) *(p_in++)];
-		if ((v & 0xc0) != 0)
-			return false;
+	int size = result.size();
+	for (int i = 0; i < size; i++)
+		ret.push_back(id[result[i]]);
 
-		w = b64inverse[(int) *(p_in++)];
-		if ((w & 0xc0) != 0)
-			return false;
+	return ret;
+}
 
-		*(p_out++) = (v << 2) | (w >> 4);
 
-		v = b64inverse[(int) *(p_in++)];
-		if ((v & 0xc0) != 0)
-			return false;
+StringSet SetTrie::supersets (String str, char split, int limit) const {
+	StringSet set;
+	std::stringstream ss(str);
 
-		*(p_out++) = (w << 4) | (v >> 2);
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
 
-		w = b64inverse[(int) *(p_in++)];
-		if ((w & 0xc0) != 0)
-			return false;
+	return supersets(set, limit);
+}
 
-		*(p_out++) = (v << 6) | w;
-	}
 
-	return (uint_fast64_t) p_out - (uint_fast64_t) &blk == sizeof(ImageBlock);
-}
+/** Finds the subsets of a set.
 
+	\param set	  The elements of the set.
+	\param limit  The maximum number of results, the search stops when they are found. A negative value means no limit.
 
-String python_set_as_string(char *p_char) {
+	\return		  The ids of the sets stored in the tree whose elements are all in the set.
+*/
+StringSet SetTrie::subsets (StringSet set, int limit) const {
 
-	int size = strlen(p_char);
+	RWGuard guard(rw_lock, false);
 
-	if (size == 5 && strcmp(p_char, "set()") == 0)
-		return "";
+	StringSet ret = {};
 
-	if (size > 10 && *((int*) p_char) == 0x7a6f7266) {
-		// frozenset({ . . . })
-		// ^[0]     ^[9]      ^[size - 1]
+	IdList result = subsets_idx(set, limit);
 
-		if (p_char[9] != '(' || p_char[size - 1] != ')')
-			return "";
+	int size = result.size();
+	for (int i = 0; i < size; i++)
+		ret.push_back(id[result[i]]);
 
-		p_char += 10;
-		size   -= 11;
+	return ret;
+}
 
-		if (size < 3)
-			return "";
-	}
 
-	if (p_char[0] != '{' || p_char[size - 1] != '}')
-		return String(p_char);
+StringSet SetTrie::subsets (String str, char split, int limit) const {
+	StringSet set;
+	std::stringstream ss(str);
 
-	String s;
-	p_char++;
-	size -= 2;
-	int quote_lev = 0;		// 1 for ', 2 for "
-	bool trailing = false;
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
 
-	while (size-- > 0) {
-		char cursor;
-		switch (cursor = *(p_char++)) {
-		case '\'':
-			switch (quote_lev) {
-			case 0:
-				quote_lev = 1;
-				break;
+	return subsets(set, limit);
+}
 
-			case 1:
-				quote_lev = 0;
-				break;
-			};
-			s.push_back('\'');
-			trailing = false;
-			break;
 
-		case '"':
-			switch (quote_lev) {
-			case 0:
-				quote_lev = 2;
-				break;
+/** Finds the supersets of a set and returns their set_ids (the indices of their nodes) instead of their id strings.
 
-			case 2:
-				quote_lev = 0;
-				break;
-			};
-			s.push_back('"');
-			trailing = false;
-			break;
+	\param set	  The elements of the set.
+	\param limit  The maximum number of results, the search stops when they are found. A negative value means no limit.
 
-		case ' ':
-			if (!trailing)
-				s.push_back(' ');
-			break;
+	\return		  The set_ids of the sets stored in the tree that contain all the elements.
+*/
+IdList SetTrie::supersets_idx (StringSet set, int limit) const {
 
-		case ',':
-			if (quote_lev == 0) {
-				s.push_back(',');
-				trailing = true;
-			} else
-				s.push_back(0x82);
-			break;
+	RWGuard guard(rw_lock, false);
 
-		default:
-			s.push_back(cursor);
-			trailing = false;
-		}
-	}
+	QueryContext &ctx = query_context();
 
-	return s;
-}
+	ctx.max_results = limit < 0 ? INT32_MAX : limit;
 
+	ctx.result.clear();
 
-/** Return a buffer to write an answer that is as big as max_id_length. max_id_length tracks the largest set id used by insert.
-*/
-char *get_answer_buffer () {
-	if (p_answer == nullptr)
-		p_answer = (char *) malloc(max_id_length + 16);
+	if (set.size() == 0) {
+		// FIX (2024/02/28): All sets are the supersets of the empty set.
+		for (int idx = id.next_node(0); idx >= 0 && (int) ctx.result.size() < ctx.max_results; idx = id.next_node(idx + 1))
+			ctx.result.push_back(idx);
 
-	return p_answer;
+		return std::move(ctx.result);
+	}
+
+	if (prepare_query(set, true, ctx))
+		supersets(tree[0].idx_child, 0, ctx);
+
+	return std::move(ctx.result);
 }
 
 
-/** Check if the current set id is larger than max_id_length. If so, reallocate the buffer to the new size.
+IdList SetTrie::supersets_idx (String str, char split, int limit) const {
+	StringSet set;
+	std::stringstream ss(str);
 
-	\param size  The new size of the id.
-*/
-void inline set_answer_buffer_size (int size) {
-	if (size > max_id_length) {
-		if (p_answer != nullptr)
-			free(p_answer);
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
 
-		p_answer = (char *) malloc(size + 16);
-		max_id_length = size;
-	}
+	return supersets_idx(set, limit);
 }
 
-// -----------------------------------------------------------------------------------------------------------------------------------------
 
-/** Create a new SetTrie object that can be used via the Python interface.
+/** Finds the subsets of a set and returns their set_ids (the indices of their nodes) instead of their id strings.
 
-	\return	A unique ID that can be passed as the st_id parameter for any method in the Python interface.
+	\param set	  The elements of the set.
+	\param limit  The maximum number of results, the search stops when they are found. A negative value means no limit.
 
-To free the resources allocated by this ID, the (python) caller must call destroy_settrie() with the st_id and never use the same
-st_id after that.
+	\return		  The set_ids of the sets stored in the tree whose elements are all in the set.
 */
-int new_settrie() {
+IdList SetTrie::subsets_idx (StringSet set, int limit) const {
 
-	instance[++instance_num] = new SetTrie();
+	RWGuard guard(rw_lock, false);
 
-	return instance_num;
-}
+	QueryContext &ctx = query_context();
 
+	ctx.max_results = limit < 0 ? INT32_MAX : limit;
 
-/** Destroy a SetTrie object that was used via the Python interface.
+	ctx.result.clear();
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
-*/
-void destroy_settrie(int st_id) {
+	if (ctx.max_results > 0 && state[0] == STATE_HAS_SET_ID)
+		ctx.result.push_back(0);
 
-	SetTrieServer::iterator it = instance.find(st_id);
+	if (prepare_query(set, false, ctx))
+		subsets(tree[0].idx_child, 0, ctx);
 
-	if (it == instance.end())
-		return;
+	return std::move(ctx.result);
+}
 
-	delete it->second;
 
-	instance.erase(it);
+IdList SetTrie::subsets_idx (String str, char split, int limit) const {
+	StringSet set;
+	std::stringstream ss(str);
+
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
+
+	return subsets_idx(set, limit);
 }
 
 
-/** Insert a Python set (serialized by a str() call) into a SetTrie object.
+/** Runs a supersets() or subsets() traversal of the query of ctx on query_threads threads and appends all its results to its result,
+	in no particular order.
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
-	\param set	  A Python set serialized by a str() call.
-	\param str_id An id representing this set that will be returned in searches.
+	\param kind  CURSOR_SUPERSETS or CURSOR_SUBSETS.
+	\param t_idx The first node of the sibling chain to search.
+	\param s_idx The first pending value of the query.
+	\param ctx	 The context of the query.
+
+Each thread runs the usual kernel on a stack of its own, PARALLEL_QUERY_STEPS frames at a time. Between two runs, when another thread
+is idle, it moves the bottom of its stack, the oldest pending sibling chain and usually the largest, to a shared queue. A large subtree
+is thus split among the threads as they run out of work, whether it has results or not. The results of each thread are merged at the end.
 */
-void insert	(int st_id, char *set, char *str_id) {
+void SetTrie::parallel_query (int kind, int t_idx, int s_idx, QueryContext &ctx) const {
 
-	SetTrieServer::iterator it = instance.find(st_id);
+	std::mutex				mtx;
+	std::condition_variable wake;
+	std::atomic<int>		num_idle(0);
 
-	if (it != instance.end()) {
-		String s = String(str_id);
-		it->second->insert(python_set_as_string(set), s, ',');
-		set_answer_buffer_size(s.length());
-	}
-}
-
-
-/** Find a Python set (serialized by a str() call) for a complete match inside a SetTrie object.
+	CursorStack shared = {{t_idx, s_idx, false}};
+	bool		done   = false;
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
-	\param set	  A Python set serialized by a str() call.
-
-	\return		  The str_id string that was given to the set when it was inserted.
-*/
-char *find (int st_id, char *set) {
+	std::vector<IdList> found(query_threads);
 
-	SetTrieServer::iterator it = instance.find(st_id);
+	auto worker = [&](int t) {
+		CursorStack local = {};
+		IdList	   &buff  = found[t];
 
-	char *p_ans = get_answer_buffer();
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mtx);
 
-	p_ans[0] = 0;
+				num_idle++;
 
-	if (it != instance.end())
-		strcpy(p_ans, it->second->find(python_set_as_string(set), ',').c_str());
+				// The traversal ends when all the threads are idle and there is nothing left to share.
+				while (shared.empty() && !done) {
+					if (num_idle == query_threads) {
+						done = true;
+						wake.notify_all();
+					} else
+						wake.wait(lock);
+				}
+				if (shared.empty())
+					return;
 
-	return p_ans;
-}
+				num_idle--;
 
+				local.push_back(shared.back());
+				shared.pop_back();
+			}
 
-/** Find all the supersets of a given Python set (serialized by a str() call) stored inside a SetTrie object.
+			int idx, steps = PARALLEL_QUERY_STEPS;
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
-	\param set	  A Python set serialized by a str() call.
+			while ((idx = kind == CURSOR_SUPERSETS ? next_superset(local, ctx.query, ctx.query_mask, ctx.last_query_idx, nullptr, &steps)
+												   : next_subset(local, ctx.query, ctx.last_query_idx, nullptr, &steps)) != CURSOR_END) {
+				if (idx >= 0)
+					buff.push_back(idx);
+				else
+					steps = PARALLEL_QUERY_STEPS;
 
-	\return		  0 if no sets were found, or an iter_id > 0 that can be used to retrieve the result using iterator_next()/iterator_size()
-				  and must be explicitly destroyed via destroy_iterator()
-*/
-int supersets (int st_id, char *set) {
+				if (local.size() > 1 && num_idle.load(std::memory_order_relaxed) > 0) {
+					std::lock_guard<std::mutex> lock(mtx);
 
-	SetTrieServer::iterator it = instance.find(st_id);
+					shared.push_back(local.front());
+					local.erase(local.begin());
 
-	if (it == instance.end())
-		return 0;
+					wake.notify_one();
+				}
+			}
+		}
+	};
 
-	StringSet ret = it->second->supersets(python_set_as_string(set), ',');
+	std::vector<std::thread> pool = {};
 
-	if (ret.size() == 0)
-		return 0;
+	for (int t = 0; t < query_threads; t++)
+		pool.push_back(std::thread(worker, t));
 
-	iterator[++instance_iter] = new StringSet(ret);
+	for (int t = 0; t < query_threads; t++) {
+		pool[t].join();
 
-	return instance_iter;
+		ctx.result.insert(ctx.result.end(), found[t].begin(), found[t].end());
+	}
 }
 
 
-/** Find all the subsets of a given Python set (serialized by a str() call) stored inside a SetTrie object.
+/** Finds the supersets of many sets at once.
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
-	\param set	  A Python set serialized by a str() call.
+	\param sets		The queries.
+	\param limit		The maximum number of results of each query. A negative value means no limit.
+	\param num_threads The number of threads running the queries.
 
-	\return		  0 if no sets were found, or an iter_id > 0 that can be used to retrieve the result using iterator_next()/iterator_size()
-				  and must be explicitly destroyed via destroy_iterator()
+	\return			The set_ids found by each query (see QueryBatch), the same supersets_idx() would find on a single thread and in
+					the same order. Each query runs on a single thread, whatever set_query_threads() says.
 */
-int subsets (int st_id, char *set) {
+QueryBatch SetTrie::supersets_batch (std::vector<StringSet> &sets, int limit, int num_threads) const {
 
-	SetTrieServer::iterator it = instance.find(st_id);
+	RWGuard guard(rw_lock, false);
 
-	if (it == instance.end())
-		return 0;
+	return query_batch(CURSOR_SUPERSETS, sets, limit, num_threads);
+}
 
-	StringSet ret = it->second->subsets(python_set_as_string(set), ',');
 
-	if (ret.size() == 0)
-		return 0;
+/** Finds the subsets of many sets at once.
 
-	iterator[++instance_iter] = new StringSet(ret);
+	\param sets		The queries.
+	\param limit		The maximum number of results of each query. A negative value means no limit.
+	\param num_threads The number of threads running the queries.
 
-	return instance_iter;
+	\return			The set_ids found by each query (see QueryBatch), the same subsets_idx() would find on a single thread and in
+					the same order. Each query runs on a single thread, whatever set_query_threads() says.
+*/
+QueryBatch SetTrie::subsets_batch (std::vector<StringSet> &sets, int limit, int num_threads) const {
+
+	RWGuard guard(rw_lock, false);
+
+	return query_batch(CURSOR_SUBSETS, sets, limit, num_threads);
 }
 
 
-/** Return all the elements in a set from a SetTrie identified by set_id as an iterator of strings.
+/** Finds many sets by their elements at once.
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
-	\param set_id A valid set_id returned by a successful next_set_id() call.
+	\param sets		The sets.
+	\param num_threads The number of threads searching.
 
-	\return		  0 on error or the empty set, or an iter_id > 0 that can be used to retrieve the result using
-				  iterator_next()/iterator_size() and must be explicitly destroyed via destroy_iterator()
+	\return			The set_id of each set or -1 if it is not in the tree, the same find_idx() returns.
 */
-int elements (int st_id, int set_id) {
+IdList SetTrie::find_batch (std::vector<StringSet> &sets, int num_threads) const {
 
-	if (set_id == 0)
-		return 0;
+	RWGuard guard(rw_lock, false);
 
-	SetTrieServer::iterator it = instance.find(st_id);
+	int size = sets.size();
 
-	if (it == instance.end())
-		return 0;
+	IdList found(size);
 
-	StringSet ret = it->second->elements(set_id);
+	parallel_for(num_threads, size, 256, [&](int lo, int hi) {
+		for (int i = lo; i < hi; i++)
+			found[i] = find_set(sets[i]);
+	});
 
-	if (ret.size() == 0)
-		return 0;
+	return found;
+}
 
-	iterator[++instance_iter] = new StringSet(ret);
 
-	return instance_iter;
+/** Appends the results of a prepared query to found (up to limit) using stk as the traversal stack. It only reads the SetTrie.
+*/
+void SetTrie::run_query (int kind, BinarySet &q, SignatureList &mask, int limit, CursorStack &stk, IdList &found) const {
+
+	int last = q.size() - 1, idx;
+
+	stk.clear();
+	stk.push_back({child(0), 0, false});
+
+	if (kind == CURSOR_SUPERSETS) {
+		while ((int) found.size() < limit && (idx = next_superset(stk, q, mask, last)) >= 0)
+			found.push_back(idx);
+	} else {
+		while ((int) found.size() < limit && (idx = next_subset(stk, q, last)) >= 0)
+			found.push_back(idx);
+	}
 }
 
 
-/** Return the integer set_id of the next set stored in a SetTrie after a given set_id to iterate over all the sets in the object.
+/** Runs a batch of supersets() or subsets() queries on num_threads threads.
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
-	\param set_id A valid set_id returned by previous call or the constant -1 to return the first set. Note that 0 may be the set_id of
-				  the empty set in case the empty set is in the SetTrie.
+	\param kind		CURSOR_SUPERSETS or CURSOR_SUBSETS.
+	\param sets		The queries.
+	\param limit		The maximum number of results of each query. A negative value means no limit.
+	\param num_threads The number of threads.
 
-	\return		  A unique integer set_id that can be used for iterating, calling set_name() or elements(). On error, it will return -3
-				  if the st_id or the set_id is invalid and -2 if the set_id given is the last set in the object or the object is empty.
+All the queries are translated to sorted ids first and the repeated ones only run once. The queries run in blocks on the threads, each
+one with a stack of its own, and their results are packed in the order of the batch.
 */
-int next_set_id (int st_id, int set_id) {
+QueryBatch SetTrie::query_batch (int kind, std::vector<StringSet> &sets, int limit, int num_threads) const {
 
-	SetTrieServer::iterator it = instance.find(st_id);
+	int size = sets.size(), max_res = limit < 0 ? INT32_MAX : limit;
 
-	if (it == instance.end())
-		return -3;
+	bool strict = kind == CURSOR_SUPERSETS;
 
-	if (set_id == -1) {
-		if (it->second->id.size() == 0)
-			return -2;
+	std::vector<BinarySet>	   q(size);
+	std::vector<SignatureList> mask(size);
+	std::vector<IdList>		   found(size);
+	std::vector<char>		   valid(size);
 
-		IdMap::iterator jt = it->second->id.begin();
+	parallel_for(num_threads, size, 256, [&](int lo, int hi) {
+		for (int i = lo; i < hi; i++)
+			valid[i] = prepare_query(sets[i], strict, q[i], mask[i]);
+	});
 
-		return jt->first;
+	// same[i] is the first query of the batch equal to query i.
+	IdList order(size), same(size);
+
+	for (int i = 0; i < size; i++)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+		return sets[a].empty() != sets[b].empty() ? sets[a].empty() : (valid[a] != valid[b] ? valid[a] < valid[b] : q[a] < q[b]);
+	});
+
+	for (int i = 0; i < size; i++) {
+		int a = order[i], b = i > 0 ? order[i - 1] : -1;
+
+		same[a] = b >= 0 && sets[a].empty() == sets[b].empty() && valid[a] == valid[b] && q[a] == q[b] ? same[b] : a;
 	}
 
-	IdMap::iterator jt = it->second->id.find(set_id);
+	parallel_for(num_threads, size, 16, [&](int lo, int hi) {
+		CursorStack stk = {};
 
-	if (jt == it->second->id.end())
-		return -3;
+		for (int i = lo; i < hi; i++) {
+			if (same[i] != i)
+				continue;
 
-	++jt;
+			IdList &res = found[i];
 
-	if (jt == it->second->id.end())
-		return -2;
+			if (strict && sets[i].empty()) {
+				// All sets are the supersets of the empty set.
+				for (int idx = id.next_node(0); idx >= 0 && (int) res.size() < max_res; idx = id.next_node(idx + 1))
+					res.push_back(idx);
 
-	return jt->first;
-}
+				continue;
+			}
 
+			if (!strict && max_res > 0 && state[0] == STATE_HAS_SET_ID)
+				res.push_back(0);
 
-/** Return the number of sets in a SetTrie object.
+			if (valid[i])
+				run_query(kind, q[i], mask[i], max_res, stk, res);
+		}
+	});
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
+	QueryBatch batch = {};
 
-	\return		  The number or -1 on invalid st_id.
-*/
-int num_sets (int st_id) {
+	batch.offset.push_back(0);
 
-	SetTrieServer::iterator it = instance.find(st_id);
+	for (int i = 0; i < size; i++) {
+		IdList &res = found[same[i]];
 
-	if (it == instance.end())
-		return -1;
+		batch.set_ids.insert(batch.set_ids.end(), res.begin(), res.end());
+		batch.offset.push_back(batch.set_ids.size());
+	}
 
-	return it->second->id.size();
+	return batch;
 }
 
 
-/** Return the name (Python id) of a set stored in a SetTrie identified by its binary (int) set_id.
+/** Counts the supersets of a set without building the list of their ids.
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
-	\param set_id A valid set_id returned by a successful next_set_id() call.
+	\param set The elements of the set.
 
-	\return		  An empty string on any error and the Python id of the set if both st_id and set_id are valid.
+	\return	The number of sets stored in the tree that contain all the elements.
+
+Once the whole query is matched at a node, all the sets in its subtree are supersets and their number is read from the summary of
+the node, so the cost does not grow with the number of results.
 */
-char *set_name (int st_id, int set_id) {
+int SetTrie::count_supersets (StringSet set) const {
 
-	SetTrieServer::iterator it = instance.find(st_id);
+	RWGuard guard(rw_lock, false);
 
-	char *p_ans = get_answer_buffer();
+	// All sets are the supersets of the empty set.
+	if (set.size() == 0)
+		return id.size();
 
-	p_ans[0] = 0;
+	QueryContext &ctx = query_context();
 
-	if (it != instance.end()) {
-		IdMap::iterator jt = it->second->id.find(set_id);
+	if (!prepare_query(set, true, ctx))
+		return 0;
 
-		if (jt != it->second->id.end())
-			strcpy(p_ans, jt->second.c_str());
-	}
+	ctx.count_only	= true;
+	ctx.num_found	= 0;
+	ctx.max_results = INT32_MAX;
 
-	return p_ans;
-}
+	ctx.result.clear();
 
+	supersets(tree[0].idx_child, 0, ctx);
 
-/** Removes a set from the object by its unique integer id.
+	ctx.count_only = false;
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
-	\param set_id A valid set_id returned by a successful next_set_id() call.
+	return ctx.num_found;
+}
 
-	\return		  0 on success or a negative error code.
-*/
-extern int remove (int st_id, int set_id) {
 
-	SetTrieServer::iterator it = instance.find(st_id);
+int SetTrie::count_supersets (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
 
-	if (it == instance.end())
-		return -1;
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
 
-	return it->second->remove(set_id);
+	return count_supersets(set);
 }
 
 
-/** Purges (reassigns node integer ids and frees RAM) after a series of remove() calls.
+/** Counts the subsets of a set without building the list of their ids.
 
-	\param st_id   The st_id returned by a previous new_settrie() call.
-	\param dry_run If nonzero, does nothing and returns the number of dirty nodes.
+	\param set The elements of the set.
 
-	\return		   A positive num_dirty_nodes on dry_run, zero on successful completion or a negative error code.
+	\return	The number of sets stored in the tree whose elements are all in the set.
 */
-extern int purge (int st_id, int dry_run) {
+int SetTrie::count_subsets (StringSet set) const {
 
-	SetTrieServer::iterator it = instance.find(st_id);
+	RWGuard guard(rw_lock, false);
 
-	if (it == instance.end())
-		return -1;
+	int count = state[0] == STATE_HAS_SET_ID;
 
-	if (dry_run)
-		return it->second->num_dirty_nodes;
+	QueryContext &ctx = query_context();
 
-	return it->second->purge();
-}
+	if (!prepare_query(set, false, ctx))
+		return count;
 
+	ctx.count_only	= true;
+	ctx.num_found	= 0;
+	ctx.max_results = INT32_MAX;
 
-/** Return the number of unread items in an iterator (returned by subsets() or supersets()).
+	ctx.result.clear();
 
-	\param iter_id  The iter_id returned by a previous subsets() or supersets() call.
+	subsets(tree[0].idx_child, 0, ctx);
 
-	\return			The number of unread items in the iterator.
-*/
-int iterator_size (int iter_id) {
+	ctx.count_only = false;
 
-	IterServer::iterator it = iterator.find(iter_id);
+	return count + ctx.num_found;
+}
 
-	if (it == iterator.end())
-		return 0;
 
-	return it->second->size();
-}
+int SetTrie::count_subsets (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
 
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
 
-/** Return the first unread item in an iterator (returned by subsets() or supersets()).
+	return count_subsets(set);
+}
 
-	\param iter_id  The iter_id returned by a previous subsets() or supersets() call.
 
-	\return			The str_id of an insert()-ed set that matches the query.
-*/
-char *iterator_next (int iter_id) {
+StringSet SetTrie::elements	(int idx) const {
 
-	IterServer::iterator it = iterator.find(iter_id);
+	RWGuard guard(rw_lock, false);
 
-	char *p_ans = get_answer_buffer();
+	StringSet ret = {};
 
-	p_ans[0] = 0;
+	if (idx > 0 && idx < tree.size() && state[idx] == STATE_HAS_SET_ID) {
+		BinarySet set = {};
 
-	if (it != iterator.end() && !it->second->empty()) {
+		path(idx, set);
 
-		String ss = it->second->back();
-		it->second->pop_back();
+		int size = set.size();
 
-		strcpy(p_ans, ss.c_str());
+		for (int i = 0; i < size; i++)
+			ret.push_back(name_arena.get(names[set[i]].name));
 	}
 
-	return p_ans;
+	return ret;
 }
 
 
-/** Destroy an iterator (returned by subsets() or supersets()).
+int SetTrie::remove	(int idx) {
 
-	\param iter_id  The iter_id returned by a previous subsets() or supersets() call.
-*/
-void destroy_iterator (int iter_id) {
+	RWGuard guard(rw_lock, true);
 
-	IterServer::iterator it = iterator.find(iter_id);
+	if (idx < 0 || idx >= tree.size() || state[idx] != STATE_HAS_SET_ID)
+		return -2;
 
-	if (it == iterator.end())
-		return;
+	IdTable::iterator it = id.find(idx);
 
-	delete it->second;
+	if (it == id.end())
+		return -3;
 
-	iterator.erase(it);
-}
+	id.erase(it);
 
+	num_changes++;
 
-/** Destroy an iterator for a binary image(returned by save_as_binary_image()).
+	for (int i = idx; i > 0; i = parent[i])
+		summary[i].num_sets--;
 
-	\param image_id  The image_id returned by a previous save_as_binary_image() call.
-*/
-void destroy_binary_image (int image_id) {
+	summary[0].num_sets--;
 
-	BinaryImageServer::iterator it = image.find(image_id);
+	if (idx == 0) {
+		state[idx] = STATE_IN_USE;
+		ElementTable::iterator it = hh_nam.find(0);
+		if (it != hh_nam.end())
+			release_element(it->second);
 
-	if (it == image.end())
-		return;
+		return 0;
+	}
 
-	delete it->second;
+	BinarySet set = {};
 
-	image.erase(it);
-}
+	path(idx, set);
 
+	int size = set.size();
 
-/** Saves a SetTrie object as a BinaryImage.
+	for (int i = 0; i < size; i++) {
+		ElementId e = set[i];
 
-	\param st_id  The st_id returned by a previous new_settrie() call.
+		if (--names[e].count == 0)
+			release_element(e);
+	}
 
-	\return		  0 on error, or a binary_image_id > 0 which is the same as st_id and must be destroyed using destroy_binary_image()
-*/
-int save_as_binary_image (int st_id) {
+	if (child(idx) != 0)
+		state[idx] = STATE_IN_USE;
+	else {
+		int stop = false, up;
 
-	SetTrieServer::iterator it = instance.find(st_id);
+		while (!stop) {
+			int lx = parent[idx], j;
 
-	if (it == instance.end())
-		return 0;
+			up = lx;
 
-	pBinaryImage p_bi = new BinaryImage;
+			if ((j = child(lx)) == idx) {
+				j = tree[idx].idx_next;
+				set_child(lx, j);
+				stop = (j != 0) || (state[lx] == STATE_HAS_SET_ID) || (lx == 0);
+			} else {
+				lx = j;
+				while ((j = tree[lx].idx_next) != idx) lx = j;
+				tree[lx].idx_next = tree[idx].idx_next;
+				stop = true;
+			}
 
-	if (!it->second->save(p_bi)) {
-		delete p_bi;
+			if (tree[idx].idx_child < 0)
+				release_run(idx);
 
-		return 0;
-	}
+			tree[idx]	= {0xbaadF00D, -1, -1};
+			parent[idx] = -1;
+			state[idx]	= STATE_IS_GARBAGE;
+			num_dirty_nodes++;
 
-	destroy_binary_image(st_id);
+			idx = lx;
+		}
 
-	image[st_id] = p_bi;
+		// The summaries of the ancestors of the removed nodes may shrink.
+		for (; up > 0; up = parent[up]) {
+			NodeSummary ns = summary[up];
 
-	return st_id;
-}
+			update_summary(up);
 
+			if (summary[up].max_value == ns.max_value && summary[up].height == ns.height)
+				break;
+		}
+	}
 
-/** Pushes raw image blocks into an initially empty SetTrie object and finally creates it already populated with the binary image.
+	return 0;
+}
 
-	\param st_id	The st_id returned by a previous new_settrie() call. The object must be empty (never inserted).
-	\param p_block	If non-empty, a block in the right order making a binary image obtained for a previous save_as_binary_image() call.
-					If empty, an order to .load() the SetTrie object and destroyed the previously stored blocks.
 
-	\return			True on success.
+/** Finds a set by its id string.
+
+	\param str_id The id the set was inserted with.
+
+	\return	The set_id (the last one inserted if many sets share the id) or -1 if there is none.
 */
-bool push_binary_image_block (int st_id, char *p_block) {
+int SetTrie::find_by_id (String str_id) const {
 
-	SetTrieServer::iterator it_settrie = instance.find(st_id);
+	RWGuard guard(rw_lock, false);
 
-	if (it_settrie == instance.end())
-		return false;
+	return id.find_node(str_id);
+}
 
-	if (p_block[0] == 0) {
-		BinaryImageServer::iterator it_image = image.find(st_id);
 
-		if (it_image == image.end())
-			return false;
+/** Removes a set by its id string (the last one inserted if many sets share the id).
 
-		bool ok = it_settrie->second->load(it_image->second);
+	\param str_id The id the set was inserted with.
 
-		destroy_binary_image(st_id);
+	\return	0 on success, -1 if there is no set with that id.
+*/
+int SetTrie::remove_by_id (String str_id) {
 
-		return ok;
-	}
+	RWGuard guard(rw_lock, true);
 
-	ImageBlock blk;
+	int idx = id.find_node(str_id);
 
-	if (!string_as_image_block(blk, p_block)) {
-		destroy_binary_image(st_id);
+	if (idx < 0)
+		return -1;
 
-		return false;
-	}
+	return remove(idx);
+}
 
-	BinaryImageServer::iterator it_image = image.find(st_id);
 
-	if (it_image == image.end()) {
-		if (blk.block_num != 1)
-			return false;
+int SetTrie::purge () {
 
-		pBinaryImage p_bi = new BinaryImage;
+	RWGuard guard(rw_lock, true);
 
-		p_bi->push_back(blk);
+	if (num_dirty_nodes <= 0)
+		return -1;
 
-		image[st_id] = p_bi;
+	num_changes++;
 
-		return true;
+	// The rebuild drops the garbage nodes and applies the frequencies changed by the removed sets.
+	if (element_order != ELEMENT_ORDER_INSERTION) {
+		reorder();
+
+		return 0;
 	}
 
-	ImageBlock *p_last = &it_image->second->back();
+	int ni = 0, size = tree.size();
+	std::map<int, int> is = {}, was = {};
 
-	if (blk.block_num != p_last->block_num + 1)
-		return false;
+	for (int i = 0; i < size; i++) {
+		if (state[i] != STATE_IS_GARBAGE) {
+			was[ni] = i;
+			is [i]  = ni;
+			ni++;
+		}
+	}
 
-	it_image->second->push_back(blk);
+	RunList runs2 = {};
 
-	return true;
+	size = was.size();
+	for (int i = 0; i < size; i++) {
+		ni = was[i];
+		if (i != ni) {
+			tree[i]	   = tree[ni];
+			parent[i]  = parent[ni];
+			state[i]   = state[ni];
+			summary[i] = summary[ni];
+		}
+		int ri = tree[i].idx_child;
+
+		if (ri < 0) {
+			// The runs are stored again in node order, dropping the ones released by remove().
+			runs2.push_back(runs[~ri]);
+			runs2.back().idx_child = is[runs2.back().idx_child];
+			tree[i].idx_child	   = ~(runs2.size() - 1);
+		} else
+			tree[i].idx_child = is[ri];
+
+		tree[i].idx_next  = is[tree[i].idx_next];
+		parent[i]		  = is[parent[i]];
+	}
+
+	runs = runs2;
+	free_runs.clear();
+
+	// Rebuilding the ids and the names drops the strings of the removed sets from the arenas.
+	IdTable id2 = id;
+	id = {};
+	for (IdTable::iterator it = id2.begin(); it != id2.end(); ++it)
+		id.set(is[it->first], it->second);
+
+	compact_names();
+
+	tree.resize(size);
+	parent.resize(size);
+	state.resize(size);
+	summary.resize(size);
+
+	num_dirty_nodes = 0;
+
+	// The signatures only grow between purges, the rebuild drops the values of the removed sets.
+	if (use_signatures)
+		set_signatures(true);
+
+	return 0;
 }
 
 
-/** Return the number of unread binary images blocks in an iterator returned by a save_as_binary_image() call.
+/** Sets the order of the elements in the sets and rebuilds the tree in that order.
 
-	\param image_id	The image_id returned by a previous save_as_binary_image() call.
+	\param order One of ELEMENT_ORDER_INSERTION, ELEMENT_ORDER_FREQUENT_FIRST or ELEMENT_ORDER_RARE_FIRST.
 
-	\return			The number of unread blocks in the iterator.
+	\return	  False if the order is not valid.
+
+ELEMENT_ORDER_INSERTION does not rebuild the tree, it just stops reordering it in purge(). Elements that are new since the last rebuild
+are ordered after the ranked ones (or take the place of an element that is no longer used) until the next purge() or reorder().
 */
-int binary_image_size (int image_id) {
+bool SetTrie::set_element_order (int order) {
 
-	BinaryImageServer::iterator it = image.find(image_id);
+	RWGuard guard(rw_lock, true);
 
-	if (it == image.end())
-		return 0;
+	if (order < ELEMENT_ORDER_INSERTION || order > ELEMENT_ORDER_RARE_FIRST)
+		return false;
 
-	return it->second->size();
+	element_order = order;
+
+	if (order != ELEMENT_ORDER_INSERTION)
+		reorder();
+
+	return true;
 }
 
 
-/** Return the first unread binary images block in an iterator returned by a save_as_binary_image() call.
+/** Enables or disables the descendant signatures used by supersets() to prune the tree.
 
-	\param image_id	The image_id returned by a previous save_as_binary_image() call.
+	\param enable True to build the signatures and keep them up to date, false to release them.
 
-	\return			The the binary image block serialized as base64 or an empty string on failure.
+Each node gets 64 bits with the bit (ElementId mod 64) set for each value in the node, its run and all its descendants. A subtree whose
+signature misses the bit of a pending query value cannot contain a superset and is skipped. insert() keeps the signatures exact,
+remove() leaves them wider than needed (still correct) until the next purge() or reorder() rebuilds them. This costs 8 bytes per node.
 */
-char *binary_image_next (int image_id) {
+void SetTrie::set_signatures (bool enable) {
 
-	BinaryImageServer::iterator it = image.find(image_id);
+	RWGuard guard(rw_lock, true);
 
-	if (it == image.end())
-		return (char *) "";
+	num_changes++;
 
-	uint8_t *p_in = (uint8_t *) it->second->data();
+	use_signatures = enable;
 
-	char *p_ret = image_block_as_string(p_in);
+	if (enable) {
+		signature.assign(tree.size(), 0);
+		signature[0] = build_signatures(child(0));
+	} else
+		SignatureList().swap(signature);
+}
 
-	it->second->erase(it->second->begin());
 
-	return p_ret;
-}
+/** Sets the number of threads used by the supersets() and subsets() queries without a limit. A single broad query on a tree of
+	PARALLEL_QUERY_MIN_NODES nodes or more is split among the threads, the results are the same but their order is not defined. The
+	default, 1, runs the queries on the calling thread. The limited queries, the counts, the cursors and the queries of smaller trees
+	always run on a single thread.
 
+	\param num_threads The number of threads.
 
-/** Free the memory allocated for the answer buffer.
+	\return			False if num_threads is below 1.
 */
-void cleanup_globals () {
-	if (p_answer != nullptr) {
-		free(p_answer);
-		p_answer = nullptr;
-	}
-}
+bool SetTrie::set_query_threads (int num_threads) {
 
-#if defined TEST
+	RWGuard guard(rw_lock, true);
 
-#ifndef INCLUDED_CATCH2
-#define INCLUDED_CATCH2
+	if (num_threads < 1)
+		return false;
 
-#include "catch.hpp"
+	query_threads = num_threads;
 
-#endif
+	return true;
+}
 
-void compare_iterating(pSetTrie p1, pSetTrie p2, bool compare_int_id) {
 
-	REQUIRE(p1->id.size() == p2->id.size());
+/** Renumbers the elements by their frequency (the number of sets using them) as defined by element_order and rebuilds the tree.
 
-	IdMap::iterator it1 = p1->id.begin();
-	IdMap::iterator it2 = p2->id.begin();
+Since the ElementId defines the order of the elements in each path and in each sibling chain, the sets are extracted, translated to
+the new ids and inserted again into an empty tree. This also removes the garbage nodes and the unused elements.
+*/
+void SetTrie::reorder () {
 
-	while (it1 != p1->id.end()) {
-		REQUIRE(it2 != p2->id.end());
-		if (compare_int_id) {
-			REQUIRE(it1->first  == it2->first);
-			REQUIRE(it1->second == it2->second);
+	RWGuard guard(rw_lock, true);
 
-			StringSet el1 = p1->elements(it1->first);
-			StringSet el2 = p2->elements(it2->first);
+	num_changes++;
 
-			REQUIRE(el1.size() == el2.size());
+	int size = names.size();
 
-			for (int i = 0; i < el1.size(); i++) {
-				REQUIRE(el1[i] == el2[i]);
-			}
-		} else {
-			IdMap::iterator it3 = p2->id.begin();
+	IdList rank = {};
 
-			while (it3 != p2->id.end() && it3->second != it1->second)
-				++it3;
+	for (int i = 0; i < size; i++)
+		if (names[i].count > 0)
+			rank.push_back(i);
 
-			REQUIRE(it1->second == it3->second);
+	if (element_order == ELEMENT_ORDER_FREQUENT_FIRST)
+		std::stable_sort(rank.begin(), rank.end(), [this](int a, int b) { return names[a].count > names[b].count; });
+	else if (element_order == ELEMENT_ORDER_RARE_FIRST)
+		std::stable_sort(rank.begin(), rank.end(), [this](int a, int b) { return names[a].count < names[b].count; });
 
-			StringSet el1 = p1->elements(it1->first);
-			StringSet el2 = p2->elements(it3->first);
+	BinarySet new_id(size, 0);
+	NameList  new_names = {};
 
-			REQUIRE(el1.size() == el2.size());
+	hh_nam.clear();
 
-			for (int i = 0; i < el1.size(); i++) {
-				REQUIRE(el1[i] == el2[i]);
-			}
-		}
-		++it1;
-		++it2;
+	for (int i = 0; i < rank.size(); i++) {
+		new_id[rank[i]] = i;
+		new_names.push_back(names[rank[i]]);
+		hh_nam[new_names[i].hash] = i;
 	}
-	REQUIRE(it2 == p2->id.end());
-}
 
+	std::vector<BinarySet> sets = {};
+	StringSet			   str_ids = {};
 
-void recurse_tree(pSetTrie ps, int ii, int &n_nodes, int &n_sets, int level) {
-	REQUIRE(level > 0);
-	REQUIRE(ii >= 0);
-	REQUIRE(ii < ps->tree.size());
+	for (IdTable::iterator it = id.begin(); it != id.end(); ++it) {
+		BinarySet set = {};
 
-	int state = ps->tree[ii].state;
+		path(it->first, set);
 
-	REQUIRE(state >= 0);
-	REQUIRE(state < STATE_IS_GARBAGE);
+		for (int i = 0; i < set.size(); i++)
+			set[i] = new_id[set[i]];
 
-	if (state == STATE_HAS_SET_ID)
-		n_sets--;
+		std::sort(set.begin(), set.end());
 
-	n_nodes--;
+		sets.push_back(set);
+		str_ids.push_back(it->second);
+	}
 
-	if (ps->tree[ii].idx_child != 0)
-		recurse_tree(ps, ps->tree[ii].idx_child, n_nodes, n_sets, level - 1);
+	names = new_names;
+	free_elements.clear();
+	compact_names();
 
-	if (ps->tree[ii].idx_next != 0)
-		recurse_tree(ps, ps->tree[ii].idx_next, n_nodes, n_sets, level - 1);
-}
+	tree.clear();
+	parent.clear();
+	state.clear();
+	runs.clear();
+	free_runs.clear();
+	summary.clear();
+	signature.clear();
+	id.clear();
 
+	new_node(0, 0, -1);
+	num_dirty_nodes = 0;
 
-void check_sets(pSetTrie ps) {
-	for (IdMap::iterator it = ps->id.begin(); it != ps->id.end(); ++it) {
-		REQUIRE(ps->tree[it->first].state == STATE_HAS_SET_ID);
-	}
+	IdList order(sets.size());
+
+	for (int i = 0; i < sets.size(); i++)
+		order[i] = i;
+
+	build(sets, str_ids, order);
 }
 
 
-void remove_by_id(pSetTrie ps, char *pID) {
+bool SetTrie::load (pBinaryImage &p_bi) {
 
-	IdMap::iterator it = ps->id.begin();
+	RWGuard guard(rw_lock, true);
 
-	while (it != ps->id.end()) {
-		if (strcmp(pID, it->second.c_str()) == 0) {
-			REQUIRE(ps->remove(it->first) == 0);
+	num_changes++;
 
-			int n_nodes = ps->tree.size() - ps->num_dirty_nodes;
-			int n_sets	= ps->id.size();
+	int c_block = 0, c_ofs = 0;
 
-			recurse_tree(ps, 0, n_nodes, n_sets, 8);
+	String		section = "settrie";
+	ElementHash hs;
+	char		buffer[8192];
 
-			REQUIRE(n_nodes == 0);
-			REQUIRE(n_sets  == 0);
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
+		return false;
 
-			check_sets(ps);
+	if (tree.size() != 1)
+		return false;
 
-			return;
-		}
+	int len;
 
-		++it;
-	}
-	REQUIRE(false);
-}
+	std::vector<ElementHash> legacy_values = {};
 
+	if (hs == MurmurHash64A(section.c_str(), section.length())) {
+		int version;
 
-SCENARIO("Test remove() and purge().") {
+		if (!image_get(p_bi, c_block, c_ofs, &version, sizeof(version)) || version != SETTRIE_IMAGE_VERSION)
+			return false;
 
-	int all = new_settrie();
-	int con = new_settrie();
-	int vow = new_settrie();
-	int non = new_settrie();
-	int bak = new_settrie();
+		if (!image_get(p_bi, c_block, c_ofs, &element_order, sizeof(element_order)))
+			return false;
 
-	REQUIRE(all > 0);
-	REQUIRE(con > 0);
-	REQUIRE(vow > 0);
-	REQUIRE(non > 0);
-	REQUIRE(bak > 0);
+		if (element_order < ELEMENT_ORDER_INSERTION || element_order > ELEMENT_ORDER_RARE_FIRST)
+			return false;
 
-	pSetTrie p_all = instance[all];
-	pSetTrie p_con = instance[con];
-	pSetTrie p_vow = instance[vow];
-	pSetTrie p_non = instance[non];
-	pSetTrie p_bak = instance[bak];
+		if (!image_get(p_bi, c_block, c_ofs, &use_signatures, sizeof(use_signatures)))
+			return false;
 
-	GIVEN("I load something to my objects.") {
-		insert(all, (char *) "a",		  (char *) "s_00");
-		insert(all, (char *) "a,b",		  (char *) "s_01");
-		insert(all, (char *) "a,b,c",	  (char *) "s_02");
-		insert(all, (char *) "a,b,c,d",	  (char *) "s_03");
-		insert(all, (char *) "a,b,c,d,e", (char *) "s_04");
-		insert(all, (char *) "a,c,d,e",	  (char *) "s_05");
-		insert(all, (char *) "a,b,d,e",	  (char *) "s_06");
-		insert(all, (char *) "a,b,c,e",	  (char *) "s_07");
-		insert(all, (char *) "b",		  (char *) "s_08");
-		insert(all, (char *) "b,c",		  (char *) "s_09");
-		insert(all, (char *) "b,c,d",	  (char *) "s_10");
-		insert(all, (char *) "b,c,d,e",	  (char *) "s_11");
-		insert(all, (char *) "b,d,e",	  (char *) "s_12");
-		insert(all, (char *) "b,c,e",	  (char *) "s_13");
-		insert(all, (char *) "c",		  (char *) "s_14");
-		insert(all, (char *) "c,d",		  (char *) "s_15");
-		insert(all, (char *) "c,d,e",	  (char *) "s_16");
-		insert(all, (char *) "c,e",		  (char *) "s_17");
-		insert(all, (char *) "d",		  (char *) "s_18");
-		insert(all, (char *) "d,e",		  (char *) "s_19");
-		insert(all, (char *) "e",		  (char *) "s_20");
-		insert(all, (char *) "a,e",		  (char *) "s_21");
+		section = "tree";
 
-		insert(con, (char *) "b",		  (char *) "s_08");
-		insert(con, (char *) "b,c",		  (char *) "s_09");
-		insert(con, (char *) "b,c,d",	  (char *) "s_10");
-		insert(con, (char *) "c",		  (char *) "s_14");
-		insert(con, (char *) "c,d",		  (char *) "s_15");
-		insert(con, (char *) "d",		  (char *) "s_18");
+		if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)) || hs != MurmurHash64A(section.c_str(), section.length()))
+			return false;
 
-		insert(vow, (char *) "a",		  (char *) "s_00");
-		insert(vow, (char *) "e",		  (char *) "s_20");
-		insert(vow, (char *) "a,e",		  (char *) "s_21");
+		if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 1)
+			return false;
 
-		pBinaryImage p_bi = new BinaryImage;
+		tree.resize(len);
+		parent.resize(len);
+		state.resize(len);
 
-		REQUIRE(p_all->save(p_bi));
-		REQUIRE(p_bak->load(p_bi));
+		if (!image_get(p_bi, c_block, c_ofs, tree.data(), len*sizeof(SetNode)))
+			return false;
 
-		delete p_bi;
+		if (!image_get(p_bi, c_block, c_ofs, parent.data(), len*sizeof(int)))
+			return false;
 
-		compare_iterating(p_all, p_bak, true);
+		if (!image_get(p_bi, c_block, c_ofs, state.data(), len*sizeof(uint8_t)))
+			return false;
 
-		REQUIRE(p_all->tree.size() == p_bak->tree.size());
-		REQUIRE(p_all->num_dirty_nodes == 0);
+		if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 0)
+			return false;
 
-		remove_by_id(p_all, (char *) "s_00");
-		remove_by_id(p_all, (char *) "s_01");
-		remove_by_id(p_all, (char *) "s_02");
-		remove_by_id(p_all, (char *) "s_03");
-		remove_by_id(p_all, (char *) "s_04");
-		remove_by_id(p_all, (char *) "s_05");
-		remove_by_id(p_all, (char *) "s_06");
-		remove_by_id(p_all, (char *) "s_07");
-		remove_by_id(p_all, (char *) "s_11");
-		remove_by_id(p_all, (char *) "s_12");
-		remove_by_id(p_all, (char *) "s_13");
-		remove_by_id(p_all, (char *) "s_16");
-		remove_by_id(p_all, (char *) "s_17");
-		remove_by_id(p_all, (char *) "s_19");
-		remove_by_id(p_all, (char *) "s_20");
-		remove_by_id(p_all, (char *) "s_21");
+		runs.resize(len);
 
-		REQUIRE(p_all->tree.size() == p_bak->tree.size());
-		REQUIRE(p_all->num_dirty_nodes == 19);
+		for (int i = 0; i < len; i++) {
+			int ll;
 
-		compare_iterating(p_all, p_con, false);
+			if (!image_get(p_bi, c_block, c_ofs, &runs[i].idx_child, sizeof(int)))
+				return false;
 
-		REQUIRE(p_all->tree.size() == p_bak->tree.size());
-		REQUIRE(p_all->tree.size() != p_con->tree.size());
-		REQUIRE(p_all->tree.size() - p_con->tree.size() == 19);
+			if (!image_get(p_bi, c_block, c_ofs, &ll, sizeof(ll)) || ll < 0)
+				return false;
 
-		p_all->purge();
+			runs[i].value.resize(ll);
 
-		REQUIRE(p_all->num_dirty_nodes == 0);
+			if (!image_get(p_bi, c_block, c_ofs, runs[i].value.data(), ll*sizeof(ElementId)))
+				return false;
 
-		int n_nodes = p_all->tree.size();
-		int n_sets	= p_all->id.size();
+			// Released runs are empty, live runs have at least one value.
+			if (ll == 0)
+				free_runs.push_back(i);
+		}
 
-		recurse_tree(p_all, 0, n_nodes, n_sets, 8);
+	} else {
+		// Images saved up to version 1.5.1 store the nodes as a single array of records.
+		section = "tree";
 
-		REQUIRE(n_nodes == 0);
-		REQUIRE(n_sets  == 0);
+		if (hs != MurmurHash64A(section.c_str(), section.length()))
+			return false;
 
-		check_sets(p_all);
+		if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 1)
+			return false;
 
-		compare_iterating(p_all, p_con, false);
+		tree.resize(len);
+		parent.resize(len);
+		state.resize(len);
+		legacy_values.resize(len);
 
-		REQUIRE(p_all->tree.size() == p_con->tree.size());
+		for (int i = 0; i < len; i++) {
+			LegacySetNode sn;
+			if (!image_get(p_bi, c_block, c_ofs, &sn, sizeof(sn)))
+				return false;
 
-		REQUIRE(p_bak->num_dirty_nodes == 0);
+			// The nodes store the element hash, it is converted to an ElementId once the names are loaded.
+			legacy_values[i] = sn.value;
+			tree[i]	  = {0, sn.idx_next, sn.idx_child};
+			parent[i] = sn.idx_parent;
+			state[i]  = sn.state;
+		}
+	}
 
-		remove_by_id(p_bak, (char *) "s_01");
-		remove_by_id(p_bak, (char *) "s_02");
-		remove_by_id(p_bak, (char *) "s_03");
-		remove_by_id(p_bak, (char *) "s_04");
-		remove_by_id(p_bak, (char *) "s_05");
-		remove_by_id(p_bak, (char *) "s_06");
-		remove_by_id(p_bak, (char *) "s_07");
-		remove_by_id(p_bak, (char *) "s_08");
-		remove_by_id(p_bak, (char *) "s_09");
-		remove_by_id(p_bak, (char *) "s_10");
-		remove_by_id(p_bak, (char *) "s_11");
-		remove_by_id(p_bak, (char *) "s_12");
-		remove_by_id(p_bak, (char *) "s_13");
-		remove_by_id(p_bak, (char *) "s_14");
-		remove_by_id(p_bak, (char *) "s_15");
-		remove_by_id(p_bak, (char *) "s_16");
-		remove_by_id(p_bak, (char *) "s_17");
-		remove_by_id(p_bak, (char *) "s_18");
-		remove_by_id(p_bak, (char *) "s_19");
+	section = "name";
 
-		REQUIRE(p_bak->num_dirty_nodes == 22);
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
+		return false;
 
-		compare_iterating(p_bak, p_vow, false);
+	if ((hs != MurmurHash64A(section.c_str(), section.length())) || (names.size() != 0))
+		return false;
 
-		REQUIRE(p_bak->tree.size() - p_vow->tree.size() == 22);
+	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 0)
+		return false;
 
-		p_bak->purge();
+	// The names are stored in ElementId order (legacy images store them in hash order, that order defines the ids). The current
+	// format stores the hash, count and length of all the names followed by their text as a single block.
+	names.resize(len);
 
-		REQUIRE(p_bak->num_dirty_nodes == 0);
+	IdList lengths(len);
 
-		n_nodes = p_bak->tree.size();
-		n_sets	= p_bak->id.size();
+	for (int i = 0; i < len; i++) {
+		ElementHash hh;
+		int			ll, count;
 
-		recurse_tree(p_bak, 0, n_nodes, n_sets, 8);
+		if (!image_get(p_bi, c_block, c_ofs, &hh, sizeof(hh)))
+			return false;
 
-		REQUIRE(n_nodes == 0);
-		REQUIRE(n_sets  == 0);
+		if (!image_get(p_bi, c_block, c_ofs, &count, sizeof(count)))
+			return false;
 
-		check_sets(p_bak);
+		if (!image_get(p_bi, c_block, c_ofs, &ll, sizeof(ll)))
+			return false;
 
-		compare_iterating(p_bak, p_vow, true);
+		if ((ll < 0) || (ll >= 8192 && legacy_values.size() > 0))
+			return false;
 
-		REQUIRE(p_bak->tree.size() == p_vow->tree.size());
+		if (legacy_values.size() > 0) {
+			if (!image_get(p_bi, c_block, c_ofs, &buffer, ll))
+				return false;
 
-		remove_by_id(p_all, (char *) "s_08");
-		remove_by_id(p_all, (char *) "s_09");
-		remove_by_id(p_all, (char *) "s_10");
-		remove_by_id(p_all, (char *) "s_14");
-		remove_by_id(p_all, (char *) "s_15");
-		remove_by_id(p_all, (char *) "s_18");
+			names[i].name = name_arena.add(buffer, ll);
+		} else
+			lengths[i] = ll;
 
-		REQUIRE(p_all->tree.size() == p_con->tree.size());
-		REQUIRE(p_all->num_dirty_nodes == 6);
+		names[i].hash  = hh;
+		names[i].count = count;
 
-		compare_iterating(p_all, p_non, true);
+		if (count > 0)
+			hh_nam[hh] = i;
+		else
+			free_elements.push_back(i);
+	}
 
-		REQUIRE(p_all->tree.size() == p_con->tree.size());
-		REQUIRE(p_all->tree.size() != p_non->tree.size());
-		REQUIRE(p_all->tree.size() - p_non->tree.size() == 6);
+	if (legacy_values.size() == 0) {
+		std::vector<char> text = {};
 
-		p_all->purge();
+		if (!image_get_text(p_bi, c_block, c_ofs, lengths, text))
+			return false;
 
-		REQUIRE(p_all->num_dirty_nodes == 0);
+		for (int i = 0, ofs = 0; i < len; ofs += lengths[i], i++)
+			names[i].name = name_arena.add(text.data() + ofs, lengths[i]);
+	}
 
-		n_nodes = p_all->tree.size();
-		n_sets	= p_all->id.size();
+	if (legacy_values.size() > 0) {
+		int size = tree.size();
 
-		recurse_tree(p_all, 0, n_nodes, n_sets, 8);
+		for (int i = 1; i < size; i++) {
+			if (state[i] == STATE_IS_GARBAGE) {
+				tree[i].value = 0xbaadF00D;
 
-		REQUIRE(n_nodes == 0);
-		REQUIRE(n_sets  == 0);
+				continue;
+			}
 
-		check_sets(p_all);
+			ElementTable::iterator it = hh_nam.find(legacy_values[i]);
 
-		compare_iterating(p_all, p_non, true);
+			if (it == hh_nam.end())
+				return false;
 
-		REQUIRE(p_all->tree.size() == p_non->tree.size());
-		REQUIRE(p_all->tree.size() == 1);
-		REQUIRE(p_all->hh_nam.size() == 0);
+			tree[i].value = it->second;
+		}
+	}
 
-		remove_by_id(p_bak, (char *) "s_00");
-		remove_by_id(p_bak, (char *) "s_20");
-		remove_by_id(p_bak, (char *) "s_21");
+	section = "id";
 
-		REQUIRE(p_bak->tree.size() == p_vow->tree.size());
-		REQUIRE(p_bak->num_dirty_nodes == 3);
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
+		return false;
 
-		compare_iterating(p_bak, p_non, true);
+	if ((hs != MurmurHash64A(section.c_str(), section.length())) || (id.size() != 0))
+		return false;
 
-		REQUIRE(p_bak->tree.size() == p_vow->tree.size());
-		REQUIRE(p_bak->tree.size() != p_non->tree.size());
-		REQUIRE(p_bak->tree.size() - p_non->tree.size() == 3);
+	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 0)
+		return false;
 
-		p_bak->purge();
+	if (legacy_values.size() > 0) {
+		for (int i = 0; i < len; i++) {
+			int ii, ll;
 
-		REQUIRE(p_bak->num_dirty_nodes == 0);
+			if (!image_get(p_bi, c_block, c_ofs, &ii, sizeof(ii)))
+				return false;
 
-		n_nodes = p_bak->tree.size();
-		n_sets	= p_bak->id.size();
+			if (!image_get(p_bi, c_block, c_ofs, &ll, sizeof(ll)))
+				return false;
 
-		recurse_tree(p_bak, 0, n_nodes, n_sets, 8);
+			if ((ll < 0) || (ll >= 8192))
+				return false;
 
-		REQUIRE(n_nodes == 0);
-		REQUIRE(n_sets  == 0);
+			if (!image_get(p_bi, c_block, c_ofs, &buffer, ll))
+				return false;
 
-		check_sets(p_bak);
+			id.set(ii, buffer, ll);
+		}
+	} else {
+		// The nodes, the lengths and the text of all the ids, each one as a single block.
+		IdList nodes(len), lengths(len);
 
-		compare_iterating(p_bak, p_non, true);
+		if (!image_get(p_bi, c_block, c_ofs, nodes.data(), len*sizeof(int)))
+			return false;
 
-		REQUIRE(p_bak->tree.size() == p_non->tree.size());
-		REQUIRE(p_bak->tree.size() == 1);
-		REQUIRE(p_bak->hh_nam.size() == 0);
+		if (!image_get(p_bi, c_block, c_ofs, lengths.data(), len*sizeof(int)))
+			return false;
 
-		insert(all, (char *) "a",	  (char *) "s_00");
-		insert(all, (char *) "a,b,c", (char *) "s_02");
+		std::vector<char> text = {};
 
-		REQUIRE(p_all->id.size() == 2);
-		REQUIRE(p_all->hh_nam.size() == 3);
-		REQUIRE(p_all->tree[0].state == STATE_IN_USE);
+		if (!image_get_text(p_bi, c_block, c_ofs, lengths, text))
+			return false;
 
-		insert(all, (char *) "", (char *) "void");
+		for (int i = 0, ofs = 0; i < len; ofs += lengths[i], i++) {
+			if (nodes[i] < 0 || nodes[i] >= tree.size())
+				return false;
 
-		REQUIRE(p_all->id.size() == 3);
-		REQUIRE(p_all->hh_nam.size() == 4);
-		REQUIRE(p_all->tree[0].state == STATE_HAS_SET_ID);
+			id.set(nodes[i], text.data() + ofs, lengths[i]);
+		}
+	}
 
-		remove_by_id(p_all, (char *) "s_02");
+	section = "end";
 
-		REQUIRE(p_all->hh_nam.size() == 2);
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
+		return false;
 
-		REQUIRE(p_all->remove(-1) == -2);
-		REQUIRE(p_all->remove(50) == -2);
-		REQUIRE(p_all->remove(0) == 0);
+	if (hs != MurmurHash64A(section.c_str(), section.length()))
+		return false;
 
-		REQUIRE(p_all->id.size() == 1);
-		REQUIRE(p_all->hh_nam.size() == 1);
-		REQUIRE(p_all->tree[0].state == STATE_IN_USE);
+	// Images saved before sibling chains were kept sorted are fixed here, the queries rely on the order.
+	sort_children();
 
-		REQUIRE(p_all->remove(0) == -2);
+	// The summaries are not stored, they are computed from the tree.
+	summary.resize(tree.size());
+	build_summaries(child(0));
 
-		REQUIRE(p_all->purge() == 0);
-		REQUIRE(p_all->purge() == -1);
+	summary[0].num_sets = id.size();
 
-		insert(all, (char *) "a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,r,s,t,u,v,w", (char *) "x");
-		REQUIRE(p_all->tree.size() == 24);
-		REQUIRE(p_all->tree[20].state == STATE_IN_USE);
-		REQUIRE(p_all->remove(20) == -2);
-		p_all->tree[20].state = STATE_HAS_SET_ID;
-		REQUIRE(p_all->remove(20) == -3);
-	}
-	destroy_settrie(bak);
-	destroy_settrie(non);
-	destroy_settrie(vow);
-	destroy_settrie(con);
-	destroy_settrie(all);
+	// The signatures are not stored, they are rebuilt from the tree.
+	if (use_signatures)
+		set_signatures(true);
+
+	return true;
 }
 
 
-SCENARIO("Test image_block_as_string() / string_as_image_block()") {
+bool SetTrie::save (pBinaryImage &p_bi) {
 
-	REQUIRE(sizeof(ImageBlock) == 6*1024);
+	RWGuard guard(rw_lock, false);
 
-	ImageBlock block;
+	String section = "settrie";
+	ElementHash hs = MurmurHash64A(section.c_str(), section.length());
 
-	block.size = IMAGE_BUFF_SIZE;
-	for (int i = 0; i < IMAGE_BUFF_SIZE; i++)
-		block.buffer[i] = i & 0xff;
+	image_put(p_bi, &hs, sizeof(hs));
 
-	block.block_num = 0;
+	int version = SETTRIE_IMAGE_VERSION;
 
-	char *p_str = image_block_as_string(block);
+	image_put(p_bi, &version, sizeof(version));
+	image_put(p_bi, &element_order, sizeof(element_order));
+	image_put(p_bi, &use_signatures, sizeof(use_signatures));
 
-	REQUIRE(strlen(p_str) == 8*1024);
+	section = "tree";
+	hs		= MurmurHash64A(section.c_str(), section.length());
 
-	// 00000001 00000010 00000011 00000100 00000101 00000110 00000111
+	image_put(p_bi, &hs, sizeof(hs));
 
-	// 0         1         2         3         4         5         6
-	// 0123456789012345678901234567890123456789012345678901234567890123
-	// ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/
+	int len = tree.size();
 
-	REQUIRE(p_str[12] == 'A');		// 000000
-	REQUIRE(p_str[13] == 'Q');		// 010000
-	REQUIRE(p_str[14] == 'I');		// 001000
-	REQUIRE(p_str[15] == 'D');		// 000011
-	REQUIRE(p_str[16] == 'B');		// 000001
-	REQUIRE(p_str[17] == 'A');		// 000000
-	REQUIRE(p_str[18] == 'U');		// 010100
-	REQUIRE(p_str[19] == 'G');		// 000110
-	REQUIRE(p_str[20] == 'B');		// 000001
+	image_put(p_bi, &len, sizeof(len));
+	image_put(p_bi, tree.data(), len*sizeof(SetNode));
+	image_put(p_bi, parent.data(), len*sizeof(int));
+	image_put(p_bi, state.data(), len*sizeof(uint8_t));
 
-	REQUIRE(p_str[8191] == b64chars[6135 & 0x3f]);
-	REQUIRE(p_str[8192] == 0);
+	len = runs.size();
 
-	ImageBlock block2;
+	image_put(p_bi, &len, sizeof(len));
 
-	REQUIRE(string_as_image_block(block2, p_str));
+	for (RunList::iterator it = runs.begin(); it != runs.end(); ++it) {
+		image_put(p_bi, &it->idx_child, sizeof(int));
+		int ll = it->value.size();
+		image_put(p_bi, &ll, sizeof(ll));
+		image_put(p_bi, it->value.data(), ll*sizeof(ElementId));
+	}
 
-	for (int ofs = 0; ofs < 8; ofs++) {
-		block.size = IMAGE_BUFF_SIZE;
-		for (int i = 0; i < IMAGE_BUFF_SIZE; i++)
-			block.buffer[i] = (i + ofs) & 0xff;
+	section = "name";
+	hs		= MurmurHash64A(section.c_str(), section.length());
 
-		block.block_num = 8 - ofs;
+	image_put(p_bi, &hs, sizeof(hs));
 
-		p_str = image_block_as_string(block);
+	len = names.size();
 
-		REQUIRE(strlen(p_str) == 8*1024);
+	image_put(p_bi, &len, sizeof(len));
 
-		REQUIRE(string_as_image_block(block2, p_str));
+	std::vector<char> text = {};
 
-		REQUIRE(block.size == block2.size);
-		REQUIRE(block.block_num == block2.block_num);
-		REQUIRE(MurmurHash64A(&block, sizeof(ImageBlock)) == MurmurHash64A(&block, sizeof(ImageBlock)));
+	for (NameList::iterator it = names.begin(); it != names.end(); ++it) {
+		image_put(p_bi, &it->hash, sizeof(ElementHash));
+		image_put(p_bi, &it->count, sizeof(int));
+		int ll = name_arena.length(it->name);
+		image_put(p_bi, &ll, sizeof(ll));
+
+		const char *p = name_arena.data(it->name);
+		text.insert(text.end(), p, p + ll);
 	}
-}
 
+	image_put_text(p_bi, text);
 
-SCENARIO("Test image_put() / image_get()") {
+	section = "id";
+	hs		= MurmurHash64A(section.c_str(), section.length());
 
-	uint8_t buffer1[4*IMAGE_BUFF_SIZE];
-	int		buffer4[IMAGE_BUFF_SIZE];
+	image_put(p_bi, &hs, sizeof(hs));
 
-	memset(buffer1, 0xcafebebe, 4*IMAGE_BUFF_SIZE);
+	len = id.size();
 
-	for (int i = 0; i < IMAGE_BUFF_SIZE; i++)
-		buffer4[i] = 2*i + 11;
+	image_put(p_bi, &len, sizeof(len));
 
-	pBinaryImage p_bi = new BinaryImage;
+	IdList nodes = {}, lengths = {};
 
-	REQUIRE(image_put(p_bi, &buffer1, IMAGE_BUFF_SIZE));
-	REQUIRE(image_put(p_bi, &buffer1, IMAGE_BUFF_SIZE - 1));
-	REQUIRE(image_put(p_bi, &buffer1, IMAGE_BUFF_SIZE + 2));
-	REQUIRE(image_put(p_bi, &buffer1, IMAGE_BUFF_SIZE - 1));
+	text.clear();
 
-	REQUIRE(image_put(p_bi, &buffer4,  4));
-	REQUIRE(image_put(p_bi, &buffer4,  8));
-	REQUIRE(image_put(p_bi, &buffer4, 16));
-	REQUIRE(image_put(p_bi, &buffer4, 32));
-
-	REQUIRE(image_put(p_bi, &buffer4, 3*IMAGE_BUFF_SIZE));
-
-	for (int i = 0; i < 8192; i++) {
-		image_put(p_bi, &i, 4);
-		image_put(p_bi, &i, 3);
-		image_put(p_bi, &i, 2);
-		image_put(p_bi, &i, 1);
+	for (IdTable::iterator it = id.begin(); it != id.end(); ++it) {
+		nodes.push_back(it->first);
+		lengths.push_back(it->second.length());
+		text.insert(text.end(), it->second.begin(), it->second.end());
 	}
 
-	for (int i = 0; i < p_bi->size(); i++)
-		REQUIRE((*p_bi)[i].block_num == i + 1);
+	image_put(p_bi, nodes.data(), len*sizeof(int));
+	image_put(p_bi, lengths.data(), len*sizeof(int));
+	image_put_text(p_bi, text);
 
-	uint8_t i_buffer1[4*IMAGE_BUFF_SIZE];
-	int		i_buffer4[IMAGE_BUFF_SIZE];
+	section = "end";
+	hs		= MurmurHash64A(section.c_str(), section.length());
 
-	for (int t = 0; t < 3; t++) {
-		int c_block = 0;
-		int c_ofs	= 0;
+	image_put(p_bi, &hs, sizeof(hs));
 
-		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer1, IMAGE_BUFF_SIZE));
-		REQUIRE(!memcmp(&buffer1, &i_buffer1, IMAGE_BUFF_SIZE));
+	return true;
+}
 
-		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer1, IMAGE_BUFF_SIZE - 1));
-		REQUIRE(!memcmp(&buffer1, &i_buffer1, IMAGE_BUFF_SIZE - 1));
 
-		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer1, IMAGE_BUFF_SIZE + 2));
-		REQUIRE(!memcmp(&buffer1, &i_buffer1, IMAGE_BUFF_SIZE + 2));
+/** Creates a cursor for a supersets() or subsets() query. The results are found by calling next().
 
-		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer1, IMAGE_BUFF_SIZE - 1));
-		REQUIRE(!memcmp(&buffer1, &i_buffer1, IMAGE_BUFF_SIZE - 1));
+	\param st	 The SetTrie to query. It must not be destroyed while the cursor is used.
+	\param kind CURSOR_SUPERSETS or CURSOR_SUBSETS.
+	\param set	 The elements of the query.
+*/
+SetTrieCursor::SetTrieCursor (SetTrie &st, int kind, StringSet set) : st(st) {
 
-		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4,  4));
-		REQUIRE(!memcmp(&buffer4, &i_buffer4,  4));
+	RWGuard guard(st.rw_lock, false);
 
-		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4,  8));
-		REQUIRE(!memcmp(&buffer4, &i_buffer4,  8));
+	this->kind	= kind;
+	num_changes = st.num_changes;
+	emit_root	= false;
 
-		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4, 16));
-		REQUIRE(!memcmp(&buffer4, &i_buffer4, 16));
+	if (kind == CURSOR_SUPERSETS) {
+		if (set.size() == 0) {
+			// All sets are the supersets of the empty set.
+			emit_root = st.state[0] == STATE_HAS_SET_ID;
 
-		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4, 32));
-		REQUIRE(!memcmp(&buffer4, &i_buffer4, 32));
+			stack.push_back({st.child(0), 0, true});
 
-		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4, 3*IMAGE_BUFF_SIZE));
-		REQUIRE(!memcmp(&buffer4, &i_buffer4, 3*IMAGE_BUFF_SIZE));
+			return;
+		}
 
-		bool failed = false;
-		for (int i = 0; i < 8192; i++) {
-			int i_i;
+		if (!st.prepare_query(set, true, query, query_mask))
+			return;
 
-			image_get(p_bi, c_block, c_ofs, &i_i, 4);
-			if (i != i_i)
-				failed = true;
-			image_get(p_bi, c_block, c_ofs, &i_i, 3);
-			if ((i & 0xffffff) != (i_i & 0xffffff))
-				failed = true;
-			image_get(p_bi, c_block, c_ofs, &i_i, 2);
-			if ((i & 0xffff) != (i_i & 0xffff))
-				failed = true;
-			image_get(p_bi, c_block, c_ofs, &i_i, 1);
-			if ((i & 0xff) != (i_i & 0xff))
-				failed = true;
+	} else {
+		emit_root = st.state[0] == STATE_HAS_SET_ID;
 
-			if (failed)
-				break;
-		}
-		REQUIRE(!failed);
+		if (!st.prepare_query(set, false, query, query_mask))
+			return;
 	}
 
-	delete p_bi;
+	last_query_idx = query.size() - 1;
+
+	stack.push_back({st.child(0), 0, false});
 }
 
+// -----------------------------------------------------------------------------------------------------------------------------------------
+//	VersionedSetTrie Implementation
+// -----------------------------------------------------------------------------------------------------------------------------------------
 
-SCENARIO("Test SetTrie.save() / SetTrie.load()") {
+/** Changes the draft of the next version. The readers keep seeing the current version until publish() is called.
 
-	SetTrie A;
+	\param fun A function that changes the draft, called while no other writer runs.
 
-	String key1 = {"no_1"};
-	String val1 = {"a b"};
+The first update() after a publish() copies the current version into the draft.
+*/
+void VersionedSetTrie::update (const std::function<void(SetTrie &)> &fun) {
 
-	A.insert(val1, key1, ' ');
+	std::lock_guard<std::mutex> lock(writer);
 
-	String key0 = {"empty"};
-	String val0 = {""};
+	if (!p_draft)
+		p_draft.reset(new SetTrie(*std::atomic_load(&current)));
 
-	A.insert(val0, key0, ',');
+	fun(*p_draft);
+}
 
-	key1 = {"no_2"};
-	val1 = {"a c d"};
 
-	A.insert(val1, key1, ' ');
+/** Makes the draft the current version. The readers holding the previous one keep it until they drop it.
 
-	key1 = {"yes_1"};
-	val1 = {"a c e"};
+	\return The number of the current version, unchanged if there was nothing to publish.
+*/
+uint64_t VersionedSetTrie::publish () {
 
-	A.insert(val1, key1, ' ');
+	std::lock_guard<std::mutex> lock(writer);
 
-	key1 = {"yes_2"};
-	val1 = {"a c d e"};
+	if (!p_draft)
+		return num_version;
 
-	A.insert(val1, key1, ' ');
+	std::atomic_store(&current, SetTrieSnapshot(p_draft.release()));
 
-	key1 = {"no_3"};
-	val1 = {"b d"};
+	return ++num_version;
+}
 
-	A.insert(val1, key1, ' ');
 
-	key1 = {"no_4"};
-	val1 = {"c d"};
+/** Replaces the whole SetTrie by one loaded from a binary image and publishes it. The image is loaded before taking the writer lock,
+	the readers never wait and the writers only wait for the swap. A draft not yet published is dropped.
 
-	A.insert(val1, key1, ' ');
+	\param p_bi The binary image.
 
-	key1 = {"yes_3"};
-	val1 = {"c e"};
+	\return	 False, with nothing changed, if the image could not be loaded.
+*/
+bool VersionedSetTrie::swap_in (pBinaryImage &p_bi) {
 
-	A.insert(val1, key1, ' ');
+	std::shared_ptr<SetTrie> p_st = std::make_shared<SetTrie>();
 
-	REQUIRE(A.supersets("c e", ' ').size()	== 3);
-	REQUIRE(A.supersets("a", ' ').size()	== 4);
-	REQUIRE(A.supersets("c", ' ').size()	== 5);
-	REQUIRE(A.supersets("b d", ' ').size()	== 1);
+	if (!p_st->load(p_bi))
+		return false;
 
-	SetTrie B;
+	std::lock_guard<std::mutex> lock(writer);
 
-	REQUIRE(B.supersets("c e", ' ').size()	== 0);
-	REQUIRE(B.supersets("a", ' ').size()	== 0);
-	REQUIRE(B.supersets("c", ' ').size()	== 0);
-	REQUIRE(B.supersets("b d", ' ').size()	== 0);
+	p_draft.reset();
 
-	pBinaryImage p_bi = new BinaryImage;
+	std::atomic_store(&current, SetTrieSnapshot(p_st));
 
-	REQUIRE(A.save(p_bi));
+	num_version++;
 
-	REQUIRE(B.load(p_bi));
+	return true;
+}
 
-	delete p_bi;
+// -----------------------------------------------------------------------------------------------------------------------------------------
+//	ShardedSetTrie Implementation
+// -----------------------------------------------------------------------------------------------------------------------------------------
 
-	REQUIRE(B.supersets("c e", ' ').size()	== 3);
-	REQUIRE(B.supersets("a", ' ').size()	== 4);
-	REQUIRE(B.supersets("c", ' ').size()	== 5);
-	REQUIRE(B.supersets("b d", ' ').size()	== 1);
+/** The shard of a set: a hash of the sorted hashes of its distinct elements, so the same set always goes to the same shard whatever the
+	order or the repetitions of its elements.
+*/
+int ShardedSetTrie::shard_of (StringSet &set) const {
+
+	std::vector<ElementHash> hashes(set.size());
+
+	for (int i = 0; i < (int) set.size(); i++)
+		hashes[i] = MurmurHash64A(set[i].c_str(), set[i].length());
+
+	std::sort(hashes.begin(), hashes.end());
+	hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+	return MurmurHash64A(hashes.data(), hashes.size()*sizeof(ElementHash)) % shard.size();
 }
 
 
-SCENARIO("Test save_as_binary_image() / push_binary_image_block(), etc.") {
+/** Inserts a set into its shard.
 
-	int a = new_settrie();
-	int b = new_settrie();
+	\param set	The set.
+	\param str_id The id of the set.
 
-	REQUIRE(a > 0);
-	REQUIRE(b > 0);
+	\return		False, with nothing changed, if the shard could run out of set_ids (see has_room()).
+*/
+bool ShardedSetTrie::insert (StringSet set, String str_id) {
 
-	GIVEN("I load something to use supersets()") {
-		insert(a, (char *) "a,b",				(char *) "sup01");
-		insert(a, (char *) "a,c,d",				(char *) "sup02");
-		insert(a, (char *) "a,c,e",				(char *) "sup03");
-		insert(a, (char *) "a,c,d,e",			(char *) "sup04");
-		insert(a, (char *) "b,d",				(char *) "sup05");
-		insert(a, (char *) "c,d",				(char *) "sup06");
-		insert(a, (char *) "c,e",				(char *) "sup07");
-		insert(a, (char *) "c,d,e,f",			(char *) "sup08");
-		insert(a, (char *) "c,d,n",				(char *) "sup09");
-		insert(a, (char *) "c,d,e,f,x",			(char *) "sup10");
-		insert(a, (char *) "c,d,e,f,y",			(char *) "sup11");
-		insert(a, (char *) "c,d,e,f,y,z",		(char *) "sup12");
-		insert(a, (char *) "d,e",				(char *) "sup13");
-		insert(a, (char *) "e,a,b,d,f,n,x,y,z", (char *) "sup14");
-		insert(a, (char *) "c",					(char *) "sup15");
-		insert(a, (char *) "e,y,z,c",			(char *) "sup16");
+	int k = shard_of(set);
 
-		char buffer[64], name[64];
+	RWGuard guard(shard[k].rw_lock, true);
 
-		for (int i = 0; i < 8192; i++) {
-			sprintf(buffer, "monster,knot%u,node%u", 3*i, i*i);
-			sprintf(name, "document%u", i);
-			insert(a, buffer, name);
-		}
+	if (!has_room(k, set.size()))
+		return false;
 
-		WHEN("I supersets() the original") {
-			int q1 = supersets(a, (char *) "c,e");
-			int q2 = supersets(a, (char *) "y,z");
-			int q3 = supersets(a, (char *) "d,e");
-			int q4 = supersets(a, (char *) "monster");
+	shard[k].insert(set, str_id);
 
-			REQUIRE(iterator_size(q1) == 8);
-			REQUIRE(iterator_size(q2) == 3);
-			REQUIRE(iterator_size(q3) == 7);
-			REQUIRE(iterator_size(q4) == 8192);
+	return true;
+}
 
-			int mask = 0;
-			String s;
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);
-			if (s == "sup12")
-				mask |= 1;
-			if (s == "sup14")
-				mask |= 2;
-			if (s == "sup16")
-				mask |= 4;
-			s = iterator_next(q3);REQUIRE(s != "");
+/** Inserts a batch of sets, the same as calling insert() for each one in order. The batch is split by shard and each shard inserts its
+	part, in the order of the batch, on its own thread.
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);
-			if (s == "sup12")
-				mask |= 1;
-			if (s == "sup14")
-				mask |= 2;
-			if (s == "sup16")
-				mask |= 4;
-			s = iterator_next(q3);REQUIRE(s != "");
+	\param sets	 The sets.
+	\param str_ids The id of each set. Only the first min(sets.size(), str_ids.size()) sets are inserted.
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);
-			if (s == "sup12")
-				mask |= 1;
-			if (s == "sup14")
-				mask |= 2;
-			if (s == "sup16")
-				mask |= 4;
-			s = iterator_next(q3);REQUIRE(s != "");
+	\return		 The number of sets inserted. A shard that could run out of set_ids (see has_room()) inserts none of its part.
+*/
+int ShardedSetTrie::insert_many (std::vector<StringSet> &sets, StringSet &str_ids) {
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s != "");
+	int size = std::min(sets.size(), str_ids.size()), n_shards = shard.size();
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s != "");
+	std::vector<std::vector<StringSet>> part_sets(n_shards);
+	std::vector<StringSet>				part_ids(n_shards);
+	std::vector<int64_t>				part_elements(n_shards);
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s != "");
+	for (int i = 0; i < size; i++) {
+		int k = shard_of(sets[i]);
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s != "");
+		part_sets[k].push_back(sets[i]);
+		part_ids[k].push_back(str_ids[i]);
+		part_elements[k] += sets[i].size();
+	}
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s == "");
+	std::atomic<int> num_inserted(0);
 
-			s = iterator_next(q1);REQUIRE(s == "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s == "");
+	parallel_for(std::min(num_threads, n_shards), n_shards, 1, [&](int lo, int hi) {
+		for (int k = lo; k < hi; k++) {
+			RWGuard guard(shard[k].rw_lock, true);
 
-			THEN("I get the expected keys") {
-				REQUIRE(mask == 7);
-			}
+			if (!has_room(k, part_elements[k]))
+				continue;
 
-			REQUIRE(iterator_size(q1) == 0);
-			REQUIRE(iterator_size(q2) == 0);
-			REQUIRE(iterator_size(q3) == 0);
+			shard[k].insert_many(part_sets[k], part_ids[k]);
 
-			destroy_iterator(q1);
-			destroy_iterator(q2);
-			destroy_iterator(q3);
-			destroy_iterator(q4);
+			num_inserted += part_sets[k].size();
 		}
-		WHEN("I supersets() the other object") {
-			int q1 = supersets(b, (char *) "c,e");
-			int q2 = supersets(b, (char *) "y,z");
-			int q3 = supersets(b, (char *) "d,e");
+	});
 
-			REQUIRE(q1 == 0);
-			REQUIRE(q2 == 0);
-			REQUIRE(q3 == 0);
-		}
-		WHEN("I copy the first object into the second") {
-			int i_a = save_as_binary_image(a);
+	return num_inserted;
+}
 
-			REQUIRE(i_a == a);
 
-			int i_a_size = binary_image_size(i_a);
+String ShardedSetTrie::find (StringSet set) const {
 
-			REQUIRE(i_a_size > 0);
+	return shard[shard_of(set)].find(set);
+}
 
-			for (int i = 0; i < i_a_size; i++) {
-				char *p_base64 = binary_image_next(i_a);
 
-				REQUIRE(strlen(p_base64) == 8192);
+int ShardedSetTrie::find_idx (StringSet set) const {
 
-				REQUIRE(push_binary_image_block(b, p_base64));
-			}
-			REQUIRE(binary_image_size(i_a) == 0);
-			destroy_binary_image(i_a);
+	int k   = shard_of(set);
+	int idx = shard[k].find_idx(set);
 
-			REQUIRE(push_binary_image_block(b, (char *) ""));
+	return idx < 0 ? idx : global_id(idx, k);
+}
 
-			THEN("I supersets() the other object") {
-				int q1 = supersets(b, (char *) "c,e");
-				int q2 = supersets(b, (char *) "y,z");
-				int q3 = supersets(b, (char *) "d,e");
-				int q4 = supersets(a, (char *) "monster");
 
-				REQUIRE(iterator_size(q1) == 8);
-				REQUIRE(iterator_size(q2) == 3);
-				REQUIRE(iterator_size(q3) == 7);
-				REQUIRE(iterator_size(q4) == 8192);
+/** Finds the supersets of a set in all the shards at once.
 
-				int mask = 0;
-				String s;
+	\param set	The query.
+	\param limit The maximum number of results. A negative value means no limit.
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);
-				if (s == "sup12")
-					mask |= 1;
+	\return		The ids of the supersets, the ones of shard 0 first. With a limit, the first ones in that order. Within a shard, the
+				order is the one of SetTrie::supersets(), not defined when set_query_threads() splits the query.
+*/
+StringSet ShardedSetTrie::supersets (StringSet set, int limit) const {
+
+	int n_shards = shard.size(), max_res = limit < 0 ? INT32_MAX : limit;
+
+	std::vector<StringSet> found(n_shards);
+
+	parallel_for(std::min(num_threads, n_shards), n_shards, 1, [&](int lo, int hi) {
+		for (int k = lo; k < hi; k++)
+			found[k] = shard[k].supersets(set, limit);
+	});
+
+	StringSet ret = {};
+
+	for (int k = 0; k < n_shards && (int) ret.size() < max_res; k++)
+		ret.insert(ret.end(), found[k].begin(), found[k].begin() + std::min((int) found[k].size(), max_res - (int) ret.size()));
+
+	return ret;
+}
+
+
+/** Finds the subsets of a set in all the shards at once.
+
+	\param set	The query.
+	\param limit The maximum number of results. A negative value means no limit.
+
+	\return		The ids of the subsets, the ones of shard 0 first. With a limit, the first ones in that order. Within a shard, the
+				order is the one of SetTrie::subsets(), not defined when set_query_threads() splits the query.
+*/
+StringSet ShardedSetTrie::subsets (StringSet set, int limit) const {
+
+	int n_shards = shard.size(), max_res = limit < 0 ? INT32_MAX : limit;
+
+	std::vector<StringSet> found(n_shards);
+
+	parallel_for(std::min(num_threads, n_shards), n_shards, 1, [&](int lo, int hi) {
+		for (int k = lo; k < hi; k++)
+			found[k] = shard[k].subsets(set, limit);
+	});
+
+	StringSet ret = {};
+
+	for (int k = 0; k < n_shards && (int) ret.size() < max_res; k++)
+		ret.insert(ret.end(), found[k].begin(), found[k].begin() + std::min((int) found[k].size(), max_res - (int) ret.size()));
+
+	return ret;
+}
+
+
+IdList ShardedSetTrie::supersets_idx (StringSet set, int limit) const {
+
+	std::vector<StringSet> sets = {set};
+
+	return supersets_batch(sets, limit).set_ids;
+}
+
+
+IdList ShardedSetTrie::subsets_idx (StringSet set, int limit) const {
+
+	std::vector<StringSet> sets = {set};
+
+	return subsets_batch(sets, limit).set_ids;
+}
+
+
+int ShardedSetTrie::count_supersets (StringSet set) const {
+
+	int n_shards = shard.size();
+
+	IdList count(n_shards);
+
+	parallel_for(std::min(num_threads, n_shards), n_shards, 1, [&](int lo, int hi) {
+		for (int k = lo; k < hi; k++)
+			count[k] = shard[k].count_supersets(set);
+	});
+
+	int total = 0;
+
+	for (int k = 0; k < n_shards; k++)
+		total += count[k];
+
+	return total;
+}
+
+
+int ShardedSetTrie::count_subsets (StringSet set) const {
+
+	int n_shards = shard.size();
+
+	IdList count(n_shards);
+
+	parallel_for(std::min(num_threads, n_shards), n_shards, 1, [&](int lo, int hi) {
+		for (int k = lo; k < hi; k++)
+			count[k] = shard[k].count_subsets(set);
+	});
+
+	int total = 0;
+
+	for (int k = 0; k < n_shards; k++)
+		total += count[k];
+
+	return total;
+}
+
+
+QueryBatch ShardedSetTrie::supersets_batch (std::vector<StringSet> &sets, int limit) const {
+
+	return query_batch(CURSOR_SUPERSETS, sets, limit);
+}
+
+
+QueryBatch ShardedSetTrie::subsets_batch (std::vector<StringSet> &sets, int limit) const {
+
+	return query_batch(CURSOR_SUBSETS, sets, limit);
+}
+
+
+/** Finds many sets by their elements at once. Each set is only searched in its shard, the shards search their part at the same time.
+
+	\param sets The sets.
+
+	\return		The set_id of each set or -1 if it is not in the tree.
+*/
+IdList ShardedSetTrie::find_batch (std::vector<StringSet> &sets) const {
+
+	int size = sets.size(), n_shards = shard.size();
+
+	std::vector<std::vector<StringSet>> part(n_shards);
+	std::vector<IdList>					pos(n_shards), found(n_shards);
+
+	for (int i = 0; i < size; i++) {
+		int k = shard_of(sets[i]);
+
+		part[k].push_back(sets[i]);
+		pos[k].push_back(i);
+	}
+
+	parallel_for(std::min(num_threads, n_shards), n_shards, 1, [&](int lo, int hi) {
+		for (int k = lo; k < hi; k++)
+			found[k] = shard[k].find_batch(part[k]);
+	});
+
+	IdList ret(size);
+
+	for (int k = 0; k < n_shards; k++)
+		for (int j = 0; j < (int) pos[k].size(); j++)
+			ret[pos[k][j]] = found[k][j] < 0 ? found[k][j] : global_id(found[k][j], k);
+
+	return ret;
+}
+
+
+/** Runs a batch of supersets() or subsets() queries on every shard, each shard on a thread, and merges the results of each query in
+	shard order, up to limit.
+*/
+QueryBatch ShardedSetTrie::query_batch (int kind, std::vector<StringSet> &sets, int limit) const {
+
+	int size = sets.size(), n_shards = shard.size(), max_res = limit < 0 ? INT32_MAX : limit;
+
+	std::vector<QueryBatch> found(n_shards);
+
+	parallel_for(std::min(num_threads, n_shards), n_shards, 1, [&](int lo, int hi) {
+		for (int k = lo; k < hi; k++)
+			found[k] = kind == CURSOR_SUPERSETS ? shard[k].supersets_batch(sets, limit) : shard[k].subsets_batch(sets, limit);
+	});
+
+	QueryBatch batch = {};
+
+	batch.offset.push_back(0);
+
+	for (int i = 0; i < size; i++) {
+		int num_res = 0;
+
+		for (int k = 0; k < n_shards; k++) {
+			QueryBatch &fk = found[k];
+
+			for (int j = fk.offset[i]; j < fk.offset[i + 1] && num_res < max_res; j++, num_res++)
+				batch.set_ids.push_back(global_id(fk.set_ids[j], k));
+		}
+		batch.offset.push_back(batch.set_ids.size());
+	}
+
+	return batch;
+}
+
+
+StringSet ShardedSetTrie::elements (int idx) const {
+
+	if (idx < 0)
+		return {};
+
+	return shard[idx % shard.size()].elements(idx / shard.size());
+}
+
+
+/** The id string of a set, an empty string if there is none.
+*/
+String ShardedSetTrie::set_name (int idx) const {
+
+	if (idx < 0)
+		return "";
+
+	const SetTrie &st = shard[idx % shard.size()];
+
+	RWGuard guard(st.rw_lock, false);
+
+	return st.id[idx / shard.size()];
+}
+
+
+/** Iterates over the set_ids, the ones of shard 0 first.
+
+	\param idx The previous set_id returned or -1 to start.
+
+	\return	The next set_id or -1 if there are no more.
+*/
+int ShardedSetTrie::next_set_id (int idx) const {
+
+	int n_shards = shard.size(), k = 0, local = 0;
+
+	if (idx >= 0) {
+		k	  = idx % n_shards;
+		local = idx / n_shards + 1;
+	}
+
+	for (; k < n_shards; k++, local = 0) {
+		RWGuard guard(shard[k].rw_lock, false);
+
+		int ni = shard[k].id.next_node(local);
+
+		if (ni >= 0)
+			return global_id(ni, k);
+	}
+
+	return -1;
+}
+
+
+/** The number of sets in all the shards.
+*/
+int ShardedSetTrie::size () const {
+
+	int total = 0;
+
+	for (int k = 0; k < (int) shard.size(); k++) {
+		RWGuard guard(shard[k].rw_lock, false);
+
+		total += shard[k].id.size();
+	}
+
+	return total;
+}
+
+
+int ShardedSetTrie::remove (int idx) {
+
+	if (idx < 0)
+		return -2;
+
+	return shard[idx % shard.size()].remove(idx / shard.size());
+}
+
+
+/** Finds a set by its id string. The id strings do not decide the shard, so all the shards are searched.
+
+	\param str_id The id the set was inserted with.
+
+	\return	The set_id (of the first shard having the id) or -1 if there is none.
+*/
+int ShardedSetTrie::find_by_id (String str_id) const {
+
+	for (int k = 0; k < (int) shard.size(); k++) {
+		int idx = shard[k].find_by_id(str_id);
+
+		if (idx >= 0)
+			return global_id(idx, k);
+	}
+
+	return -1;
+}
+
+
+/** Removes a set by its id string, the one find_by_id() finds.
+
+	\param str_id The id the set was inserted with.
+
+	\return	0 on success, -1 if there is no set with that id.
+*/
+int ShardedSetTrie::remove_by_id (String str_id) {
+
+	for (int k = 0; k < (int) shard.size(); k++)
+		if (shard[k].remove_by_id(str_id) == 0)
+			return 0;
+
+	return -1;
+}
+
+
+/** Purges all the shards. The set_ids of the shards having garbage change.
+
+	\return	0 if any shard was purged, -1 if none had garbage.
+*/
+int ShardedSetTrie::purge () {
+
+	int ret = -1;
+
+	for (int k = 0; k < (int) shard.size(); k++)
+		if (shard[k].purge() == 0)
+			ret = 0;
+
+	return ret;
+}
+
+
+/** The number of nodes purge() would release in all the shards.
+*/
+int ShardedSetTrie::num_dirty_nodes () const {
+
+	int total = 0;
+
+	for (int k = 0; k < (int) shard.size(); k++) {
+		RWGuard guard(shard[k].rw_lock, false);
+
+		total += shard[k].num_dirty_nodes;
+	}
+
+	return total;
+}
+
+
+bool ShardedSetTrie::set_element_order (int order) {
+
+	if (order < ELEMENT_ORDER_INSERTION || order > ELEMENT_ORDER_RARE_FIRST)
+		return false;
+
+	for (int k = 0; k < (int) shard.size(); k++)
+		shard[k].set_element_order(order);
+
+	return true;
+}
+
+
+void ShardedSetTrie::set_signatures (bool enable) {
+
+	for (int k = 0; k < (int) shard.size(); k++)
+		shard[k].set_signatures(enable);
+}
+
+
+/** Sets the number of threads each shard uses for a broad query (see SetTrie::set_query_threads()). The shards themselves are
+	queried on the num_threads threads given to the constructor.
+*/
+bool ShardedSetTrie::set_query_threads (int num_threads) {
+
+	if (num_threads < 1)
+		return false;
+
+	for (int k = 0; k < (int) shard.size(); k++)
+		shard[k].set_query_threads(num_threads);
+
+	return true;
+}
+
+
+/** Loads the shards saved by save(). The number of shards becomes the one of the image.
+
+	\param p_bi The binary image.
+
+	\return	False, with nothing changed, if the ShardedSetTrie is not empty or the image is not valid.
+
+It replaces the shards, so it must not run while other threads use the ShardedSetTrie.
+*/
+bool ShardedSetTrie::load (pBinaryImage &p_bi) {
+
+	if (size() != 0)
+		return false;
+
+	int c_block = 0, c_ofs = 0;
+
+	String		section = "sharded";
+	ElementHash hs;
+
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)) || hs != MurmurHash64A(section.c_str(), section.length()))
+		return false;
+
+	int version, n_shards;
+
+	if (!image_get(p_bi, c_block, c_ofs, &version, sizeof(version)) || version != SETTRIE_IMAGE_VERSION)
+		return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, &n_shards, sizeof(n_shards)) || n_shards < 1 || n_shards > MAX_SHARDS)
+		return false;
+
+	std::vector<SetTrie> loaded(n_shards);
+
+	char buffer[IMAGE_BUFF_SIZE];
+
+	for (int k = 0; k < n_shards; k++) {
+		int64_t len;
+
+		if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 0)
+			return false;
+
+		// Each shard is stored as the bytes of its own image.
+		BinaryImage	 img  = {};
+		pBinaryImage p_img = &img;
+
+		while (len > 0) {
+			int mv_size = std::min(len, (int64_t) IMAGE_BUFF_SIZE);
+
+			if (!image_get(p_bi, c_block, c_ofs, buffer, mv_size))
+				return false;
+
+			image_put(p_img, buffer, mv_size);
+
+			len -= mv_size;
+		}
+
+		if (!loaded[k].load(p_img))
+			return false;
+	}
+
+	shard.swap(loaded);
+
+	return true;
+}
+
+
+/** Saves all the shards, each one as its own image after the number of shards.
+
+	\param p_bi The binary image.
+
+	\return	False if a shard could not be saved.
+
+Each shard is saved under its own lock, one after another, so it must not run while other threads change the ShardedSetTrie.
+*/
+bool ShardedSetTrie::save (pBinaryImage &p_bi) {
+
+	String section = "sharded";
+	ElementHash hs = MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	int version = SETTRIE_IMAGE_VERSION, n_shards = shard.size();
+
+	image_put(p_bi, &version, sizeof(version));
+	image_put(p_bi, &n_shards, sizeof(n_shards));
+
+	for (int k = 0; k < n_shards; k++) {
+		BinaryImage	 img  = {};
+		pBinaryImage p_img = &img;
+
+		if (!shard[k].save(p_img))
+			return false;
+
+		int64_t len = 0;
+
+		for (int b = 0; b < (int) img.size(); b++)
+			len += img[b].size;
+
+		image_put(p_bi, &len, sizeof(len));
+
+		for (int b = 0; b < (int) img.size(); b++)
+			image_put(p_bi, img[b].buffer, img[b].size);
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------------
+//	FrozenSetTrie Implementation
+// -----------------------------------------------------------------------------------------------------------------------------------------
+
+inline void image_put_string(pBinaryImage p_bi, String &str) {
+	int ll = str.length();
+	image_put(p_bi, &ll, sizeof(ll));
+	image_put(p_bi, (void *) str.c_str(), ll);
+}
+
+
+inline bool image_get_string(pBinaryImage p_bi, int &c_block, int &c_ofs, String &str) {
+	int ll;
+
+	if (!image_get(p_bi, c_block, c_ofs, &ll, sizeof(ll)) || ll < 0)
+		return false;
+
+	str.resize(ll);
+
+	return ll == 0 || image_get(p_bi, c_block, c_ofs, &str[0], ll);
+}
+
+
+inline void image_put_words(pBinaryImage p_bi, int bits, std::vector<uint64_t> &words) {
+	image_put(p_bi, &bits, sizeof(bits));
+	image_put(p_bi, words.data(), words.size()*sizeof(uint64_t));
+}
+
+
+inline bool image_get_words(pBinaryImage p_bi, int &c_block, int &c_ofs, int &bits, std::vector<uint64_t> &words) {
+
+	if (!image_get(p_bi, c_block, c_ofs, &bits, sizeof(bits)) || bits < 0)
+		return false;
+
+	words.resize(((uint64_t) bits + 63) >> 6);
+
+	return image_get(p_bi, c_block, c_ofs, words.data(), words.size()*sizeof(uint64_t));
+}
+
+
+void FrozenSetTrie::build (SetTrie &st) {
+
+	louds	 = {};
+	terminal = {};
+	values	 = {};
+	hashes	 = {};
+	codes	 = {};
+	names	 = {};
+	ids		 = {};
+
+	ElementSlotList by_hash = st.hh_nam.sorted();
+
+	for (ElementSlotList::iterator it = by_hash.begin(); it != by_hash.end(); ++it) {
+		hashes.push_back(it->first);
+		codes.push_back(it->second);
+	}
+
+	for (NameList::iterator it = st.names.begin(); it != st.names.end(); ++it)
+		names.push_back(st.name_arena.get(it->name));
+
+	int bits = 1;
+	while (bits < 32 && ((uint64_t) 1 << bits) < names.size())
+		bits++;
+
+	values.set_width(bits);
+
+	// The runs of the SetTrie are expanded, each value of a run is a node with a single child. A queue item is a SetTrie node and
+	// a position in its run (-1 for the value of the node itself).
+	IdList queue = {0}, queue_pos = {-1};
+
+	for (int h = 0; h < (int) queue.size(); h++) {
+		int i = queue[h], pos = queue_pos[h];
+		int ri = st.tree[i].idx_child, len = ri < 0 ? st.runs[~ri].value.size() : 0;
+
+		if (i == 0)
+			values.push_back(0);
+		else
+			values.push_back(pos < 0 ? st.tree[i].value : st.runs[~ri].value[pos]);
+
+		if (pos + 1 < len) {
+			terminal.push_back(false);
+
+			louds.push_back(true);
+			queue.push_back(i);
+			queue_pos.push_back(pos + 1);
+			louds.push_back(false);
+
+			continue;
+		}
+
+		bool has_id = st.state[i] == STATE_HAS_SET_ID;
+
+		terminal.push_back(has_id);
+
+		if (has_id)
+			ids.push_back(st.id[i]);
+
+		for (int j = st.child(i); j != 0; j = st.tree[j].idx_next) {
+			louds.push_back(true);
+			queue.push_back(j);
+			queue_pos.push_back(-1);
+		}
+		louds.push_back(false);
+	}
+
+	louds.build();
+	terminal.build();
+}
+
+
+String FrozenSetTrie::find (StringSet set) const {
+
+	int v = 0, size = set.size();
+
+	IdList &query = query_context().query;
+
+	query.clear();
+
+	for (int i = 0; i < size; i++) {
+		int cc = code(MurmurHash64A(set[i].c_str(), set[i].length()));
+
+		if (cc < 0)
+			return "";
+
+		query.push_back(cc);
+	}
+	std::sort(query.begin(), query.end());
+
+	query.erase(unique(query.begin(), query.end()), query.end());
+
+	size = query.size();
+
+	for (int i = 0; i < size; i++) {
+		int first, last;
+		children(v, first, last);
+
+		int lo = first, hi = last;
+
+		while (lo < hi) {
+			int mid = (lo + hi) >> 1;
+
+			if ((int) values.get(mid) < query[i])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		if (lo == last || (int) values.get(lo) != query[i])
+			return "";
+
+		v = lo;
+	}
+
+	if (!terminal.get(v))
+		return "";
+
+	return ids[terminal.rank1(v)];
+}
+
+
+String FrozenSetTrie::find (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
+
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
+
+	return find(set);
+}
+
+
+StringSet FrozenSetTrie::supersets (StringSet set) const {
+
+	StringSet ret = {};
+
+	int size = set.size();
+
+	if (size == 0)
+		return ids;
+
+	SnapshotContext &ctx = query_context();
+
+	ctx.query.clear();
+
+	for (int i = 0; i < size; i++) {
+		int cc = code(MurmurHash64A(set[i].c_str(), set[i].length()));
+
+		if (cc < 0)
+			return ret;
+
+		ctx.query.push_back(cc);
+	}
+	std::sort(ctx.query.begin(), ctx.query.end());
+
+	ctx.query.erase(unique(ctx.query.begin(), ctx.query.end()), ctx.query.end());
+
+	ctx.last_query_idx = ctx.query.size() - 1;
+
+	ctx.result.clear();
+	ctx.stack.clear();
+
+	push_children(ctx, 0, 0, false);
+	supersets(ctx);
+
+	size = ctx.result.size();
+	for (int i = 0; i < size; i++)
+		ret.push_back(ids[terminal.rank1(ctx.result[i])]);
+
+	return ret;
+}
+
+
+StringSet FrozenSetTrie::supersets (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
+
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
+
+	return supersets(set);
+}
+
+
+StringSet FrozenSetTrie::subsets (StringSet set) const {
+
+	StringSet ret = {};
+
+	if (terminal.get(0))
+		ret.push_back(ids[0]);
+
+	SnapshotContext &ctx = query_context();
+
+	ctx.query.clear();
+
+	int size = set.size();
+
+	for (int i = 0; i < size; i++) {
+		int cc = code(MurmurHash64A(set[i].c_str(), set[i].length()));
+
+		if (cc >= 0)
+			ctx.query.push_back(cc);
+	}
+	if (ctx.query.size() == 0)
+		return ret;
+
+	std::sort(ctx.query.begin(), ctx.query.end());
+
+	ctx.query.erase(unique(ctx.query.begin(), ctx.query.end()), ctx.query.end());
+
+	ctx.last_query_idx = ctx.query.size() - 1;
+
+	ctx.result.clear();
+	ctx.stack.clear();
+
+	push_children(ctx, 0, 0, false);
+	subsets(ctx);
+
+	size = ctx.result.size();
+	for (int i = 0; i < size; i++)
+		ret.push_back(ids[terminal.rank1(ctx.result[i])]);
+
+	return ret;
+}
+
+
+StringSet FrozenSetTrie::subsets (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
+
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
+
+	return subsets(set);
+}
+
+
+StringSet FrozenSetTrie::elements (int idx) const {
+
+	StringSet ret = {};
+
+	if (idx > 0 && idx < num_nodes() && terminal.get(idx)) {
+		while (idx > 0) {
+			ret.push_back(names[values.get(idx)]);
+
+			idx = parent(idx);
+		}
+	}
+
+	return ret;
+}
+
+
+bool FrozenSetTrie::load (pBinaryImage &p_bi) {
+
+	int c_block = 0, c_ofs = 0;
+
+	String		section = "frozen";
+	ElementHash hs;
+
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)) || hs != MurmurHash64A(section.c_str(), section.length()))
+		return false;
+
+	int version, len, width;
+
+	if (!image_get(p_bi, c_block, c_ofs, &version, sizeof(version)) || version != SETTRIE_IMAGE_VERSION)
+		return false;
+
+	if (!image_get_words(p_bi, c_block, c_ofs, louds.num_bits, louds.words))
+		return false;
+
+	if (!image_get_words(p_bi, c_block, c_ofs, terminal.num_bits, terminal.words))
+		return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, &width, sizeof(width)) || width < 1 || width > 32)
+		return false;
+
+	values.set_width(width);
+
+	if (!image_get_words(p_bi, c_block, c_ofs, len, values.words) || len % width != 0)
+		return false;
+
+	values.size = len/width;
+
+	if (louds.num_bits != 2*values.size - 1 || terminal.num_bits != values.size)
+		return false;
+
+	louds.build();
+	terminal.build();
+
+	section = "name";
+
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)) || hs != MurmurHash64A(section.c_str(), section.length()))
+		return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 0)
+		return false;
+
+	names.resize(len);
+
+	for (int i = 0; i < len; i++)
+		if (!image_get_string(p_bi, c_block, c_ofs, names[i]))
+			return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 0 || len > names.size())
+		return false;
+
+	hashes.resize(len);
+	codes.resize(len);
+
+	if (!image_get(p_bi, c_block, c_ofs, hashes.data(), len*sizeof(ElementHash)))
+		return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, codes.data(), len*sizeof(int)))
+		return false;
+
+	section = "id";
+
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)) || hs != MurmurHash64A(section.c_str(), section.length()))
+		return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len != terminal.rank1(terminal.num_bits))
+		return false;
+
+	ids.resize(len);
+
+	for (int i = 0; i < len; i++)
+		if (!image_get_string(p_bi, c_block, c_ofs, ids[i]))
+			return false;
+
+	section = "end";
+
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
+		return false;
+
+	return hs == MurmurHash64A(section.c_str(), section.length());
+}
+
+
+bool FrozenSetTrie::save (pBinaryImage &p_bi) {
+
+	String section = "frozen";
+	ElementHash hs = MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	int version = SETTRIE_IMAGE_VERSION;
+
+	image_put(p_bi, &version, sizeof(version));
+
+	image_put_words(p_bi, louds.num_bits, louds.words);
+	image_put_words(p_bi, terminal.num_bits, terminal.words);
+
+	image_put(p_bi, &values.width, sizeof(int));
+	image_put_words(p_bi, values.size*values.width, values.words);
+
+	section = "name";
+	hs		= MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	int len = names.size();
+
+	image_put(p_bi, &len, sizeof(len));
+
+	for (int i = 0; i < len; i++)
+		image_put_string(p_bi, names[i]);
+
+	len = hashes.size();
+
+	image_put(p_bi, &len, sizeof(len));
+	image_put(p_bi, hashes.data(), len*sizeof(ElementHash));
+	image_put(p_bi, codes.data(), len*sizeof(int));
+
+	section = "id";
+	hs		= MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	len = ids.size();
+
+	image_put(p_bi, &len, sizeof(len));
+
+	for (int i = 0; i < len; i++)
+		image_put_string(p_bi, ids[i]);
+
+	section = "end";
+	hs		= MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------------
+//	DawgSetTrie Implementation
+// -----------------------------------------------------------------------------------------------------------------------------------------
+
+inline void image_put_packed(pBinaryImage p_bi, PackedArray &pa) {
+	image_put(p_bi, &pa.width, sizeof(int));
+	image_put_words(p_bi, pa.size*pa.width, pa.words);
+}
+
+
+inline bool image_get_packed(pBinaryImage p_bi, int &c_block, int &c_ofs, PackedArray &pa) {
+	int width, len;
+
+	if (!image_get(p_bi, c_block, c_ofs, &width, sizeof(width)) || width < 1 || width > 32)
+		return false;
+
+	pa.set_width(width);
+
+	if (!image_get_words(p_bi, c_block, c_ofs, len, pa.words) || len % width != 0)
+		return false;
+
+	pa.size = len/width;
+
+	return true;
+}
+
+
+inline int bits_for(uint64_t n) {
+	int bits = 1;
+	while (bits < 32 && ((uint64_t) 1 << bits) <= n)
+		bits++;
+
+	return bits;
+}
+
+
+/** Reduces the whole SetTrie, returning the root state of the DAWG. Each subtree (the value of a node at a position of its run) becomes
+	the state of the DAWG equivalent to it, registered unless an identical state exists. The set ids are collected in depth first order.
+
+	A state is identified by its key: the terminal flag followed by the value and the target state of each edge.
+
+The subtrees are reduced in post order from an explicit stack of ReduceFrame, so a long path does not need a deep call stack.
+*/
+int DawgSetTrie::reduce (SetTrie &st, StateRegister &reg, std::vector<BinarySet> &keys, IdList &count) {
+
+	std::vector<ReduceFrame> stack = {};
+
+	// Opening a frame collects the id of its set before the sets below it.
+	auto open = [&](int i, int pos) {
+		int ri = st.tree[i].idx_child, len = ri < 0 ? st.runs[~ri].value.size() : 0;
+
+		ReduceFrame f = {i, pos, -1, 0, {0}};
+
+		if (pos + 1 >= len) {
+			if (st.state[i] == STATE_HAS_SET_ID) {
+				f.key[0] = 1;
+				f.n		 = 1;
+				ids.push_back(st.id[i]);
+			}
+			f.j = st.child(i);
+		}
+		stack.push_back(f);
+	};
+
+	open(0, -1);
+
+	while (true) {
+		ReduceFrame &f = stack.back();
+
+		if (f.j == -1) {
+			open(f.i, f.pos + 1);
+
+			continue;
+		}
+
+		if (f.j != 0) {
+			open(f.j, -1);
+
+			continue;
+		}
+
+		int s;
+
+		StateRegister::iterator it = reg.find(f.key);
+
+		if (it != reg.end())
+			s = it->second;
+		else {
+			s = keys.size();
+
+			keys.push_back(f.key);
+			count.push_back(f.n);
+
+			reg[f.key] = s;
+		}
+
+		stack.pop_back();
+
+		if (stack.empty())
+			return s;
+
+		// The state s is the target of the next edge of the parent.
+		ReduceFrame &p = stack.back();
+
+		if (p.j == -1) {
+			p.key.push_back(st.runs[~st.tree[p.i].idx_child].value[p.pos + 1]);
+			p.j = 0;
+		} else {
+			p.key.push_back(st.tree[p.j].value);
+			p.j = st.tree[p.j].idx_next;
+		}
+		p.key.push_back(s);
+		p.n += count[s];
+	}
+}
+
+
+void DawgSetTrie::build (SetTrie &st) {
+
+	terminal = {};
+	first	 = {};
+	values	 = {};
+	targets	 = {};
+	ranks	 = {};
+	counts	 = {};
+	hashes	 = {};
+	codes	 = {};
+	names	 = {};
+	ids		 = {};
+
+	ElementSlotList by_hash = st.hh_nam.sorted();
+
+	for (ElementSlotList::iterator it = by_hash.begin(); it != by_hash.end(); ++it) {
+		hashes.push_back(it->first);
+		codes.push_back(it->second);
+	}
+
+	for (NameList::iterator it = st.names.begin(); it != st.names.end(); ++it)
+		names.push_back(st.name_arena.get(it->name));
+
+	StateRegister		   reg	 = {};
+	std::vector<BinarySet> keys	 = {};
+	IdList				   count = {};
+
+	root = reduce(st, reg, keys, count);
+
+	int num_states = keys.size(), num_edges = 0;
+
+	for (int s = 0; s < num_states; s++)
+		num_edges += keys[s].size()/2;
+
+	first.set_width(bits_for(num_edges));
+	values.set_width(bits_for(names.size()));
+	targets.set_width(bits_for(num_states));
+	ranks.set_width(bits_for(ids.size()));
+	counts.set_width(bits_for(ids.size()));
+
+	int e = 0;
+
+	for (int s = 0; s < num_states; s++) {
+		BinarySet &key = keys[s];
+
+		int size = key.size(), rank = key[0];
+
+		terminal.push_back(key[0] == 1);
+		first.push_back(e);
+		counts.push_back(count[s]);
+
+		for (int k = 1; k < size; k += 2) {
+			values.push_back(key[k]);
+			targets.push_back(key[k + 1]);
+			ranks.push_back(rank);
+
+			rank += count[key[k + 1]];
+			e++;
+		}
+	}
+	first.push_back(e);
+
+	terminal.build();
+}
+
+
+String DawgSetTrie::find (StringSet set) const {
+
+	int s = root, rank = 0, size = set.size();
+
+	IdList &query = query_context().query;
+
+	query.clear();
+
+	for (int i = 0; i < size; i++) {
+		int cc = code(MurmurHash64A(set[i].c_str(), set[i].length()));
+
+		if (cc < 0)
+			return "";
+
+		query.push_back(cc);
+	}
+	std::sort(query.begin(), query.end());
+
+	query.erase(unique(query.begin(), query.end()), query.end());
+
+	size = query.size();
+
+	for (int i = 0; i < size; i++) {
+		int e = edge(s, query[i]);
+
+		if (e < 0)
+			return "";
+
+		rank += ranks.get(e);
+		s	  = targets.get(e);
+	}
+
+	if (!terminal.get(s))
+		return "";
+
+	return ids[rank];
+}
+
+
+String DawgSetTrie::find (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
+
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
+
+	return find(set);
+}
+
+
+StringSet DawgSetTrie::supersets (StringSet set) const {
+
+	StringSet ret = {};
+
+	int size = set.size();
+
+	if (size == 0)
+		return ids;
+
+	SnapshotContext &ctx = query_context();
+
+	ctx.query.clear();
+
+	for (int i = 0; i < size; i++) {
+		int cc = code(MurmurHash64A(set[i].c_str(), set[i].length()));
+
+		if (cc < 0)
+			return ret;
+
+		ctx.query.push_back(cc);
+	}
+	std::sort(ctx.query.begin(), ctx.query.end());
+
+	ctx.query.erase(unique(ctx.query.begin(), ctx.query.end()), ctx.query.end());
+
+	ctx.last_query_idx = ctx.query.size() - 1;
+
+	ctx.result.clear();
+	ctx.stack.clear();
+
+	push_edges(ctx, root, 0, 0);
+	supersets(ctx);
+
+	size = ctx.result.size();
+	for (int i = 0; i < size; i++)
+		ret.push_back(ids[ctx.result[i]]);
+
+	return ret;
+}
+
+
+StringSet DawgSetTrie::supersets (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
+
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
+
+	return supersets(set);
+}
+
+
+StringSet DawgSetTrie::subsets (StringSet set) const {
+
+	StringSet ret = {};
+
+	if (ids.size() > 0 && terminal.get(root))
+		ret.push_back(ids[0]);
+
+	SnapshotContext &ctx = query_context();
+
+	ctx.query.clear();
+
+	int size = set.size();
+
+	for (int i = 0; i < size; i++) {
+		int cc = code(MurmurHash64A(set[i].c_str(), set[i].length()));
+
+		if (cc >= 0)
+			ctx.query.push_back(cc);
+	}
+	if (ctx.query.size() == 0)
+		return ret;
+
+	std::sort(ctx.query.begin(), ctx.query.end());
+
+	ctx.query.erase(unique(ctx.query.begin(), ctx.query.end()), ctx.query.end());
+
+	ctx.last_query_idx = ctx.query.size() - 1;
+
+	ctx.result.clear();
+	ctx.stack.clear();
+
+	push_edges(ctx, root, 0, 0);
+	subsets(ctx);
+
+	size = ctx.result.size();
+	for (int i = 0; i < size; i++)
+		ret.push_back(ids[ctx.result[i]]);
+
+	return ret;
+}
+
+
+StringSet DawgSetTrie::subsets (String str, char split) const {
+	StringSet set;
+	std::stringstream ss(str);
+
+	String elem;
+	while (std::getline(ss, elem, split))
+		set.push_back(elem);
+
+	return subsets(set);
+}
+
+
+/** Returns the elements of the set number idx, in [0, num_sets()).
+*/
+StringSet DawgSetTrie::elements (int idx) const {
+
+	StringSet ret = {};
+
+	if (idx < 0 || idx >= (int) ids.size())
+		return ret;
+
+	int s = root;
+
+	while (!terminal.get(s) || idx > 0) {
+		int lo = first.get(s), hi = first.get(s + 1) - 1;
+
+		// The last edge whose first set is not after idx.
+		while (lo < hi) {
+			int mid = (lo + hi + 1) >> 1;
+
+			if ((int) ranks.get(mid) <= idx)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+
+		idx -= ranks.get(lo);
+		ret.push_back(names[values.get(lo)]);
+
+		s = targets.get(lo);
+	}
+
+	return ret;
+}
+
+
+bool DawgSetTrie::load (pBinaryImage &p_bi) {
+
+	int c_block = 0, c_ofs = 0;
+
+	String		section = "dawg";
+	ElementHash hs;
+
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)) || hs != MurmurHash64A(section.c_str(), section.length()))
+		return false;
+
+	int version, len;
+
+	if (!image_get(p_bi, c_block, c_ofs, &version, sizeof(version)) || version != SETTRIE_IMAGE_VERSION)
+		return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, &root, sizeof(root)))
+		return false;
+
+	if (!image_get_words(p_bi, c_block, c_ofs, terminal.num_bits, terminal.words))
+		return false;
+
+	if (!image_get_packed(p_bi, c_block, c_ofs, first) || !image_get_packed(p_bi, c_block, c_ofs, values))
+		return false;
+
+	if (!image_get_packed(p_bi, c_block, c_ofs, targets) || !image_get_packed(p_bi, c_block, c_ofs, ranks))
+		return false;
+
+	if (!image_get_packed(p_bi, c_block, c_ofs, counts))
+		return false;
+
+	int num_states = terminal.num_bits;
+
+	if (root < 0 || root >= num_states || first.size != num_states + 1 || counts.size != num_states)
+		return false;
+
+	if (targets.size != values.size || ranks.size != values.size || (int) first.get(num_states) != values.size)
+		return false;
+
+	terminal.build();
+
+	section = "name";
+
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)) || hs != MurmurHash64A(section.c_str(), section.length()))
+		return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 0)
+		return false;
+
+	names.resize(len);
+
+	for (int i = 0; i < len; i++)
+		if (!image_get_string(p_bi, c_block, c_ofs, names[i]))
+			return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len < 0 || len > (int) names.size())
+		return false;
+
+	hashes.resize(len);
+	codes.resize(len);
+
+	if (!image_get(p_bi, c_block, c_ofs, hashes.data(), len*sizeof(ElementHash)))
+		return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, codes.data(), len*sizeof(int)))
+		return false;
+
+	section = "id";
+
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)) || hs != MurmurHash64A(section.c_str(), section.length()))
+		return false;
+
+	if (!image_get(p_bi, c_block, c_ofs, &len, sizeof(len)) || len != (int) counts.get(root))
+		return false;
+
+	ids.resize(len);
+
+	for (int i = 0; i < len; i++)
+		if (!image_get_string(p_bi, c_block, c_ofs, ids[i]))
+			return false;
+
+	section = "end";
+
+	if (!image_get(p_bi, c_block, c_ofs, &hs, sizeof(hs)))
+		return false;
+
+	return hs == MurmurHash64A(section.c_str(), section.length());
+}
+
+
+bool DawgSetTrie::save (pBinaryImage &p_bi) {
+
+	String section = "dawg";
+	ElementHash hs = MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	int version = SETTRIE_IMAGE_VERSION;
+
+	image_put(p_bi, &version, sizeof(version));
+	image_put(p_bi, &root, sizeof(root));
+
+	image_put_words(p_bi, terminal.num_bits, terminal.words);
+
+	image_put_packed(p_bi, first);
+	image_put_packed(p_bi, values);
+	image_put_packed(p_bi, targets);
+	image_put_packed(p_bi, ranks);
+	image_put_packed(p_bi, counts);
+
+	section = "name";
+	hs		= MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	int len = names.size();
+
+	image_put(p_bi, &len, sizeof(len));
+
+	for (int i = 0; i < len; i++)
+		image_put_string(p_bi, names[i]);
+
+	len = hashes.size();
+
+	image_put(p_bi, &len, sizeof(len));
+	image_put(p_bi, hashes.data(), len*sizeof(ElementHash));
+	image_put(p_bi, codes.data(), len*sizeof(int));
+
+	section = "id";
+	hs		= MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	len = ids.size();
+
+	image_put(p_bi, &len, sizeof(len));
+
+	for (int i = 0; i < len; i++)
+		image_put_string(p_bi, ids[i]);
+
+	section = "end";
+	hs		= MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------------
+//	Python Implementation
+// -----------------------------------------------------------------------------------------------------------------------------------------
+
+typedef SetTrie		   *pSetTrie;
+typedef StringSet	   *pStringSet;
+typedef SetTrieCursor  *pSetTrieCursor;
+typedef ShardedSetTrie *pShardedSetTrie;
+
+// A cursor and the st_id of the SetTrie it reads. The SetTrie may be destroyed before the cursor, cursor_next() checks it still exists.
+struct CursorInstance {
+	int			   st_id;
+	pSetTrieCursor p_cursor;
+};
+
+// The sets staged by stage_insert() until insert_staged() inserts them all in a single insert_many() call.
+struct InsertBatch {
+	std::vector<StringSet> sets;
+	StringSet			   str_ids;
+};
+
+typedef std::map<int, pSetTrie>		   SetTrieServer;
+typedef std::map<int, pStringSet>	   IterServer;
+typedef std::map<int, CursorInstance>  CursorServer;
+typedef std::map<int, pBinaryImage>	   BinaryImageServer;
+typedef std::map<int, InsertBatch>	   BatchServer;
+typedef std::map<int, pShardedSetTrie> ShardedServer;
+
+int instance_num	= 0;
+int instance_iter	= 0;
+int instance_cursor = 0;
+
+SetTrieServer	  instance = {};
+IterServer		  iterator = {};
+CursorServer	  cursor   = {};
+BinaryImageServer image	   = {};
+BatchServer		  batch	   = {};
+ShardedServer	  sharded  = {};
+
+int max_id_length	= 1024;
+char *p_answer		= nullptr;
+String idx_answer	= {};
+char answer_block  [8208];	// 4K + final zero aligned to 16 bytes
+
+const char b64chars[]	   = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+uint8_t	   b64inverse[256] = {0};
+
+char *image_block_as_string(uint8_t *p_in) {
+
+	char *p_out	  = (char *) &answer_block;
+
+	uint8_t v, w;
+	for (int i = 0; i < 2048; i++) {
+		v = *(p_in++);
+		*(p_out++) = b64chars[v >> 2];
+
+		w = *(p_in++);
+		*(p_out++) = b64chars[((v << 4) & 0x30) | w >> 4];
+
+		v = *(p_in++);
+		*(p_out++) = b64chars[((w << 2) & 0x3c) | v >> 6];
+		*(p_out++) = b64chars[v & 0x3f];
+	}
+	*p_out = 0;
+
+	return (char *) &answer_block;
+}
+
+
+char *image_block_as_string(ImageBlock &blk) {
+	uint8_t *p_in = (uint8_t *) &blk;
+
+	return image_block_as_string(p_in);
+}
+
+
+bool string_as_image_block(ImageBlock &blk, char *p_in) {
+
+	if (b64inverse[0] != 0xc0) {
+		// create the inverse of b64chars[] in b64inverse[] just once if not exists
+		memset(&b64inverse, 0xc0c0c0c0, sizeof(b64inverse));
+
+		for (int i = 0; i < 64; i++)
+			b64inverse[(int) b64chars[i]] = i;
+	}
+	uint8_t *p_out = (uint8_t *) &blk;
+
+	uint8_t v, w;
+	for (int i = 0; i < 2048; i++) {
+		v = b64inverse[(int) *(p_in++)];
+		if ((v & 0xc0) != 0)
+			return false;
+
+		w = b64inverse[(int) *(p_in++)];
+		if ((w & 0xc0) != 0)
+			return false;
+
+		*(p_out++) = (v << 2) | (w >> 4);
+
+		v = b64inverse[(int) *(p_in++)];
+		if ((v & 0xc0) != 0)
+			return false;
+
+		*(p_out++) = (w << 4) | (v >> 2);
+
+		w = b64inverse[(int) *(p_in++)];
+		if ((w & 0xc0) != 0)
+			return false;
+
+		*(p_out++) = (v << 6) | w;
+	}
+
+	return (uint_fast64_t) p_out - (uint_fast64_t) &blk == sizeof(ImageBlock);
+}
+
+
+/** Serialize a list of set_ids as the base64 encoding of its int32 array (with padding), decoded in Python by array('i', b64decode()).
+*/
+char *set_ids_as_string(const IdList &ids) {
+
+	const uint8_t *p_in = (const uint8_t *) ids.data();
+	int			   size = ids.size()*sizeof(int);
+
+	idx_answer.clear();
+	idx_answer.reserve(4*((size + 2)/3));
+
+	for (int i = 0; i < size; i += 3) {
+		uint32_t v = p_in[i] << 16;
+
+		if (i + 1 < size)
+			v |= p_in[i + 1] << 8;
+
+		if (i + 2 < size)
+			v |= p_in[i + 2];
+
+		idx_answer.push_back(b64chars[v >> 18]);
+		idx_answer.push_back(b64chars[(v >> 12) & 0x3f]);
+		idx_answer.push_back(i + 1 < size ? b64chars[(v >> 6) & 0x3f] : '=');
+		idx_answer.push_back(i + 2 < size ? b64chars[v & 0x3f] : '=');
+	}
+
+	return (char *) idx_answer.c_str();
+}
+
+
+String python_set_as_string(char *p_char) {
+
+	int size = strlen(p_char);
+
+	if (size == 5 && strcmp(p_char, "set()") == 0)
+		return "";
+
+	if (size > 10 && *((int*) p_char) == 0x7a6f7266) {
+		// frozenset({ . . . })
+		// ^[0]     ^[9]      ^[size - 1]
+
+		if (p_char[9] != '(' || p_char[size - 1] != ')')
+			return "";
+
+		p_char += 10;
+		size   -= 11;
+
+		if (size < 3)
+			return "";
+	}
+
+	if (p_char[0] != '{' || p_char[size - 1] != '}')
+		return String(p_char);
+
+	String s;
+	p_char++;
+	size -= 2;
+	int quote_lev = 0;		// 1 for ', 2 for "
+	bool trailing = false;
+
+	while (size-- > 0) {
+		char cursor;
+		switch (cursor = *(p_char++)) {
+		case '\'':
+			switch (quote_lev) {
+			case 0:
+				quote_lev = 1;
+				break;
+
+			case 1:
+				quote_lev = 0;
+				break;
+			};
+			s.push_back('\'');
+			trailing = false;
+			break;
+
+		case '"':
+			switch (quote_lev) {
+			case 0:
+				quote_lev = 2;
+				break;
+
+			case 2:
+				quote_lev = 0;
+				break;
+			};
+			s.push_back('"');
+			trailing = false;
+			break;
+
+		case ' ':
+			if (!trailing)
+				s.push_back(' ');
+			break;
+
+		case ',':
+			if (quote_lev == 0) {
+				s.push_back(',');
+				trailing = true;
+			} else
+				s.push_back(0x82);
+			break;
+
+		default:
+			s.push_back(cursor);
+			trailing = false;
+		}
+	}
+
+	return s;
+}
+
+
+/** Parse a Python set serialized by a str() call into its elements, split as insert() splits them.
+*/
+StringSet python_set_as_string_set(char *set) {
+
+	StringSet elements = {};
+	std::stringstream ss(python_set_as_string(set));
+
+	String elem;
+	while (std::getline(ss, elem, ','))
+		elements.push_back(elem);
+
+	return elements;
+}
+
+
+/** Return a buffer to write an answer that is as big as max_id_length. max_id_length tracks the largest set id used by insert.
+*/
+char *get_answer_buffer () {
+	if (p_answer == nullptr)
+		p_answer = (char *) malloc(max_id_length + 16);
+
+	return p_answer;
+}
+
+
+/** Check if the current set id is larger than max_id_length. If so, reallocate the buffer to the new size.
+
+	\param size  The new size of the id.
+*/
+void inline set_answer_buffer_size (int size) {
+	if (size > max_id_length) {
+		if (p_answer != nullptr)
+			free(p_answer);
+
+		p_answer = (char *) malloc(size + 16);
+		max_id_length = size;
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------------
+
+/** Create a new SetTrie object that can be used via the Python interface.
+
+	\return	A unique ID that can be passed as the st_id parameter for any method in the Python interface.
+
+To free the resources allocated by this ID, the (python) caller must call destroy_settrie() with the st_id and never use the same
+st_id after that.
+*/
+int new_settrie() {
+
+	instance[++instance_num] = new SetTrie();
+
+	return instance_num;
+}
+
+
+/** Destroy a SetTrie object that was used via the Python interface.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+*/
+void destroy_settrie(int st_id) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return;
+
+	delete it->second;
+
+	instance.erase(it);
+	batch.erase(st_id);
+}
+
+
+/** Insert a Python set (serialized by a str() call) into a SetTrie object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+	\param str_id An id representing this set that will be returned in searches.
+*/
+void insert	(int st_id, char *set, char *str_id) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it != instance.end()) {
+		String s = String(str_id);
+		it->second->insert(python_set_as_string(set), s, ',');
+		set_answer_buffer_size(s.length());
+	}
+}
+
+
+/** Stage a Python set (serialized by a str() call) to be inserted into a SetTrie object by the next insert_staged() call.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+	\param str_id An id representing this set that will be returned in searches.
+*/
+void stage_insert (int st_id, char *set, char *str_id) {
+
+	if (instance.find(st_id) == instance.end())
+		return;
+
+	InsertBatch &bat = batch[st_id];
+
+	bat.sets.push_back(python_set_as_string_set(set));
+	bat.str_ids.push_back(str_id);
+
+	set_answer_buffer_size(bat.str_ids.back().length());
+}
+
+
+/** Insert all the sets staged by stage_insert() calls. An empty SetTrie is built in a single pass, which is much faster than
+	inserting the sets one by one.
+
+	\param st_id		The st_id returned by a previous new_settrie() call.
+	\param num_threads The number of threads building the tree.
+
+	\return			The number of sets inserted or -1 on invalid st_id.
+*/
+int insert_staged (int st_id, int num_threads) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	BatchServer::iterator jt = batch.find(st_id);
+
+	if (jt == batch.end())
+		return 0;
+
+	int size = jt->second.sets.size();
+
+	it->second->insert_many(jt->second.sets, jt->second.str_ids, num_threads);
+
+	batch.erase(jt);
+
+	return size;
+}
+
+
+/** Find a Python set (serialized by a str() call) for a complete match inside a SetTrie object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+
+	\return		  The str_id string that was given to the set when it was inserted.
+*/
+char *find (int st_id, char *set) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	char *p_ans = get_answer_buffer();
+
+	p_ans[0] = 0;
+
+	if (it != instance.end())
+		strcpy(p_ans, it->second->find(python_set_as_string(set), ',').c_str());
+
+	return p_ans;
+}
+
+
+/** Find a Python set (serialized by a str() call) for a complete match inside a SetTrie object and return its set_id.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+
+	\return		  The set_id of the set (that can be passed to set_name(), elements() or remove()) or -1 if not found.
+*/
+int find_idx (int st_id, char *set) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	return it->second->find_idx(python_set_as_string(set), ',');
+}
+
+
+/** Find all the supersets of a given Python set (serialized by a str() call) stored inside a SetTrie object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+	\param limit  The maximum number of results, negative for all of them.
+
+	\return		  0 if no sets were found, or an iter_id > 0 that can be used to retrieve the result using iterator_next()/iterator_size()
+				  and must be explicitly destroyed via destroy_iterator()
+*/
+int supersets (int st_id, char *set, int limit) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return 0;
+
+	StringSet ret = it->second->supersets(python_set_as_string(set), ',', limit);
+
+	if (ret.size() == 0)
+		return 0;
+
+	iterator[++instance_iter] = new StringSet(ret);
+
+	return instance_iter;
+}
+
+
+/** Find all the subsets of a given Python set (serialized by a str() call) stored inside a SetTrie object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+	\param limit  The maximum number of results, negative for all of them.
+
+	\return		  0 if no sets were found, or an iter_id > 0 that can be used to retrieve the result using iterator_next()/iterator_size()
+				  and must be explicitly destroyed via destroy_iterator()
+*/
+int subsets (int st_id, char *set, int limit) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return 0;
+
+	StringSet ret = it->second->subsets(python_set_as_string(set), ',', limit);
+
+	if (ret.size() == 0)
+		return 0;
+
+	iterator[++instance_iter] = new StringSet(ret);
+
+	return instance_iter;
+}
+
+
+/** Find all the supersets of a given Python set (serialized by a str() call) stored inside a SetTrie object and return their set_ids.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+	\param limit  The maximum number of results, negative for all of them.
+
+	\return		  The set_ids as the base64 encoding of an int32 array (see set_ids_as_string()). Empty if none were found.
+*/
+char *supersets_idx (int st_id, char *set, int limit) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	IdList none = {};
+
+	if (it == instance.end())
+		return set_ids_as_string(none);
+
+	return set_ids_as_string(it->second->supersets_idx(python_set_as_string(set), ',', limit));
+}
+
+
+/** Find all the subsets of a given Python set (serialized by a str() call) stored inside a SetTrie object and return their set_ids.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+	\param limit  The maximum number of results, negative for all of them.
+
+	\return		  The set_ids as the base64 encoding of an int32 array (see set_ids_as_string()). Empty if none were found.
+*/
+char *subsets_idx (int st_id, char *set, int limit) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	IdList none = {};
+
+	if (it == instance.end())
+		return set_ids_as_string(none);
+
+	return set_ids_as_string(it->second->subsets_idx(python_set_as_string(set), ',', limit));
+}
+
+
+/** Parse a batch of Python sets, each one serialized by a str() call, separated by newlines (that str() escapes inside the elements).
+*/
+std::vector<StringSet> python_batch_as_string_sets(char *sets) {
+
+	std::vector<StringSet> ret = {};
+
+	std::stringstream lines(sets);
+
+	String line;
+	while (std::getline(lines, line, '\n'))
+		ret.push_back(python_set_as_string_set((char *) line.c_str()));
+
+	return ret;
+}
+
+
+/** Serialize a QueryBatch as set_ids_as_string() of the offsets of the n queries (n + 1 values) followed by the set_ids.
+*/
+char *query_batch_as_string(QueryBatch &batch) {
+
+	IdList packed = batch.offset;
+
+	packed.insert(packed.end(), batch.set_ids.begin(), batch.set_ids.end());
+
+	return set_ids_as_string(packed);
+}
+
+
+/** Find all the supersets of a batch of Python sets stored inside a SetTrie object, running the queries on many threads.
+
+	\param st_id		The st_id returned by a previous new_settrie() call.
+	\param sets		The sets, each one serialized by a str() call, separated by newlines.
+	\param limit		The maximum number of results of each query, negative for all of them.
+	\param num_threads The number of threads.
+
+	\return			The offsets and the set_ids (see query_batch_as_string()). Empty on invalid st_id.
+*/
+char *supersets_batch (int st_id, char *sets, int limit, int num_threads) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	IdList none = {};
+
+	if (it == instance.end())
+		return set_ids_as_string(none);
+
+	std::vector<StringSet> queries = python_batch_as_string_sets(sets);
+
+	QueryBatch batch = it->second->supersets_batch(queries, limit, num_threads);
+
+	return query_batch_as_string(batch);
+}
+
+
+/** Find all the subsets of a batch of Python sets stored inside a SetTrie object, running the queries on many threads.
+
+	\param st_id		The st_id returned by a previous new_settrie() call.
+	\param sets		The sets, each one serialized by a str() call, separated by newlines.
+	\param limit		The maximum number of results of each query, negative for all of them.
+	\param num_threads The number of threads.
+
+	\return			The offsets and the set_ids (see query_batch_as_string()). Empty on invalid st_id.
+*/
+char *subsets_batch (int st_id, char *sets, int limit, int num_threads) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	IdList none = {};
+
+	if (it == instance.end())
+		return set_ids_as_string(none);
+
+	std::vector<StringSet> queries = python_batch_as_string_sets(sets);
+
+	QueryBatch batch = it->second->subsets_batch(queries, limit, num_threads);
+
+	return query_batch_as_string(batch);
+}
+
+
+/** Find a batch of Python sets for a complete match inside a SetTrie object and return their set_ids.
+
+	\param st_id		The st_id returned by a previous new_settrie() call.
+	\param sets		The sets, each one serialized by a str() call, separated by newlines.
+	\param num_threads The number of threads.
+
+	\return			The set_id of each set, -1 if not found, as set_ids_as_string(). Empty on invalid st_id.
+*/
+char *find_batch (int st_id, char *sets, int num_threads) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	IdList none = {};
+
+	if (it == instance.end())
+		return set_ids_as_string(none);
+
+	std::vector<StringSet> queries = python_batch_as_string_sets(sets);
+
+	IdList found = it->second->find_batch(queries, num_threads);
+
+	return set_ids_as_string(found);
+}
+
+
+/** Create a SetTrieCursor for supersets_cursor() or subsets_cursor().
+*/
+int new_cursor (int st_id, char *set, int kind) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return 0;
+
+	StringSet elements;
+	std::stringstream ss(python_set_as_string(set));
+
+	String elem;
+	while (std::getline(ss, elem, ','))
+		elements.push_back(elem);
+
+	cursor[++instance_cursor] = {st_id, new SetTrieCursor(*it->second, kind, elements)};
+
+	return instance_cursor;
+}
+
+
+/** Start a lazy search of the supersets of a given Python set (serialized by a str() call) stored inside a SetTrie object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+
+	\return		  A cursor_id > 0 that returns the results via cursor_next() and must be explicitly destroyed via destroy_cursor()
+				  or 0 if the st_id is not valid.
+*/
+int supersets_cursor (int st_id, char *set) {
+
+	return new_cursor(st_id, set, CURSOR_SUPERSETS);
+}
+
+
+/** Start a lazy search of the subsets of a given Python set (serialized by a str() call) stored inside a SetTrie object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+
+	\return		  A cursor_id > 0 that returns the results via cursor_next() and must be explicitly destroyed via destroy_cursor()
+				  or 0 if the st_id is not valid.
+*/
+int subsets_cursor (int st_id, char *set) {
+
+	return new_cursor(st_id, set, CURSOR_SUBSETS);
+}
+
+
+/** Find the next result of a cursor (returned by supersets_cursor() or subsets_cursor()).
+
+	\param cursor_id The cursor_id returned by a previous supersets_cursor() or subsets_cursor() call.
+
+	\return			 The set_id of the next result (that can be passed to set_name()), -1 if there are no more results or -2 if the
+					 SetTrie was modified or destroyed after the cursor was created.
+*/
+int cursor_next (int cursor_id) {
+
+	CursorServer::iterator it = cursor.find(cursor_id);
+
+	if (it == cursor.end() || instance.find(it->second.st_id) == instance.end())
+		return CURSOR_INVALID;
+
+	return it->second.p_cursor->next();
+}
+
+
+/** Destroy a cursor (returned by supersets_cursor() or subsets_cursor()).
+
+	\param cursor_id The cursor_id returned by a previous supersets_cursor() or subsets_cursor() call.
+*/
+void destroy_cursor (int cursor_id) {
+
+	CursorServer::iterator it = cursor.find(cursor_id);
+
+	if (it == cursor.end())
+		return;
+
+	delete it->second.p_cursor;
+
+	cursor.erase(it);
+}
+
+
+/** Count the supersets of a given Python set (serialized by a str() call) stored inside a SetTrie object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+
+	\return		  The number of supersets or -1 if the st_id is not valid.
+*/
+int count_supersets (int st_id, char *set) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	return it->second->count_supersets(python_set_as_string(set), ',');
+}
+
+
+/** Count the subsets of a given Python set (serialized by a str() call) stored inside a SetTrie object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set	  A Python set serialized by a str() call.
+
+	\return		  The number of subsets or -1 if the st_id is not valid.
+*/
+int count_subsets (int st_id, char *set) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	return it->second->count_subsets(python_set_as_string(set), ',');
+}
+
+
+/** Return all the elements in a set from a SetTrie identified by set_id as an iterator of strings.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set_id A valid set_id returned by a successful next_set_id() call.
+
+	\return		  0 on error or the empty set, or an iter_id > 0 that can be used to retrieve the result using
+				  iterator_next()/iterator_size() and must be explicitly destroyed via destroy_iterator()
+*/
+int elements (int st_id, int set_id) {
+
+	if (set_id == 0)
+		return 0;
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return 0;
+
+	StringSet ret = it->second->elements(set_id);
+
+	if (ret.size() == 0)
+		return 0;
+
+	iterator[++instance_iter] = new StringSet(ret);
+
+	return instance_iter;
+}
+
+
+/** Return the integer set_id of the next set stored in a SetTrie after a given set_id to iterate over all the sets in the object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set_id A valid set_id returned by previous call or the constant -1 to return the first set. Note that 0 may be the set_id of
+				  the empty set in case the empty set is in the SetTrie.
+
+	\return		  A unique integer set_id that can be used for iterating, calling set_name() or elements(). On error, it will return -3
+				  if the st_id or the set_id is invalid and -2 if the set_id given is the last set in the object or the object is empty.
+*/
+int next_set_id (int st_id, int set_id) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -3;
+
+	if (set_id == -1) {
+		if (it->second->id.size() == 0)
+			return -2;
+
+		IdTable::iterator jt = it->second->id.begin();
+
+		return jt->first;
+	}
+
+	IdTable::iterator jt = it->second->id.find(set_id);
+
+	if (jt == it->second->id.end())
+		return -3;
+
+	++jt;
+
+	if (jt == it->second->id.end())
+		return -2;
+
+	return jt->first;
+}
+
+
+/** Return the number of sets in a SetTrie object.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+
+	\return		  The number or -1 on invalid st_id.
+*/
+int num_sets (int st_id) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	return it->second->id.size();
+}
+
+
+/** Return the name (Python id) of a set stored in a SetTrie identified by its binary (int) set_id.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set_id A valid set_id returned by a successful next_set_id() call.
+
+	\return		  An empty string on any error and the Python id of the set if both st_id and set_id are valid.
+*/
+char *set_name (int st_id, int set_id) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	char *p_ans = get_answer_buffer();
+
+	p_ans[0] = 0;
+
+	if (it != instance.end()) {
+		IdTable::iterator jt = it->second->id.find(set_id);
+
+		if (jt != it->second->id.end())
+			strcpy(p_ans, jt->second.c_str());
+	}
+
+	return p_ans;
+}
+
+
+/** Removes a set from the object by its unique integer id.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param set_id A valid set_id returned by a successful next_set_id() call.
+
+	\return		  0 on success or a negative error code.
+*/
+extern int remove (int st_id, int set_id) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	return it->second->remove(set_id);
+}
+
+
+/** Finds a set by its id string.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param str_id The id the set was inserted with.
+
+	\return		  The set_id of the set (the last one inserted if many share the id) or -1 if not found or on invalid st_id.
+*/
+int find_by_id (int st_id, char *str_id) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	return it->second->find_by_id(str_id);
+}
+
+
+/** Removes a set from the object by its id string.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param str_id The id the set was inserted with.
+
+	\return		  0 on success or a negative error code.
+*/
+int remove_by_id (int st_id, char *str_id) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	return it->second->remove_by_id(str_id);
+}
+
+
+/** Purges (reassigns node integer ids and frees RAM) after a series of remove() calls.
+
+	\param st_id   The st_id returned by a previous new_settrie() call.
+	\param dry_run If nonzero, does nothing and returns the number of dirty nodes.
+
+	\return		   A positive num_dirty_nodes on dry_run, zero on successful completion or a negative error code.
+*/
+extern int purge (int st_id, int dry_run) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	if (dry_run)
+		return it->second->num_dirty_nodes;
+
+	return it->second->purge();
+}
+
+
+/** Sets the order of the elements in the sets (see SetTrie::set_element_order()). This rebuilds the tree and changes the set_id of the sets.
+
+	\param st_id The st_id returned by a previous new_settrie() call.
+	\param order 0 for the order of insertion, 1 for the most frequent elements first or 2 for the rarest elements first.
+
+	\return	  Zero on success or a negative error code.
+*/
+extern int set_element_order (int st_id, int order) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	if (!it->second->set_element_order(order))
+		return -2;
+
+	return 0;
+}
+
+
+/** Enables or disables the descendant signatures that prune supersets() queries (see SetTrie::set_signatures()).
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+	\param enable Non zero to build and maintain the signatures, zero to release them.
+
+	\return	   Zero on success or a negative error code.
+*/
+extern int set_signatures (int st_id, int enable) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	it->second->set_signatures(enable != 0);
+
+	return 0;
+}
+
+
+/** Sets the number of threads running the queries without a limit (see SetTrie::set_query_threads()).
+
+	\param st_id		The st_id returned by a previous new_settrie() call.
+	\param num_threads The number of threads, 1 runs the queries on the calling thread.
+
+	\return			Zero on success or a negative error code.
+*/
+extern int set_query_threads (int st_id, int num_threads) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return -1;
+
+	if (!it->second->set_query_threads(num_threads))
+		return -2;
+
+	return 0;
+}
+
+
+/** Return the number of unread items in an iterator (returned by subsets() or supersets()).
+
+	\param iter_id  The iter_id returned by a previous subsets() or supersets() call.
+
+	\return			The number of unread items in the iterator.
+*/
+int iterator_size (int iter_id) {
+
+	IterServer::iterator it = iterator.find(iter_id);
+
+	if (it == iterator.end())
+		return 0;
+
+	return it->second->size();
+}
+
+
+/** Return the first unread item in an iterator (returned by subsets() or supersets()).
+
+	\param iter_id  The iter_id returned by a previous subsets() or supersets() call.
+
+	\return			The str_id of an insert()-ed set that matches the query.
+*/
+char *iterator_next (int iter_id) {
+
+	IterServer::iterator it = iterator.find(iter_id);
+
+	char *p_ans = get_answer_buffer();
+
+	p_ans[0] = 0;
+
+	if (it != iterator.end() && !it->second->empty()) {
+
+		String ss = it->second->back();
+		it->second->pop_back();
+
+		strcpy(p_ans, ss.c_str());
+	}
+
+	return p_ans;
+}
+
+
+/** Destroy an iterator (returned by subsets() or supersets()).
+
+	\param iter_id  The iter_id returned by a previous subsets() or supersets() call.
+*/
+void destroy_iterator (int iter_id) {
+
+	IterServer::iterator it = iterator.find(iter_id);
+
+	if (it == iterator.end())
+		return;
+
+	delete it->second;
+
+	iterator.erase(it);
+}
+
+
+/** Destroy an iterator for a binary image(returned by save_as_binary_image()).
+
+	\param image_id  The image_id returned by a previous save_as_binary_image() call.
+*/
+void destroy_binary_image (int image_id) {
+
+	BinaryImageServer::iterator it = image.find(image_id);
+
+	if (it == image.end())
+		return;
+
+	delete it->second;
+
+	image.erase(it);
+}
+
+
+/** Saves a SetTrie object as a BinaryImage.
+
+	\param st_id  The st_id returned by a previous new_settrie() call.
+
+	\return		  0 on error, or a binary_image_id > 0 which is the same as st_id and must be destroyed using destroy_binary_image()
+*/
+int save_as_binary_image (int st_id) {
+
+	SetTrieServer::iterator it = instance.find(st_id);
+
+	if (it == instance.end())
+		return 0;
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	if (!it->second->save(p_bi)) {
+		delete p_bi;
+
+		return 0;
+	}
+
+	destroy_binary_image(st_id);
+
+	image[st_id] = p_bi;
+
+	return st_id;
+}
+
+
+/** Appends a block serialized by binary_image_next() to the image image_id, checking that the blocks come in order.
+*/
+bool push_image_block (int image_id, char *p_block) {
+
+	ImageBlock blk;
+
+	if (!string_as_image_block(blk, p_block)) {
+		destroy_binary_image(image_id);
+
+		return false;
+	}
+
+	BinaryImageServer::iterator it_image = image.find(image_id);
+
+	if (it_image == image.end()) {
+		if (blk.block_num != 1)
+			return false;
+
+		pBinaryImage p_bi = new BinaryImage;
+
+		p_bi->push_back(blk);
+
+		image[image_id] = p_bi;
+
+		return true;
+	}
+
+	ImageBlock *p_last = &it_image->second->back();
+
+	if (blk.block_num != p_last->block_num + 1)
+		return false;
+
+	it_image->second->push_back(blk);
+
+	return true;
+}
+
+
+/** Pushes raw image blocks into an initially empty SetTrie object and finally creates it already populated with the binary image.
+
+	\param st_id	The st_id returned by a previous new_settrie() call. The object must be empty (never inserted).
+	\param p_block	If non-empty, a block in the right order making a binary image obtained for a previous save_as_binary_image() call.
+					If empty, an order to .load() the SetTrie object and destroyed the previously stored blocks.
+
+	\return			True on success.
+*/
+bool push_binary_image_block (int st_id, char *p_block) {
+
+	SetTrieServer::iterator it_settrie = instance.find(st_id);
+
+	if (it_settrie == instance.end())
+		return false;
+
+	if (p_block[0] == 0) {
+		BinaryImageServer::iterator it_image = image.find(st_id);
+
+		if (it_image == image.end())
+			return false;
+
+		bool ok = it_settrie->second->load(it_image->second);
+
+		destroy_binary_image(st_id);
+
+		return ok;
+	}
+
+	return push_image_block(st_id, p_block);
+}
+
+
+/** Return the number of unread binary images blocks in an iterator returned by a save_as_binary_image() call.
+
+	\param image_id	The image_id returned by a previous save_as_binary_image() call.
+
+	\return			The number of unread blocks in the iterator.
+*/
+int binary_image_size (int image_id) {
+
+	BinaryImageServer::iterator it = image.find(image_id);
+
+	if (it == image.end())
+		return 0;
+
+	return it->second->size();
+}
+
+
+/** Return the first unread binary images block in an iterator returned by a save_as_binary_image() call.
+
+	\param image_id	The image_id returned by a previous save_as_binary_image() call.
+
+	\return			The the binary image block serialized as base64 or an empty string on failure.
+*/
+char *binary_image_next (int image_id) {
+
+	BinaryImageServer::iterator it = image.find(image_id);
+
+	if (it == image.end())
+		return (char *) "";
+
+	uint8_t *p_in = (uint8_t *) it->second->data();
+
+	char *p_ret = image_block_as_string(p_in);
+
+	it->second->erase(it->second->begin());
+
+	return p_ret;
+}
+
+
+/** Create a new ShardedSetTrie object that can be used via the Python interface.
+
+	\param num_shards  The number of shards.
+	\param num_threads The number of threads the shards are queried and filled on.
+
+	\return			A unique ID that can be passed as the sh_id parameter of the sharded_*() functions. It never collides with an st_id,
+					so the binary image functions work with both.
+
+To free the resources allocated by this ID, the (python) caller must call destroy_sharded_settrie() with the sh_id.
+*/
+int new_sharded_settrie (int num_shards, int num_threads) {
+
+	sharded[++instance_num] = new ShardedSetTrie(num_shards, num_threads);
+
+	return instance_num;
+}
+
+
+/** Destroy a ShardedSetTrie object that was used via the Python interface.
+
+	\param sh_id  The sh_id returned by a previous new_sharded_settrie() call.
+*/
+void destroy_sharded_settrie (int sh_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return;
+
+	delete it->second;
+
+	sharded.erase(it);
+	batch.erase(sh_id);
+}
+
+
+/** Insert a Python set (serialized by a str() call) into a ShardedSetTrie object. See insert().
+
+	\return		  0 on success, -1 on invalid sh_id or -2 if the shard of the set is full.
+*/
+int sharded_insert (int sh_id, char *set, char *str_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	String s = String(str_id);
+
+	set_answer_buffer_size(s.length());
+
+	return it->second->insert(python_set_as_string_set(set), s) ? 0 : -2;
+}
+
+
+/** Stage a Python set to be inserted into a ShardedSetTrie object by the next sharded_insert_staged() call. See stage_insert().
+*/
+void sharded_stage_insert (int sh_id, char *set, char *str_id) {
+
+	if (sharded.find(sh_id) == sharded.end())
+		return;
+
+	InsertBatch &bat = batch[sh_id];
+
+	bat.sets.push_back(python_set_as_string_set(set));
+	bat.str_ids.push_back(str_id);
+
+	set_answer_buffer_size(bat.str_ids.back().length());
+}
+
+
+/** Insert all the sets staged by sharded_stage_insert() calls, each shard on its own thread.
+
+	\param sh_id  The sh_id returned by a previous new_sharded_settrie() call.
+
+	\return		  The number of sets inserted (less than the number staged if a shard is full) or -1 on invalid sh_id.
+*/
+int sharded_insert_staged (int sh_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	BatchServer::iterator jt = batch.find(sh_id);
+
+	if (jt == batch.end())
+		return 0;
+
+	int size = it->second->insert_many(jt->second.sets, jt->second.str_ids);
+
+	batch.erase(jt);
+
+	return size;
+}
+
+
+/** Find a Python set for a complete match inside a ShardedSetTrie object. See find().
+*/
+char *sharded_find (int sh_id, char *set) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	char *p_ans = get_answer_buffer();
+
+	p_ans[0] = 0;
+
+	if (it != sharded.end())
+		strcpy(p_ans, it->second->find(python_set_as_string_set(set)).c_str());
+
+	return p_ans;
+}
+
+
+/** Find a Python set for a complete match inside a ShardedSetTrie object and return its set_id, -1 if not found. See find_idx().
+*/
+int sharded_find_idx (int sh_id, char *set) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	return it->second->find_idx(python_set_as_string_set(set));
+}
+
+
+/** Find all the supersets of a Python set stored inside a ShardedSetTrie object. Returns an iter_id as supersets() does.
+*/
+int sharded_supersets (int sh_id, char *set, int limit) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return 0;
+
+	StringSet ret = it->second->supersets(python_set_as_string_set(set), limit);
+
+	if (ret.size() == 0)
+		return 0;
+
+	iterator[++instance_iter] = new StringSet(ret);
+
+	return instance_iter;
+}
+
+
+/** Find all the subsets of a Python set stored inside a ShardedSetTrie object. Returns an iter_id as subsets() does.
+*/
+int sharded_subsets (int sh_id, char *set, int limit) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return 0;
+
+	StringSet ret = it->second->subsets(python_set_as_string_set(set), limit);
+
+	if (ret.size() == 0)
+		return 0;
+
+	iterator[++instance_iter] = new StringSet(ret);
+
+	return instance_iter;
+}
+
+
+/** Find all the supersets of a Python set stored inside a ShardedSetTrie object and return their set_ids as supersets_idx() does.
+*/
+char *sharded_supersets_idx (int sh_id, char *set, int limit) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	IdList found = {};
+
+	if (it != sharded.end())
+		found = it->second->supersets_idx(python_set_as_string_set(set), limit);
+
+	return set_ids_as_string(found);
+}
+
+
+/** Find all the subsets of a Python set stored inside a ShardedSetTrie object and return their set_ids as subsets_idx() does.
+*/
+char *sharded_subsets_idx (int sh_id, char *set, int limit) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	IdList found = {};
+
+	if (it != sharded.end())
+		found = it->second->subsets_idx(python_set_as_string_set(set), limit);
+
+	return set_ids_as_string(found);
+}
+
+
+/** Find all the supersets of a batch of Python sets stored inside a ShardedSetTrie object. The result is as in supersets_batch().
+*/
+char *sharded_supersets_batch (int sh_id, char *sets, int limit) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	IdList none = {};
+
+	if (it == sharded.end())
+		return set_ids_as_string(none);
+
+	std::vector<StringSet> queries = python_batch_as_string_sets(sets);
+
+	QueryBatch batch = it->second->supersets_batch(queries, limit);
+
+	return query_batch_as_string(batch);
+}
+
+
+/** Find all the subsets of a batch of Python sets stored inside a ShardedSetTrie object. The result is as in subsets_batch().
+*/
+char *sharded_subsets_batch (int sh_id, char *sets, int limit) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	IdList none = {};
+
+	if (it == sharded.end())
+		return set_ids_as_string(none);
+
+	std::vector<StringSet> queries = python_batch_as_string_sets(sets);
+
+	QueryBatch batch = it->second->subsets_batch(queries, limit);
+
+	return query_batch_as_string(batch);
+}
+
+
+/** Find a batch of Python sets for a complete match inside a ShardedSetTrie object. The result is as in find_batch().
+*/
+char *sharded_find_batch (int sh_id, char *sets) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	IdList none = {};
+
+	if (it == sharded.end())
+		return set_ids_as_string(none);
+
+	std::vector<StringSet> queries = python_batch_as_string_sets(sets);
+
+	IdList found = it->second->find_batch(queries);
+
+	return set_ids_as_string(found);
+}
+
+
+/** Count the supersets of a Python set stored inside a ShardedSetTrie object, -1 on invalid sh_id.
+*/
+int sharded_count_supersets (int sh_id, char *set) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	return it->second->count_supersets(python_set_as_string_set(set));
+}
+
+
+/** Count the subsets of a Python set stored inside a ShardedSetTrie object, -1 on invalid sh_id.
+*/
+int sharded_count_subsets (int sh_id, char *set) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	return it->second->count_subsets(python_set_as_string_set(set));
+}
+
+
+/** Return all the elements in a set from a ShardedSetTrie as an iter_id, 0 on error or for the empty set. See elements().
+*/
+int sharded_elements (int sh_id, int set_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return 0;
+
+	StringSet ret = it->second->elements(set_id);
+
+	if (ret.size() == 0)
+		return 0;
+
+	iterator[++instance_iter] = new StringSet(ret);
+
+	return instance_iter;
+}
+
+
+/** Return the set_id of the next set stored in a ShardedSetTrie after a given set_id, -1 to start. See next_set_id().
+
+	\return		  The next set_id, -2 after the last set and -3 if the sh_id is invalid.
+*/
+int sharded_next_set_id (int sh_id, int set_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end() || set_id < -1)
+		return -3;
+
+	int idx = it->second->next_set_id(set_id);
+
+	return idx < 0 ? -2 : idx;
+}
+
+
+/** Return the number of sets in a ShardedSetTrie object or -1 on invalid sh_id.
+*/
+int sharded_num_sets (int sh_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	return it->second->size();
+}
+
+
+/** Return the number of shards of a ShardedSetTrie object (it changes when an image is loaded) or -1 on invalid sh_id.
+*/
+int sharded_num_shards (int sh_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	return it->second->num_shards();
+}
+
+
+/** Return the name (Python id) of a set stored in a ShardedSetTrie or an empty string on any error. See set_name().
+*/
+char *sharded_set_name (int sh_id, int set_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	char *p_ans = get_answer_buffer();
+
+	p_ans[0] = 0;
+
+	if (it != sharded.end())
+		strcpy(p_ans, it->second->set_name(set_id).c_str());
+
+	return p_ans;
+}
+
+
+/** Removes a set from a ShardedSetTrie by its set_id. Returns 0 on success or a negative error code.
+*/
+int sharded_remove (int sh_id, int set_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	return it->second->remove(set_id);
+}
+
+
+/** Finds a set of a ShardedSetTrie by its id string. Returns its set_id or -1 if not found or on invalid sh_id.
+*/
+int sharded_find_by_id (int sh_id, char *str_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	return it->second->find_by_id(str_id);
+}
+
+
+/** Removes a set from a ShardedSetTrie by its id string. Returns 0 on success or a negative error code.
+*/
+int sharded_remove_by_id (int sh_id, char *str_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	return it->second->remove_by_id(str_id);
+}
+
+
+/** Purges all the shards of a ShardedSetTrie. Returns the number of dirty nodes on dry_run, otherwise as purge().
+*/
+int sharded_purge (int sh_id, int dry_run) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	if (dry_run)
+		return it->second->num_dirty_nodes();
+
+	return it->second->purge();
+}
+
+
+/** Sets the order of the elements in all the shards. Returns zero on success or a negative error code as set_element_order().
+*/
+int sharded_set_element_order (int sh_id, int order) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	if (!it->second->set_element_order(order))
+		return -2;
+
+	return 0;
+}
+
+
+/** Enables or disables the descendant signatures in all the shards. Returns zero on success or a negative error code.
+*/
+int sharded_set_signatures (int sh_id, int enable) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	it->second->set_signatures(enable != 0);
+
+	return 0;
+}
+
+
+/** Sets the number of threads each shard splits its broad queries among. Returns zero on success or a negative error code.
+*/
+int sharded_set_query_threads (int sh_id, int num_threads) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return -1;
+
+	if (!it->second->set_query_threads(num_threads))
+		return -2;
+
+	return 0;
+}
+
+
+/** Saves a ShardedSetTrie object as a BinaryImage read with binary_image_size()/binary_image_next(). See save_as_binary_image().
+
+	\return		  0 on error, or a binary_image_id > 0 which is the same as sh_id and must be destroyed using destroy_binary_image()
+*/
+int sharded_save_as_binary_image (int sh_id) {
+
+	ShardedServer::iterator it = sharded.find(sh_id);
+
+	if (it == sharded.end())
+		return 0;
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	if (!it->second->save(p_bi)) {
+		delete p_bi;
+
+		return 0;
+	}
+
+	destroy_binary_image(sh_id);
+
+	image[sh_id] = p_bi;
+
+	return sh_id;
+}
+
+
+/** Pushes raw image blocks into an empty ShardedSetTrie object, an empty block loads it. See push_binary_image_block().
+*/
+bool sharded_push_binary_image_block (int sh_id, char *p_block) {
+
+	ShardedServer::iterator it_sharded = sharded.find(sh_id);
+
+	if (it_sharded == sharded.end())
+		return false;
+
+	if (p_block[0] == 0) {
+		BinaryImageServer::iterator it_image = image.find(sh_id);
+
+		if (it_image == image.end())
+			return false;
+
+		bool ok = it_sharded->second->load(it_image->second);
+
+		destroy_binary_image(sh_id);
+
+		return ok;
+	}
+
+	return push_image_block(sh_id, p_block);
+}
+
+
+/** Free the memory allocated for the answer buffer.
+*/
+void cleanup_globals () {
+	if (p_answer != nullptr) {
+		free(p_answer);
+		p_answer = nullptr;
+	}
+}
+
+#if defined TEST
+
+#ifndef INCLUDED_CATCH2
+#define INCLUDED_CATCH2
+
+#include "catch.hpp"
+
+#endif
+
+#include <pthread.h>
+
+void compare_iterating(pSetTrie p1, pSetTrie p2, bool compare_int_id) {
+
+	REQUIRE(p1->id.size() == p2->id.size());
+
+	IdTable::iterator it1 = p1->id.begin();
+	IdTable::iterator it2 = p2->id.begin();
+
+	while (it1 != p1->id.end()) {
+		REQUIRE(it2 != p2->id.end());
+		if (compare_int_id) {
+			REQUIRE(it1->first  == it2->first);
+			REQUIRE(it1->second == it2->second);
+
+			StringSet el1 = p1->elements(it1->first);
+			StringSet el2 = p2->elements(it2->first);
+
+			REQUIRE(el1.size() == el2.size());
+
+			for (int i = 0; i < el1.size(); i++) {
+				REQUIRE(el1[i] == el2[i]);
+			}
+		} else {
+			IdTable::iterator it3 = p2->id.begin();
+
+			while (it3 != p2->id.end() && it3->second != it1->second)
+				++it3;
+
+			REQUIRE(it1->second == it3->second);
+
+			StringSet el1 = p1->elements(it1->first);
+			StringSet el2 = p2->elements(it3->first);
+
+			REQUIRE(el1.size() == el2.size());
+
+			for (int i = 0; i < el1.size(); i++) {
+				REQUIRE(el1[i] == el2[i]);
+			}
+		}
+		++it1;
+		++it2;
+	}
+	REQUIRE(it2 == p2->id.end());
+}
+
+
+void recurse_tree(pSetTrie ps, int ii, int &n_nodes, int &n_sets, int level) {
+	REQUIRE(level > 0);
+	REQUIRE(ii >= 0);
+	REQUIRE(ii < ps->tree.size());
+
+	int state = ps->state[ii];
+
+	REQUIRE(state >= 0);
+	REQUIRE(state < STATE_IS_GARBAGE);
+
+	if (state == STATE_HAS_SET_ID)
+		n_sets--;
+
+	n_nodes--;
+
+	if (ps->child(ii) != 0)
+		recurse_tree(ps, ps->child(ii), n_nodes, n_sets, level - 1);
+
+	if (ps->tree[ii].idx_next != 0)
+		recurse_tree(ps, ps->tree[ii].idx_next, n_nodes, n_sets, level - 1);
+}
+
+
+void check_sets(pSetTrie ps) {
+	for (IdTable::iterator it = ps->id.begin(); it != ps->id.end(); ++it) {
+		REQUIRE(ps->state[it->first] == STATE_HAS_SET_ID);
+	}
+}
+
+
+void remove_by_id(pSetTrie ps, char *pID) {
+
+	IdTable::iterator it = ps->id.begin();
+
+	while (it != ps->id.end()) {
+		if (strcmp(pID, it->second.c_str()) == 0) {
+			REQUIRE(ps->remove(it->first) == 0);
+
+			int n_nodes = ps->tree.size() - ps->num_dirty_nodes;
+			int n_sets	= ps->id.size();
+
+			recurse_tree(ps, 0, n_nodes, n_sets, 8);
+
+			REQUIRE(n_nodes == 0);
+			REQUIRE(n_sets  == 0);
+
+			check_sets(ps);
+
+			return;
+		}
+
+		++it;
+	}
+	REQUIRE(false);
+}
+
+
+std::vector<StringSet> random_sets(uint64_t &rnd, int num_sets, int max_size, int num_elements) {
+
+	std::vector<StringSet> sets;
+
+	for (int i = 0; i < num_sets; i++) {
+		StringSet set;
+		int size = 1 + (rnd >> 33) % max_size;
+
+		for (int j = 0; j < size; j++) {
+			rnd = rnd*6364136223846793005 + 1442695040888963407;
+			set.push_back("e" + std::to_string((rnd >> 33) % num_elements));
+		}
+		rnd = rnd*6364136223846793005 + 1442695040888963407;
+
+		sets.push_back(set);
+	}
+
+	return sets;
+}
+
+
+void check_sorted_chains(pSetTrie ps) {
+	int size = ps->tree.size();
+
+	for (int i = 0; i < size; i++) {
+		if (ps->state[i] == STATE_IS_GARBAGE)
+			continue;
+
+		int j = ps->child(i);
+
+		while (j != 0 && ps->tree[j].idx_next != 0) {
+			REQUIRE(ps->tree[j].value < ps->tree[ps->tree[j].idx_next].value);
+			j = ps->tree[j].idx_next;
+		}
+	}
+}
+
+
+void check_summaries(SetTrie &st) {
+	SummaryList kept = st.summary;
+
+	st.build_summaries(st.child(0));
+
+	int size = st.tree.size();
+
+	REQUIRE(kept.size() == size);
+
+	for (int i = 1; i < size; i++) {
+		if (st.state[i] == STATE_IS_GARBAGE)
+			continue;
+
+		REQUIRE(kept[i].max_value == st.summary[i].max_value);
+		REQUIRE(kept[i].height	  == st.summary[i].height);
+		REQUIRE(kept[i].num_sets  == st.summary[i].num_sets);
+	}
+
+	int num_sets = st.state[0] == STATE_HAS_SET_ID;
+
+	for (int ci = st.child(0); ci != 0; ci = st.tree[ci].idx_next)
+		num_sets += st.summary[ci].num_sets;
+
+	REQUIRE(num_sets				== st.id.size());
+	REQUIRE(st.summary[0].num_sets	== st.id.size());
+}
+
+
+int num_values(SetTrie &st) {
+	int n = st.tree.size();
+
+	for (RunList::iterator it = st.runs.begin(); it != st.runs.end(); ++it)
+		n += it->value.size();
+
+	return n;
+}
+
+
+/** Runs fun on a new thread with a stack of stack_size bytes, to check that the deep trees do not need a deep stack.
+*/
+void run_with_stack(size_t stack_size, std::function<void()> fun) {
+
+	pthread_attr_t attr;
+	pthread_t	   th;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, stack_size);
+
+	REQUIRE(pthread_create(&th, &attr, [](void *p_fun) -> void * { (*(std::function<void()> *) p_fun)(); return nullptr; }, &fun) == 0);
+
+	pthread_join(th, nullptr);
+	pthread_attr_destroy(&attr);
+}
+
+
+SCENARIO("Test remove() and purge().") {
+
+	int all = new_settrie();
+	int con = new_settrie();
+	int vow = new_settrie();
+	int non = new_settrie();
+	int bak = new_settrie();
+
+	REQUIRE(all > 0);
+	REQUIRE(con > 0);
+	REQUIRE(vow > 0);
+	REQUIRE(non > 0);
+	REQUIRE(bak > 0);
+
+	pSetTrie p_all = instance[all];
+	pSetTrie p_con = instance[con];
+	pSetTrie p_vow = instance[vow];
+	pSetTrie p_non = instance[non];
+	pSetTrie p_bak = instance[bak];
+
+	GIVEN("I load something to my objects.") {
+		insert(all, (char *) "a",		  (char *) "s_00");
+		insert(all, (char *) "a,b",		  (char *) "s_01");
+		insert(all, (char *) "a,b,c",	  (char *) "s_02");
+		insert(all, (char *) "a,b,c,d",	  (char *) "s_03");
+		insert(all, (char *) "a,b,c,d,e", (char *) "s_04");
+		insert(all, (char *) "a,c,d,e",	  (char *) "s_05");
+		insert(all, (char *) "a,b,d,e",	  (char *) "s_06");
+		insert(all, (char *) "a,b,c,e",	  (char *) "s_07");
+		insert(all, (char *) "b",		  (char *) "s_08");
+		insert(all, (char *) "b,c",		  (char *) "s_09");
+		insert(all, (char *) "b,c,d",	  (char *) "s_10");
+		insert(all, (char *) "b,c,d,e",	  (char *) "s_11");
+		insert(all, (char *) "b,d,e",	  (char *) "s_12");
+		insert(all, (char *) "b,c,e",	  (char *) "s_13");
+		insert(all, (char *) "c",		  (char *) "s_14");
+		insert(all, (char *) "c,d",		  (char *) "s_15");
+		insert(all, (char *) "c,d,e",	  (char *) "s_16");
+		insert(all, (char *) "c,e",		  (char *) "s_17");
+		insert(all, (char *) "d",		  (char *) "s_18");
+		insert(all, (char *) "d,e",		  (char *) "s_19");
+		insert(all, (char *) "e",		  (char *) "s_20");
+		insert(all, (char *) "a,e",		  (char *) "s_21");
+
+		insert(con, (char *) "b",		  (char *) "s_08");
+		insert(con, (char *) "b,c",		  (char *) "s_09");
+		insert(con, (char *) "b,c,d",	  (char *) "s_10");
+		insert(con, (char *) "c",		  (char *) "s_14");
+		insert(con, (char *) "c,d",		  (char *) "s_15");
+		insert(con, (char *) "d",		  (char *) "s_18");
+
+		insert(vow, (char *) "a",		  (char *) "s_00");
+		insert(vow, (char *) "e",		  (char *) "s_20");
+		insert(vow, (char *) "a,e",		  (char *) "s_21");
+
+		pBinaryImage p_bi = new BinaryImage;
+
+		REQUIRE(p_all->save(p_bi));
+		REQUIRE(p_bak->load(p_bi));
+
+		delete p_bi;
+
+		compare_iterating(p_all, p_bak, true);
+
+		REQUIRE(p_all->tree.size() == p_bak->tree.size());
+		REQUIRE(p_all->num_dirty_nodes == 0);
+
+		remove_by_id(p_all, (char *) "s_00");
+		remove_by_id(p_all, (char *) "s_01");
+		remove_by_id(p_all, (char *) "s_02");
+		remove_by_id(p_all, (char *) "s_03");
+		remove_by_id(p_all, (char *) "s_04");
+		remove_by_id(p_all, (char *) "s_05");
+		remove_by_id(p_all, (char *) "s_06");
+		remove_by_id(p_all, (char *) "s_07");
+		remove_by_id(p_all, (char *) "s_11");
+		remove_by_id(p_all, (char *) "s_12");
+		remove_by_id(p_all, (char *) "s_13");
+		remove_by_id(p_all, (char *) "s_16");
+		remove_by_id(p_all, (char *) "s_17");
+		remove_by_id(p_all, (char *) "s_19");
+		remove_by_id(p_all, (char *) "s_20");
+		remove_by_id(p_all, (char *) "s_21");
+
+		REQUIRE(p_all->tree.size() == p_bak->tree.size());
+		REQUIRE(p_all->num_dirty_nodes == 16);
+
+		compare_iterating(p_all, p_con, false);
+
+		REQUIRE(p_all->tree.size() == p_bak->tree.size());
+		REQUIRE(p_all->tree.size() != p_con->tree.size());
+		REQUIRE(p_all->tree.size() - p_con->tree.size() == 16);
+
+		p_all->purge();
+
+		REQUIRE(p_all->num_dirty_nodes == 0);
+
+		int n_nodes = p_all->tree.size();
+		int n_sets	= p_all->id.size();
+
+		recurse_tree(p_all, 0, n_nodes, n_sets, 8);
+
+		REQUIRE(n_nodes == 0);
+		REQUIRE(n_sets  == 0);
+
+		check_sets(p_all);
+
+		compare_iterating(p_all, p_con, false);
+
+		REQUIRE(p_all->tree.size() == p_con->tree.size());
+
+		REQUIRE(p_bak->num_dirty_nodes == 0);
+
+		remove_by_id(p_bak, (char *) "s_01");
+		remove_by_id(p_bak, (char *) "s_02");
+		remove_by_id(p_bak, (char *) "s_03");
+		remove_by_id(p_bak, (char *) "s_04");
+		remove_by_id(p_bak, (char *) "s_05");
+		remove_by_id(p_bak, (char *) "s_06");
+		remove_by_id(p_bak, (char *) "s_07");
+		remove_by_id(p_bak, (char *) "s_08");
+		remove_by_id(p_bak, (char *) "s_09");
+		remove_by_id(p_bak, (char *) "s_10");
+		remove_by_id(p_bak, (char *) "s_11");
+		remove_by_id(p_bak, (char *) "s_12");
+		remove_by_id(p_bak, (char *) "s_13");
+		remove_by_id(p_bak, (char *) "s_14");
+		remove_by_id(p_bak, (char *) "s_15");
+		remove_by_id(p_bak, (char *) "s_16");
+		remove_by_id(p_bak, (char *) "s_17");
+		remove_by_id(p_bak, (char *) "s_18");
+		remove_by_id(p_bak, (char *) "s_19");
+
+		REQUIRE(p_bak->num_dirty_nodes == 19);
+
+		compare_iterating(p_bak, p_vow, false);
+
+		REQUIRE(p_bak->tree.size() - p_vow->tree.size() == 19);
+
+		p_bak->purge();
+
+		REQUIRE(p_bak->num_dirty_nodes == 0);
+
+		n_nodes = p_bak->tree.size();
+		n_sets	= p_bak->id.size();
+
+		recurse_tree(p_bak, 0, n_nodes, n_sets, 8);
+
+		REQUIRE(n_nodes == 0);
+		REQUIRE(n_sets  == 0);
+
+		check_sets(p_bak);
+
+		compare_iterating(p_bak, p_vow, true);
+
+		REQUIRE(p_bak->tree.size() == p_vow->tree.size());
+
+		remove_by_id(p_all, (char *) "s_08");
+		remove_by_id(p_all, (char *) "s_09");
+		remove_by_id(p_all, (char *) "s_10");
+		remove_by_id(p_all, (char *) "s_14");
+		remove_by_id(p_all, (char *) "s_15");
+		remove_by_id(p_all, (char *) "s_18");
+
+		REQUIRE(p_all->tree.size() == p_con->tree.size());
+		REQUIRE(p_all->num_dirty_nodes == 6);
+
+		compare_iterating(p_all, p_non, true);
+
+		REQUIRE(p_all->tree.size() == p_con->tree.size());
+		REQUIRE(p_all->tree.size() != p_non->tree.size());
+		REQUIRE(p_all->tree.size() - p_non->tree.size() == 6);
+
+		p_all->purge();
+
+		REQUIRE(p_all->num_dirty_nodes == 0);
+
+		n_nodes = p_all->tree.size();
+		n_sets	= p_all->id.size();
+
+		recurse_tree(p_all, 0, n_nodes, n_sets, 8);
+
+		REQUIRE(n_nodes == 0);
+		REQUIRE(n_sets  == 0);
+
+		check_sets(p_all);
+
+		compare_iterating(p_all, p_non, true);
+
+		REQUIRE(p_all->tree.size() == p_non->tree.size());
+		REQUIRE(p_all->tree.size() == 1);
+		REQUIRE(p_all->hh_nam.size() == 0);
+
+		remove_by_id(p_bak, (char *) "s_00");
+		remove_by_id(p_bak, (char *) "s_20");
+		remove_by_id(p_bak, (char *) "s_21");
+
+		REQUIRE(p_bak->tree.size() == p_vow->tree.size());
+		REQUIRE(p_bak->num_dirty_nodes == 3);
+
+		compare_iterating(p_bak, p_non, true);
+
+		REQUIRE(p_bak->tree.size() == p_vow->tree.size());
+		REQUIRE(p_bak->tree.size() != p_non->tree.size());
+		REQUIRE(p_bak->tree.size() - p_non->tree.size() == 3);
+
+		p_bak->purge();
+
+		REQUIRE(p_bak->num_dirty_nodes == 0);
+
+		n_nodes = p_bak->tree.size();
+		n_sets	= p_bak->id.size();
+
+		recurse_tree(p_bak, 0, n_nodes, n_sets, 8);
+
+		REQUIRE(n_nodes == 0);
+		REQUIRE(n_sets  == 0);
+
+		check_sets(p_bak);
+
+		compare_iterating(p_bak, p_non, true);
+
+		REQUIRE(p_bak->tree.size() == p_non->tree.size());
+		REQUIRE(p_bak->tree.size() == 1);
+		REQUIRE(p_bak->hh_nam.size() == 0);
+
+		insert(all, (char *) "a",	  (char *) "s_00");
+		insert(all, (char *) "a,b,c", (char *) "s_02");
+
+		REQUIRE(p_all->id.size() == 2);
+		REQUIRE(p_all->hh_nam.size() == 3);
+		REQUIRE(p_all->state[0] == STATE_IN_USE);
+
+		insert(all, (char *) "", (char *) "void");
+
+		REQUIRE(p_all->id.size() == 3);
+		REQUIRE(p_all->hh_nam.size() == 4);
+		REQUIRE(p_all->state[0] == STATE_HAS_SET_ID);
+
+		remove_by_id(p_all, (char *) "s_02");
+
+		REQUIRE(p_all->hh_nam.size() == 2);
+
+		REQUIRE(p_all->remove(-1) == -2);
+		REQUIRE(p_all->remove(50) == -2);
+		REQUIRE(p_all->remove(0) == 0);
+
+		REQUIRE(p_all->id.size() == 1);
+		REQUIRE(p_all->hh_nam.size() == 1);
+		REQUIRE(p_all->state[0] == STATE_IN_USE);
+
+		REQUIRE(p_all->remove(0) == -2);
+
+		REQUIRE(p_all->purge() == 0);
+		REQUIRE(p_all->purge() == -1);
+
+		insert(all, (char *) "a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,r,s,t,u,v,w", (char *) "x");
+		REQUIRE(p_all->tree.size() == 3);
+		insert(all, (char *) "a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,r,s,t,u,v,y", (char *) "y");
+		REQUIRE(p_all->tree.size() == 5);
+		REQUIRE(p_all->state[3] == STATE_IN_USE);
+		REQUIRE(p_all->remove(3) == -2);
+		p_all->state[3] = STATE_HAS_SET_ID;
+		REQUIRE(p_all->remove(3) == -3);
+	}
+	destroy_settrie(bak);
+	destroy_settrie(non);
+	destroy_settrie(vow);
+	destroy_settrie(con);
+	destroy_settrie(all);
+}
+
+
+SCENARIO("Test image_block_as_string() / string_as_image_block()") {
+
+	REQUIRE(sizeof(ImageBlock) == 6*1024);
+
+	ImageBlock block;
+
+	block.size = IMAGE_BUFF_SIZE;
+	for (int i = 0; i < IMAGE_BUFF_SIZE; i++)
+		block.buffer[i] = i & 0xff;
+
+	block.block_num = 0;
+
+	char *p_str = image_block_as_string(block);
+
+	REQUIRE(strlen(p_str) == 8*1024);
+
+	// 00000001 00000010 00000011 00000100 00000101 00000110 00000111
+
+	// 0         1         2         3         4         5         6
+	// 0123456789012345678901234567890123456789012345678901234567890123
+	// ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/
+
+	REQUIRE(p_str[12] == 'A');		// 000000
+	REQUIRE(p_str[13] == 'Q');		// 010000
+	REQUIRE(p_str[14] == 'I');		// 001000
+	REQUIRE(p_str[15] == 'D');		// 000011
+	REQUIRE(p_str[16] == 'B');		// 000001
+	REQUIRE(p_str[17] == 'A');		// 000000
+	REQUIRE(p_str[18] == 'U');		// 010100
+	REQUIRE(p_str[19] == 'G');		// 000110
+	REQUIRE(p_str[20] == 'B');		// 000001
+
+	REQUIRE(p_str[8191] == b64chars[6135 & 0x3f]);
+	REQUIRE(p_str[8192] == 0);
+
+	ImageBlock block2;
+
+	REQUIRE(string_as_image_block(block2, p_str));
+
+	for (int ofs = 0; ofs < 8; ofs++) {
+		block.size = IMAGE_BUFF_SIZE;
+		for (int i = 0; i < IMAGE_BUFF_SIZE; i++)
+			block.buffer[i] = (i + ofs) & 0xff;
+
+		block.block_num = 8 - ofs;
+
+		p_str = image_block_as_string(block);
+
+		REQUIRE(strlen(p_str) == 8*1024);
+
+		REQUIRE(string_as_image_block(block2, p_str));
+
+		REQUIRE(block.size == block2.size);
+		REQUIRE(block.block_num == block2.block_num);
+		REQUIRE(MurmurHash64A(&block, sizeof(ImageBlock)) == MurmurHash64A(&block, sizeof(ImageBlock)));
+	}
+}
+
+
+SCENARIO("Test image_put() / image_get()") {
+
+	uint8_t buffer1[4*IMAGE_BUFF_SIZE];
+	int		buffer4[IMAGE_BUFF_SIZE];
+
+	memset(buffer1, 0xcafebebe, 4*IMAGE_BUFF_SIZE);
+
+	for (int i = 0; i < IMAGE_BUFF_SIZE; i++)
+		buffer4[i] = 2*i + 11;
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	REQUIRE(image_put(p_bi, &buffer1, IMAGE_BUFF_SIZE));
+	REQUIRE(image_put(p_bi, &buffer1, IMAGE_BUFF_SIZE - 1));
+	REQUIRE(image_put(p_bi, &buffer1, IMAGE_BUFF_SIZE + 2));
+	REQUIRE(image_put(p_bi, &buffer1, IMAGE_BUFF_SIZE - 1));
+
+	REQUIRE(image_put(p_bi, &buffer4,  4));
+	REQUIRE(image_put(p_bi, &buffer4,  8));
+	REQUIRE(image_put(p_bi, &buffer4, 16));
+	REQUIRE(image_put(p_bi, &buffer4, 32));
+
+	REQUIRE(image_put(p_bi, &buffer4, 3*IMAGE_BUFF_SIZE));
+
+	for (int i = 0; i < 8192; i++) {
+		image_put(p_bi, &i, 4);
+		image_put(p_bi, &i, 3);
+		image_put(p_bi, &i, 2);
+		image_put(p_bi, &i, 1);
+	}
+
+	for (int i = 0; i < p_bi->size(); i++)
+		REQUIRE((*p_bi)[i].block_num == i + 1);
+
+	uint8_t i_buffer1[4*IMAGE_BUFF_SIZE];
+	int		i_buffer4[IMAGE_BUFF_SIZE];
+
+	for (int t = 0; t < 3; t++) {
+		int c_block = 0;
+		int c_ofs	= 0;
+
+		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer1, IMAGE_BUFF_SIZE));
+		REQUIRE(!memcmp(&buffer1, &i_buffer1, IMAGE_BUFF_SIZE));
+
+		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer1, IMAGE_BUFF_SIZE - 1));
+		REQUIRE(!memcmp(&buffer1, &i_buffer1, IMAGE_BUFF_SIZE - 1));
+
+		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer1, IMAGE_BUFF_SIZE + 2));
+		REQUIRE(!memcmp(&buffer1, &i_buffer1, IMAGE_BUFF_SIZE + 2));
+
+		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer1, IMAGE_BUFF_SIZE - 1));
+		REQUIRE(!memcmp(&buffer1, &i_buffer1, IMAGE_BUFF_SIZE - 1));
+
+		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4,  4));
+		REQUIRE(!memcmp(&buffer4, &i_buffer4,  4));
+
+		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4,  8));
+		REQUIRE(!memcmp(&buffer4, &i_buffer4,  8));
+
+		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4, 16));
+		REQUIRE(!memcmp(&buffer4, &i_buffer4, 16));
+
+		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4, 32));
+		REQUIRE(!memcmp(&buffer4, &i_buffer4, 32));
+
+		REQUIRE(image_get(p_bi, c_block, c_ofs, &i_buffer4, 3*IMAGE_BUFF_SIZE));
+		REQUIRE(!memcmp(&buffer4, &i_buffer4, 3*IMAGE_BUFF_SIZE));
+
+		bool failed = false;
+		for (int i = 0; i < 8192; i++) {
+			int i_i;
+
+			image_get(p_bi, c_block, c_ofs, &i_i, 4);
+			if (i != i_i)
+				failed = true;
+			image_get(p_bi, c_block, c_ofs, &i_i, 3);
+			if ((i & 0xffffff) != (i_i & 0xffffff))
+				failed = true;
+			image_get(p_bi, c_block, c_ofs, &i_i, 2);
+			if ((i & 0xffff) != (i_i & 0xffff))
+				failed = true;
+			image_get(p_bi, c_block, c_ofs, &i_i, 1);
+			if ((i & 0xff) != (i_i & 0xff))
+				failed = true;
+
+			if (failed)
+				break;
+		}
+		REQUIRE(!failed);
+	}
+
+	delete p_bi;
+}
+
+
+SCENARIO("Test SetTrie.save() / SetTrie.load()") {
+
+	SetTrie A;
+
+	String key1 = {"no_1"};
+	String val1 = {"a b"};
+
+	A.insert(val1, key1, ' ');
+
+	String key0 = {"empty"};
+	String val0 = {""};
+
+	A.insert(val0, key0, ',');
+
+	key1 = {"no_2"};
+	val1 = {"a c d"};
+
+	A.insert(val1, key1, ' ');
+
+	key1 = {"yes_1"};
+	val1 = {"a c e"};
+
+	A.insert(val1, key1, ' ');
+
+	key1 = {"yes_2"};
+	val1 = {"a c d e"};
+
+	A.insert(val1, key1, ' ');
+
+	key1 = {"no_3"};
+	val1 = {"b d"};
+
+	A.insert(val1, key1, ' ');
+
+	key1 = {"no_4"};
+	val1 = {"c d"};
+
+	A.insert(val1, key1, ' ');
+
+	key1 = {"yes_3"};
+	val1 = {"c e"};
+
+	A.insert(val1, key1, ' ');
+
+	REQUIRE(A.supersets("c e", ' ').size()	== 3);
+	REQUIRE(A.supersets("a", ' ').size()	== 4);
+	REQUIRE(A.supersets("c", ' ').size()	== 5);
+	REQUIRE(A.supersets("b d", ' ').size()	== 1);
+
+	SetTrie B;
+
+	REQUIRE(B.supersets("c e", ' ').size()	== 0);
+	REQUIRE(B.supersets("a", ' ').size()	== 0);
+	REQUIRE(B.supersets("c", ' ').size()	== 0);
+	REQUIRE(B.supersets("b d", ' ').size()	== 0);
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	REQUIRE(A.save(p_bi));
+
+	REQUIRE(B.load(p_bi));
+
+	delete p_bi;
+
+	REQUIRE(B.supersets("c e", ' ').size()	== 3);
+	REQUIRE(B.supersets("a", ' ').size()	== 4);
+	REQUIRE(B.supersets("c", ' ').size()	== 5);
+	REQUIRE(B.supersets("b d", ' ').size()	== 1);
+}
+
+
+SCENARIO("Test save_as_binary_image() / push_binary_image_block(), etc.") {
+
+	int a = new_settrie();
+	int b = new_settrie();
+
+	REQUIRE(a > 0);
+	REQUIRE(b > 0);
+
+	GIVEN("I load something to use supersets()") {
+		insert(a, (char *) "a,b",				(char *) "sup01");
+		insert(a, (char *) "a,c,d",				(char *) "sup02");
+		insert(a, (char *) "a,c,e",				(char *) "sup03");
+		insert(a, (char *) "a,c,d,e",			(char *) "sup04");
+		insert(a, (char *) "b,d",				(char *) "sup05");
+		insert(a, (char *) "c,d",				(char *) "sup06");
+		insert(a, (char *) "c,e",				(char *) "sup07");
+		insert(a, (char *) "c,d,e,f",			(char *) "sup08");
+		insert(a, (char *) "c,d,n",				(char *) "sup09");
+		insert(a, (char *) "c,d,e,f,x",			(char *) "sup10");
+		insert(a, (char *) "c,d,e,f,y",			(char *) "sup11");
+		insert(a, (char *) "c,d,e,f,y,z",		(char *) "sup12");
+		insert(a, (char *) "d,e",				(char *) "sup13");
+		insert(a, (char *) "e,a,b,d,f,n,x,y,z", (char *) "sup14");
+		insert(a, (char *) "c",					(char *) "sup15");
+		insert(a, (char *) "e,y,z,c",			(char *) "sup16");
+
+		char buffer[64], name[64];
+
+		for (int i = 0; i < 8192; i++) {
+			sprintf(buffer, "monster,knot%u,node%u", 3*i, i*i);
+			sprintf(name, "document%u", i);
+			insert(a, buffer, name);
+		}
+
+		WHEN("I supersets() the original") {
+			int q1 = supersets(a, (char *) "c,e", -1);
+			int q2 = supersets(a, (char *) "y,z", -1);
+			int q3 = supersets(a, (char *) "d,e", -1);
+			int q4 = supersets(a, (char *) "monster", -1);
+
+			REQUIRE(iterator_size(q1) == 8);
+			REQUIRE(iterator_size(q2) == 3);
+			REQUIRE(iterator_size(q3) == 7);
+			REQUIRE(iterator_size(q4) == 8192);
+
+			int mask = 0;
+			String s;
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);
+			if (s == "sup12")
+				mask |= 1;
+			if (s == "sup14")
+				mask |= 2;
+			if (s == "sup16")
+				mask |= 4;
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);
+			if (s == "sup12")
+				mask |= 1;
+			if (s == "sup14")
+				mask |= 2;
+			if (s == "sup16")
+				mask |= 4;
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);
+			if (s == "sup12")
+				mask |= 1;
+			if (s == "sup14")
+				mask |= 2;
+			if (s == "sup16")
+				mask |= 4;
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s == "");
+
+			s = iterator_next(q1);REQUIRE(s == "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s == "");
+
+			THEN("I get the expected keys") {
+				REQUIRE(mask == 7);
+			}
+
+			REQUIRE(iterator_size(q1) == 0);
+			REQUIRE(iterator_size(q2) == 0);
+			REQUIRE(iterator_size(q3) == 0);
+
+			destroy_iterator(q1);
+			destroy_iterator(q2);
+			destroy_iterator(q3);
+			destroy_iterator(q4);
+		}
+		WHEN("I supersets() the other object") {
+			int q1 = supersets(b, (char *) "c,e", -1);
+			int q2 = supersets(b, (char *) "y,z", -1);
+			int q3 = supersets(b, (char *) "d,e", -1);
+
+			REQUIRE(q1 == 0);
+			REQUIRE(q2 == 0);
+			REQUIRE(q3 == 0);
+		}
+		WHEN("I copy the first object into the second") {
+			int i_a = save_as_binary_image(a);
+
+			REQUIRE(i_a == a);
+
+			int i_a_size = binary_image_size(i_a);
+
+			REQUIRE(i_a_size > 0);
+
+			for (int i = 0; i < i_a_size; i++) {
+				char *p_base64 = binary_image_next(i_a);
+
+				REQUIRE(strlen(p_base64) == 8192);
+
+				REQUIRE(push_binary_image_block(b, p_base64));
+			}
+			REQUIRE(binary_image_size(i_a) == 0);
+			destroy_binary_image(i_a);
+
+			REQUIRE(push_binary_image_block(b, (char *) ""));
+
+			THEN("I supersets() the other object") {
+				int q1 = supersets(b, (char *) "c,e", -1);
+				int q2 = supersets(b, (char *) "y,z", -1);
+				int q3 = supersets(b, (char *) "d,e", -1);
+				int q4 = supersets(a, (char *) "monster", -1);
+
+				REQUIRE(iterator_size(q1) == 8);
+				REQUIRE(iterator_size(q2) == 3);
+				REQUIRE(iterator_size(q3) == 7);
+				REQUIRE(iterator_size(q4) == 8192);
+
+				int mask = 0;
+				String s;
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);
+				if (s == "sup12")
+					mask |= 1;
+				if (s == "sup14")
+					mask |= 2;
+				if (s == "sup16")
+					mask |= 4;
+				s = iterator_next(q3);REQUIRE(s != "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);
+				if (s == "sup12")
+					mask |= 1;
+				if (s == "sup14")
+					mask |= 2;
+				if (s == "sup16")
+					mask |= 4;
+				s = iterator_next(q3);REQUIRE(s != "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);
+				if (s == "sup12")
+					mask |= 1;
 				if (s == "sup14")
 					mask |= 2;
-				if (s == "sup16")
+				if (s == "sup16")
+					mask |= 4;
+				s = iterator_next(q3);REQUIRE(s != "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);REQUIRE(s == "");
+				s = iterator_next(q3);REQUIRE(s != "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);REQUIRE(s == "");
+				s = iterator_next(q3);REQUIRE(s != "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);REQUIRE(s == "");
+				s = iterator_next(q3);REQUIRE(s != "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);REQUIRE(s == "");
+				s = iterator_next(q3);REQUIRE(s != "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);REQUIRE(s == "");
+				s = iterator_next(q3);REQUIRE(s == "");
+
+				s = iterator_next(q1);REQUIRE(s == "");
+				s = iterator_next(q2);REQUIRE(s == "");
+				s = iterator_next(q3);REQUIRE(s == "");
+
+				REQUIRE(mask == 7);
+
+				REQUIRE(iterator_size(q1) == 0);
+				REQUIRE(iterator_size(q2) == 0);
+				REQUIRE(iterator_size(q3) == 0);
+
+				destroy_iterator(q1);
+				destroy_iterator(q2);
+				destroy_iterator(q3);
+				destroy_iterator(q4);
+			}
+		}
+	}
+	destroy_settrie(b);
+	destroy_settrie(a);
+}
+
+
+SCENARIO("Test python_set_as_string()") {
+
+	String s;
+
+	// Special case: This is how python serializes the empty set.
+
+	s = python_set_as_string((char *) "set()");		  REQUIRE(s == "");
+	s = python_set_as_string((char *) "frozenset()"); REQUIRE(s == "");
+
+	// Fall back to doing nothing when not a set.
+
+	s = python_set_as_string((char *) "a, b,c, ',', \",aa\"");	REQUIRE(s == "a, b,c, ',', \",aa\"");
+	s = python_set_as_string((char *) "{a, b,c, ',', \",aa\"");	REQUIRE(s == "{a, b,c, ',', \",aa\"");
+	s = python_set_as_string((char *) "a, b,c, ',', \",aa\"}");	REQUIRE(s == "a, b,c, ',', \",aa\"}");
+
+	// Remove space after comma.
+
+	s = python_set_as_string((char *) "{}");			 REQUIRE(s == "");
+	s = python_set_as_string((char *) "{a}");			 REQUIRE(s == "a");
+	s = python_set_as_string((char *) "{a }");			 REQUIRE(s == "a ");
+	s = python_set_as_string((char *) "{a, b}");		 REQUIRE(s == "a,b");
+	s = python_set_as_string((char *) "{1,2,345}");		 REQUIRE(s == "1,2,345");
+	s = python_set_as_string((char *) "{1, 2, 345}");	 REQUIRE(s == "1,2,345");
+	s = python_set_as_string((char *) "{1,  2, 345}");	 REQUIRE(s == "1,2,345");
+	s = python_set_as_string((char *) "{1,  2, '345'}"); REQUIRE(s == "1,2,'345'");
+
+	s = python_set_as_string((char *) "frozenset({})");				REQUIRE(s == "");
+	s = python_set_as_string((char *) "frozenset({a})");			REQUIRE(s == "a");
+	s = python_set_as_string((char *) "frozenset({a })");			REQUIRE(s == "a ");
+	s = python_set_as_string((char *) "frozenset({a, b})");			REQUIRE(s == "a,b");
+	s = python_set_as_string((char *) "frozenset({1,2,345})");		REQUIRE(s == "1,2,345");
+	s = python_set_as_string((char *) "frozenset({1, 2, 345})");	REQUIRE(s == "1,2,345");
+	s = python_set_as_string((char *) "frozenset({1,  2, 345})");	REQUIRE(s == "1,2,345");
+	s = python_set_as_string((char *) "frozenset({1,  2, '345'})");	REQUIRE(s == "1,2,'345'");
+
+	// Replace commas inside quotes by \x82.
+
+	s = python_set_as_string((char *) "{1, 'two', 'three'}");		 REQUIRE(s == "1,'two','three'");
+	s = python_set_as_string((char *) "{1, 'two,three', 'four'}");	 REQUIRE(s == "1,'two\x82three','four'");
+	s = python_set_as_string((char *) "{1, \"two,three\", 'four'}"); REQUIRE(s == "1,\"two\x82three\",'four'");
+
+	s = python_set_as_string((char *) "frozenset({1, 'two', 'three'})");		REQUIRE(s == "1,'two','three'");
+	s = python_set_as_string((char *) "frozenset({1, 'two,three', 'four'})");	REQUIRE(s == "1,'two\x82three','four'");
+	s = python_set_as_string((char *) "frozenset({1, \"two,three\", 'four'})");	REQUIRE(s == "1,\"two\x82three\",'four'");
+
+	s = python_set_as_string((char *) "{1, '8', 'six, seven', 10, 555, 44, \"El'even, O'Toole\", 'three', 9999, '\"Dirty\" Harry, 2'}");
+
+	REQUIRE(s == "1,'8','six\x82 seven',10,555,44,\"El'even\x82 O'Toole\",'three',9999,'\"Dirty\" Harry\x82 2'");
+
+	s = python_set_as_string((char *) "frozenset({'2, 3', 1, 'its', 'this', \"it's\"})"); REQUIRE(s == "'2\x82 3',1,'its','this',\"it's\"");
+}
+
+
+SCENARIO("Test the Python interface parts") {
+
+	int st1 = new_settrie();
+	int st2 = new_settrie();
+	int st3 = new_settrie();
+
+	GIVEN("I load something to use find()") {
+		insert(st1, (char *) "set()",	  (char *) "empty_set");
+		insert(st1, (char *) "1,3,5",	  (char *) "find1");
+		insert(st1, (char *) "1,2,3,4,5", (char *) "find2");
+		insert(st1, (char *) "1,2,x",	  (char *) "find3");
+
+		WHEN("I find() it") {
+			String f1 = find(st1, (char *) "1,2,x");
+			String f2 = find(st1, (char *) "1,2,y");
+			String f3 = find(st1, (char *) "set()");
+
+			THEN("I get the expected keys") {
+				REQUIRE(f1 == "find3");
+				REQUIRE(f2 == "");
+				REQUIRE(f3 == "empty_set");
+			}
+		}
+	}
+
+	GIVEN("I load something to use supersets()") {
+		insert(st2, (char *) "a,b",				  (char *) "sup01");
+		insert(st2, (char *) "a,c,d",			  (char *) "sup02");
+		insert(st2, (char *) "a,c,e",			  (char *) "sup03");
+		insert(st2, (char *) "a,c,d,e",			  (char *) "sup04");
+		insert(st2, (char *) "b,d",				  (char *) "sup05");
+		insert(st2, (char *) "c,d",				  (char *) "sup06");
+		insert(st2, (char *) "c,e",				  (char *) "sup07");
+		insert(st2, (char *) "c,d,e,f",			  (char *) "sup08");
+		insert(st2, (char *) "c,d,n",			  (char *) "sup09");
+		insert(st2, (char *) "c,d,e,f,x",		  (char *) "sup10");
+		insert(st2, (char *) "c,d,e,f,y",		  (char *) "sup11");
+		insert(st2, (char *) "c,d,e,f,y,z",		  (char *) "sup12");
+		insert(st2, (char *) "d,e",				  (char *) "sup13");
+		insert(st2, (char *) "e,a,b,d,f,n,x,y,z", (char *) "sup14");
+		insert(st2, (char *) "c",				  (char *) "sup15");
+		insert(st2, (char *) "e,y,z,c",			  (char *) "sup16");
+
+		WHEN("I supersets() it") {
+			int q1 = supersets(st2, (char *) "c,e", -1);
+			int q2 = supersets(st2, (char *) "y,z", -1);
+			int q3 = supersets(st2, (char *) "d,e", -1);
+
+			REQUIRE(iterator_size(q1) == 8);
+			REQUIRE(iterator_size(q2) == 3);
+			REQUIRE(iterator_size(q3) == 7);
+
+			int mask = 0;
+			String s;
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);
+			if (s == "sup12")
+				mask |= 1;
+			if (s == "sup14")
+				mask |= 2;
+			if (s == "sup16")
+				mask |= 4;
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);
+			if (s == "sup12")
+				mask |= 1;
+			if (s == "sup14")
+				mask |= 2;
+			if (s == "sup16")
+				mask |= 4;
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);
+			if (s == "sup12")
+				mask |= 1;
+			if (s == "sup14")
+				mask |= 2;
+			if (s == "sup16")
+				mask |= 4;
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s != "");
+
+			s = iterator_next(q1);REQUIRE(s != "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s == "");
+
+			s = iterator_next(q1);REQUIRE(s == "");
+			s = iterator_next(q2);REQUIRE(s == "");
+			s = iterator_next(q3);REQUIRE(s == "");
+
+			THEN("I get the expected keys") {
+				REQUIRE(mask == 7);
+			}
+
+			REQUIRE(iterator_size(q1) == 0);
+			REQUIRE(iterator_size(q2) == 0);
+			REQUIRE(iterator_size(q3) == 0);
+
+			destroy_iterator(q1);
+			destroy_iterator(q2);
+			destroy_iterator(q3);
+		}
+
+		GIVEN("I load something to use subsets()") {
+			insert(st3, (char *) "1,3,5",	  (char *) "sub1");
+			insert(st3, (char *) "1,2,3,4,5", (char *) "sub2");
+			insert(st3, (char *) "1,2,x",	  (char *) "sub3");
+			insert(st3, (char *) "1,x",		  (char *) "sub4");
+			insert(st3, (char *) "1,y",		  (char *) "sub5");
+
+			WHEN("I find() it") {
+				int q1 = subsets(st3, (char *) "1,2,3,4,5,x,y", -1);
+				int q2 = subsets(st3, (char *) "1,2,x,y", -1);
+				int q3 = subsets(st3, (char *) "1,x,y", -1);
+
+				REQUIRE(iterator_size(q1) == 5);
+				REQUIRE(iterator_size(q2) == 3);
+				REQUIRE(iterator_size(q3) == 2);
+
+				int mask = 0;
+				String s;
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);
+				if (s == "sub3")
+					mask |= 1;
+				if (s == "sub4")
+					mask |= 2;
+				if (s == "sub5")
+					mask |= 4;
+				s = iterator_next(q3);REQUIRE(s != "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);
+				if (s == "sub3")
+					mask |= 1;
+				if (s == "sub4")
+					mask |= 2;
+				if (s == "sub5")
 					mask |= 4;
 				s = iterator_next(q3);REQUIRE(s != "");
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);
-				if (s == "sup12")
-					mask |= 1;
-				if (s == "sup14")
-					mask |= 2;
-				if (s == "sup16")
-					mask |= 4;
-				s = iterator_next(q3);REQUIRE(s != "");
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);
+				if (s == "sub3")
+					mask |= 1;
+				if (s == "sub4")
+					mask |= 2;
+				if (s == "sub5")
+					mask |= 4;
+				s = iterator_next(q3);REQUIRE(s == "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);REQUIRE(s == "");
+				s = iterator_next(q3);REQUIRE(s == "");
+
+				s = iterator_next(q1);REQUIRE(s != "");
+				s = iterator_next(q2);REQUIRE(s == "");
+				s = iterator_next(q3);REQUIRE(s == "");
+
+				s = iterator_next(q1);REQUIRE(s == "");
+				s = iterator_next(q2);REQUIRE(s == "");
+				s = iterator_next(q3);REQUIRE(s == "");
+
+				THEN("I get the expected keys") {
+					REQUIRE(mask == 7);
+				}
+
+				REQUIRE(iterator_size(q1) == 0);
+				REQUIRE(iterator_size(q2) == 0);
+				REQUIRE(iterator_size(q3) == 0);
+
+				destroy_iterator(q1);
+				destroy_iterator(q2);
+				destroy_iterator(q3);
+			}
+		}
+	}
+	destroy_settrie(st1);
+	destroy_settrie(st2);
+	destroy_settrie(st3);
+}
+
+
+SCENARIO("Small Insert/find test") {
+
+	SetTrie ST;
+
+	BinarySet b_set = {3, 5, 7};
+
+	REQUIRE(ST.find(b_set) == 0);
+
+	String key0 = {"empty"};
+	String val0 = {""};
+
+	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "") == 0);
+
+	ST.insert(val0, key0, ',');
+
+	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "empty") == 0);
+
+	String key1 = {"ky1"};
+	String val1 = {"1 3 5"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(strcmp(ST.find(val1, ' ').c_str(), key1.c_str()) == 0);
+
+	String key2 = {"ky1"};
+	String val2 = {"1 2 3 4 5"};
+
+	ST.insert(val2, key2, ' ');
+
+	REQUIRE(strcmp(ST.find(val2, ' ').c_str(), key2.c_str()) == 0);
+	REQUIRE(strcmp(ST.find(val1, ' ').c_str(), key1.c_str()) == 0);
+
+	val1.clear();
+
+	ST.insert(val1, key1, ' ');
+
+	val2 = "1 2 x";
+
+	REQUIRE(ST.find(val2, ' ') == "");
+
+	val2 = "1 2 3 4";
+
+	REQUIRE(ST.find(val2, ' ') == "");
+
+	val2 = "";
+
+	REQUIRE(ST.find(val2, ' ') == "ky1");
+}
+
+
+SCENARIO("Small Insert/supersets test") {
+
+	SetTrie ST;
+
+	QueryContext ctx;
+
+	ctx.query = {1000003, 1000005, 1000007};
+	ctx.last_query_idx = ctx.query.size() - 1;
+	ST.supersets(ST.tree[0].idx_child, 0, ctx);
+
+	REQUIRE(ctx.result.size() == 0);
+
+	ST.supersets(0, 0, ctx);
+
+	REQUIRE(ctx.result.size() == 0);
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 0);
+	REQUIRE(ST.supersets("", ' ').size()	== 0);
+
+	String key1 = {"no_1"};
+	String val1 = {"a b"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("", ' ').size()	== 1);
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 0);
+	REQUIRE(ST.supersets("a", ' ').size()	== 1);
+	REQUIRE(ST.supersets("b", ' ').size()	== 1);
+	REQUIRE(ST.supersets("a b", ' ').size() == 1);
+	REQUIRE(ST.supersets("c", ' ').size()	== 0);
+
+	String key0 = {"empty"};
+	String val0 = {""};
+
+	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "") == 0);
+
+	ST.insert(val0, key0, ',');
+
+	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "empty") == 0);
+
+	StringSet ss = ST.supersets("", ' ');
+
+	REQUIRE(ss.size() == 2);
+	REQUIRE(ss[0] == "empty");
+	REQUIRE(ss[1] == "no_1");
+
+	key1 = {"no_2"};
+	val1 = {"a c d"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 0);
+	REQUIRE(ST.supersets("a", ' ').size()	== 2);
+	REQUIRE(ST.supersets("b", ' ').size()	== 1);
+	REQUIRE(ST.supersets("a d", ' ').size() == 1);
+	REQUIRE(ST.supersets("c", ' ').size()	== 1);
+
+	key1 = {"yes_1"};
+	val1 = {"a c e"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 1);
+	REQUIRE(ST.supersets("a", ' ').size()	== 3);
+	REQUIRE(ST.supersets("b", ' ').size()	== 1);
+	REQUIRE(ST.supersets("a c", ' ').size() == 2);
+	REQUIRE(ST.supersets("c", ' ').size()	== 2);
+
+	key1 = {"yes_2"};
+	val1 = {"a c d e"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 2);
+	REQUIRE(ST.supersets("a", ' ').size()	== 4);
+	REQUIRE(ST.supersets("c", ' ').size()	== 3);
+	REQUIRE(ST.supersets("e", ' ').size()	== 2);
+
+	key1 = {"no_3"};
+	val1 = {"b d"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 2);
+	REQUIRE(ST.supersets("a", ' ').size()	== 4);
+	REQUIRE(ST.supersets("c", ' ').size()	== 3);
+	REQUIRE(ST.supersets("b d", ' ').size()	== 1);
+
+	key1 = {"no_4"};
+	val1 = {"c d"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 2);
+	REQUIRE(ST.supersets("a", ' ').size()	== 4);
+	REQUIRE(ST.supersets("c", ' ').size()	== 4);
+	REQUIRE(ST.supersets("b d", ' ').size()	== 1);
+
+	key1 = {"yes_3"};
+	val1 = {"c e"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 3);
+	REQUIRE(ST.supersets("a", ' ').size()	== 4);
+	REQUIRE(ST.supersets("c", ' ').size()	== 5);
+	REQUIRE(ST.supersets("b d", ' ').size()	== 1);
+
+	key1 = {"yes_4"};
+	val1 = {"c d e f"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 4);
+	REQUIRE(ST.supersets("f", ' ').size()	== 1);
+	REQUIRE(ST.supersets("c", ' ').size()	== 6);
+	REQUIRE(ST.supersets("e f", ' ').size()	== 1);
+
+	key1 = {"no_5"};
+	val1 = {"c d n"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 4);
+	REQUIRE(ST.supersets("n", ' ').size()	== 1);
+	REQUIRE(ST.supersets("c", ' ').size()	== 7);
+	REQUIRE(ST.supersets("c d", ' ').size()	== 5);
+
+	key1 = {"yes_5"};
+	val1 = {"c d e f x"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 5);
+	REQUIRE(ST.supersets("n", ' ').size()	== 1);
+	REQUIRE(ST.supersets("c", ' ').size()	== 8);
+	REQUIRE(ST.supersets("c d", ' ').size()	== 6);
+
+	key1 = {"yes_6"};
+	val1 = {"c d e f y"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 6);
+	REQUIRE(ST.supersets("z", ' ').size()	== 0);
+	REQUIRE(ST.supersets("c", ' ').size()	== 9);
+	REQUIRE(ST.supersets("c d", ' ').size()	== 7);
+
+	key1 = {"yes_7"};
+	val1 = {"c d e f y z"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 7);
+	REQUIRE(ST.supersets("z", ' ').size()	== 1);
+	REQUIRE(ST.supersets("f y", ' ').size()	== 2);
+	REQUIRE(ST.supersets("c d", ' ').size()	== 8);
+	REQUIRE(ST.supersets("c", ' ').size()	== 10);
+
+	key1 = {"no_6"};
+	val1 = {"d e"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 7);
+	REQUIRE(ST.supersets("z", ' ').size()	== 1);
+	REQUIRE(ST.supersets("f y", ' ').size()	== 2);
+	REQUIRE(ST.supersets("c d", ' ').size()	== 8);
+	REQUIRE(ST.supersets("c", ' ').size()	== 10);
+
+	key1 = {"no_7"};
+	val1 = {"e a b d f n x y z"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 7);
+	REQUIRE(ST.supersets("z", ' ').size()	== 2);
+	REQUIRE(ST.supersets("f y", ' ').size()	== 3);
+	REQUIRE(ST.supersets("d e", ' ').size()	== 7);
+	REQUIRE(ST.supersets("c", ' ').size()	== 10);
+
+	key1 = {"no_8"};
+	val1 = {"c"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 7);
+	REQUIRE(ST.supersets("z", ' ').size()	== 2);
+	REQUIRE(ST.supersets("f y", ' ').size()	== 3);
+	REQUIRE(ST.supersets("d e", ' ').size()	== 7);
+	REQUIRE(ST.supersets("c", ' ').size()	== 11);
+
+	key1 = {"yes_8"};
+	val1 = {"e y z c"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.supersets("c e", ' ').size() == 8);
+	REQUIRE(ST.supersets("z", ' ').size()	== 3);
+	REQUIRE(ST.supersets("y z", ' ').size()	== 3);
+	REQUIRE(ST.supersets("d e", ' ').size()	== 7);
+	REQUIRE(ST.supersets("c", ' ').size()	== 12);
+
+	REQUIRE(ST.supersets("", ' ').size()	   == 17);
+	REQUIRE(ST.supersets("xy", ' ').size()	   == 0);
+	REQUIRE(ST.supersets("a b xy", ' ').size() == 0);
+
+	ctx = QueryContext();
+
+	ctx.query = {1000003, 1000005, 1000007};
+	ctx.last_query_idx = ctx.query.size() - 1;
+	ST.supersets(ST.tree[0].idx_child, 0, ctx);
+
+	REQUIRE(ctx.result.size() == 0);
+
+	ST.supersets(0, 0, ctx);
+
+	REQUIRE(ctx.result.size() == 0);
+
+	int tot = 0;
+
+	ss = ST.supersets("c e", ' ');
+
+	for (int i = 0; i < 8; i ++) {
+		if (ss[i] == "yes_1")
+			tot += 1;
+		if (ss[i] == "yes_2")
+			tot += 2;
+		if (ss[i] == "yes_3")
+			tot += 4;
+		if (ss[i] == "yes_4")
+			tot += 8;
+		if (ss[i] == "yes_5")
+			tot += 16;
+		if (ss[i] == "yes_6")
+			tot += 32;
+		if (ss[i] == "yes_7")
+			tot += 64;
+		if (ss[i] == "yes_8")
+			tot += 128;
+	}
+	REQUIRE(tot == 255);
+}
+
+
+SCENARIO("Small Insert/subsets test") {
+
+	SetTrie ST;
+
+	QueryContext ctx;
+
+	ctx.query = {1000003, 1000005, 1000007};
+	ctx.last_query_idx = ctx.query.size() - 1;
+	ST.subsets(ST.tree[0].idx_child, 0, ctx);
+
+	REQUIRE(ctx.result.size() == 0);
+
+	ST.subsets(0, 0, ctx);
+
+	REQUIRE(ctx.result.size() == 0);
+
+	REQUIRE(ST.subsets("c e", ' ').size() == 0);
+	REQUIRE(ST.subsets("", ' ').size()	  == 0);
+
+	String key1 = {"key_1"};
+	String val1 = {"a b"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("", ' ').size() == 0);
+
+	REQUIRE(ST.subsets("c e", ' ').size()	== 0);
+	REQUIRE(ST.subsets("a", ' ').size()		== 0);
+	REQUIRE(ST.subsets("b", ' ').size()		== 0);
+	REQUIRE(ST.subsets("a b", ' ').size()	== 1);
+	REQUIRE(ST.subsets("c a b", ' ').size()	== 1);
+
+	key1 = {"key_2"};
+	val1 = {"a c d"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()			== 0);
+	REQUIRE(ST.subsets("x", ' ').size()			== 0);
+	REQUIRE(ST.subsets("a b", ' ').size()		== 1);
+	REQUIRE(ST.subsets("c a b", ' ').size()		== 1);
+	REQUIRE(ST.subsets("c a d", ' ').size()		== 1);
+	REQUIRE(ST.subsets("c a b d", ' ').size()	== 2);
+
+	String key0 = {"empty"};
+	String val0 = {""};
+
+	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "") == 0);
+
+	ST.insert(val0, key0, ',');
+
+	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "empty") == 0);
+
+	StringSet ss = ST.subsets("", ' ');
+
+	REQUIRE(ss.size() == 1);
+	REQUIRE(ss[0] == "empty");
+
+	key1 = {"key_3"};
+	val1 = {"a c e"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()			== 1);
+	REQUIRE(ST.subsets("x", ' ').size()			== 1);
+	REQUIRE(ST.subsets("a b x", ' ').size()		== 2);
+	REQUIRE(ST.subsets("c a b", ' ').size()		== 2);
+	REQUIRE(ST.subsets("a c e", ' ').size()		== 2);
+	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 4);
+
+	key1 = {"key_4"};
+	val1 = {"a c d e"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()			== 1);
+	REQUIRE(ST.subsets("x y z", ' ').size()		== 1);
+	REQUIRE(ST.subsets("a b x", ' ').size()		== 2);
+	REQUIRE(ST.subsets("c a d e", ' ').size()	== 4);
+	REQUIRE(ST.subsets("a c e", ' ').size()		== 2);
+	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 5);
+
+	key1 = {"key_5"};
+	val1 = {"b"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()			== 1);
+	REQUIRE(ST.subsets("b", ' ').size()			== 2);
+	REQUIRE(ST.subsets("x y z", ' ').size()		== 1);
+	REQUIRE(ST.subsets("a b x", ' ').size()		== 3);
+	REQUIRE(ST.subsets("c a d e", ' ').size()	== 4);
+	REQUIRE(ST.subsets("a c e", ' ').size()		== 2);
+	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 6);
+
+	key1 = {"key_6"};
+	val1 = {"c d"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()			== 1);
+	REQUIRE(ST.subsets("b", ' ').size()			== 2);
+	REQUIRE(ST.subsets("c d", ' ').size()		== 2);
+	REQUIRE(ST.subsets("c d x y z", ' ').size()	== 2);
+	REQUIRE(ST.subsets("a b x", ' ').size()		== 3);
+	REQUIRE(ST.subsets("c a d e", ' ').size()	== 5);
+	REQUIRE(ST.subsets("a c e", ' ').size()		== 2);
+	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 7);
+
+	key1 = {"key_7"};
+	val1 = {"c e"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()			== 1);
+	REQUIRE(ST.subsets("b", ' ').size()			== 2);
+	REQUIRE(ST.subsets("c d", ' ').size()		== 2);
+	REQUIRE(ST.subsets("c d x y z", ' ').size()	== 2);
+	REQUIRE(ST.subsets("a b x", ' ').size()		== 3);
+	REQUIRE(ST.subsets("c a d e", ' ').size()	== 6);
+	REQUIRE(ST.subsets("c e", ' ').size()		== 2);
+	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 8);
+
+	key1 = {"key_8"};
+	val1 = {"c d e f"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()				== 1);
+	REQUIRE(ST.subsets("b", ' ').size()				== 2);
+	REQUIRE(ST.subsets("c d e f", ' ').size()		== 4);
+	REQUIRE(ST.subsets("c d e f x y", ' ').size()	== 4);
+	REQUIRE(ST.subsets("c a b d e f", ' ').size()	== 9);
+
+	key1 = {"key_9"};
+	val1 = {"c d n"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()				==  1);
+	REQUIRE(ST.subsets("b", ' ').size()				==  2);
+	REQUIRE(ST.subsets("c d n", ' ').size()			==  3);
+	REQUIRE(ST.subsets("c d n f x y", ' ').size()	==  3);
+	REQUIRE(ST.subsets("c a b d e f n", ' ').size()	== 10);
+
+	key1 = {"key_a"};
+	val1 = {"c d e f x"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()					==  1);
+	REQUIRE(ST.subsets("b", ' ').size()					==  2);
+	REQUIRE(ST.subsets("c d e f x", ' ').size()			==  5);
+	REQUIRE(ST.subsets("c d e f x y z xx", ' ').size()	==  5);
+	REQUIRE(ST.subsets("c a b d e f n x", ' ').size()	== 11);
+
+	key1 = {"key_b"};
+	val1 = {"c d e f y"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()					==  1);
+	REQUIRE(ST.subsets("b", ' ').size()					==  2);
+	REQUIRE(ST.subsets("c d e f y", ' ').size()			==  5);
+	REQUIRE(ST.subsets("c d e f x y z xx", ' ').size()	==  6);
+	REQUIRE(ST.subsets("c a b d e f n x y", ' ').size()	== 12);
+
+	key1 = {"key_c"};
+	val1 = {"c d e f y z"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()						==  1);
+	REQUIRE(ST.subsets("b", ' ').size()						==  2);
+	REQUIRE(ST.subsets("c d e f y z", ' ').size()			==  6);
+	REQUIRE(ST.subsets("c d e f y z xx yy", ' ').size()		==  6);
+	REQUIRE(ST.subsets("c a b d e f n x y z", ' ').size()	== 13);
+
+	key1 = {"key_d"};
+	val1 = {"d e"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()						==  1);
+	REQUIRE(ST.subsets("b", ' ').size()						==  2);
+	REQUIRE(ST.subsets("d e", ' ').size()					==  2);
+	REQUIRE(ST.subsets("d e xx yy", ' ').size()				==  2);
+	REQUIRE(ST.subsets("c a b d e f n x y z", ' ').size()	== 14);
+
+	key1 = {"key_e"};
+	val1 = {"e a b d f n x y z"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()						==  1);
+	REQUIRE(ST.subsets("b", ' ').size()						==  2);
+	REQUIRE(ST.subsets("e a b d f n x y z", ' ').size()		==  5);
+	REQUIRE(ST.subsets("e a b d f n x y z xxy", ' ').size()	==  5);
+	REQUIRE(ST.subsets("c a b d e f n x y z", ' ').size()	== 15);
+
+	key1 = {"key_f"};
+	val1 = {"c"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("a", ' ').size()						==  1);
+	REQUIRE(ST.subsets("b", ' ').size()						==  2);
+	REQUIRE(ST.subsets("c", ' ').size()						==  2);
+	REQUIRE(ST.subsets("c xx yy", ' ').size()				==  2);
+	REQUIRE(ST.subsets("c a b d e f n x y z", ' ').size()	== 16);
+
+	key1 = {"key_0"};
+	val1 = {"e y z c"};
+
+	ST.insert(val1, key1, ' ');
+
+	REQUIRE(ST.subsets("xx yy aa bb cc dd ee", ' ').size()	==  1);
+	REQUIRE(ST.subsets("a", ' ').size()						==  1);
+	REQUIRE(ST.subsets("c", ' ').size()						==  2);
+	REQUIRE(ST.subsets("e y z c", ' ').size()				==  4);
+	REQUIRE(ST.subsets("e y z c xx yy", ' ').size()			==  4);
+	REQUIRE(ST.subsets("a b c d e f n x y z", ' ').size()	== 17);
+
+	ctx = QueryContext();
+
+	ctx.query = {1000003, 1000005, 1000007};
+	ctx.last_query_idx = ctx.query.size() - 1;
+	ST.subsets(ST.tree[0].idx_child, 0, ctx);
+
+	REQUIRE(ctx.result.size() == 0);
+
+	ST.subsets(0, 0, ctx);
+
+	REQUIRE(ctx.result.size() == 0);
+
+	int tot = 0;
+
+	ss = ST.subsets("a b c d e f n x y z", ' ');
+
+	for (int i = 0; i < 17; i ++) {
+		if (ss[i] == "key_0")
+			tot += 1;
+		if (ss[i] == "key_1")
+			tot += 2;
+		if (ss[i] == "key_2")
+			tot += 4;
+		if (ss[i] == "key_3")
+			tot += 8;
+		if (ss[i] == "key_4")
+			tot += 16;
+		if (ss[i] == "key_5")
+			tot += 32;
+		if (ss[i] == "key_6")
+			tot += 64;
+		if (ss[i] == "key_7")
+			tot += 128;
+		if (ss[i] == "key_8")
+			tot += 256;
+		if (ss[i] == "key_9")
+			tot += 512;
+		if (ss[i] == "key_a")
+			tot += 1024;
+		if (ss[i] == "key_b")
+			tot += 2048;
+		if (ss[i] == "key_c")
+			tot += 4096;
+		if (ss[i] == "key_d")
+			tot += 8192;
+		if (ss[i] == "key_e")
+			tot += 16384;
+		if (ss[i] == "key_f")
+			tot += 32768;
+		if (ss[i] == "empty")
+			tot += 65536;
+	}
+	REQUIRE(tot == 131071);
+}
+
+
+SCENARIO("Test sorted sibling chains vs. brute force") {
+
+	SetTrie ST;
+
+	uint64_t rnd = 12345;
+
+	std::vector<StringSet> sets = random_sets(rnd, 500, 6, 40);
+
+	for (int i = 0; i < 500; i++)
+		ST.insert(sets[i], "s" + std::to_string(i));
+
+	check_sorted_chains(&ST);
+
+	std::vector<std::vector<String>> sorted_sets;
+
+	for (int i = 0; i < 500; i++) {
+		StringSet set = sets[i];
+		std::sort(set.begin(), set.end());
+		set.erase(unique(set.begin(), set.end()), set.end());
+		sorted_sets.push_back(set);
+	}
+
+	for (int q = 0; q < 200; q++) {
+		StringSet query = random_sets(rnd, 1, q < 100 ? 3 : 12, 40)[0];
+
+		StringSet s_query = query;
+		std::sort(s_query.begin(), s_query.end());
+		s_query.erase(unique(s_query.begin(), s_query.end()), s_query.end());
+
+		std::map<String, int> sup = {}, sub = {};
+
+		for (int i = 0; i < 500; i++) {
+			String key = ST.find(sets[i]);
+
+			REQUIRE(key != "");
+
+			if (std::includes(sorted_sets[i].begin(), sorted_sets[i].end(), s_query.begin(), s_query.end()))
+				sup[key] = 1;
+
+			if (std::includes(s_query.begin(), s_query.end(), sorted_sets[i].begin(), sorted_sets[i].end()))
+				sub[key] = 1;
+		}
+
+		StringSet ret = ST.supersets(query);
+
+		REQUIRE(ret.size() == sup.size());
+
+		for (int i = 0; i < ret.size(); i++)
+			REQUIRE(sup.count(ret[i]) == 1);
+
+		ret = ST.subsets(query);
+
+		REQUIRE(ret.size() == sub.size());
+
+		for (int i = 0; i < ret.size(); i++)
+			REQUIRE(sub.count(ret[i]) == 1);
+	}
+
+	WHEN("An image has unsorted chains") {
+		int i = ST.tree[0].idx_child;
+		int j = ST.tree[i].idx_next;
+
+		ST.tree[0].idx_child = j;
+		ST.tree[i].idx_next	 = ST.tree[j].idx_next;
+		ST.tree[j].idx_next	 = i;
+
+		pBinaryImage p_bi = new BinaryImage;
+
+		REQUIRE(ST.save(p_bi));
+
+		SetTrie ST2;
+
+		REQUIRE(ST2.load(p_bi));
+
+		delete p_bi;
+
+		THEN("load() sorts them") {
+			check_sorted_chains(&ST2);
+
+			for (int i = 0; i < 500; i++)
+				REQUIRE(ST2.find(sets[i]) != "");
+		}
+	}
+}
+
+
+SCENARIO("Test path compression vs. brute force") {
+
+	SetTrie ST;
+
+	uint64_t rnd = 97531;
+
+	// Long baskets sharing a few first elements, plus prefixes of some of them that end inside the runs and split them.
+
+	std::vector<StringSet> sets = random_sets(rnd, 300, 50, 1000);
+
+	for (int i = 0; i < 300; i++) {
+		sets[i].push_back("e" + std::to_string(i % 3));
+		sets[i].push_back("e" + std::to_string(i % 5));
+	}
+
+	for (int i = 0; i < 300; i += 4) {
+		StringSet prefix(sets[i].begin(), sets[i].begin() + sets[i].size()/2);
+		sets.push_back(prefix);
+	}
+
+	int num_sets = sets.size();
+
+	for (int i = 0; i < num_sets; i++)
+		ST.insert(sets[i], "s" + std::to_string(i));
+
+	REQUIRE(ST.runs.size() > 0);
+	REQUIRE(2*ST.tree.size() < num_values(ST));
+
+	check_sorted_chains(&ST);
+
+	std::vector<StringSet> sorted_sets;
+
+	for (int i = 0; i < num_sets; i++) {
+		StringSet set = sets[i];
+		std::sort(set.begin(), set.end());
+		set.erase(unique(set.begin(), set.end()), set.end());
+		sorted_sets.push_back(set);
+	}
+
+	std::vector<bool> removed(num_sets, false);
+
+	for (int pass = 0; pass < 3; pass++) {
+		check_summaries(ST);
+
+		std::map<String, int> node = {};
+
+		for (IdTable::iterator it = ST.id.begin(); it != ST.id.end(); ++it)
+			node[it->second] = it->first;
+
+		for (int i = 0; i < num_sets; i++) {
+			String key = ST.find(sets[i]);
+
+			if (removed[i]) {
+				REQUIRE(key == "");
+
+				continue;
+			}
+
+			REQUIRE(key != "");
+
+			StringSet elem = ST.elements(node[key]);
+			std::sort(elem.begin(), elem.end());
+
+			REQUIRE(elem == sorted_sets[i]);
+		}
+
+		for (int q = 0; q < 100; q++) {
+			int i = (q*37) % num_sets, j = (q*53 + 1) % num_sets;
+
+			// A few elements of a set for supersets(), the union of two sets for subsets().
+			int		  n_sup		= std::min((int) sorted_sets[i].size(), 1 + q % 3);
+			StringSet sup_query = StringSet(sorted_sets[i].begin(), sorted_sets[i].begin() + n_sup);
+			StringSet sub_query = sorted_sets[i];
+
+			sub_query.insert(sub_query.end(), sorted_sets[j].begin(), sorted_sets[j].end());
+			std::sort(sub_query.begin(), sub_query.end());
+			sub_query.erase(unique(sub_query.begin(), sub_query.end()), sub_query.end());
+
+			std::map<String, int> sup = {}, sub = {};
+
+			for (int k = 0; k < num_sets; k++) {
+				if (removed[k])
+					continue;
+
+				String key = ST.find(sets[k]);
+
+				if (std::includes(sorted_sets[k].begin(), sorted_sets[k].end(), sup_query.begin(), sup_query.end()))
+					sup[key] = 1;
+
+				if (std::includes(sub_query.begin(), sub_query.end(), sorted_sets[k].begin(), sorted_sets[k].end()))
+					sub[key] = 1;
+			}
+
+			StringSet ret = ST.supersets(sup_query);
+
+			REQUIRE(ret.size() == sup.size());
+			REQUIRE(ST.count_supersets(sup_query) == sup.size());
+
+			for (int k = 0; k < ret.size(); k++)
+				REQUIRE(sup.count(ret[k]) == 1);
+
+			ret = ST.subsets(sub_query);
+
+			REQUIRE(ret.size() == sub.size());
+			REQUIRE(ST.count_subsets(sub_query) == sub.size());
+
+			for (int k = 0; k < ret.size(); k++)
+				REQUIRE(sub.count(ret[k]) == 1);
+
+			// The cursors return the same results in the same order.
+			IdList	  cur_ids;
+			StringSet expected = ST.supersets(sup_query);
+
+			SetTrieCursor sup_cursor(ST, CURSOR_SUPERSETS, sup_query);
+
+			for (int set_id; (set_id = sup_cursor.next()) >= 0;)
+				cur_ids.push_back(set_id);
+
+			REQUIRE(sup_cursor.next() == CURSOR_END);
+			REQUIRE(cur_ids.size() == expected.size());
+
+			for (int k = 0; k < cur_ids.size(); k++)
+				REQUIRE(ST.id[cur_ids[k]] == expected[k]);
+
+			cur_ids.clear();
+			expected = ST.subsets(sub_query);
+
+			SetTrieCursor sub_cursor(ST, CURSOR_SUBSETS, sub_query);
+
+			for (int set_id; (set_id = sub_cursor.next()) >= 0;)
+				cur_ids.push_back(set_id);
+
+			REQUIRE(cur_ids.size() == expected.size());
+
+			for (int k = 0; k < cur_ids.size(); k++)
+				REQUIRE(ST.id[cur_ids[k]] == expected[k]);
+
+			// The first results found when the search stops early.
+			int limit = q % 4;
+
+			ret = ST.supersets(sup_query, limit);
+
+			REQUIRE(ret.size() == std::min(limit, (int) sup.size()));
+
+			for (int k = 0; k < ret.size(); k++)
+				REQUIRE(sup.count(ret[k]) == 1);
+
+			ret = ST.subsets(sub_query, limit);
+
+			REQUIRE(ret.size() == std::min(limit, (int) sub.size()));
+
+			for (int k = 0; k < ret.size(); k++)
+				REQUIRE(sub.count(ret[k]) == 1);
+		}
+
+		if (pass == 0) {
+			// Remove every third set, the removed leaves release their runs.
+
+			for (int i = 0; i < num_sets; i += 3) {
+				String key = ST.find(sets[i]);
+
+				for (int k = 0; k < num_sets; k++)
+					if (!removed[k] && ST.find(sets[k]) == key)
+						removed[k] = true;
+
+				for (IdTable::iterator it = ST.id.begin(); it != ST.id.end(); ++it)
+					if (it->second == key) {
+						REQUIRE(ST.remove(it->first) == 0);
+						break;
+					}
+			}
+
+			REQUIRE(ST.free_runs.size() > 0);
+		} else if (pass == 1) {
+			REQUIRE(ST.purge() == 0);
+			REQUIRE(ST.free_runs.size() == 0);
+
+			check_sorted_chains(&ST);
+
+			pBinaryImage p_bi = new BinaryImage;
+
+			REQUIRE(ST.save(p_bi));
+
+			SetTrie LT;
+
+			REQUIRE(LT.load(p_bi));
+
+			delete p_bi;
+
+			REQUIRE(LT.runs.size() == ST.runs.size());
+
+			check_summaries(LT);
+
+			for (int i = 0; i < num_sets; i++)
+				REQUIRE(LT.find(sets[i]) == ST.find(sets[i]));
+		}
+	}
+}
+
+
+SCENARIO("Test the hot/cold node layout and loading version 1.5.1 images") {
+
+	REQUIRE(sizeof(SetNode) == 12);
+	REQUIRE(sizeof(LegacySetNode) == 24);
+
+	// Version 1.5.1 images store the element hash in the nodes and the names in hash order, the sets are sorted by hash.
+	// Inserting all the elements in hash order first gives A the same order. They have no runs either: every node of A
+	// is the end of a set or has more than one child.
+
+	std::map<ElementHash, String> by_hash = {};
+	StringSet elem = {"a", "b", "c", "d", "e", "f"};
+
+	for (int i = 0; i < elem.size(); i++)
+		by_hash[MurmurHash64A(elem[i].c_str(), elem[i].length())] = elem[i];
+
+	StringSet all = {};
+	for (std::map<ElementHash, String>::iterator it = by_hash.begin(); it != by_hash.end(); ++it)
+		all.push_back(it->second);
+
+	SetTrie A;
+
+	for (int i = 1; i <= all.size(); i++)
+		A.insert(StringSet(all.begin(), all.begin() + i), "p" + std::to_string(i));
+
+	A.insert({all[0], all[2]},		   "x02");
+	A.insert({all[0], all[2], all[3]}, "x023");
+	A.insert({},					   "empty");
+	A.insert({all[1]},				   "x1");
+	A.insert({all[1], all[3]},		   "x13");
+
+	REQUIRE(A.parent.size() == A.tree.size());
+	REQUIRE(A.state.size()	== A.tree.size());
+	REQUIRE(A.runs.size()	== 0);
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	String section = "tree";
+	ElementHash hs = MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	int len = A.tree.size();
+
+	image_put(p_bi, &len, sizeof(len));
+
+	for (int i = 0; i < len; i++) {
+		ElementHash hh = i == 0 ? 0 : A.names[A.tree[i].value].hash;
+
+		LegacySetNode sn = {hh, A.tree[i].idx_next, A.tree[i].idx_child, A.parent[i], A.state[i]};
+		image_put(p_bi, &sn, sizeof(sn));
+	}
+
+	section = "name";
+	hs		= MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	len = A.hh_nam.size();
+
+	image_put(p_bi, &len, sizeof(len));
+
+	ElementSlotList names_by_hash = A.hh_nam.sorted();
+
+	for (ElementSlotList::iterator it = names_by_hash.begin(); it != names_by_hash.end(); ++it) {
+		Name &nam = A.names[it->second];
+		image_put(p_bi, &nam.hash, sizeof(ElementHash));
+		image_put(p_bi, &nam.count, sizeof(int));
+		int ll = A.name_arena.length(nam.name);
+		image_put(p_bi, &ll, sizeof(ll));
+		image_put(p_bi, (void *) A.name_arena.data(nam.name), ll);
+	}
+
+	section = "id";
+	hs		= MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	len = A.id.size();
+
+	image_put(p_bi, &len, sizeof(len));
+
+	for (IdTable::iterator it = A.id.begin(); it != A.id.end(); ++it) {
+		int ii = it->first;
+		image_put(p_bi, &ii, sizeof(ii));
+		int ll = it->second.length();
+		image_put(p_bi, &ll, sizeof(ll));
+		image_put(p_bi, (void *) it->second.c_str(), ll);
+	}
+
+	section = "end";
+	hs		= MurmurHash64A(section.c_str(), section.length());
+
+	image_put(p_bi, &hs, sizeof(hs));
+
+	SetTrie B;
+
+	REQUIRE(B.load(p_bi));
+
+	delete p_bi;
+
+	REQUIRE(B.tree.size()	== A.tree.size());
+	REQUIRE(B.hh_nam.size() == A.hh_nam.size());
+
+	len = A.tree.size();
+
+	for (int i = 1; i < len; i++) {
+		REQUIRE(B.names[B.tree[i].value].hash == A.names[A.tree[i].value].hash);
+		REQUIRE(B.parent[i]	== A.parent[i]);
+		REQUIRE(B.state[i]	== A.state[i]);
+	}
+
+	REQUIRE(B.find({all[3], all[2], all[0]})					 == "x023");
+	REQUIRE(B.find("", ' ')										 == "empty");
+	REQUIRE(B.supersets({all[3]}).size()						 == 5);
+	REQUIRE(B.subsets({all[0], all[1], all[2], all[3]}).size() == 9);
+}
+
+
+SCENARIO("Test the dense element dictionary") {
+
+	SetTrie ST;
+
+	ST.insert("a b c", "abc", ' ');
+	ST.insert("b c d", "bcd", ' ');
+
+	REQUIRE(ST.names.size()  == 4);
+	REQUIRE(ST.hh_nam.size() == 4);
+
+	for (ElementTable::iterator it = ST.hh_nam.begin(); it != ST.hh_nam.end(); ++it)
+		REQUIRE(ST.names[it->second].hash == it->first);
+
+	REQUIRE(ST.remove(ST.id.begin()->first) == 0);
+
+	int num_free = ST.free_elements.size();
+
+	REQUIRE(num_free == 1);
+	REQUIRE(ST.hh_nam.size() == 3);
+
+	// A released id is reused before the dictionary grows.
+
+	ST.insert("x y", "xy", ' ');
+
+	REQUIRE(ST.names.size()			== 5);
+	REQUIRE(ST.free_elements.size() == 0);
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	int last = 0;
+	for (IdTable::iterator it = ST.id.begin(); it != ST.id.end(); ++it)
+		last = it->first;
+
+	ST.remove(last);
+
+	REQUIRE(ST.save(p_bi));
+
+	SetTrie LT;
+
+	REQUIRE(LT.load(p_bi));
+
+	delete p_bi;
+
+	REQUIRE(LT.names.size()			== ST.names.size());
+	REQUIRE(LT.free_elements.size() == ST.free_elements.size());
+	REQUIRE(LT.hh_nam				== ST.hh_nam);
+
+	REQUIRE(LT.find("b c d", ' ')				== ST.find("b c d", ' '));
+	REQUIRE(LT.supersets("c", ' ')				== ST.supersets("c", ' '));
+	REQUIRE(LT.subsets("a b c d x y", ' ')		== ST.subsets("a b c d x y", ' '));
+	REQUIRE(LT.find("x y", ' ')					== "");
+}
+
+
+SCENARIO("Test frequency-aware element ordering") {
+
+	SetTrie ST, FT, RT;
+
+	uint64_t rnd = 2468;
+
+	// A skewed vocabulary: the product of two uniform numbers makes small element numbers much more frequent.
+
+	std::vector<StringSet> sets;
+
+	for (int i = 0; i < 1000; i++) {
+		StringSet set;
+		int size = 1 + (rnd >> 33) % 8;
+
+		for (int j = 0; j < size; j++) {
+			rnd = rnd*6364136223846793005 + 1442695040888963407;
+			uint64_t a = (rnd >> 33) % 200;
+			rnd = rnd*6364136223846793005 + 1442695040888963407;
+			uint64_t b = (rnd >> 33) % 200;
+
+			set.push_back("e" + std::to_string(a*b/200));
+		}
+		rnd = rnd*6364136223846793005 + 1442695040888963407;
+
+		sets.push_back(set);
+	}
+
+	for (int i = 0; i < 1000; i++) {
+		ST.insert(sets[i], "s" + std::to_string(i));
+		FT.insert(sets[i], "s" + std::to_string(i));
+		RT.insert(sets[i], "s" + std::to_string(i));
+	}
+
+	REQUIRE(!FT.set_element_order(3));
+	REQUIRE(FT.set_element_order(ELEMENT_ORDER_FREQUENT_FIRST));
+	REQUIRE(RT.set_element_order(ELEMENT_ORDER_RARE_FIRST));
+
+	REQUIRE(num_values(FT) < num_values(ST));
+	REQUIRE(num_values(FT) < num_values(RT));
+
+	for (int i = 1; i < FT.names.size(); i++) {
+		REQUIRE(FT.names[i - 1].count >= FT.names[i].count);
+		REQUIRE(RT.names[i - 1].count <= RT.names[i].count);
+	}
+
+	check_sorted_chains(&FT);
+	check_sorted_chains(&RT);
+
+	for (int i = 1; i < FT.tree.size(); i++)
+		if (FT.parent[i] > 0)
+			REQUIRE(FT.tree[FT.parent[i]].value < FT.tree[i].value);
+
+	for (int i = 0; i < 1000; i += 7) {
+		StringSet r1 = ST.supersets(sets[i]), r2 = FT.supersets(sets[i]), r3 = RT.supersets(sets[i]);
+
+		std::sort(r1.begin(), r1.end());
+		std::sort(r2.begin(), r2.end());
+		std::sort(r3.begin(), r3.end());
+
+		REQUIRE(r1 == r2);
+		REQUIRE(r1 == r3);
+
+		r1 = ST.subsets(sets[i]), r2 = FT.subsets(sets[i]), r3 = RT.subsets(sets[i]);
+
+		std::sort(r1.begin(), r1.end());
+		std::sort(r2.begin(), r2.end());
+		std::sort(r3.begin(), r3.end());
+
+		REQUIRE(r1 == r2);
+		REQUIRE(r1 == r3);
+
+		REQUIRE(ST.find(sets[i]) == FT.find(sets[i]));
+		REQUIRE(ST.find(sets[i]) == RT.find(sets[i]));
+	}
+
+	// New sets are inserted in the current order, purge() ranks the elements again.
+
+	FT.insert("e0 new", "new", ' ');
+
+	REQUIRE(FT.find("new e0", ' ') == "new");
+
+	for (IdTable::iterator it = FT.id.begin(); FT.id.size() > 900; it = FT.id.begin())
+		REQUIRE(FT.remove(it->first) == 0);
+
+	REQUIRE(FT.purge() == 0);
+	REQUIRE(FT.num_dirty_nodes == 0);
+	REQUIRE(FT.id.size() == 900);
+	REQUIRE(FT.free_elements.size() == 0);
+
+	for (int i = 1; i < FT.names.size(); i++)
+		REQUIRE(FT.names[i - 1].count >= FT.names[i].count);
+
+	check_sorted_chains(&FT);
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	REQUIRE(FT.save(p_bi));
+
+	SetTrie LT;
+
+	REQUIRE(LT.load(p_bi));
+
+	delete p_bi;
+
+	REQUIRE(LT.element_order == ELEMENT_ORDER_FREQUENT_FIRST);
+	REQUIRE(LT.tree.size()	 == FT.tree.size());
+
+	for (int i = 0; i < 1000; i += 7)
+		REQUIRE(LT.supersets(sets[i]) == FT.supersets(sets[i]));
+
+	REQUIRE(FT.set_element_order(ELEMENT_ORDER_INSERTION));
+	REQUIRE(FT.tree.size() == LT.tree.size());
+}
+
+
+SCENARIO("Test subtree summaries") {
+
+	SetTrie ST;
+
+	// The ids are given in order of insertion: a = 0, b = 1, c = 2, d = 3, x = 4.
+
+	ST.insert("a b c d", "abcd", ' ');
+	ST.insert("a x", "ax", ' ');
+	ST.insert("a b", "ab", ' ');
+
+	int a = ST.find(0, 0), b = ST.find(a, 1), c = ST.child(b);
+
+	REQUIRE(ST.summary[a].max_value == 4);
+	REQUIRE(ST.summary[a].height	== 4);
+	REQUIRE(ST.summary[b].max_value == 3);
+	REQUIRE(ST.summary[b].height	== 3);
+	REQUIRE(ST.summary[c].max_value == 3);
+	REQUIRE(ST.summary[c].height	== 2);
+	REQUIRE(ST.summary[a].num_sets	== 3);
+	REQUIRE(ST.summary[b].num_sets	== 2);
+	REQUIRE(ST.summary[c].num_sets	== 1);
+
+	REQUIRE(ST.count_supersets("a", ' ')		== 3);
+	REQUIRE(ST.count_supersets("b", ' ')		== 2);
+	REQUIRE(ST.count_supersets("", ' ')		== 3);
+	REQUIRE(ST.count_supersets("a y", ' ')		== 0);
+	REQUIRE(ST.count_subsets("a b c d x", ' ') == 3);
+	REQUIRE(ST.count_subsets("a b y", ' ')		== 1);
+	REQUIRE(ST.count_subsets("y", ' ')			== 0);
+
+	check_summaries(ST);
+
+	// Too long for the subtree of a, beyond the max value of the subtree of b.
+	REQUIRE(ST.supersets("a b c d x", ' ').size() == 0);
+	REQUIRE(ST.supersets("b d", ' ').size()		  == 1);
+	REQUIRE(ST.subsets("a b x", ' ').size()		  == 2);
+
+	REQUIRE(ST.id[c] == "abcd");
+	REQUIRE(ST.remove(c) == 0);
+
+	REQUIRE(ST.summary[a].max_value == 4);
+	REQUIRE(ST.summary[a].height	== 2);
+
+	check_summaries(ST);
+
+	REQUIRE(ST.remove(ST.find(a, 4)) == 0);
+
+	REQUIRE(ST.summary[a].max_value == 1);
+
+	check_summaries(ST);
+
+	REQUIRE(ST.supersets("a x", ' ').size() == 0);
+	REQUIRE(ST.supersets("a b", ' ').size() == 1);
+
+	ST.insert("", "empty", ' ');
+
+	REQUIRE(ST.subsets("a b", ' ', 1)		 == StringSet({"empty"}));
+	REQUIRE(ST.subsets("a b", ' ', 2).size() == 2);
+	REQUIRE(ST.supersets("", ' ', 1).size()	 == 1);
+	REQUIRE(ST.supersets("", ' ', 0).size()	 == 0);
+
+	REQUIRE(ST.summary[0].num_sets		== 2);
+	REQUIRE(ST.count_subsets("y", ' ')	== 1);
+	REQUIRE(ST.count_supersets("a", ' ') == 1);
+
+	check_summaries(ST);
+
+	SetTrieCursor all(ST, CURSOR_SUPERSETS, {}), none(ST, CURSOR_SUPERSETS, {"y"}), root(ST, CURSOR_SUBSETS, {"y"});
+
+	REQUIRE(all.next()	== 0);
+	REQUIRE(all.next()	> 0);
+	REQUIRE(all.next()	== CURSOR_END);
+	REQUIRE(none.next() == CURSOR_END);
+	REQUIRE(root.next() == 0);
+	REQUIRE(root.next() == CURSOR_END);
+
+	SetTrieCursor changed(ST, CURSOR_SUBSETS, {"a", "b"});
+
+	REQUIRE(changed.next() == 0);
+
+	ST.insert("b", "b", ' ');
+
+	REQUIRE(changed.next() == CURSOR_INVALID);
+}
+
+
+SCENARIO("Test the set_id queries") {
+
+	SetTrie ST;
+
+	ST.insert("a b", "ab", ' ');
+	ST.insert("a c", "ac", ' ');
+	ST.insert("b", "b", ' ');
+
+	int ab = ST.find_idx("a b", ' '), ac = ST.find_idx("c a", ' '), b = ST.find_idx("b", ' ');
+
+	REQUIRE(ST.id[ab] == "ab");
+	REQUIRE(ST.id[ac] == "ac");
+	REQUIRE(ST.id[b]  == "b");
+
+	REQUIRE(ST.find_idx("a", ' ')	  == -1);
+	REQUIRE(ST.find_idx("a x", ' ') == -1);
+	REQUIRE(ST.find_idx("", ' ')	  == -1);
+
+	REQUIRE(ST.supersets_idx("a", ' ')	  == IdList({ab, ac}));
+	REQUIRE(ST.supersets_idx("a", ' ', 1) == IdList({ab}));
+	REQUIRE(ST.subsets_idx("a b c", ' ')  == IdList({ab, ac, b}));
+	REQUIRE(ST.subsets_idx("x", ' ').size() == 0);
+
+	ST.insert("", "empty", ' ');
+
+	REQUIRE(ST.find_idx("", ' ')		== 0);
+	REQUIRE(ST.subsets_idx("x", ' ') == IdList({0}));
+
+	// The results belong to the caller, the next query does not change them.
+
+	IdList sup_a = ST.supersets_idx("a", ' '), sub_b = ST.subsets_idx("b", ' ');
+
+	REQUIRE(sup_a == IdList({ab, ac}));
+	REQUIRE(sub_b == IdList({0, b}));
+	REQUIRE(ST.supersets_idx("a", ' ') != ST.supersets_idx("c", ' '));
+
+	// Nor does a query of another SetTrie on the same thread, though they share the query_context() of the thread.
+
+	SetTrie OT;
+
+	OT.insert("x", "x", ' ');
+
+	IdList ra = ST.supersets_idx("a", ' '), rb = OT.supersets_idx("x", ' ');
+
+	REQUIRE(ra.size() == 2);
+	REQUIRE(rb.size() == 1);
+	REQUIRE(ST.supersets_idx("a", ' ') == IdList({ab, ac}));
+	REQUIRE(ra.data() != rb.data());
+
+	// The base64 of the int32 array, with padding when the size is not a multiple of 3 bytes.
+
+	IdList ids = {};
+
+	REQUIRE(String(set_ids_as_string(ids)) == "");
+
+	ids = {1};
+	REQUIRE(String(set_ids_as_string(ids)) == "AQAAAA==");
+
+	ids = {1, 0x04030201, -1};
+	REQUIRE(String(set_ids_as_string(ids)) == "AQAAAAECAwT/////");
+
+	int st_id = new_settrie();
+
+	insert(st_id, (char *) "{'a', 'b'}", (char *) "ab");
+	insert(st_id, (char *) "{'b'}", (char *) "b");
+
+	int idx = find_idx(st_id, (char *) "{'b', 'a'}");
+
+	REQUIRE(idx > 0);
+	REQUIRE(String(set_name(st_id, idx)) == "ab");
+	REQUIRE(find_idx(st_id + 1, (char *) "{'b'}") == -1);
+
+	ids = {idx};
+
+	String expected = set_ids_as_string(ids);
+
+	REQUIRE(String(supersets_idx(st_id, (char *) "{'a'}", -1)) == expected);
+	REQUIRE(String(subsets_idx(st_id, (char *) "{'a'}", -1))	 == "");
+	REQUIRE(String(supersets_idx(st_id + 1, (char *) "{'a'}", -1)) == "");
+
+	destroy_settrie(st_id);
+}
+
+
+SCENARIO("Test the iterative kernels on a deep tree") {
+
+	SetTrie ST;
+
+	// Every prefix of a long set is also a set: a path of 3000 nodes with a set in each.
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);
-				if (s == "sup12")
-					mask |= 1;
-				if (s == "sup14")
-					mask |= 2;
-				if (s == "sup16")
-					mask |= 4;
-				s = iterator_next(q3);REQUIRE(s != "");
+	StringSet set = {};
+
+	for (int i = 0; i < 3000; i++)
+		set.push_back("e" + std::to_string(i));
+
+	for (int i = 3000; i > 0; i--)
+		ST.insert(StringSet(set.begin(), set.begin() + i), "s" + std::to_string(i));
+
+	REQUIRE(ST.tree.size() == 3001);
+
+	check_summaries(ST);
+
+	REQUIRE(ST.supersets({"e1999"}).size()			== 1001);
+	REQUIRE(ST.count_supersets({"e1999", "e5"})	== 1001);
+	REQUIRE(ST.supersets({"e1999"}, 10).size()		== 10);
+	REQUIRE(ST.subsets(set).size()					== 3000);
+	REQUIRE(ST.count_subsets(set)					== 3000);
+	REQUIRE(SetTrie::query_context().result.empty());
+	REQUIRE(ST.subsets({"e0", "e1", "e3"}).size()	== 2);
+
+	// The stack grows with the depth of the tree once and is reused by the next queries.
+	int capacity = SetTrie::query_context().stack.capacity();
+
+	REQUIRE(capacity >= 3000);
+
+	REQUIRE(ST.supersets({"e0"}).front() == "s1");
+	REQUIRE(SetTrie::query_context().stack.capacity() == capacity);
+
+	ST.set_signatures(true);
+
+	REQUIRE(ST.signature[ST.child(0)] == ~(uint64_t) 0);
+	REQUIRE(ST.supersets({"e2999", "e0"}).size() == 1);
+}
+
+
+SCENARIO("Test descendant signatures") {
+
+	SetTrie ST, GT;
+
+	uint64_t rnd = 86420;
+
+	std::vector<StringSet> sets = random_sets(rnd, 800, 12, 300);
+
+	GT.set_signatures(true);
+
+	REQUIRE(GT.signature.size() == GT.tree.size());
+
+	for (int i = 0; i < 800; i++) {
+		ST.insert(sets[i], "s" + std::to_string(i));
+		GT.insert(sets[i], "s" + std::to_string(i));
+	}
+
+	REQUIRE(GT.signature.size() == GT.tree.size());
+	REQUIRE(ST.signature.size() == 0);
+
+	// The signatures kept by insert() must cover the exact ones (after splitting a run, the tail node keeps the bits of the head).
+
+	SignatureList kept = GT.signature;
+
+	GT.set_signatures(true);
+
+	for (int i = 0; i < GT.tree.size(); i++)
+		REQUIRE((GT.signature[i] & ~kept[i]) == 0);
+
+	for (int i = 1; i < GT.tree.size(); i++) {
+		REQUIRE((GT.node_bits(i) & ~GT.signature[i]) == 0);
+
+		if (GT.parent[i] > 0)
+			REQUIRE((GT.signature[i] & ~GT.signature[GT.parent[i]]) == 0);
+	}
+
+	std::vector<StringSet> queries;
+
+	for (int q = 0; q < 300; q++) {
+		StringSet query;
+
+		// Two elements of a set (always found) and one more that may not be in the set.
+		query.push_back(sets[q][0]);
+		query.push_back(sets[q].back());
+
+		if (q % 2 == 0)
+			query.push_back("e" + std::to_string((q*31) % 300));
+
+		queries.push_back(query);
+	}
+
+	for (int pass = 0; pass < 3; pass++) {
+		for (int q = 0; q < 300; q++) {
+			StringSet r1 = ST.supersets(queries[q]), r2 = GT.supersets(queries[q]);
+
+			std::sort(r1.begin(), r1.end());
+			std::sort(r2.begin(), r2.end());
+
+			REQUIRE(r1 == r2);
+
+			if (pass == 0 && q % 2 == 1)
+				REQUIRE(r1.size() > 0);
+		}
+
+		if (pass == 0) {
+			// remove() leaves the signatures wider than needed, they must still be correct.
+			for (int i = 0; i < 800; i += 3) {
+				String key = "s" + std::to_string(i);
+
+				for (IdTable::iterator it = ST.id.begin(); it != ST.id.end(); ++it)
+					if (it->second == key) {
+						REQUIRE(ST.remove(it->first) == 0);
+						break;
+					}
+
+				for (IdTable::iterator it = GT.id.begin(); it != GT.id.end(); ++it)
+					if (it->second == key) {
+						REQUIRE(GT.remove(it->first) == 0);
+						break;
+					}
+			}
+		} else if (pass == 1) {
+			REQUIRE(ST.purge() == 0);
+			REQUIRE(GT.purge() == 0);
+
+			REQUIRE(GT.signature.size() == GT.tree.size());
+		}
+	}
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	REQUIRE(GT.save(p_bi));
+
+	SetTrie LT;
+
+	REQUIRE(LT.load(p_bi));
+
+	delete p_bi;
+
+	REQUIRE(LT.use_signatures);
+	REQUIRE(LT.signature == GT.signature);
+
+	for (int q = 0; q < 300; q += 5)
+		REQUIRE(LT.supersets(queries[q]) == GT.supersets(queries[q]));
+
+	REQUIRE(GT.set_element_order(ELEMENT_ORDER_RARE_FIRST));
+	REQUIRE(GT.signature.size() == GT.tree.size());
+
+	for (int q = 0; q < 300; q += 5) {
+		StringSet r1 = ST.supersets(queries[q]), r2 = GT.supersets(queries[q]);
+
+		std::sort(r1.begin(), r1.end());
+		std::sort(r2.begin(), r2.end());
+
+		REQUIRE(r1 == r2);
+	}
+
+	GT.set_signatures(false);
+
+	REQUIRE(GT.signature.size() == 0);
+	REQUIRE(GT.supersets(queries[1]).size() > 0);
+}
+
+
+SCENARIO("Test the IdTable") {
+
+	IdTable id;
+
+	REQUIRE(id.size() == 0);
+	REQUIRE(id.begin() == id.end());
+
+	id.set(7, "seven");
+	id.set(2, "two");
+	id.set(9, "nine");
+	id.set(4, "four");
+
+	REQUIRE(id.size() == 4);
+	REQUIRE(id.find(3) == id.end());
+	REQUIRE(id.find(-1) == id.end());
+	REQUIRE(id.find(100) == id.end());
+	REQUIRE(id.find(9)->second == "nine");
+
+	// Iterating visits the nodes in increasing order, whatever the order of insertion.
+
+	IdList nodes;
+	for (IdTable::iterator it = id.begin(); it != id.end(); ++it)
+		nodes.push_back(it->first);
+
+	REQUIRE(nodes == IdList({2, 4, 7, 9}));
+
+	// Erasing moves the last entry into the hole, its slot must follow it.
+
+	id.erase(id.find(7));
+
+	REQUIRE(id.size() == 3);
+	REQUIRE(id.find(7) == id.end());
+	REQUIRE(id.find(4)->second == "four");
+	REQUIRE(id[2] == "two");
+	REQUIRE(id[9] == "nine");
+
+	id.erase(id.find(2));
+	id.set(2, "two again");
+
+	nodes.clear();
+	for (IdTable::iterator it = id.begin(); it != id.end(); ++it)
+		nodes.push_back(it->first);
+
+	REQUIRE(nodes == IdList({2, 4, 9}));
+	REQUIRE(id[2] == "two again");
+
+	id.clear();
+
+	REQUIRE(id.size() == 0);
+	REQUIRE(id.begin() == id.end());
+}
+
+
+SCENARIO("Test the string arenas") {
+
+	StringArena arena;
+
+	StringRef a = arena.add("abc"), e = arena.add(""), b = arena.add("de");
+
+	REQUIRE(arena.size() == 5);
+	REQUIRE(arena.get(a) == "abc");
+	REQUIRE(arena.get(e) == "");
+	REQUIRE(arena.get(b) == "de");
+	REQUIRE(sizeof(StringRef) == 8);
+
+	SetTrie ST;
+
+	uint64_t rnd = 24680;
+
+	std::vector<StringSet> sets = random_sets(rnd, 400, 8, 150);
+
+	for (int i = 0; i < 400; i++)
+		ST.insert(sets[i], "set_" + std::to_string(i));
+
+	size_t id_text = ST.id.text_size(), name_text = ST.name_arena.size();
+
+	// remove() leaves the strings in the arenas, purge() drops them.
+
+	IdList nodes = {};
+	for (IdTable::iterator it = ST.id.begin(); it != ST.id.end(); ++it)
+		nodes.push_back(it->first);
+
+	for (int i = 0; i < nodes.size(); i += 2)
+		REQUIRE(ST.remove(nodes[i]) == 0);
+
+	REQUIRE(ST.id.text_size()	  == id_text);
+	REQUIRE(ST.name_arena.size() == name_text);
+
+	REQUIRE(ST.purge() == 0);
+
+	size_t live_ids = 0;
+	for (IdTable::iterator it = ST.id.begin(); it != ST.id.end(); ++it)
+		live_ids += it->second.length();
+
+	size_t live_names = 0;
+	for (ElementTable::iterator it = ST.hh_nam.begin(); it != ST.hh_nam.end(); ++it)
+		live_names += ST.name_arena.length(ST.names[it->second].name);
+
+	REQUIRE(ST.id.text_size()	  == live_ids);
+	REQUIRE(ST.name_arena.size() == live_names);
+	REQUIRE(live_ids < id_text);
+
+	// The arenas are saved as single blocks and the loaded ones are compact.
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	REQUIRE(ST.save(p_bi));
+
+	SetTrie LT;
+
+	REQUIRE(LT.load(p_bi));
+
+	delete p_bi;
+
+	REQUIRE(LT.id.text_size()	  == live_ids);
+	REQUIRE(LT.name_arena.size() == live_names);
+
+	compare_iterating(&ST, &LT, true);
+
+	for (int i = 0; i < 400; i++)
+		REQUIRE(LT.find(sets[i]) == ST.find(sets[i]));
+
+	// Strings of 16 Mb or more keep their length in the arena.
+
+	String edge(STRING_REF_LONG - 1, 'e'), at_limit(STRING_REF_LONG, 'l'), huge(20 << 20, 'h');
+
+	huge[12345] = 'x';
+
+	StringRef r_edge = arena.add(edge), r_limit = arena.add(at_limit), r_huge = arena.add(huge), r_after = arena.add("fg");
+
+	REQUIRE(r_edge.length  == STRING_REF_LONG - 1);
+	REQUIRE(r_limit.length == STRING_REF_LONG);
+	REQUIRE(arena.length(r_huge)  == huge.length());
+	REQUIRE(arena.get(r_edge)	  == edge);
+	REQUIRE(arena.get(r_limit)	  == at_limit);
+	REQUIRE(arena.get(r_huge)	  == huge);
+	REQUIRE(arena.get(r_after)	  == "fg");
+
+	SetTrie HT;
+
+	HT.insert({"a", huge}, at_limit);
+	HT.insert({"b"}, huge);
+
+	REQUIRE(HT.find({huge, "a"})	  == at_limit);
+	REQUIRE(HT.find({"b"})			  == huge);
+	REQUIRE(HT.find_by_id(huge)		  == HT.find_idx({"b"}));
+	REQUIRE(HT.supersets({huge})	  == StringSet({at_limit}));
+	REQUIRE(HT.elements(HT.find_idx({"a", huge})).size() == 2);
+
+	pBinaryImage p_huge = new BinaryImage;
+
+	REQUIRE(HT.save(p_huge));
+
+	SetTrie HT2;
+
+	REQUIRE(HT2.load(p_huge));
+	REQUIRE(HT2.find({"a", huge}) == at_limit);
+	REQUIRE(HT2.find({"b"})		  == huge);
+
+	delete p_huge;
+}
+
+
+SCENARIO("Test insert_many() vs. insert()") {
+
+	uint64_t rnd = 11235;
+
+	std::vector<StringSet> sets = random_sets(rnd, 2000, 10, 60);
+	StringSet			   ids	= {};
+
+	for (int i = 0; i < 2000; i++)
+		ids.push_back("s" + std::to_string(i));
+
+	// Repeated sets, the empty set and prefixes of other sets.
+
+	sets[10] = sets[3];
+	sets[11] = {};
+	sets[12] = {};
+	sets[13] = StringSet(sets[20].begin(), sets[20].begin() + sets[20].size()/2);
+
+	SetTrie ST, BT, MT, GT;
+
+	for (int i = 0; i < 2000; i++)
+		ST.insert(sets[i], ids[i]);
+
+	BT.insert_many(sets, ids);
+
+	GT.set_signatures(true);
+	GT.insert_many(sets, ids);
+
+	// On a SetTrie that is not empty, insert_many() inserts in lexicographic order.
+
+	std::vector<StringSet> head(sets.begin(), sets.begin() + 700), tail(sets.begin() + 700, sets.end());
+	StringSet			   head_ids(ids.begin(), ids.begin() + 700), tail_ids(ids.begin() + 700, ids.end());
+
+	MT.insert_many(head, head_ids);
+	MT.insert_many(tail, tail_ids);
+
+	REQUIRE(BT.tree.size()	== ST.tree.size());
+	REQUIRE(BT.runs.size()	== ST.runs.size());
+	REQUIRE(BT.id.size()	== ST.id.size());
+	REQUIRE(MT.tree.size()	== ST.tree.size());
+	REQUIRE(BT.names.size() == ST.names.size());
+
+	for (int i = 0; i < ST.names.size(); i++)
+		REQUIRE(BT.names[i].count == ST.names[i].count);
+
+	check_sorted_chains(&BT);
+	check_summaries(BT);
+	check_summaries(MT);
+
+	// The nodes are numbered in depth-first order: a node, its descendants and then its next sibling.
+
+	IdList pending = {BT.child(0)};
+	int	   expected = 1;
+
+	while (!pending.empty()) {
+		int idx = pending.back();
+
+		pending.pop_back();
+
+		if (idx == 0)
+			continue;
+
+		REQUIRE(idx == expected++);
+
+		pending.push_back(BT.tree[idx].idx_next);
+		pending.push_back(BT.child(idx));
+	}
+	REQUIRE(expected == BT.tree.size());
+
+	SignatureList kept = GT.signature;
+
+	GT.set_signatures(true);
+
+	REQUIRE(kept == GT.signature);
+
+	for (int i = 0; i < 2000; i++) {
+		REQUIRE(BT.find(sets[i]) == ST.find(sets[i]));
+		REQUIRE(MT.find(sets[i]) == ST.find(sets[i]));
+
+		if (i % 20 == 0) {
+			StringSet r1 = ST.supersets(sets[i]), r2 = BT.supersets(sets[i]), r3 = GT.supersets(sets[i]);
+			std::sort(r1.begin(), r1.end());
+			std::sort(r2.begin(), r2.end());
+			std::sort(r3.begin(), r3.end());
+
+			REQUIRE(r1 == r2);
+			REQUIRE(r1 == r3);
+
+			r1 = ST.subsets(sets[i]);
+			r2 = BT.subsets(sets[i]);
+			std::sort(r1.begin(), r1.end());
+			std::sort(r2.begin(), r2.end());
+
+			REQUIRE(r1 == r2);
+		}
+	}
+
+	REQUIRE(BT.find(StringSet()) == "s12");
+	REQUIRE(BT.find_by_id("s3") == -1);
+
+	// The built tree supports the usual updates.
+
+	REQUIRE(BT.remove_by_id("s20") == 0);
+	REQUIRE(BT.purge() == 0);
+	BT.insert(sets[20], "again");
+
+	REQUIRE(BT.find(sets[20]) == "again");
+	check_summaries(BT);
+}
+
+
+SCENARIO("Test insert_many() on many threads") {
+
+	uint64_t rnd = 24680;
+
+	std::vector<StringSet> sets = random_sets(rnd, 3000, 12, 90);
+	StringSet			   ids	= {};
+
+	for (int i = 0; i < 3000; i++)
+		ids.push_back("s" + std::to_string(i));
+
+	sets[7]  = sets[2];
+	sets[8]  = {};
+	sets[9]  = StringSet(sets[30].begin(), sets[30].begin() + sets[30].size()/2);
+
+	// The parts are built apart and appended, the result is the same tree as the one built on a single thread.
+
+	for (int threads = 2; threads <= 8; threads *= 2) {
+		SetTrie ST, PT;
+
+		ST.set_signatures(true);
+		PT.set_signatures(true);
+
+		ST.insert_many(sets, ids);
+		PT.insert_many(sets, ids, threads);
+
+		REQUIRE(PT.tree.size() == ST.tree.size());
+		REQUIRE(PT.runs.size() == ST.runs.size());
+		REQUIRE(PT.id.size()   == ST.id.size());
+		REQUIRE(PT.hh_nam	   == ST.hh_nam);
+
+		for (int i = 0; i < ST.tree.size(); i++) {
+			REQUIRE(PT.tree[i].value	 == ST.tree[i].value);
+			REQUIRE(PT.tree[i].idx_next  == ST.tree[i].idx_next);
+			REQUIRE(PT.tree[i].idx_child == ST.tree[i].idx_child);
+			REQUIRE(PT.parent[i]		 == ST.parent[i]);
+			REQUIRE(PT.state[i]			 == ST.state[i]);
+			REQUIRE(PT.id[i]			 == ST.id[i]);
+			REQUIRE(PT.summary[i].max_value == ST.summary[i].max_value);
+			REQUIRE(PT.summary[i].height	== ST.summary[i].height);
+			REQUIRE(PT.summary[i].num_sets	== ST.summary[i].num_sets);
+		}
+
+		for (int i = 0; i < ST.runs.size(); i++) {
+			REQUIRE(PT.runs[i].idx_child == ST.runs[i].idx_child);
+			REQUIRE(PT.runs[i].value	 == ST.runs[i].value);
+		}
+
+		REQUIRE(PT.signature == ST.signature);
+
+		for (int i = 0; i < 3000; i += 7)
+			REQUIRE(PT.find(sets[i]) == ST.find(sets[i]));
+
+		check_summaries(PT);
+	}
+}
+
+
+SCENARIO("Test the queries on many threads") {
+
+	uint64_t rnd = 97531;
+
+	std::vector<StringSet> sets = random_sets(rnd, 20000, 10, 50);
+	StringSet			   ids	= {};
+
+	// A skewed tree: most sets share the element "common", and one root child holds most of the nodes.
+
+	for (int i = 0; i < 20000; i++) {
+		if (i % 5 != 0)
+			sets[i].push_back("common");
+
+		ids.push_back("s" + std::to_string(i));
+	}
+	sets[17] = {};
+
+	SetTrie ST, PT;
+
+	ST.insert_many(sets, ids);
+	PT.insert_many(sets, ids);
+
+	REQUIRE(!PT.set_query_threads(0));
+	REQUIRE(PT.set_query_threads(4));
+	REQUIRE(PT.query_threads == 4);
+	REQUIRE(PT.tree.size() >= PARALLEL_QUERY_MIN_NODES);
+
+	for (int pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			ST.set_signatures(true);
+			PT.set_signatures(true);
+		}
+
+		for (int q = 0; q < 60; q++) {
+			StringSet query = q == 0 ? StringSet({"common"}) : random_sets(rnd, 1, q < 30 ? 2 : 14, 50)[0];
+
+			StringSet r1 = ST.supersets(query), r2 = PT.supersets(query);
+			std::sort(r1.begin(), r1.end());
+			std::sort(r2.begin(), r2.end());
+
+			REQUIRE(r1 == r2);
+
+			r1 = ST.subsets(query);
+			r2 = PT.subsets(query);
+			std::sort(r1.begin(), r1.end());
+			std::sort(r2.begin(), r2.end());
+
+			REQUIRE(r1 == r2);
+		}
+	}
+
+	int num_common = ST.count_supersets(StringSet({"common"}));
+
+	REQUIRE(num_common > 2500);
+	REQUIRE(PT.supersets(StringSet({"common"})).size() == num_common);
+
+	// The limited queries run on a single thread and return the same results in the same order.
+
+	REQUIRE(PT.supersets(StringSet({"common"}), 10) == ST.supersets(StringSet({"common"}), 10));
+	REQUIRE(PT.count_supersets(StringSet({"common"})) == num_common);
+	REQUIRE(PT.count_subsets(sets[3]) == ST.count_subsets(sets[3]));
+
+	// With a step budget, the kernels pause and resume where they were, finding the same results in the same order.
+
+	QueryContext &ctx = SetTrie::query_context();
+
+	for (int kind = CURSOR_SUPERSETS; kind <= CURSOR_SUBSETS; kind++) {
+		StringSet query = kind == CURSOR_SUPERSETS ? StringSet({"common"}) : sets[3];
+
+		IdList expected = kind == CURSOR_SUPERSETS ? ST.supersets_idx(query) : ST.subsets_idx(query), found = {};
+
+		REQUIRE(ST.prepare_query(query, kind == CURSOR_SUPERSETS, ctx));
+
+		CursorStack stk = {{ST.tree[0].idx_child, 0, false}};
+
+		int idx, steps = 3, num_paused = 0;
+
+		while ((idx = kind == CURSOR_SUPERSETS ? ST.next_superset(stk, ctx.query, ctx.query_mask, ctx.last_query_idx, nullptr, &steps)
+											   : ST.next_subset(stk, ctx.query, ctx.last_query_idx, nullptr, &steps)) != CURSOR_END) {
+			if (idx == CURSOR_PAUSED) {
+				steps = 3;
+				num_paused++;
+			} else
+				found.push_back(idx);
+		}
+
+		if (kind == CURSOR_SUBSETS && ST.state[0] == STATE_HAS_SET_ID)
+			found.insert(found.begin(), 0);
+
+		REQUIRE(num_paused > 0);
+		REQUIRE(found == expected);
+	}
+
+	// A small tree is always queried on the calling thread, in the same order as with a single thread.
+
+	std::vector<StringSet> few(sets.begin(), sets.begin() + 300);
+	StringSet			   few_ids(ids.begin(), ids.begin() + 300);
+
+	SetTrie SS, SP;
+
+	SS.insert_many(few, few_ids);
+	SP.insert_many(few, few_ids);
+	SP.set_query_threads(4);
+
+	REQUIRE(SP.tree.size() < PARALLEL_QUERY_MIN_NODES);
+
+	for (int i = 0; i < 20; i++) {
+		REQUIRE(SP.supersets(StringSet(few[i].begin(), few[i].begin() + few[i].size()/2)) ==
+				SS.supersets(StringSet(few[i].begin(), few[i].begin() + few[i].size()/2)));
+		REQUIRE(SP.subsets(sets[i]) == SS.subsets(sets[i]));
+	}
+}
+
+
+SCENARIO("Test the batched queries") {
+
+	uint64_t rnd = 86420;
+
+	std::vector<StringSet> sets = random_sets(rnd, 3000, 8, 40);
+	StringSet			   ids	= {};
+
+	for (int i = 0; i < 3000; i++)
+		ids.push_back("s" + std::to_string(i));
+
+	sets[5] = {};
+
+	SetTrie ST;
+
+	ST.insert_many(sets, ids);
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);REQUIRE(s == "");
-				s = iterator_next(q3);REQUIRE(s != "");
+	// Repeated queries, the empty set, unknown elements and sets in the tree.
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);REQUIRE(s == "");
-				s = iterator_next(q3);REQUIRE(s != "");
+	std::vector<StringSet> queries = random_sets(rnd, 300, 6, 44);
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);REQUIRE(s == "");
-				s = iterator_next(q3);REQUIRE(s != "");
+	queries[0] = {};
+	queries[1] = {"unknown"};
+	queries[2] = {"unknown", sets[0][0]};
+	queries[3] = queries[7];
+	queries[4] = sets[9];
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);REQUIRE(s == "");
-				s = iterator_next(q3);REQUIRE(s != "");
+	for (int i = 0; i < 50; i++)
+		queries.push_back(sets[i*13]);
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);REQUIRE(s == "");
-				s = iterator_next(q3);REQUIRE(s == "");
+	for (int pass = 0; pass < 2; pass++) {
+		if (pass == 1)
+			ST.set_signatures(true);
 
-				s = iterator_next(q1);REQUIRE(s == "");
-				s = iterator_next(q2);REQUIRE(s == "");
-				s = iterator_next(q3);REQUIRE(s == "");
+		for (int limit = -1; limit <= 3; limit += 4) {
+			for (int threads = 1; threads <= 4; threads += 3) {
+				QueryBatch sup = ST.supersets_batch(queries, limit, threads), sub = ST.subsets_batch(queries, limit, threads);
 
-				REQUIRE(mask == 7);
+				REQUIRE(sup.offset.size() == queries.size() + 1);
+				REQUIRE(sub.offset.size() == queries.size() + 1);
+				REQUIRE(sup.offset.back() == sup.set_ids.size());
+				REQUIRE(sub.offset.back() == sub.set_ids.size());
 
-				REQUIRE(iterator_size(q1) == 0);
-				REQUIRE(iterator_size(q2) == 0);
-				REQUIRE(iterator_size(q3) == 0);
+				for (int i = 0; i < queries.size(); i++) {
+					IdList r1(sup.set_ids.begin() + sup.offset[i], sup.set_ids.begin() + sup.offset[i + 1]);
 
-				destroy_iterator(q1);
-				destroy_iterator(q2);
-				destroy_iterator(q3);
-				destroy_iterator(q4);
+					REQUIRE(r1 == ST.supersets_idx(queries[i], limit));
+
+					IdList r2(sub.set_ids.begin() + sub.offset[i], sub.set_ids.begin() + sub.offset[i + 1]);
+
+					REQUIRE(r2 == ST.subsets_idx(queries[i], limit));
+				}
 			}
 		}
 	}
-	destroy_settrie(b);
-	destroy_settrie(a);
+
+	IdList found = ST.find_batch(queries, 3);
+
+	REQUIRE(found.size() == queries.size());
+
+	for (int i = 0; i < queries.size(); i++)
+		REQUIRE(found[i] == ST.find_idx(queries[i]));
+
+	REQUIRE(found[0] == ST.find_idx(sets[5]));
+	REQUIRE(found[1] == -1);
+
+	std::vector<StringSet> none = {};
+
+	REQUIRE(ST.supersets_batch(none, -1, 4).offset == IdList({0}));
+	REQUIRE(ST.find_batch(none, 4).empty());
 }
 
 
-SCENARIO("Test python_set_as_string()") {
+SCENARIO("Test concurrent readers and a writer on one SetTrie") {
 
-	String s;
+	uint64_t rnd = 13579;
 
-	// Special case: This is how python serializes the empty set.
+	std::vector<StringSet> sets = random_sets(rnd, 3000, 8, 40);
+	StringSet			   ids	= {};
 
-	s = python_set_as_string((char *) "set()");		  REQUIRE(s == "");
-	s = python_set_as_string((char *) "frozenset()"); REQUIRE(s == "");
+	for (int i = 0; i < 3000; i++)
+		ids.push_back("s" + std::to_string(i));
 
-	// Fall back to doing nothing when not a set.
+	SetTrie ST;
 
-	s = python_set_as_string((char *) "a, b,c, ',', \",aa\"");	REQUIRE(s == "a, b,c, ',', \",aa\"");
-	s = python_set_as_string((char *) "{a, b,c, ',', \",aa\"");	REQUIRE(s == "{a, b,c, ',', \",aa\"");
-	s = python_set_as_string((char *) "a, b,c, ',', \",aa\"}");	REQUIRE(s == "a, b,c, ',', \",aa\"}");
+	ST.set_signatures(true);
+	ST.insert_many(sets, ids);
 
-	// Remove space after comma.
+	std::vector<StringSet> queries = random_sets(rnd, 200, 4, 40);
+	std::vector<StringSet> sup(200), sub(200);
+	IdList				   cnt(200);
+	StringSet			   found(200);
 
-	s = python_set_as_string((char *) "{}");			 REQUIRE(s == "");
-	s = python_set_as_string((char *) "{a}");			 REQUIRE(s == "a");
-	s = python_set_as_string((char *) "{a }");			 REQUIRE(s == "a ");
-	s = python_set_as_string((char *) "{a, b}");		 REQUIRE(s == "a,b");
-	s = python_set_as_string((char *) "{1,2,345}");		 REQUIRE(s == "1,2,345");
-	s = python_set_as_string((char *) "{1, 2, 345}");	 REQUIRE(s == "1,2,345");
-	s = python_set_as_string((char *) "{1,  2, 345}");	 REQUIRE(s == "1,2,345");
-	s = python_set_as_string((char *) "{1,  2, '345'}"); REQUIRE(s == "1,2,'345'");
+	for (int i = 0; i < 200; i++) {
+		sup[i]	 = ST.supersets(queries[i]);
+		sub[i]	 = ST.subsets(queries[i]);
+		cnt[i]	 = ST.count_supersets(queries[i]);
+		found[i] = ST.find(sets[i]);
 
-	s = python_set_as_string((char *) "frozenset({})");				REQUIRE(s == "");
-	s = python_set_as_string((char *) "frozenset({a})");			REQUIRE(s == "a");
-	s = python_set_as_string((char *) "frozenset({a })");			REQUIRE(s == "a ");
-	s = python_set_as_string((char *) "frozenset({a, b})");			REQUIRE(s == "a,b");
-	s = python_set_as_string((char *) "frozenset({1,2,345})");		REQUIRE(s == "1,2,345");
-	s = python_set_as_string((char *) "frozenset({1, 2, 345})");	REQUIRE(s == "1,2,345");
-	s = python_set_as_string((char *) "frozenset({1,  2, 345})");	REQUIRE(s == "1,2,345");
-	s = python_set_as_string((char *) "frozenset({1,  2, '345'})");	REQUIRE(s == "1,2,'345'");
+		std::sort(sup[i].begin(), sup[i].end());
+		std::sort(sub[i].begin(), sub[i].end());
+	}
 
-	// Replace commas inside quotes by \x82.
+	// The writer inserts sets of other elements, so the answers of the readers do not change. purge() renumbers the set_ids and may
+	// change the order of the results.
 
-	s = python_set_as_string((char *) "{1, 'two', 'three'}");		 REQUIRE(s == "1,'two','three'");
-	s = python_set_as_string((char *) "{1, 'two,three', 'four'}");	 REQUIRE(s == "1,'two\x82three','four'");
-	s = python_set_as_string((char *) "{1, \"two,three\", 'four'}"); REQUIRE(s == "1,\"two\x82three\",'four'");
+	std::atomic<int> num_errors(0);
 
-	s = python_set_as_string((char *) "frozenset({1, 'two', 'three'})");		REQUIRE(s == "1,'two','three'");
-	s = python_set_as_string((char *) "frozenset({1, 'two,three', 'four'})");	REQUIRE(s == "1,'two\x82three','four'");
-	s = python_set_as_string((char *) "frozenset({1, \"two,three\", 'four'})");	REQUIRE(s == "1,\"two\x82three\",'four'");
+	std::vector<std::thread> pool = {};
 
-	s = python_set_as_string((char *) "{1, '8', 'six, seven', 10, 555, 44, \"El'even, O'Toole\", 'three', 9999, '\"Dirty\" Harry, 2'}");
+	for (int t = 0; t < 4; t++)
+		pool.push_back(std::thread([&, t]() {
+			for (int r = 0; r < 3; r++)
+				for (int i = t; i < 200; i += 2) {
+					StringSet r1 = ST.supersets(queries[i]), r2 = ST.subsets(queries[i]);
+					std::sort(r1.begin(), r1.end());
+					std::sort(r2.begin(), r2.end());
 
-	REQUIRE(s == "1,'8','six\x82 seven',10,555,44,\"El'even\x82 O'Toole\",'three',9999,'\"Dirty\" Harry\x82 2'");
+					if (r1 != sup[i] || r2 != sub[i] || ST.count_supersets(queries[i]) != cnt[i] || ST.find(sets[i]) != found[i])
+						num_errors++;
 
-	s = python_set_as_string((char *) "frozenset({'2, 3', 1, 'its', 'this', \"it's\"})"); REQUIRE(s == "'2\x82 3',1,'its','this',\"it's\"");
+					IdList res = ST.supersets_idx(queries[i]);
+
+					if (res.size() != sup[i].size())
+						num_errors++;
+				}
+		}));
+
+	pool.push_back(std::thread([&]() {
+		for (int i = 0; i < 600; i++)
+			ST.insert({"w" + std::to_string(i % 50), "x" + std::to_string(i)}, "w" + std::to_string(i));
+
+		ST.remove_by_id("w5");
+		ST.purge();
+	}));
+
+	for (std::thread &th : pool)
+		th.join();
+
+	REQUIRE(num_errors == 0);
+	REQUIRE(ST.find_by_id("w599") >= 0);
+	REQUIRE(ST.find_by_id("w5") == -1);
+	REQUIRE(ST.supersets({"w7"}).size() == 12);
+
+	check_summaries(ST);
+
+	// The public methods calling each other on the same thread do not lock again.
+
+	RWLock rw;
+
+	{
+		RWGuard outer(rw, true);
+		RWGuard inner(rw, false);
+	}
+	{
+		RWGuard reader(rw, false);
+	}
 }
 
 
-SCENARIO("Test the Python interface parts") {
+SCENARIO("Test the VersionedSetTrie") {
 
-	int st1 = new_settrie();
-	int st2 = new_settrie();
-	int st3 = new_settrie();
+	VersionedSetTrie VT;
 
-	GIVEN("I load something to use find()") {
-		insert(st1, (char *) "set()",	  (char *) "empty_set");
-		insert(st1, (char *) "1,3,5",	  (char *) "find1");
-		insert(st1, (char *) "1,2,3,4,5", (char *) "find2");
-		insert(st1, (char *) "1,2,x",	  (char *) "find3");
+	SetTrieSnapshot empty = VT.snapshot();
 
-		WHEN("I find() it") {
-			String f1 = find(st1, (char *) "1,2,x");
-			String f2 = find(st1, (char *) "1,2,y");
-			String f3 = find(st1, (char *) "set()");
+	REQUIRE(VT.version() == 0);
+	REQUIRE(empty->count_supersets(StringSet()) == 0);
+	REQUIRE(VT.publish() == 0);
 
-			THEN("I get the expected keys") {
-				REQUIRE(f1 == "find3");
-				REQUIRE(f2 == "");
-				REQUIRE(f3 == "empty_set");
+	// Version v holds the sets "c", "e0" .. "e<10v - 1>" and nothing else: a reader sees a whole version or the previous one.
+
+	std::atomic<bool> stop(false);
+	std::atomic<int>  num_errors(0), num_reads(0);
+
+	std::vector<std::thread> pool = {};
+
+	for (int t = 0; t < 3; t++)
+		pool.push_back(std::thread([&]() {
+			while (!stop) {
+				SetTrieSnapshot snap = VT.snapshot();
+
+				int n = snap->count_supersets({"c"});
+
+				if (n % 10 != 0 || (int) snap->supersets({"c"}).size() != n || (n > 0 && snap->find(StringSet({"c", "e" + std::to_string(n - 1)})) == ""))
+					num_errors++;
+
+				num_reads++;
 			}
-		}
+		}));
+
+	SetTrieSnapshot first = {};
+
+	for (int v = 1; v <= 30; v++) {
+		for (int i = 0; i < 10; i++)
+			VT.update([v, i](SetTrie &st) { st.insert({"c", "e" + std::to_string(10*(v - 1) + i)}, "s" + std::to_string(10*(v - 1) + i)); });
+
+		REQUIRE(VT.publish() == v);
+
+		if (v == 1)
+			first = VT.snapshot();
 	}
 
-	GIVEN("I load something to use supersets()") {
-		insert(st2, (char *) "a,b",				  (char *) "sup01");
-		insert(st2, (char *) "a,c,d",			  (char *) "sup02");
-		insert(st2, (char *) "a,c,e",			  (char *) "sup03");
-		insert(st2, (char *) "a,c,d,e",			  (char *) "sup04");
-		insert(st2, (char *) "b,d",				  (char *) "sup05");
-		insert(st2, (char *) "c,d",				  (char *) "sup06");
-		insert(st2, (char *) "c,e",				  (char *) "sup07");
-		insert(st2, (char *) "c,d,e,f",			  (char *) "sup08");
-		insert(st2, (char *) "c,d,n",			  (char *) "sup09");
-		insert(st2, (char *) "c,d,e,f,x",		  (char *) "sup10");
-		insert(st2, (char *) "c,d,e,f,y",		  (char *) "sup11");
-		insert(st2, (char *) "c,d,e,f,y,z",		  (char *) "sup12");
-		insert(st2, (char *) "d,e",				  (char *) "sup13");
-		insert(st2, (char *) "e,a,b,d,f,n,x,y,z", (char *) "sup14");
-		insert(st2, (char *) "c",				  (char *) "sup15");
-		insert(st2, (char *) "e,y,z,c",			  (char *) "sup16");
+	stop = true;
 
-		WHEN("I supersets() it") {
-			int q1 = supersets(st2, (char *) "c,e");
-			int q2 = supersets(st2, (char *) "y,z");
-			int q3 = supersets(st2, (char *) "d,e");
+	for (std::thread &th : pool)
+		th.join();
 
-			REQUIRE(iterator_size(q1) == 8);
-			REQUIRE(iterator_size(q2) == 3);
-			REQUIRE(iterator_size(q3) == 7);
+	REQUIRE(num_errors == 0);
+	REQUIRE(VT.version() == 30);
+	REQUIRE(VT.snapshot()->count_supersets({"c"}) == 300);
 
-			int mask = 0;
-			String s;
+	// The old versions live as long as someone holds them.
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);
-			if (s == "sup12")
-				mask |= 1;
-			if (s == "sup14")
-				mask |= 2;
-			if (s == "sup16")
-				mask |= 4;
-			s = iterator_next(q3);REQUIRE(s != "");
+	REQUIRE(first->count_supersets({"c"}) == 10);
+	REQUIRE(empty->count_supersets({"c"}) == 0);
+	REQUIRE(first.use_count() == 1);
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);
-			if (s == "sup12")
-				mask |= 1;
-			if (s == "sup14")
-				mask |= 2;
-			if (s == "sup16")
-				mask |= 4;
-			s = iterator_next(q3);REQUIRE(s != "");
+	// An unpublished draft is not seen, swap_in() replaces everything at once.
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);
-			if (s == "sup12")
-				mask |= 1;
-			if (s == "sup14")
-				mask |= 2;
-			if (s == "sup16")
-				mask |= 4;
-			s = iterator_next(q3);REQUIRE(s != "");
+	VT.update([](SetTrie &st) { st.remove_by_id("s0"); });
+
+	REQUIRE(VT.snapshot()->find_by_id("s0") >= 0);
+
+	SetTrie other;
+
+	other.insert({"x", "y"}, "xy");
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	REQUIRE(other.save(p_bi));
+
+	SetTrieSnapshot before = VT.snapshot();
+
+	REQUIRE(VT.swap_in(p_bi));
+
+	delete p_bi;
+
+	REQUIRE(VT.version() == 31);
+	REQUIRE(VT.snapshot()->find(StringSet({"y", "x"})) == "xy");
+	REQUIRE(VT.snapshot()->count_supersets({"c"}) == 0);
+	REQUIRE(before->count_supersets({"c"}) == 300);
+	REQUIRE(VT.publish() == 31);
+
+	pBinaryImage p_bad = new BinaryImage;
+
+	REQUIRE(!VT.swap_in(p_bad));
+	REQUIRE(VT.snapshot()->find(StringSet({"x", "y"})) == "xy");
+
+	delete p_bad;
+}
+
+
+SCENARIO("Test ShardedSetTrie vs. SetTrie") {
+
+	SetTrie		   ST;
+	ShardedSetTrie SH(5, 3);
+
+	uint64_t rnd = 271828;
+
+	std::vector<StringSet> sets = random_sets(rnd, 1500, 7, 60);
+	StringSet			   ids	= {};
+
+	for (int i = 0; i < (int) sets.size(); i++)
+		ids.push_back("s" + std::to_string(i));
+
+	std::vector<StringSet> first(sets.begin(), sets.begin() + 500), rest(sets.begin() + 500, sets.end());
+	StringSet			   first_ids(ids.begin(), ids.begin() + 500), rest_ids(ids.begin() + 500, ids.end());
+
+	for (int i = 0; i < (int) first.size(); i++)
+		REQUIRE(SH.insert(first[i], first_ids[i]));
+
+	REQUIRE(SH.insert_many(rest, rest_ids) == rest.size());
+	ST.insert_many(sets, ids);
+
+	SH.insert({}, "empty");
+	ST.insert({}, "empty");
+
+	REQUIRE(SH.num_shards() == 5);
+	REQUIRE(SH.size()		== ST.id.size());
+
+	// A set is always in the shard of its canonical form, the other shards do not have it.
+
+	StringSet shuffled = {"e7", "e3", "e7", "e1"}, canonical = {"e1", "e3", "e7"};
+
+	REQUIRE(SH.shard_of(shuffled) == SH.shard_of(canonical));
+
+	int n_found = 0;
+
+	for (int k = 0; k < SH.num_shards(); k++) {
+		REQUIRE(SH.shard[k].id.size() > 100);
+		n_found += SH.shard[k].find_idx(sets[3]) >= 0;
+	}
+	REQUIRE(n_found == 1);
+
+	auto sorted = [](StringSet s) { std::sort(s.begin(), s.end()); return s; };
+
+	std::vector<StringSet> queries = random_sets(rnd, 60, 3, 60);
+
+	queries.push_back({});
+	queries.push_back({"none"});
+
+	for (int i = 0; i < (int) queries.size(); i++) {
+		StringSet sub_query = queries[i];
+
+		sub_query.insert(sub_query.end(), sets[i].begin(), sets[i].end());
+
+		REQUIRE(sorted(SH.supersets(queries[i])) == sorted(ST.supersets(queries[i])));
+		REQUIRE(sorted(SH.subsets(sub_query))	 == sorted(ST.subsets(sub_query)));
+		REQUIRE(SH.count_supersets(queries[i])	 == ST.count_supersets(queries[i]));
+		REQUIRE(SH.count_subsets(sub_query)		 == ST.count_subsets(sub_query));
+		REQUIRE(SH.supersets(queries[i], 3).size() == std::min(3, ST.count_supersets(queries[i])));
+
+		IdList idx = SH.supersets_idx(queries[i]);
+
+		REQUIRE(idx.size() == ST.count_supersets(queries[i]));
+
+		for (int j = 0; j < (int) idx.size(); j++)
+			REQUIRE(SH.find_idx(SH.elements(idx[j])) == idx[j]);
+	}
+
+	for (int i = 0; i < (int) sets.size(); i += 7) {
+		REQUIRE(SH.find(sets[i]) == ST.find(sets[i]));
+
+		int idx = SH.find_idx(sets[i]);
+
+		REQUIRE(sorted(SH.elements(idx)) == sorted(ST.elements(ST.find_idx(sets[i]))));
+		REQUIRE(SH.set_name(idx)		 == ST.find(sets[i]));
+		REQUIRE(SH.find_by_id(SH.set_name(idx)) == idx);
+	}
+
+	REQUIRE(SH.find(StringSet({"none"}))	 == "");
+	REQUIRE(SH.find_idx(StringSet({"none"})) == -1);
+	REQUIRE(SH.find(StringSet())			 == "empty");
+
+	// The batches give the same results as the single queries.
+
+	QueryBatch sup = SH.supersets_batch(queries, 4), sub = SH.subsets_batch(sets);
+
+	IdList found = SH.find_batch(sets);
+
+	REQUIRE(sup.offset.size() == queries.size() + 1);
+	REQUIRE(sub.offset.size() == sets.size() + 1);
+
+	for (int i = 0; i < (int) queries.size(); i++)
+		REQUIRE(IdList(sup.set_ids.begin() + sup.offset[i], sup.set_ids.begin() + sup.offset[i + 1]) == SH.supersets_idx(queries[i], 4));
+
+	for (int i = 0; i < (int) sets.size(); i += 11) {
+		REQUIRE(IdList(sub.set_ids.begin() + sub.offset[i], sub.set_ids.begin() + sub.offset[i + 1]) == SH.subsets_idx(sets[i]));
+		REQUIRE(found[i] == SH.find_idx(sets[i]));
+	}
+
+	// Iterating visits every set once.
+
+	int n_sets = 0;
+
+	for (int idx = SH.next_set_id(-1); idx >= 0; idx = SH.next_set_id(idx)) {
+		REQUIRE(SH.set_name(idx) != "");
+		n_sets++;
+	}
+	REQUIRE(n_sets == SH.size());
+
+	// Removing, purging, saving and loading.
+
+	for (int i = 0; i < 300; i += 3) {
+		String str_id = ST.find(sets[i]);
+
+		REQUIRE(SH.remove_by_id(str_id) == ST.remove_by_id(str_id));
+	}
+	REQUIRE(SH.remove(SH.find_idx(sets[1])) == 0);
+	REQUIRE(ST.remove(ST.find_idx(sets[1])) == 0);
+	REQUIRE(SH.remove(-5) == -2);
+
+	REQUIRE(SH.num_dirty_nodes() > 0);
+	REQUIRE(SH.purge() == 0);
+	REQUIRE(SH.num_dirty_nodes() == 0);
+	REQUIRE(SH.purge() == -1);
+
+	REQUIRE(SH.set_element_order(ELEMENT_ORDER_RARE_FIRST));
+	REQUIRE(!SH.set_element_order(7));
+	SH.set_signatures(true);
+	REQUIRE(SH.set_query_threads(2));
+	REQUIRE(!SH.set_query_threads(0));
+
+	REQUIRE(SH.size() == ST.id.size());
+
+	for (int i = 0; i < (int) queries.size(); i++)
+		REQUIRE(sorted(SH.supersets(queries[i])) == sorted(ST.supersets(queries[i])));
+
+	pBinaryImage p_bi = new BinaryImage;
+
+	REQUIRE(SH.save(p_bi));
+
+	ShardedSetTrie SH2(2, 1);
+
+	REQUIRE(SH2.load(p_bi));
+	REQUIRE(!SH2.load(p_bi));
+	REQUIRE(SH2.num_shards() == 5);
+	REQUIRE(SH2.size()		 == SH.size());
+
+	for (int i = 0; i < (int) queries.size(); i++) {
+		REQUIRE(SH2.supersets_idx(queries[i]) == SH.supersets_idx(queries[i]));
+		REQUIRE(SH2.supersets(queries[i])	  == SH.supersets(queries[i]));
+	}
+
+	for (int i = 0; i < (int) sets.size(); i += 13)
+		REQUIRE(SH2.find(sets[i]) == ST.find(sets[i]));
+
+	delete p_bi;
+
+	pBinaryImage p_bad = new BinaryImage;
+
+	ShardedSetTrie SH3;
+
+	REQUIRE(!SH3.load(p_bad));
+
+	ST.save(p_bad);
+
+	REQUIRE(!SH3.load(p_bad));
+	REQUIRE(SH3.num_shards() == 4);
+
+	delete p_bad;
+
+	// A corrupt number of shards is rejected before anything is allocated.
+
+	for (int n_bad : {0, -3, MAX_SHARDS + 1, INT32_MAX}) {
+		String		section = "sharded";
+		ElementHash hs		= MurmurHash64A(section.c_str(), section.length());
+		int			version = SETTRIE_IMAGE_VERSION;
+
+		p_bad = new BinaryImage;
+
+		image_put(p_bad, &hs, sizeof(hs));
+		image_put(p_bad, &version, sizeof(version));
+		image_put(p_bad, &n_bad, sizeof(n_bad));
+
+		REQUIRE(!SH3.load(p_bad));
+		REQUIRE(SH3.num_shards() == 4);
+
+		delete p_bad;
+	}
+
+	REQUIRE(ShardedSetTrie(MAX_SHARDS + 10, 1).num_shards() == MAX_SHARDS);
+
+	// With fewer ids than sets, only the sets having an id are inserted.
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s != "");
+	std::vector<StringSet> three = {{"a"}, {"b"}, {"c"}};
+	StringSet			   one_id = {"only"};
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s != "");
+	REQUIRE(SH3.insert_many(three, one_id) == 1);
+	REQUIRE(SH3.size()		== 1);
+	REQUIRE(SH3.find({"a"}) == "only");
+	REQUIRE(SH3.find({"b"}) == "");
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s != "");
+	// A shard takes nodes while their set_ids fit in an int.
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s != "");
+	for (int k = 0; k < SH3.num_shards(); k++) {
+		int64_t room = ((int64_t) INT32_MAX - k)/SH3.num_shards() + 1 - SH3.shard[k].tree.size();
 
-			s = iterator_next(q1);REQUIRE(s != "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s == "");
+		REQUIRE(SH3.has_room(k, room));
+		REQUIRE(!SH3.has_room(k, room + 1));
 
-			s = iterator_next(q1);REQUIRE(s == "");
-			s = iterator_next(q2);REQUIRE(s == "");
-			s = iterator_next(q3);REQUIRE(s == "");
+		int last = SH3.global_id(SH3.shard[k].tree.size() + room - 1, k);
 
-			THEN("I get the expected keys") {
-				REQUIRE(mask == 7);
-			}
+		REQUIRE(last >= INT32_MAX - SH3.num_shards() + 1);
+	}
+}
 
-			REQUIRE(iterator_size(q1) == 0);
-			REQUIRE(iterator_size(q2) == 0);
-			REQUIRE(iterator_size(q3) == 0);
 
-			destroy_iterator(q1);
-			destroy_iterator(q2);
-			destroy_iterator(q3);
-		}
+SCENARIO("Test the id string index") {
 
-		GIVEN("I load something to use subsets()") {
-			insert(st3, (char *) "1,3,5",	  (char *) "sub1");
-			insert(st3, (char *) "1,2,3,4,5", (char *) "sub2");
-			insert(st3, (char *) "1,2,x",	  (char *) "sub3");
-			insert(st3, (char *) "1,x",		  (char *) "sub4");
-			insert(st3, (char *) "1,y",		  (char *) "sub5");
+	SetTrie ST;
 
-			WHEN("I find() it") {
-				int q1 = subsets(st3, (char *) "1,2,3,4,5,x,y");
-				int q2 = subsets(st3, (char *) "1,2,x,y");
-				int q3 = subsets(st3, (char *) "1,x,y");
+	uint64_t rnd = 35791;
 
-				REQUIRE(iterator_size(q1) == 5);
-				REQUIRE(iterator_size(q2) == 3);
-				REQUIRE(iterator_size(q3) == 2);
+	std::vector<StringSet> sets = random_sets(rnd, 600, 6, 80);
 
-				int mask = 0;
-				String s;
+	// The ids repeat every 250 sets, find_by_id() returns the last set inserted with the id. Inserting a set again replaces its id.
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);
-				if (s == "sub3")
-					mask |= 1;
-				if (s == "sub4")
-					mask |= 2;
-				if (s == "sub5")
-					mask |= 4;
-				s = iterator_next(q3);REQUIRE(s != "");
+	std::map<String, IdList> nodes = {};
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);
-				if (s == "sub3")
-					mask |= 1;
-				if (s == "sub4")
-					mask |= 2;
-				if (s == "sub5")
-					mask |= 4;
-				s = iterator_next(q3);REQUIRE(s != "");
+	for (int i = 0; i < 600; i++) {
+		String str_id = "id" + std::to_string(i % 250);
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);
-				if (s == "sub3")
-					mask |= 1;
-				if (s == "sub4")
-					mask |= 2;
-				if (s == "sub5")
-					mask |= 4;
-				s = iterator_next(q3);REQUIRE(s == "");
+		int idx = ST.find_idx(sets[i]);
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);REQUIRE(s == "");
-				s = iterator_next(q3);REQUIRE(s == "");
+		if (idx >= 0) {
+			IdList &l = nodes[ST.id[idx]];
+			l.erase(std::remove(l.begin(), l.end(), idx), l.end());
+		}
 
-				s = iterator_next(q1);REQUIRE(s != "");
-				s = iterator_next(q2);REQUIRE(s == "");
-				s = iterator_next(q3);REQUIRE(s == "");
+		ST.insert(sets[i], str_id);
 
-				s = iterator_next(q1);REQUIRE(s == "");
-				s = iterator_next(q2);REQUIRE(s == "");
-				s = iterator_next(q3);REQUIRE(s == "");
+		nodes[str_id].push_back(ST.find_idx(sets[i]));
+	}
 
-				THEN("I get the expected keys") {
-					REQUIRE(mask == 7);
-				}
+	REQUIRE(ST.find_by_id("nothere") == -1);
 
-				REQUIRE(iterator_size(q1) == 0);
-				REQUIRE(iterator_size(q2) == 0);
-				REQUIRE(iterator_size(q3) == 0);
+	for (std::map<String, IdList>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+		int idx = ST.find_by_id(it->first);
 
-				destroy_iterator(q1);
-				destroy_iterator(q2);
-				destroy_iterator(q3);
-			}
+		if (it->second.empty()) {
+			REQUIRE(idx == -1);
+			continue;
 		}
+
+		REQUIRE(ST.id[idx] == it->first);
+		REQUIRE(idx == it->second.back());
 	}
-	destroy_settrie(st1);
-	destroy_settrie(st2);
-	destroy_settrie(st3);
-}
 
+	// Removing every set by its id empties the index, whatever the order of the chains.
 
-SCENARIO("Small Insert/find test") {
+	for (int round = 0; round < 3; round++) {
+		for (std::map<String, IdList>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+			int idx = ST.find_by_id(it->first);
 
-	SetTrie ST;
+			if (idx < 0)
+				continue;
 
-	BinarySet b_set = {3, 5, 7};
+			REQUIRE(ST.id[idx] == it->first);
+			REQUIRE(ST.remove_by_id(it->first) == 0);
+			REQUIRE(ST.find_by_id(it->first) != idx);
+		}
 
-	REQUIRE(ST.find(b_set) == 0);
+		if (round == 0) {
+			REQUIRE(ST.purge() == 0);
 
-	String key0 = {"empty"};
-	String val0 = {""};
+			for (IdTable::iterator it = ST.id.begin(); it != ST.id.end(); ++it)
+				REQUIRE(ST.id[ST.find_by_id(it->second)] == it->second);
+		}
+	}
 
-	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "") == 0);
+	REQUIRE(ST.id.size() == 0);
+	REQUIRE(ST.remove_by_id("id0") == -1);
 
-	ST.insert(val0, key0, ',');
+	// Overwriting the id of a set moves it to the chain of the new id.
 
-	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "empty") == 0);
+	ST.insert({"a"}, "old");
+	ST.insert({"a"}, "new");
 
-	String key1 = {"ky1"};
-	String val1 = {"1 3 5"};
+	REQUIRE(ST.find_by_id("old") == -1);
+	REQUIRE(ST.find_by_id("new") == ST.find_idx({"a"}));
+}
 
-	ST.insert(val1, key1, ' ');
 
-	REQUIRE(strcmp(ST.find(val1, ' ').c_str(), key1.c_str()) == 0);
+SCENARIO("Test the ElementTable vs. std::map") {
 
-	String key2 = {"ky1"};
-	String val2 = {"1 2 3 4 5"};
+	ElementTable table;
+	std::map<ElementHash, ElementId> ref;
 
-	ST.insert(val2, key2, ' ');
+	REQUIRE(table.size() == 0);
+	REQUIRE(table.find(0) == table.end());
 
-	REQUIRE(strcmp(ST.find(val2, ' ').c_str(), key2.c_str()) == 0);
-	REQUIRE(strcmp(ST.find(val1, ' ').c_str(), key1.c_str()) == 0);
+	uint64_t rnd = 13579;
 
-	val1.clear();
+	// The keys share their lowest bits in groups of 8 to build long clusters, 0 is a valid key (the hash of the empty set).
 
-	ST.insert(val1, key1, ' ');
+	for (int step = 0; step < 20000; step++) {
+		rnd = rnd*6364136223846793005 + 1442695040888963407;
 
-	val2 = "1 2 x";
+		ElementHash hh = ((rnd >> 33) % 400) << 20 | (rnd >> 40) % 8;
 
-	REQUIRE(ST.find(val2, ' ') == "");
+		if (step % 997 == 0)
+			hh = 0;
 
-	val2 = "1 2 3 4";
+		if ((rnd >> 20) % 3 == 0) {
+			table.erase(hh);
+			ref.erase(hh);
+		} else {
+			table[hh] = step;
+			ref[hh]	  = step;
+		}
 
-	REQUIRE(ST.find(val2, ' ') == "");
+		if (step % 1000 == 0 || step > 19900) {
+			REQUIRE(table.size() == ref.size());
 
-	val2 = "";
+			for (std::map<ElementHash, ElementId>::iterator it = ref.begin(); it != ref.end(); ++it) {
+				ElementTable::iterator jt = table.find(it->first);
 
-	REQUIRE(ST.find(val2, ' ') == "ky1");
-}
+				REQUIRE(jt != table.end());
+				REQUIRE(jt->second == it->second);
+			}
 
+			int n = 0;
+			for (ElementTable::iterator jt = table.begin(); jt != table.end(); ++jt) {
+				REQUIRE(ref.find(jt->first) != ref.end());
+				n++;
+			}
+			REQUIRE(n == ref.size());
 
-SCENARIO("Small Insert/supersets test") {
+			ElementSlotList by_hash = table.sorted();
 
-	SetTrie ST;
+			REQUIRE(by_hash.size() == ref.size());
 
-	ST.query = {3, 5, 7};
-	ST.last_query_idx = ST.query.size() - 1;
-	ST.result.clear();
-	ST.supersets(ST.tree[0].idx_child, 0);
+			n = 0;
+			for (std::map<ElementHash, ElementId>::iterator it = ref.begin(); it != ref.end(); ++it, n++) {
+				REQUIRE(by_hash[n].first  == it->first);
+				REQUIRE(by_hash[n].second == it->second);
+			}
+		}
+	}
 
-	REQUIRE(ST.result.size() == 0);
+	ElementTable copy = table;
 
-	ST.supersets(0, 0);
+	REQUIRE(copy == table);
 
-	REQUIRE(ST.result.size() == 0);
+	copy[12345] = 1;
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 0);
-	REQUIRE(ST.supersets("", ' ').size()	== 0);
+	REQUIRE(!(copy == table));
 
-	String key1 = {"no_1"};
-	String val1 = {"a b"};
+	table.clear();
 
-	ST.insert(val1, key1, ' ');
+	REQUIRE(table.size() == 0);
+	REQUIRE(table.begin() == table.end());
+	REQUIRE(table.find(0) == table.end());
+}
 
-	REQUIRE(ST.supersets("", ' ').size()	== 1);
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 0);
-	REQUIRE(ST.supersets("a", ' ').size()	== 1);
-	REQUIRE(ST.supersets("b", ' ').size()	== 1);
-	REQUIRE(ST.supersets("a b", ' ').size() == 1);
-	REQUIRE(ST.supersets("c", ' ').size()	== 0);
+SCENARIO("Test DawgSetTrie vs. SetTrie") {
 
-	String key0 = {"empty"};
-	String val0 = {""};
+	SetTrie ST;
 
-	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "") == 0);
+	uint64_t rnd = 8642;
 
-	ST.insert(val0, key0, ',');
+	// Two leading elements out of 200 and one of ten suffixes of 20 elements. The leading elements go first in the element order.
 
-	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "empty") == 0);
+	StringSet lead = {};
 
-	StringSet ss = ST.supersets("", ' ');
+	for (int i = 0; i < 200; i++)
+		lead.push_back("p" + std::to_string(i));
 
-	REQUIRE(ss.size() == 2);
-	REQUIRE(ss[0] == "empty");
-	REQUIRE(ss[1] == "no_1");
+	ST.insert(lead, "lead");
 
-	key1 = {"no_2"};
-	val1 = {"a c d"};
+	std::vector<StringSet> sets;
 
-	ST.insert(val1, key1, ' ');
+	for (int i = 0; i < 1000; i++) {
+		StringSet set = {};
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 0);
-	REQUIRE(ST.supersets("a", ' ').size()	== 2);
-	REQUIRE(ST.supersets("b", ' ').size()	== 1);
-	REQUIRE(ST.supersets("a d", ' ').size() == 1);
-	REQUIRE(ST.supersets("c", ' ').size()	== 1);
+		rnd = rnd*6364136223846793005 + 1442695040888963407;
+		set.push_back("p" + std::to_string((rnd >> 33) % 200));
+		rnd = rnd*6364136223846793005 + 1442695040888963407;
+		set.push_back("p" + std::to_string((rnd >> 33) % 200));
 
-	key1 = {"yes_1"};
-	val1 = {"a c e"};
+		int suffix = i % 10;
 
-	ST.insert(val1, key1, ' ');
+		for (int j = 0; j < 20; j++)
+			set.push_back("z" + std::to_string(suffix) + "_" + std::to_string(j));
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 1);
-	REQUIRE(ST.supersets("a", ' ').size()	== 3);
-	REQUIRE(ST.supersets("b", ' ').size()	== 1);
-	REQUIRE(ST.supersets("a c", ' ').size() == 2);
-	REQUIRE(ST.supersets("c", ' ').size()	== 2);
+		sets.push_back(set);
 
-	key1 = {"yes_2"};
-	val1 = {"a c d e"};
+		ST.insert(set, "s" + std::to_string(i));
+	}
 
-	ST.insert(val1, key1, ' ');
+	std::vector<StringSet> more = random_sets(rnd, 500, 8, 300);
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 2);
-	REQUIRE(ST.supersets("a", ' ').size()	== 4);
-	REQUIRE(ST.supersets("c", ' ').size()	== 3);
-	REQUIRE(ST.supersets("e", ' ').size()	== 2);
+	for (int i = 0; i < 500; i++) {
+		sets.push_back(more[i]);
+		ST.insert(more[i], "r" + std::to_string(i));
+	}
 
-	key1 = {"no_3"};
-	val1 = {"b d"};
+	ST.insert("", "empty", ',');
 
-	ST.insert(val1, key1, ' ');
+	DawgSetTrie DA(ST);
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 2);
-	REQUIRE(ST.supersets("a", ' ').size()	== 4);
-	REQUIRE(ST.supersets("c", ' ').size()	== 3);
-	REQUIRE(ST.supersets("b d", ' ').size()	== 1);
+	REQUIRE(DA.num_sets() == ST.id.size());
+	REQUIRE(4*DA.num_states() < num_values(ST));
 
-	key1 = {"no_4"};
-	val1 = {"c d"};
+	FrozenSetTrie FT(ST);
 
-	ST.insert(val1, key1, ' ');
+	REQUIRE(DA.num_bytes() < FT.num_bytes());
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 2);
-	REQUIRE(ST.supersets("a", ' ').size()	== 4);
-	REQUIRE(ST.supersets("c", ' ').size()	== 4);
-	REQUIRE(ST.supersets("b d", ' ').size()	== 1);
+	int num_sets = sets.size();
 
-	key1 = {"yes_3"};
-	val1 = {"c e"};
+	for (int i = 0; i < num_sets; i++)
+		REQUIRE(DA.find(sets[i]) == ST.find(sets[i]));
 
-	ST.insert(val1, key1, ' ');
+	REQUIRE(DA.find("", ',')		== "empty");
+	REQUIRE(DA.find("p1,xx", ',')	== "");
+	REQUIRE(DA.find("z1_1,z1_2", ',') == "");
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 3);
-	REQUIRE(ST.supersets("a", ' ').size()	== 4);
-	REQUIRE(ST.supersets("c", ' ').size()	== 5);
-	REQUIRE(ST.supersets("b d", ' ').size()	== 1);
+	for (int i = 0; i < DA.num_sets(); i++)
+		REQUIRE(ST.find(DA.elements(i)) == DA.ids[i]);
 
-	key1 = {"yes_4"};
-	val1 = {"c d e f"};
+	REQUIRE(DA.elements(-1).size()			 == 0);
+	REQUIRE(DA.elements(DA.num_sets()).size() == 0);
 
-	ST.insert(val1, key1, ' ');
+	pBinaryImage p_bi = new BinaryImage;
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 4);
-	REQUIRE(ST.supersets("f", ' ').size()	== 1);
-	REQUIRE(ST.supersets("c", ' ').size()	== 6);
-	REQUIRE(ST.supersets("e f", ' ').size()	== 1);
+	REQUIRE(DA.save(p_bi));
 
-	key1 = {"no_5"};
-	val1 = {"c d n"};
+	DawgSetTrie DA2;
 
-	ST.insert(val1, key1, ' ');
+	REQUIRE(DA2.load(p_bi));
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 4);
-	REQUIRE(ST.supersets("n", ' ').size()	== 1);
-	REQUIRE(ST.supersets("c", ' ').size()	== 7);
-	REQUIRE(ST.supersets("c d", ' ').size()	== 5);
+	delete p_bi;
 
-	key1 = {"yes_5"};
-	val1 = {"c d e f x"};
+	std::vector<StringSet> queries = random_sets(rnd, 300, 6, 300);
 
-	ST.insert(val1, key1, ' ');
+	for (int q = 0; q < 300; q++) {
+		if (q < 100)
+			queries[q].resize(1 + q % 2);
+		else if (q < 200)
+			queries[q] = {sets[q*5][q % 3], "z" + std::to_string(q % 10) + "_" + std::to_string(q % 20)};
+		else if (q < 250)
+			queries[q].insert(queries[q].end(), sets[q].begin(), sets[q].end());
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 5);
-	REQUIRE(ST.supersets("n", ' ').size()	== 1);
-	REQUIRE(ST.supersets("c", ' ').size()	== 8);
-	REQUIRE(ST.supersets("c d", ' ').size()	== 6);
+		StringSet r1 = ST.supersets(queries[q]);
+		StringSet r2 = DA.supersets(queries[q]);
+		StringSet r3 = DA2.supersets(queries[q]);
 
-	key1 = {"yes_6"};
-	val1 = {"c d e f y"};
+		std::sort(r1.begin(), r1.end());
+		std::sort(r2.begin(), r2.end());
+		std::sort(r3.begin(), r3.end());
 
-	ST.insert(val1, key1, ' ');
+		REQUIRE(r1 == r2);
+		REQUIRE(r1 == r3);
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 6);
-	REQUIRE(ST.supersets("z", ' ').size()	== 0);
-	REQUIRE(ST.supersets("c", ' ').size()	== 9);
-	REQUIRE(ST.supersets("c d", ' ').size()	== 7);
+		r1 = ST.subsets(queries[q]);
+		r2 = DA.subsets(queries[q]);
+		r3 = DA2.subsets(queries[q]);
 
-	key1 = {"yes_7"};
-	val1 = {"c d e f y z"};
+		std::sort(r1.begin(), r1.end());
+		std::sort(r2.begin(), r2.end());
+		std::sort(r3.begin(), r3.end());
 
-	ST.insert(val1, key1, ' ');
+		REQUIRE(r1 == r2);
+		REQUIRE(r1 == r3);
+	}
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 7);
-	REQUIRE(ST.supersets("z", ' ').size()	== 1);
-	REQUIRE(ST.supersets("f y", ' ').size()	== 2);
-	REQUIRE(ST.supersets("c d", ' ').size()	== 8);
-	REQUIRE(ST.supersets("c", ' ').size()	== 10);
+	REQUIRE(DA.supersets("", ',').size() == ST.id.size());
+	REQUIRE(DA.subsets("", ',').size()	 == 1);
 
-	key1 = {"no_6"};
-	val1 = {"d e"};
+	SetTrie empty;
 
-	ST.insert(val1, key1, ' ');
+	DawgSetTrie DA3(empty);
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 7);
-	REQUIRE(ST.supersets("z", ' ').size()	== 1);
-	REQUIRE(ST.supersets("f y", ' ').size()	== 2);
-	REQUIRE(ST.supersets("c d", ' ').size()	== 8);
-	REQUIRE(ST.supersets("c", ' ').size()	== 10);
+	REQUIRE(DA3.num_states() == 1);
+	REQUIRE(DA3.find("a", ',') == "");
+	REQUIRE(DA3.supersets("a", ',').size() == 0);
+	REQUIRE(DA3.subsets("a", ',').size() == 0);
+
+	// Many threads can query the same DawgSetTrie.
+
+	std::vector<StringSet> expected(queries.size());
+
+	for (int q = 0; q < (int) queries.size(); q++)
+		expected[q] = DA.subsets(queries[q]);
+
+	std::atomic<int> num_errors(0);
+
+	std::vector<std::thread> pool = {};
 
-	key1 = {"no_7"};
-	val1 = {"e a b d f n x y z"};
+	for (int t = 0; t < 3; t++)
+		pool.push_back(std::thread([&, t]() {
+			for (int q = t; q < (int) queries.size(); q++)
+				if (DA.subsets(queries[q]) != expected[q] || DA.find(sets[q]) != ST.find(sets[q]))
+					num_errors++;
+		}));
 
-	ST.insert(val1, key1, ' ');
+	for (std::thread &th : pool)
+		th.join();
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 7);
-	REQUIRE(ST.supersets("z", ' ').size()	== 2);
-	REQUIRE(ST.supersets("f y", ' ').size()	== 3);
-	REQUIRE(ST.supersets("d e", ' ').size()	== 7);
-	REQUIRE(ST.supersets("c", ' ').size()	== 10);
+	REQUIRE(num_errors == 0);
+}
 
-	key1 = {"no_8"};
-	val1 = {"c"};
 
-	ST.insert(val1, key1, ' ');
+SCENARIO("Test DawgSetTrie on a deep tree with a small stack") {
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 7);
-	REQUIRE(ST.supersets("z", ' ').size()	== 2);
-	REQUIRE(ST.supersets("f y", ' ').size()	== 3);
-	REQUIRE(ST.supersets("d e", ' ').size()	== 7);
-	REQUIRE(ST.supersets("c", ' ').size()	== 11);
+	SetTrie ST;
 
-	key1 = {"yes_8"};
-	val1 = {"e y z c"};
+	// A single set of 10000 elements and a few of its prefixes: a path of 10000 values, most of them in runs.
 
-	ST.insert(val1, key1, ' ');
+	StringSet set = {};
 
-	REQUIRE(ST.supersets("c e", ' ').size() == 8);
-	REQUIRE(ST.supersets("z", ' ').size()	== 3);
-	REQUIRE(ST.supersets("y z", ' ').size()	== 3);
-	REQUIRE(ST.supersets("d e", ' ').size()	== 7);
-	REQUIRE(ST.supersets("c", ' ').size()	== 12);
+	for (int i = 0; i < 10000; i++)
+		set.push_back("e" + std::to_string(i));
 
-	REQUIRE(ST.supersets("", ' ').size()	   == 17);
-	REQUIRE(ST.supersets("xy", ' ').size()	   == 0);
-	REQUIRE(ST.supersets("a b xy", ' ').size() == 0);
+	ST.insert(set, "all");
 
-	ST.query = {3, 5, 7};
-	ST.last_query_idx = ST.query.size() - 1;
-	ST.result.clear();
-	ST.supersets(ST.tree[0].idx_child, 0);
+	DawgSetTrie DA;
 
-	REQUIRE(ST.result.size() == 0);
+	run_with_stack(1 << 20, [&]() { DA.build(ST); });
 
-	ST.supersets(0, 0);
+	REQUIRE(DA.num_states() == 10001);
+	REQUIRE(DA.find(set)	== "all");
 
-	REQUIRE(ST.result.size() == 0);
+	for (int i = 2500; i < 10000; i += 2500)
+		ST.insert(StringSet(set.begin(), set.begin() + i), "s" + std::to_string(i));
 
-	int tot = 0;
+	DawgSetTrie DA2;
 
-	ss = ST.supersets("c e", ' ');
+	size_t num_sup = 0, num_sub = 0, num_last = 0;
 
-	for (int i = 0; i < 8; i ++) {
-		if (ss[i] == "yes_1")
-			tot += 1;
-		if (ss[i] == "yes_2")
-			tot += 2;
-		if (ss[i] == "yes_3")
-			tot += 4;
-		if (ss[i] == "yes_4")
-			tot += 8;
-		if (ss[i] == "yes_5")
-			tot += 16;
-		if (ss[i] == "yes_6")
-			tot += 32;
-		if (ss[i] == "yes_7")
-			tot += 64;
-		if (ss[i] == "yes_8")
-			tot += 128;
-	}
-	REQUIRE(tot == 255);
+	run_with_stack(1 << 20, [&]() {
+		DA2.build(ST);
+
+		num_sup	 = DA2.supersets({"e0"}).size();
+		num_sub	 = DA2.subsets(set).size();
+		num_last = DA2.supersets({"e9999", "e3"}).size();
+	});
+
+	REQUIRE(DA2.num_sets() == 4);
+	REQUIRE(num_sup		   == 4);
+	REQUIRE(num_sub		   == 4);
+	REQUIRE(num_last	   == 1);
+	REQUIRE(DA2.find(StringSet(set.begin(), set.begin() + 5000)) == "s5000");
 }
 
 
-SCENARIO("Small Insert/subsets test") {
+SCENARIO("Test BitVector rank() / select()") {
 
-	SetTrie ST;
+	BitVector bv;
 
-	ST.query = {3, 5, 7};
-	ST.last_query_idx = ST.query.size() - 1;
-	ST.result.clear();
-	ST.subsets(ST.tree[0].idx_child, 0);
+	std::vector<int> ones = {}, zeros = {};
 
-	REQUIRE(ST.result.size() == 0);
+	uint64_t rnd = 777;
 
-	ST.subsets(0, 0);
+	for (int i = 0; i < 5000; i++) {
+		rnd = rnd*6364136223846793005 + 1442695040888963407;
 
-	REQUIRE(ST.result.size() == 0);
+		bool bit = ((rnd >> 33) % (i < 2500 ? 2 : 9)) == 0;
 
-	REQUIRE(ST.subsets("c e", ' ').size() == 0);
-	REQUIRE(ST.subsets("", ' ').size()	  == 0);
+		bv.push_back(bit);
 
-	String key1 = {"key_1"};
-	String val1 = {"a b"};
+		if (bit)
+			ones.push_back(i);
+		else
+			zeros.push_back(i);
+	}
+	bv.build();
 
-	ST.insert(val1, key1, ' ');
+	REQUIRE(bv.num_bits == 5000);
 
-	REQUIRE(ST.subsets("", ' ').size() == 0);
+	int r = 0;
+	for (int i = 0; i <= 5000; i++) {
+		REQUIRE(bv.rank1(i) == r);
+		REQUIRE(bv.rank0(i) == i - r);
 
-	REQUIRE(ST.subsets("c e", ' ').size()	== 0);
-	REQUIRE(ST.subsets("a", ' ').size()		== 0);
-	REQUIRE(ST.subsets("b", ' ').size()		== 0);
-	REQUIRE(ST.subsets("a b", ' ').size()	== 1);
-	REQUIRE(ST.subsets("c a b", ' ').size()	== 1);
+		if (i < 5000) {
+			REQUIRE(bv.get(i) == (r < ones.size() && ones[r] == i));
+			r += bv.get(i);
+		}
+	}
 
-	key1 = {"key_2"};
-	val1 = {"a c d"};
+	for (int k = 0; k < ones.size(); k++)
+		REQUIRE(bv.select1(k + 1) == ones[k]);
 
-	ST.insert(val1, key1, ' ');
+	for (int k = 0; k < zeros.size(); k++)
+		REQUIRE(bv.select0(k + 1) == zeros[k]);
 
-	REQUIRE(ST.subsets("a", ' ').size()			== 0);
-	REQUIRE(ST.subsets("x", ' ').size()			== 0);
-	REQUIRE(ST.subsets("a b", ' ').size()		== 1);
-	REQUIRE(ST.subsets("c a b", ' ').size()		== 1);
-	REQUIRE(ST.subsets("c a d", ' ').size()		== 1);
-	REQUIRE(ST.subsets("c a b d", ' ').size()	== 2);
+	PackedArray pa;
 
-	String key0 = {"empty"};
-	String val0 = {""};
+	pa.set_width(13);
 
-	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "") == 0);
+	for (int i = 0; i < 1000; i++)
+		pa.push_back((i*i*7) & 0x1fff);
 
-	ST.insert(val0, key0, ',');
+	for (int i = 0; i < 1000; i++)
+		REQUIRE(pa.get(i) == ((i*i*7) & 0x1fff));
+}
 
-	REQUIRE(strcmp(ST.find(val0, ',').c_str(), "empty") == 0);
 
-	StringSet ss = ST.subsets("", ' ');
+SCENARIO("Test FrozenSetTrie vs. SetTrie") {
 
-	REQUIRE(ss.size() == 1);
-	REQUIRE(ss[0] == "empty");
+	SetTrie ST;
 
-	key1 = {"key_3"};
-	val1 = {"a c e"};
+	uint64_t rnd = 4321;
 
-	ST.insert(val1, key1, ' ');
+	std::vector<StringSet> sets = random_sets(rnd, 2000, 8, 300);
 
-	REQUIRE(ST.subsets("a", ' ').size()			== 1);
-	REQUIRE(ST.subsets("x", ' ').size()			== 1);
-	REQUIRE(ST.subsets("a b x", ' ').size()		== 2);
-	REQUIRE(ST.subsets("c a b", ' ').size()		== 2);
-	REQUIRE(ST.subsets("a c e", ' ').size()		== 2);
-	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 4);
+	for (int i = 0; i < 2000; i++)
+		ST.insert(sets[i], "s" + std::to_string(i));
 
-	key1 = {"key_4"};
-	val1 = {"a c d e"};
+	ST.insert("", "empty", ',');
 
-	ST.insert(val1, key1, ' ');
+	FrozenSetTrie FT(ST);
 
-	REQUIRE(ST.subsets("a", ' ').size()			== 1);
-	REQUIRE(ST.subsets("x y z", ' ').size()		== 1);
-	REQUIRE(ST.subsets("a b x", ' ').size()		== 2);
-	REQUIRE(ST.subsets("c a d e", ' ').size()	== 4);
-	REQUIRE(ST.subsets("a c e", ' ').size()		== 2);
-	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 5);
+	REQUIRE(FT.num_nodes() == num_values(ST));
+	REQUIRE(FT.num_sets()  == ST.id.size());
 
-	key1 = {"key_5"};
-	val1 = {"b"};
+	size_t st_bytes = ST.tree.size()*(sizeof(SetNode) + sizeof(int) + sizeof(uint8_t)) + ST.runs.size()*sizeof(Run)
+					+ (num_values(ST) - ST.tree.size())*sizeof(ElementId);
 
-	ST.insert(val1, key1, ' ');
+	REQUIRE(3*FT.num_bytes() < st_bytes);
 
-	REQUIRE(ST.subsets("a", ' ').size()			== 1);
-	REQUIRE(ST.subsets("b", ' ').size()			== 2);
-	REQUIRE(ST.subsets("x y z", ' ').size()		== 1);
-	REQUIRE(ST.subsets("a b x", ' ').size()		== 3);
-	REQUIRE(ST.subsets("c a d e", ' ').size()	== 4);
-	REQUIRE(ST.subsets("a c e", ' ').size()		== 2);
-	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 6);
+	for (int i = 0; i < 2000; i++)
+		REQUIRE(FT.find(sets[i]) == ST.find(sets[i]));
 
-	key1 = {"key_6"};
-	val1 = {"c d"};
+	REQUIRE(FT.find("", ',')	   == "empty");
+	REQUIRE(FT.find("e1,xx", ',') == "");
 
-	ST.insert(val1, key1, ' ');
+	for (int v = 1; v < FT.num_nodes(); v++) {
+		if (!FT.terminal.get(v))
+			continue;
 
-	REQUIRE(ST.subsets("a", ' ').size()			== 1);
-	REQUIRE(ST.subsets("b", ' ').size()			== 2);
-	REQUIRE(ST.subsets("c d", ' ').size()		== 2);
-	REQUIRE(ST.subsets("c d x y z", ' ').size()	== 2);
-	REQUIRE(ST.subsets("a b x", ' ').size()		== 3);
-	REQUIRE(ST.subsets("c a d e", ' ').size()	== 5);
-	REQUIRE(ST.subsets("a c e", ' ').size()		== 2);
-	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 7);
+		REQUIRE(ST.find(FT.elements(v)) == FT.ids[FT.terminal.rank1(v)]);
+	}
+	REQUIRE(FT.elements(0).size() == 0);
+	REQUIRE(FT.elements(FT.num_nodes()).size() == 0);
 
-	key1 = {"key_7"};
-	val1 = {"c e"};
+	pBinaryImage p_bi = new BinaryImage;
 
-	ST.insert(val1, key1, ' ');
+	REQUIRE(FT.save(p_bi));
 
-	REQUIRE(ST.subsets("a", ' ').size()			== 1);
-	REQUIRE(ST.subsets("b", ' ').size()			== 2);
-	REQUIRE(ST.subsets("c d", ' ').size()		== 2);
-	REQUIRE(ST.subsets("c d x y z", ' ').size()	== 2);
-	REQUIRE(ST.subsets("a b x", ' ').size()		== 3);
-	REQUIRE(ST.subsets("c a d e", ' ').size()	== 6);
-	REQUIRE(ST.subsets("c e", ' ').size()		== 2);
-	REQUIRE(ST.subsets("c a b d e", ' ').size()	== 8);
+	FrozenSetTrie FT2;
 
-	key1 = {"key_8"};
-	val1 = {"c d e f"};
+	REQUIRE(FT2.load(p_bi));
 
-	ST.insert(val1, key1, ' ');
+	delete p_bi;
 
-	REQUIRE(ST.subsets("a", ' ').size()				== 1);
-	REQUIRE(ST.subsets("b", ' ').size()				== 2);
-	REQUIRE(ST.subsets("c d e f", ' ').size()		== 4);
-	REQUIRE(ST.subsets("c d e f x y", ' ').size()	== 4);
-	REQUIRE(ST.subsets("c a b d e f", ' ').size()	== 9);
+	std::vector<StringSet> queries = random_sets(rnd, 300, 6, 300);
 
-	key1 = {"key_9"};
-	val1 = {"c d n"};
+	for (int q = 0; q < 300; q++) {
+		if (q < 150)
+			queries[q].resize(1 + q % 2);
 
-	ST.insert(val1, key1, ' ');
+		StringSet r1 = ST.supersets(queries[q]);
+		StringSet r2 = FT.supersets(queries[q]);
+		StringSet r3 = FT2.supersets(queries[q]);
 
-	REQUIRE(ST.subsets("a", ' ').size()				==  1);
-	REQUIRE(ST.subsets("b", ' ').size()				==  2);
-	REQUIRE(ST.subsets("c d n", ' ').size()			==  3);
-	REQUIRE(ST.subsets("c d n f x y", ' ').size()	==  3);
-	REQUIRE(ST.subsets("c a b d e f n", ' ').size()	== 10);
+		std::sort(r1.begin(), r1.end());
+		std::sort(r2.begin(), r2.end());
+		std::sort(r3.begin(), r3.end());
 
-	key1 = {"key_a"};
-	val1 = {"c d e f x"};
+		REQUIRE(r1 == r2);
+		REQUIRE(r1 == r3);
 
-	ST.insert(val1, key1, ' ');
+		r1 = ST.subsets(queries[q]);
+		r2 = FT.subsets(queries[q]);
+		r3 = FT2.subsets(queries[q]);
 
-	REQUIRE(ST.subsets("a", ' ').size()					==  1);
-	REQUIRE(ST.subsets("b", ' ').size()					==  2);
-	REQUIRE(ST.subsets("c d e f x", ' ').size()			==  5);
-	REQUIRE(ST.subsets("c d e f x y z xx", ' ').size()	==  5);
-	REQUIRE(ST.subsets("c a b d e f n x", ' ').size()	== 11);
+		std::sort(r1.begin(), r1.end());
+		std::sort(r2.begin(), r2.end());
+		std::sort(r3.begin(), r3.end());
 
-	key1 = {"key_b"};
-	val1 = {"c d e f y"};
+		REQUIRE(r1 == r2);
+		REQUIRE(r1 == r3);
+	}
 
-	ST.insert(val1, key1, ' ');
+	REQUIRE(FT.supersets("", ',').size() == ST.id.size());
+	REQUIRE(FT.subsets("", ',').size()	 == 1);
 
-	REQUIRE(ST.subsets("a", ' ').size()					==  1);
-	REQUIRE(ST.subsets("b", ' ').size()					==  2);
-	REQUIRE(ST.subsets("c d e f y", ' ').size()			==  5);
-	REQUIRE(ST.subsets("c d e f x y z xx", ' ').size()	==  6);
-	REQUIRE(ST.subsets("c a b d e f n x y", ' ').size()	== 12);
+	SetTrie empty;
 
-	key1 = {"key_c"};
-	val1 = {"c d e f y z"};
+	FrozenSetTrie FT3(empty);
 
-	ST.insert(val1, key1, ' ');
+	REQUIRE(FT3.num_nodes() == 1);
+	REQUIRE(FT3.find("a", ',') == "");
+	REQUIRE(FT3.supersets("a", ',').size() == 0);
+	REQUIRE(FT3.subsets("a", ',').size() == 0);
 
-	REQUIRE(ST.subsets("a", ' ').size()						==  1);
-	REQUIRE(ST.subsets("b", ' ').size()						==  2);
-	REQUIRE(ST.subsets("c d e f y z", ' ').size()			==  6);
-	REQUIRE(ST.subsets("c d e f y z xx yy", ' ').size()		==  6);
-	REQUIRE(ST.subsets("c a b d e f n x y z", ' ').size()	== 13);
+	// Many threads can query the same FrozenSetTrie.
 
-	key1 = {"key_d"};
-	val1 = {"d e"};
+	std::vector<StringSet> expected(queries.size());
 
-	ST.insert(val1, key1, ' ');
+	for (int q = 0; q < (int) queries.size(); q++)
+		expected[q] = FT.supersets(queries[q]);
 
-	REQUIRE(ST.subsets("a", ' ').size()						==  1);
-	REQUIRE(ST.subsets("b", ' ').size()						==  2);
-	REQUIRE(ST.subsets("d e", ' ').size()					==  2);
-	REQUIRE(ST.subsets("d e xx yy", ' ').size()				==  2);
-	REQUIRE(ST.subsets("c a b d e f n x y z", ' ').size()	== 14);
+	std::atomic<int> num_errors(0);
 
-	key1 = {"key_e"};
-	val1 = {"e a b d f n x y z"};
+	std::vector<std::thread> pool = {};
 
-	ST.insert(val1, key1, ' ');
+	for (int t = 0; t < 3; t++)
+		pool.push_back(std::thread([&, t]() {
+			for (int q = t; q < (int) queries.size(); q++)
+				if (FT.supersets(queries[q]) != expected[q] || FT.find(sets[q]) != ST.find(sets[q]))
+					num_errors++;
+		}));
 
-	REQUIRE(ST.subsets("a", ' ').size()						==  1);
-	REQUIRE(ST.subsets("b", ' ').size()						==  2);
-	REQUIRE(ST.subsets("e a b d f n x y z", ' ').size()		==  5);
-	REQUIRE(ST.subsets("e a b d f n x y z xxy", ' ').size()	==  5);
-	REQUIRE(ST.subsets("c a b d e f n x y z", ' ').size()	== 15);
+	for (std::thread &th : pool)
+		th.join();
 
-	key1 = {"key_f"};
-	val1 = {"c"};
+	REQUIRE(num_errors == 0);
+}
 
-	ST.insert(val1, key1, ' ');
 
-	REQUIRE(ST.subsets("a", ' ').size()						==  1);
-	REQUIRE(ST.subsets("b", ' ').size()						==  2);
-	REQUIRE(ST.subsets("c", ' ').size()						==  2);
-	REQUIRE(ST.subsets("c xx yy", ' ').size()				==  2);
-	REQUIRE(ST.subsets("c a b d e f n x y z", ' ').size()	== 16);
+SCENARIO("Test FrozenSetTrie on a deep tree with a small stack") {
 
-	key1 = {"key_0"};
-	val1 = {"e y z c"};
+	SetTrie ST;
 
-	ST.insert(val1, key1, ' ');
+	// A single set of 10000 elements and all its prefixes ending at a multiple of 1000.
 
-	REQUIRE(ST.subsets("xx yy aa bb cc dd ee", ' ').size()	==  1);
-	REQUIRE(ST.subsets("a", ' ').size()						==  1);
-	REQUIRE(ST.subsets("c", ' ').size()						==  2);
-	REQUIRE(ST.subsets("e y z c", ' ').size()				==  4);
-	REQUIRE(ST.subsets("e y z c xx yy", ' ').size()			==  4);
-	REQUIRE(ST.subsets("a b c d e f n x y z", ' ').size()	== 17);
+	StringSet set = {};
 
-	ST.query = {3, 5, 7};
-	ST.last_query_idx = ST.query.size() - 1;
-	ST.result.clear();
-	ST.subsets(ST.tree[0].idx_child, 0);
+	for (int i = 0; i < 10000; i++)
+		set.push_back("e" + std::to_string(i));
 
-	REQUIRE(ST.result.size() == 0);
+	for (int i = 1000; i <= 10000; i += 1000)
+		ST.insert(StringSet(set.begin(), set.begin() + i), "s" + std::to_string(i));
 
-	ST.subsets(0, 0);
+	FrozenSetTrie FT(ST);
 
-	REQUIRE(ST.result.size() == 0);
+	REQUIRE(FT.num_nodes() == 10001);
 
-	int tot = 0;
+	size_t num_sup = 0, num_sub = 0, num_last = 0;
+	String found;
 
-	ss = ST.subsets("a b c d e f n x y z", ' ');
+	run_with_stack(1 << 20, [&]() {
+		num_sup	 = FT.supersets({"e0"}).size();
+		num_sub	 = FT.subsets(set).size();
+		num_last = FT.supersets({"e9999", "e3"}).size();
+		found	 = FT.find(set);
+	});
 
-	for (int i = 0; i < 17; i ++) {
-		if (ss[i] == "key_0")
-			tot += 1;
-		if (ss[i] == "key_1")
-			tot += 2;
-		if (ss[i] == "key_2")
-			tot += 4;
-		if (ss[i] == "key_3")
-			tot += 8;
-		if (ss[i] == "key_4")
-			tot += 16;
-		if (ss[i] == "key_5")
-			tot += 32;
-		if (ss[i] == "key_6")
-			tot += 64;
-		if (ss[i] == "key_7")
-			tot += 128;
-		if (ss[i] == "key_8")
-			tot += 256;
-		if (ss[i] == "key_9")
-			tot += 512;
-		if (ss[i] == "key_a")
-			tot += 1024;
-		if (ss[i] == "key_b")
-			tot += 2048;
-		if (ss[i] == "key_c")
-			tot += 4096;
-		if (ss[i] == "key_d")
-			tot += 8192;
-		if (ss[i] == "key_e")
-			tot += 16384;
-		if (ss[i] == "key_f")
-			tot += 32768;
-		if (ss[i] == "empty")
-			tot += 65536;
-	}
-	REQUIRE(tot == 131071);
+	REQUIRE(num_sup	 == 10);
+	REQUIRE(num_sub	 == 10);
+	REQUIRE(num_last == 1);
+	REQUIRE(found	 == "s10000");
+	REQUIRE(FT.subsets(StringSet(set.begin(), set.begin() + 2500)).size() == 2);
 }
 
 #endif
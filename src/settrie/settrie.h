@@ -22,252 +22,2177 @@
 #define INCLUDED_SETTRIE
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 #include <cstdint>
+#include <cstring>
 
 #define IMAGE_BUFF_SIZE				6136
+#define SETTRIE_IMAGE_VERSION		7
 
 #define STATE_IN_USE				0
 #define STATE_HAS_SET_ID			1
 #define STATE_IS_GARBAGE			2
 
+#define ELEMENT_ORDER_INSERTION		0		///< Elements are ordered by the first time they were inserted.
+#define ELEMENT_ORDER_FREQUENT_FIRST 1		///< The elements used by most sets come first. Maximizes prefix sharing.
+#define ELEMENT_ORDER_RARE_FIRST	2		///< The elements used by less sets come first. Lets supersets() prune early.
+
+#define CURSOR_SUPERSETS			0
+#define CURSOR_SUBSETS				1
+
+#define CURSOR_END					-1		///< SetTrieCursor::next() has returned all the results.
+#define CURSOR_INVALID				-2		///< The SetTrie was modified after the SetTrieCursor was created.
+#define CURSOR_PAUSED				-3		///< The traversal used up its step budget, calling again resumes it.
+
+#define PARALLEL_QUERY_MIN_NODES	16384	///< The queries of a smaller tree always run on the calling thread.
+#define PARALLEL_QUERY_STEPS		256		///< The steps a query thread takes between two checks for idle threads.
+
+#define MAX_SHARDS					4096	///< The most shards a ShardedSetTrie has, more are clamped and images with more are invalid.
+
 typedef uint64_t 					ElementHash;
+typedef uint32_t 					ElementId;
 typedef std::string					String;
 
-typedef std::vector<ElementHash>	BinarySet;
-typedef std::vector<String>			StringSet;
-typedef std::vector<int>			IdList;
+typedef std::vector<ElementId>		BinarySet;
+typedef std::vector<String>			StringSet;
+typedef std::vector<int>			IdList;
+
+#define STRING_REF_LONG				0xffFFFF	///< StringRef::length of a string whose length is stored in the arena.
+
+// A string stored in a StringArena: 8 bytes instead of the 32 of a std::string plus its heap block. The length of a string of 16 Mb or
+// more does not fit, it is stored in the 8 bytes before the text and length is STRING_REF_LONG. Use StringArena::length() to read it.
+struct StringRef {
+	uint64_t offset : 40, length : 24;
+};
+
+/** Append-only storage for the element names and the set ids.
+
+All the strings are stored one after the other in a single buffer and referenced by StringRef, so there is no heap block per string
+and no allocator overhead. Strings are never removed: the owner copies the live ones to a new arena to drop the others (see
+SetTrie::purge()).
+*/
+class StringArena {
+
+	public:
+
+		inline StringRef add(const char *p, size_t len) {
+			StringRef ref = {text.size(), (uint64_t) len};
+
+			if (len >= STRING_REF_LONG) {
+				uint64_t long_len = len;
+
+				ref.length = STRING_REF_LONG;
+
+				text.insert(text.end(), (const char *) &long_len, (const char *) &long_len + sizeof(long_len));
+			}
+
+			text.insert(text.end(), p, p + len);
+
+			return ref;
+		}
+
+		inline size_t length(StringRef ref) const {
+			if (ref.length != STRING_REF_LONG)
+				return ref.length;
+
+			uint64_t long_len;
+
+			memcpy(&long_len, text.data() + ref.offset, sizeof(long_len));
+
+			return long_len;
+		}
+
+		inline const char *data(StringRef ref) const {
+			return text.data() + ref.offset + (ref.length == STRING_REF_LONG ? sizeof(uint64_t) : 0);
+		}
+
+		inline StringRef add(const String &str)		{ return add(str.data(), str.length()); }
+		inline String get(StringRef ref) const		{ return String(data(ref), length(ref)); }
+		inline size_t size() const					{ return text.size(); }
+		inline void clear()							{ text.clear(); }
+
+	private:
+
+		std::vector<char> text = {};
+};
+
+// An element of the dictionary. The ElementId of an element is its index in a NameList, the nodes store that instead of the hash.
+// The name is stored in SetTrie::name_arena.
+struct Name {
+	StringRef	name;
+	ElementHash hash;
+	int			count;
+};
+
+typedef std::vector<Name>					NameList;
+typedef std::pair<ElementHash, ElementId>	ElementSlot;
+typedef std::vector<ElementSlot>			ElementSlotList;
+
+#define ELEMENT_SLOT_EMPTY			0xffffFFFF	///< The value of an unused ElementTable slot.
+
+/** The element registry of a SetTrie: the ElementId of each element hash.
+
+An open-addressing table with linear probing. The keys are already MurmurHash64A hashes, so their lowest bits are used as the home slot
+as they are. The slots hold the key and the value side by side, a lookup is usually one cache miss instead of the log2(n) node jumps of
+the std::map this replaces, and no memory is allocated per element. The table doubles when it is half full and erase() shifts the
+following entries back instead of leaving tombstones, so lookups never get slower after many removals.
+
+Iterating visits the elements in slot order, use sorted() when the hashes are needed in order.
+*/
+class ElementTable {
+
+	public:
+
+		class iterator {
+
+			public:
+
+				iterator(ElementTable *p_table, int idx) : p_table(p_table), idx(idx) {}
+
+				inline ElementSlot &operator*()						{ return p_table->slot[idx]; }
+				inline ElementSlot *operator->()					{ return &p_table->slot[idx]; }
+				inline iterator &operator++()						{ idx = p_table->next(idx + 1); return *this; }
+				inline bool operator==(const iterator &it) const	{ return idx == it.idx; }
+				inline bool operator!=(const iterator &it) const	{ return idx != it.idx; }
+
+			private:
+
+				ElementTable *p_table;
+				int			  idx;
+
+			friend class ElementTable;
+		};
+
+		inline iterator begin()	{ return iterator(this, next(0)); }
+		inline iterator end()	{ return iterator(this, slot.size()); }
+		inline size_t	size()	{ return num_used; }
+
+		inline iterator find(ElementHash hh) {
+			int i = locate(hh);
+
+			return i < 0 ? end() : iterator(this, i);
+		}
+
+		/// The ElementId of a hash or ELEMENT_SLOT_EMPTY if it is not in the table. Unlike find(), it works on a const table.
+		inline ElementId get(ElementHash hh) const {
+			int i = locate(hh);
+
+			return i < 0 ? ELEMENT_SLOT_EMPTY : slot[i].second;
+		}
+
+		inline ElementId &operator[](ElementHash hh) {
+			if (2*(num_used + 1) > slot.size())
+				grow();
+
+			int mask = slot.size() - 1, i = hh & mask;
+
+			while (slot[i].second != ELEMENT_SLOT_EMPTY && slot[i].first != hh)
+				i = (i + 1) & mask;
+
+			if (slot[i].second == ELEMENT_SLOT_EMPTY) {
+				slot[i] = ElementSlot(hh, 0);
+				num_used++;
+			}
+
+			return slot[i].second;
+		}
+
+		inline void erase(ElementHash hh) {
+			iterator it = find(hh);
+
+			if (it == end())
+				return;
+
+			int mask = slot.size() - 1, i = it.idx;
+
+			// Backward shift: move back every following entry of the cluster whose home slot is not between the hole and itself.
+
+			for (int j = (i + 1) & mask; slot[j].second != ELEMENT_SLOT_EMPTY; j = (j + 1) & mask) {
+				int home = slot[j].first & mask;
+
+				if (((j - home) & mask) >= ((j - i) & mask)) {
+					slot[i] = slot[j];
+					i		= j;
+				}
+			}
+			slot[i].second = ELEMENT_SLOT_EMPTY;
+			num_used--;
+		}
+
+		inline void clear() {
+			slot.clear();
+			num_used = 0;
+		}
+
+		/// The (hash, ElementId) pairs sorted by hash.
+		inline ElementSlotList sorted() {
+			ElementSlotList ret = {};
+
+			for (iterator it = begin(); it != end(); ++it)
+				ret.push_back(*it);
+
+			std::sort(ret.begin(), ret.end());
+
+			return ret;
+		}
+
+		inline bool operator==(const ElementTable &table) const {
+			if (table.num_used != num_used)
+				return false;
+
+			for (ElementSlotList::const_iterator it = slot.begin(); it != slot.end(); ++it) {
+				if (it->second == ELEMENT_SLOT_EMPTY)
+					continue;
+
+				int j = table.locate(it->first);
+
+				if (j < 0 || table.slot[j].second != it->second)
+					return false;
+			}
+			return true;
+		}
+
+	private:
+
+		inline int locate(ElementHash hh) const {
+			if (num_used == 0)
+				return -1;
+
+			int mask = slot.size() - 1;
+
+			for (int i = hh & mask;; i = (i + 1) & mask) {
+				if (slot[i].second == ELEMENT_SLOT_EMPTY)
+					return -1;
+
+				if (slot[i].first == hh)
+					return i;
+			}
+		}
+
+		inline int next(int idx) {
+			while (idx < (int) slot.size() && slot[idx].second == ELEMENT_SLOT_EMPTY)
+				idx++;
+
+			return idx;
+		}
+
+		inline void grow() {
+			ElementSlotList old = {};
+
+			old.swap(slot);
+			slot.resize(old.empty() ? 16 : 2*old.size(), ElementSlot(0, ELEMENT_SLOT_EMPTY));
+
+			int mask = slot.size() - 1;
+
+			for (ElementSlotList::iterator it = old.begin(); it != old.end(); ++it) {
+				if (it->second == ELEMENT_SLOT_EMPTY)
+					continue;
+
+				int i = it->first & mask;
+
+				while (slot[i].second != ELEMENT_SLOT_EMPTY)
+					i = (i + 1) & mask;
+
+				slot[i] = *it;
+			}
+		}
+
+		ElementSlotList slot	 = {};
+		size_t			num_used = 0;
+};
+
+uint64_t MurmurHash64A (const void *key, int len);
+
+typedef std::pair<int, String>				IdEntry;
+typedef std::pair<int, StringRef>			IdRef;
+typedef std::vector<IdRef>					IdRefList;
+
+/** The ids of the sets stored in a SetTrie, indexed by the node where each set ends.
+
+The (node, id) pairs are kept in a dense array and each node has the index of its pair (or -1) in a side array, so find(), operator[] and
+erase() are O(1) instead of a tree walk. Iterating visits the nodes in increasing order, like the std::map this replaces, skipping the
+empty slots. The id strings are stored in a StringArena, the iterators build the (node, id) IdEntry when it is read.
+
+find_node() is the reverse lookup: an ElementTable maps the hash of each id string to the last node stored with it, the other nodes
+with the same hash (the same id or a collision) are chained through same_hash.
+*/
+class IdTable {
+
+	public:
+
+		class iterator {
+
+			public:
+
+				iterator(IdTable *p_table, int idx) : p_table(p_table), idx(idx) {}
+
+				inline IdEntry &operator*()						{ return entry(); }
+				inline IdEntry *operator->()					{ return &entry(); }
+				inline iterator &operator++()					{ idx = p_table->next(idx + 1); return *this; }
+				inline bool operator==(const iterator &it) const { return idx == it.idx; }
+				inline bool operator!=(const iterator &it) const { return idx != it.idx; }
+
+			private:
+
+				inline IdEntry &entry() {
+					if (value.first != idx)
+						value = IdEntry(idx, p_table->arena.get(p_table->entries[p_table->slot[idx]].second));
+
+					return value;
+				}
+
+				IdTable *p_table;
+				int		 idx;
+				IdEntry	 value = {-1, ""};
+
+			friend class IdTable;
+		};
+
+		inline iterator begin()		  { return iterator(this, next(0)); }
+		inline iterator end()		  { return iterator(this, slot.size()); }
+		inline size_t	size() const { return entries.size(); }
+
+		/// The first node from idx on with an id, -1 if there is none. Unlike the iterators, it works on a const table.
+		inline int next_node(int idx) const {
+			idx = next(idx);
+
+			return idx < (int) slot.size() ? idx : -1;
+		}
+
+		/// The bytes used by the id strings, including the ones of erased ids.
+		inline size_t text_size() const { return arena.size(); }
+
+		inline iterator find(int idx) {
+			if (idx < 0 || idx >= (int) slot.size() || slot[idx] < 0)
+				return end();
+
+			return iterator(this, idx);
+		}
+
+		/// The id of the set ending at node idx, an empty string if there is none. Use set() to store one.
+		inline const String operator[](int idx) const {
+			if (idx < 0 || idx >= (int) slot.size() || slot[idx] < 0)
+				return "";
+
+			return arena.get(entries[slot[idx]].second);
+		}
+
+		inline void set(int idx, const char *p, int len) {
+			if (idx >= (int) slot.size())
+				slot.resize(idx + 1, -1);
+
+			if (slot[idx] < 0) {
+				slot[idx] = entries.size();
+				entries.push_back(IdRef(idx, arena.add(p, len)));
+				same_hash.push_back(-1);
+			} else {
+				unlink(idx);
+				entries[slot[idx]].second = arena.add(p, len);
+			}
+
+			ElementHash hh = MurmurHash64A(p, len);
+
+			ElementTable::iterator it = by_hash.find(hh);
+
+			same_hash[slot[idx]] = it == by_hash.end() ? -1 : (int) it->second;
+			by_hash[hh]			 = idx;
+		}
+
+		inline void set(int idx, const String &str) { set(idx, str.data(), str.length()); }
+
+		/// The node of a set stored with the id str (the last one stored if there are many), -1 if there is none.
+		inline int find_node(const String &str) const {
+			ElementId last = by_hash.get(MurmurHash64A(str.data(), str.length()));
+
+			if (last == ELEMENT_SLOT_EMPTY)
+				return -1;
+
+			for (int idx = last; idx >= 0; idx = same_hash[slot[idx]]) {
+				StringRef ref = entries[slot[idx]].second;
+
+				if (arena.length(ref) == str.length() && memcmp(arena.data(ref), str.data(), str.length()) == 0)
+					return idx;
+			}
+
+			return -1;
+		}
+
+		/// The id string stays in the arena until the table is rebuilt.
+		inline void erase(iterator it) {
+			unlink(it.idx);
+
+			int e = slot[it.idx], last = entries.size() - 1;
+
+			if (e != last) {
+				entries[e]	 = entries[last];
+				same_hash[e] = same_hash[last];
+				slot[entries[e].first] = e;
+			}
+			entries.pop_back();
+			same_hash.pop_back();
+			slot[it.idx] = -1;
+		}
+
+		inline void clear() {
+			slot.clear();
+			entries.clear();
+			same_hash.clear();
+			by_hash.clear();
+			arena.clear();
+		}
+
+	private:
+
+		inline int next(int idx) const {
+			while (idx < (int) slot.size() && slot[idx] < 0)
+				idx++;
+
+			return idx;
+		}
+
+		// Removes the node idx from the chain of its id hash.
+		inline void unlink(int idx) {
+			StringRef	 ref = entries[slot[idx]].second;
+			ElementHash	 hh	 = MurmurHash64A(arena.data(ref), arena.length(ref));
+			int			 nxt = same_hash[slot[idx]];
+
+			ElementTable::iterator it = by_hash.find(hh);
+
+			if (it->second == idx) {
+				if (nxt < 0)
+					by_hash.erase(hh);
+				else
+					it->second = nxt;
+
+				return;
+			}
+
+			int prev = it->second;
+
+			while (same_hash[slot[prev]] != idx)
+				prev = same_hash[slot[prev]];
+
+			same_hash[slot[prev]] = nxt;
+		}
+
+		IdList		 slot;
+		IdRefList	 entries;
+		IdList		 same_hash;
+		ElementTable by_hash;
+		StringArena	 arena;
+};
+
+// The fields used by the query kernels. The parent and the state of each node are kept apart in SetTrie::parent and SetTrie::state,
+// they are only needed by elements(), remove() and when a match is found.
+struct SetNode {
+	ElementId value;
+
+	int idx_next, idx_child;
+};
+
+// A run of values following the value of a node in a chain of single children (path compression). A node with a run stores the
+// bitwise complement of the run index in idx_child, the first child after the run is Run::idx_child.
+struct Run {
+	int idx_child;
+
+	BinarySet value;
+};
+
+// Exact bounds of the subtree of a node, used by the query kernels to skip dead subtrees. The height counts the values of the longest
+// path from the node (its own value and run included) to a leaf, max_value is the largest value in the subtree and num_sets is the
+// number of sets ending in the subtree (the node included).
+struct NodeSummary {
+	ElementId max_value;
+
+	int height, num_sets;
+};
+
+typedef std::vector<SetNode>		BinaryTree;
+typedef std::vector<uint8_t>		StateList;
+typedef std::vector<Run>			RunList;
+typedef std::vector<uint64_t>		SignatureList;
+typedef std::vector<NodeSummary>	SummaryList;
+
+// A sibling chain pending in the stack of a SetTrieCursor: t_idx is the next node of the chain and s_idx the first pending query value.
+// When all is set, the query is already matched and all the sets in the chain and their descendants are results.
+struct CursorFrame {
+	int t_idx, s_idx;
+
+	bool all;
+};
+
+typedef std::vector<CursorFrame>	CursorStack;
+
+// The results of a batch of queries: the set_ids found by query i are set_ids[offset[i]] to set_ids[offset[i + 1] - 1].
+struct QueryBatch {
+	IdList offset, set_ids;
+};
+
+// The scratch state of a query: the sorted ids of the query, the signature bits of its pending values, the results and the stack of the
+// traversal. Each thread has its own (see SetTrie::query_context()), so many threads can query the same SetTrie at once.
+struct QueryContext {
+	BinarySet	  query		 = {};
+	SignatureList query_mask = {};
+	IdList		  result	 = {};
+	CursorStack	  stack		 = {};
+
+	int	 last_query_idx = 0, num_found = 0, max_results = INT32_MAX;
+	bool count_only		= false;
+};
+
+/** A reader-writer lock (std::shared_mutex is C++17). Many readers or a single writer hold it at a time, and a waiting writer stops new
+	readers from coming in, so a stream of queries cannot starve the updates. Copying an object does not copy its lock.
+*/
+class RWLock {
+
+	public:
+
+		RWLock() {}
+		RWLock(const RWLock &) {}
+
+		inline RWLock &operator=(const RWLock &) { return *this; }
+
+		inline void lock_shared() {
+			std::unique_lock<std::mutex> lock(mtx);
+
+			ready.wait(lock, [this] { return !writing && num_waiting == 0; });
+
+			num_readers++;
+		}
+
+		inline void unlock_shared() {
+			std::lock_guard<std::mutex> lock(mtx);
+
+			if (--num_readers == 0)
+				ready.notify_all();
+		}
+
+		inline void lock() {
+			std::unique_lock<std::mutex> lock(mtx);
+
+			num_waiting++;
+
+			ready.wait(lock, [this] { return !writing && num_readers == 0; });
+
+			num_waiting--;
+			writing = true;
+		}
+
+		inline void unlock() {
+			std::lock_guard<std::mutex> lock(mtx);
+
+			writing = false;
+
+			ready.notify_all();
+		}
+
+	private:
+
+		std::mutex				mtx;
+		std::condition_variable ready;
+
+		int	 num_readers = 0, num_waiting = 0;
+		bool writing	 = false;
+};
+
+/** Holds an RWLock, shared or exclusive, for the life of the guard. The public methods of SetTrie call each other, a thread already
+	holding the lock does not take it again.
+*/
+class RWGuard {
+
+	public:
+
+		RWGuard(RWLock &rw, bool exclusive) : rw(rw), exclusive(exclusive) {
+			p_prev = held();
+
+			if (p_prev == &rw)
+				return;
+
+			if (exclusive)
+				rw.lock();
+			else
+				rw.lock_shared();
+
+			held() = &rw;
+		}
+
+		~RWGuard() {
+			if (p_prev == &rw)
+				return;
+
+			held() = p_prev;
+
+			if (exclusive)
+				rw.unlock();
+			else
+				rw.unlock_shared();
+		}
+
+	private:
+
+		static inline RWLock *&held() {
+			static thread_local RWLock *p_held = nullptr;
+
+			return p_held;
+		}
+
+		RWLock &rw;
+		RWLock *p_prev;
+		bool	exclusive;
+};
+
+// This structure is 64encoded to 8K (3 input bytes == 24 bit -> 4 output chars == 24 bit). Therefore, its size is 6K.
+struct ImageBlock {
+	int size, block_num;
+
+	uint8_t buffer[IMAGE_BUFF_SIZE];		// makes sizeof(ImageBlock) == 6K
+};
+
+typedef std::vector<ImageBlock>		BinaryImage;
+typedef BinaryImage				   *pBinaryImage;
+
+
+class SetTrie {
+
+	public:
+
+		SetTrie() {
+			num_dirty_nodes = 0;
+			element_order	= ELEMENT_ORDER_INSERTION;
+			use_signatures	= false;
+			new_node(0, 0, -1);
+		}
+
+		void	  insert	(StringSet set, String id);
+		void	  insert	(String str, String str_id, char split);
+		void	  insert_many (std::vector<StringSet> &sets, StringSet &str_ids, int num_threads = 1);
+		String	  find		(StringSet set) const;
+		String	  find		(String str, char split) const;
+		StringSet supersets	(StringSet set, int limit = -1) const;
+		StringSet supersets	(String str, char split, int limit = -1) const;
+		StringSet subsets	(StringSet set, int limit = -1) const;
+		StringSet subsets	(String str, char split, int limit = -1) const;
+		int		  find_idx	(StringSet set) const;
+		int		  find_idx	(String str, char split) const;
+		IdList	  supersets_idx (StringSet set, int limit = -1) const;
+		IdList	  supersets_idx (String str, char split, int limit = -1) const;
+		IdList	  subsets_idx	(StringSet set, int limit = -1) const;
+		IdList	  subsets_idx	(String str, char split, int limit = -1) const;
+		int		  count_supersets (StringSet set) const;
+		int		  count_supersets (String str, char split) const;
+		int		  count_subsets	  (StringSet set) const;
+		int		  count_subsets	  (String str, char split) const;
+		QueryBatch supersets_batch (std::vector<StringSet> &sets, int limit = -1, int num_threads = 1) const;
+		QueryBatch subsets_batch   (std::vector<StringSet> &sets, int limit = -1, int num_threads = 1) const;
+		IdList	  find_batch	  (std::vector<StringSet> &sets, int num_threads = 1) const;
+		StringSet elements	(int idx) const;
+		int		  remove	(int idx);
+		int		  find_by_id   (String str_id) const;
+		int		  remove_by_id (String str_id);
+		int		  purge		();
+		bool	  set_element_order (int order);
+		void	  reorder	();
+		void	  set_signatures (bool enable);
+		bool	  set_query_threads (int num_threads);
+		bool	  load		(pBinaryImage &p_bi);
+		bool	  save		(pBinaryImage &p_bi);
+
+		IdTable id			  = {};
+		int	  num_dirty_nodes;
+		int	  element_order;
+		bool  use_signatures;
+		int	  num_changes	= 0;
+		int	  query_threads = 1;
+
+		friend class FrozenSetTrie;
+		friend class DawgSetTrie;
+		friend class SetTrieCursor;
+		friend class ShardedSetTrie;
+
+#ifndef TEST
+	private:
+#endif
+
+	inline int new_node(ElementId value, int idx_next, int idx_parent) {
+
+		SetNode node = {value, idx_next, 0};
+
+		tree.push_back(node);
+		parent.push_back(idx_parent);
+		state.push_back(STATE_IN_USE);
+		summary.push_back({0, 0, 0});
+
+		if (use_signatures)
+			signature.push_back(0);
+
+		return tree.size() - 1;
+	}
+
+	inline int child(int idx) const {
+		int ci = tree[idx].idx_child;
+
+		return ci < 0 ? runs[~ci].idx_child : ci;
+	}
+
+	inline void set_child(int idx, int ci) {
+		int ri = tree[idx].idx_child;
+
+		if (ri < 0)
+			runs[~ri].idx_child = ci;
+		else
+			tree[idx].idx_child = ci;
+	}
+
+	inline void new_run(int idx, BinarySet::iterator first, BinarySet::iterator last) {
+		int ri;
+
+		if (free_runs.empty()) {
+			ri = runs.size();
+			runs.push_back({});
+		} else {
+			ri = free_runs.back();
+			free_runs.pop_back();
+		}
+		runs[ri].idx_child = tree[idx].idx_child;
+		runs[ri].value.assign(first, last);
+
+		tree[idx].idx_child = ~ri;
+	}
+
+	inline void release_run(int idx) {
+		int ri = tree[idx].idx_child;
+
+		tree[idx].idx_child = runs[~ri].idx_child;
+
+		runs[~ri].value.clear();
+		free_runs.push_back(~ri);
+	}
+
+	/** Splits the run of node c before its j-th value. A new node takes the value of c and the first j values of the run, c keeps
+		the rest. The node c keeps its index, so its set id and the parent of its children do not change.
+	*/
+	inline int split(int c, int j) {
+
+		int h = new_node(tree[c].value, tree[c].idx_next, parent[c]);
+		int p = parent[c], k = child(p);
+
+		if (k == c)
+			set_child(p, h);
+		else {
+			while (tree[k].idx_next != c)
+				k = tree[k].idx_next;
+
+			tree[k].idx_next = h;
+		}
+
+		int		  ri  = ~tree[c].idx_child;
+		BinarySet run = runs[ri].value;
+
+		tree[h].idx_child = c;
+
+		// The subtree of h is the subtree of c. The signature of c is not narrowed, a superset of the bits is still valid.
+		if (use_signatures)
+			signature[h] = signature[c];
+
+		summary[h]		   = summary[c];
+		summary[c].height -= j + 1;
+
+		if (j > 0)
+			new_run(h, run.begin(), run.begin() + j);
+
+		tree[c].value	 = run[j];
+		tree[c].idx_next = 0;
+		parent[c]		 = h;
+
+		if (j + 1 == run.size())
+			release_run(c);
+		else
+			runs[ri].value.assign(run.begin() + j + 1, run.end());
+
+		return h;
+	}
+
+	inline int insert(int idx, ElementId value) {
+
+		int idx_c = child(idx);
+
+		if (idx_c == 0 || tree[idx_c].value > value) {
+			idx_c = new_node(value, idx_c, idx);
+
+			set_child(idx, idx_c);
+
+			return idx_c;
+		}
+
+		idx	= idx_c;
+
+		while (true) {
+			if (tree[idx].value == value)
+				return idx;
+
+			int idx_n = tree[idx].idx_next;
+
+			if (idx_n == 0 || tree[idx_n].value > value) {
+				idx_c = new_node(value, idx_n, parent[idx]);
+
+				tree[idx].idx_next = idx_c;
+
+				return idx_c;
+			}
+
+			idx = idx_n;
+		}
+	}
+
+	inline int insert(BinarySet set) {
+
+		int idx	 = 0;
+		int size = set.size();
+
+		if (size == 0) {
+			mark_set(0);
+
+			return 0;
+		}
+
+		for (int i = 0; i < size; i++) {
+			int n_nodes = tree.size();
+
+			idx	= insert(idx, set[i]);
+
+			// A new node has no children: the rest of the set becomes its run.
+			if (tree.size() > n_nodes) {
+				if (i + 1 < size)
+					new_run(idx, set.begin() + i + 1, set.end());
+
+				break;
+			}
+
+			int ri = tree[idx].idx_child;
+
+			if (ri < 0) {
+				BinarySet &run = runs[~ri].value;
+
+				int j = 0, len = run.size();
+
+				while (j < len && i + 1 + j < size && run[j] == set[i + 1 + j])
+					j++;
+
+				if (j < len)
+					idx = split(idx, j);
+
+				i += j;
+			}
+		}
+
+		mark_set(idx);
+		add_summary(idx);
+
+		if (use_signatures)
+			add_signature(idx);
+
+		return idx;
+	}
+
+	/// Marks a set ending at idx and counts it in the summaries of the path to the root.
+	inline void mark_set(int idx) {
+
+		if (state[idx] == STATE_HAS_SET_ID)
+			return;
+
+		state[idx] = STATE_HAS_SET_ID;
+
+		for (; idx > 0; idx = parent[idx])
+			summary[idx].num_sets++;
+
+		summary[0].num_sets++;
+	}
+
+	/// The number of values in a node: its own value and its run.
+	inline int node_length(int idx) {
+		int ri = tree[idx].idx_child;
+
+		return ri < 0 ? 1 + runs[~ri].value.size() : 1;
+	}
+
+	/// The last value of a node: the last value of its run or its own value.
+	inline ElementId last_value(int idx) {
+		int ri = tree[idx].idx_child;
+
+		return ri < 0 ? runs[~ri].value.back() : tree[idx].value;
+	}
+
+	/// Extends the summaries of the path from idx to the root with a set ending at idx.
+	inline void add_summary(int idx) {
+		ElementId max_value = last_value(idx);
+		int		  height	= 0;
+
+		while (idx > 0) {
+			height += node_length(idx);
+
+			NodeSummary &ns = summary[idx];
+
+			// The summaries of the ancestors already cover an unchanged summary.
+			if (ns.max_value >= max_value && ns.height >= height)
+				return;
+
+			ns.max_value = std::max(ns.max_value, max_value);
+			ns.height	 = std::max(ns.height, height);
+
+			idx = parent[idx];
+		}
+	}
+
+	/// Computes the summary of a node from its values and the summaries of its children.
+	inline void update_summary(int idx) {
+		NodeSummary ns = {last_value(idx), 0, state[idx] == STATE_HAS_SET_ID};
+
+		for (int ci = child(idx); ci != 0; ci = tree[ci].idx_next) {
+			ns.max_value = std::max(ns.max_value, summary[ci].max_value);
+			ns.height	 = std::max(ns.height, summary[ci].height);
+			ns.num_sets += summary[ci].num_sets;
+		}
+		ns.height += node_length(idx);
+
+		summary[idx] = ns;
+	}
+
+	/// Appends the nodes of a sibling chain and all its descendants to order, each node before its descendants.
+	inline void preorder(int t_idx, IdList &order) {
+
+		IdList pending = {t_idx};
+
+		while (!pending.empty()) {
+			int idx = pending.back();
+
+			pending.pop_back();
+
+			for (; idx != 0; idx = tree[idx].idx_next) {
+				order.push_back(idx);
+
+				if (int ci = child(idx))
+					pending.push_back(ci);
+			}
+		}
+	}
+
+	/// Computes the summaries of a sibling chain and all its descendants, the descendants first.
+	inline void build_summaries(int t_idx) {
+
+		IdList order = {};
+
+		preorder(t_idx, order);
+
+		for (IdList::reverse_iterator it = order.rbegin(); it != order.rend(); ++it)
+			update_summary(*it);
+	}
+
+	/// The bit of an element in a signature. The ids are dense, so consecutive elements never share a bit.
+	static inline uint64_t signature_bit(ElementId value) {
+		return (uint64_t) 1 << (value & 63);
+	}
+
+	/// The bits of the value of a node and of its run.
+	inline uint64_t node_bits(int idx) {
+		uint64_t bits = signature_bit(tree[idx].value);
+		int		 ri	  = tree[idx].idx_child;
+
+		if (ri < 0)
+			for (BinarySet::iterator it = runs[~ri].value.begin(); it != runs[~ri].value.end(); ++it)
+				bits |= signature_bit(*it);
+
+		return bits;
+	}
+
+	/// Adds the values of the path from idx to the root to the signatures of the nodes in the path.
+	inline void add_signature(int idx) {
+		uint64_t bits = 0;
+
+		while (idx > 0) {
+			bits |= node_bits(idx);
+			signature[idx] |= bits;
+
+			idx = parent[idx];
+		}
+		signature[0] |= bits;
+	}
+
+	/// Computes the signatures of a sibling chain and all its descendants and returns the union of the signatures of the chain.
+	inline uint64_t build_signatures(int t_idx) {
+
+		IdList order = {};
+
+		preorder(t_idx, order);
+
+		for (IdList::reverse_iterator it = order.rbegin(); it != order.rend(); ++it) {
+			uint64_t bits = node_bits(*it);
+
+			for (int ci = child(*it); ci != 0; ci = tree[ci].idx_next)
+				bits |= signature[ci];
+
+			signature[*it] = bits;
+		}
+
+		uint64_t chain = 0;
+
+		for (; t_idx != 0; t_idx = tree[t_idx].idx_next)
+			chain |= signature[t_idx];
+
+		return chain;
+	}
+
+	inline int find(int idx, ElementId value) const {
+
+		if ((idx = child(idx)) == 0)
+			return 0;
+
+		while (true) {
+			ElementId t_value;
+			if ((t_value = tree[idx].value) == value)
+				return idx;
+
+			if (t_value > value || (idx = tree[idx].idx_next) == 0)
+				return 0;
+		}
+	}
+
+	inline int find(const BinarySet &set) const {
+
+		int idx	 = 0;
+		int size = set.size();
+
+		for (int i = 0; i < size; i++) {
+			if ((idx = find(idx, set[i])) == 0)
+				return 0;
+
+			int ri = tree[idx].idx_child;
+
+			if (ri < 0) {
+				const BinarySet &run = runs[~ri].value;
+
+				int len = run.size();
+
+				if (i + len >= size)
+					return 0;
+
+				for (int j = 0; j < len; j++)
+					if (run[j] != set[++i])
+						return 0;
+			}
+		}
+
+		return idx;
+	}
+
+	/// Appends the values of the path from idx to the root, last value first.
+	inline void path(int idx, BinarySet &set) const {
+
+		while (idx > 0) {
+			int ri = tree[idx].idx_child;
+
+			if (ri < 0)
+				set.insert(set.end(), runs[~ri].value.rbegin(), runs[~ri].value.rend());
+
+			set.push_back(tree[idx].value);
+
+			idx = parent[idx];
+		}
+	}
+
+	/** Finds the next superset of a query resuming the traversal kept in stack (see CursorFrame).
+
+		\param stack The pending sibling chains, the first one is the children of the root.
+		\param q	  The sorted ids of the query.
+		\param mask  The signature bits of the pending values of the query, mask[s] for q[s..last].
+		\param last  The index of the last value of the query.
+		\param p_count If given, the sets of each matched subtree are added to *p_count instead and CURSOR_END is returned at the end of
+					  the traversal.
+		\param p_steps If given, the number of frames it may visit. It is decremented at each one and CURSOR_PAUSED is returned when
+					  it runs out.
+
+		\return	  The node of the next superset, CURSOR_END or CURSOR_PAUSED.
+	*/
+	inline int next_superset(CursorStack &stack, const BinarySet &q, const SignatureList &mask, int last, int *p_count = nullptr,
+							 int *p_steps = nullptr) const {
+
+		while (!stack.empty()) {
+			if (p_steps != nullptr && --*p_steps < 0)
+				return CURSOR_PAUSED;
+
+			CursorFrame f = stack.back();
+
+			if (f.t_idx == 0) {
+				stack.pop_back();
+
+				continue;
+			}
+
+			int t_idx = f.t_idx;
+
+			stack.back().t_idx = tree[t_idx].idx_next;
+
+			// The query is already matched: every node with a set in the subtree is a result.
+			if (f.all) {
+				if (int ci = child(t_idx))
+					stack.push_back({ci, 0, true});
+
+				if (state[t_idx] == STATE_HAS_SET_ID)
+					return t_idx;
+
+				continue;
+			}
+
+			int		  s_idx = f.s_idx;
+			ElementId t_value;
+
+			// Siblings are sorted by value: once past q[s_idx], no remaining subtree can contain it.
+			if ((t_value = tree[t_idx].value) > q[s_idx]) {
+				stack.pop_back();
+
+				continue;
+			}
+
+			// The pending query values must fit in the subtree: as many as its height, the last one up to its max value. A pending
+			// value missing in the signature of the subtree also proves that no set below contains the query.
+			if (	summary[t_idx].height <= last - s_idx || summary[t_idx].max_value < q[last]
+				|| (use_signatures && (mask[s_idx] & ~signature[t_idx]) != 0))
+				continue;
+
+			int s  = s_idx + (t_value == q[s_idx]);
+			int ci = tree[t_idx].idx_child;
+
+			if (ci < 0) {
+				const BinarySet &run = runs[~ci].value;
+
+				ci = runs[~ci].idx_child;
+
+				// The values of the path grow: a run value above the pending query value means it cannot be in this subtree.
+				int len = run.size();
+
+				for (int j = 0; j < len && s <= last; j++) {
+					if (run[j] == q[s])
+						s++;
+					else if (run[j] > q[s]) {
+						ci = -1;
+
+						break;
+					}
+				}
+			}
+
+			if (s > last) {
+				// Every set in the subtree is a superset, count_supersets() only needs their number.
+				if (p_count != nullptr) {
+					*p_count += summary[t_idx].num_sets;
+
+					continue;
+				}
+
+				if (ci > 0)
+					stack.push_back({ci, 0, true});
+
+				if (state[t_idx] == STATE_HAS_SET_ID)
+					return t_idx;
+
+			} else if (ci > 0)
+				stack.push_back({ci, s, false});
+		}
+
+		return CURSOR_END;
+	}
+
+	/** Finds the next subset of a query resuming the traversal kept in stack (see CursorFrame). The parameters are the same as in
+		next_superset(), with p_count the subsets are counted in *p_count and CURSOR_END is returned at the end of the traversal.
+	*/
+	inline int next_subset(CursorStack &stack, const BinarySet &q, int last, int *p_count = nullptr, int *p_steps = nullptr) const {
+
+		// Merge-join of each sorted sibling chain against the sorted query.
+		while (!stack.empty()) {
+			if (p_steps != nullptr && --*p_steps < 0)
+				return CURSOR_PAUSED;
+
+			int t_idx = stack.back().t_idx;
+
+			if (t_idx == 0) {
+				stack.pop_back();
+
+				continue;
+			}
+
+			ElementId t_value = tree[t_idx].value;
+			int		  s_idx	  = stack.back().s_idx;
+
+			while (s_idx < last && q[s_idx] < t_value)
+				s_idx++;
+
+			if (q[s_idx] < t_value) {
+				stack.pop_back();
+
+				continue;
+			}
+
+			stack.back() = {tree[t_idx].idx_next, s_idx, false};
+
+			if (q[s_idx] == t_value) {
+				int s  = s_idx;
+				int ci = tree[t_idx].idx_child;
+
+				if (ci < 0) {
+					const BinarySet &run = runs[~ci].value;
+
+					ci = runs[~ci].idx_child;
+
+					// All the values of the run must follow in the query.
+					int len = run.size();
+
+					for (int j = 0; j < len; j++) {
+						while (s < last && q[++s] < run[j]);
+
+						if (q[s] != run[j]) {
+							ci = -1;
+
+							break;
+						}
+					}
+				}
+
+				if (ci >= 0) {
+					// The children can only match the next query values up to the max value of the subtree.
+					if (ci != 0 && s < last && q[s + 1] <= summary[t_idx].max_value)
+						stack.push_back({ci, s + 1, false});
+
+					if (state[t_idx] == STATE_HAS_SET_ID) {
+						if (p_count == nullptr)
+							return t_idx;
+
+						(*p_count)++;
+					}
+				}
+			}
+		}
+
+		return CURSOR_END;
+	}
+
+	/// Appends the supersets of the query of ctx to its result (up to max_results) using its reusable stack. The depth of the tree does
+	/// not use the call stack. With count_only, the supersets are counted in num_found instead.
+	inline void supersets(int t_idx, int s_idx, QueryContext &ctx) const {
+
+		if (query_threads > 1 && ctx.max_results == INT32_MAX && !ctx.count_only && tree.size() >= PARALLEL_QUERY_MIN_NODES) {
+			parallel_query(CURSOR_SUPERSETS, t_idx, s_idx, ctx);
+
+			return;
+		}
+
+		ctx.stack.clear();
+		ctx.stack.push_back({t_idx, s_idx, false});
+
+		int idx, *p_count = ctx.count_only ? &ctx.num_found : nullptr;
+
+		while (		(int) ctx.result.size() < ctx.max_results
+			   && (idx = next_superset(ctx.stack, ctx.query, ctx.query_mask, ctx.last_query_idx, p_count)) >= 0)
+			ctx.result.push_back(idx);
+	}
+
+	/// Appends the subsets of the query of ctx to its result (up to max_results) using its reusable stack. With count_only, the subsets
+	/// are counted in num_found instead.
+	inline void subsets(int t_idx, int s_idx, QueryContext &ctx) const {
+
+		if (query_threads > 1 && ctx.max_results == INT32_MAX && !ctx.count_only && tree.size() >= PARALLEL_QUERY_MIN_NODES) {
+			parallel_query(CURSOR_SUBSETS, t_idx, s_idx, ctx);
+
+			return;
+		}
+
+		ctx.stack.clear();
+		ctx.stack.push_back({t_idx, s_idx, false});
+
+		int idx, *p_count = ctx.count_only ? &ctx.num_found : nullptr;
+
+		while ((int) ctx.result.size() < ctx.max_results && (idx = next_subset(ctx.stack, ctx.query, ctx.last_query_idx, p_count)) >= 0)
+			ctx.result.push_back(idx);
+	}
+
+	/// The QueryContext of the calling thread, shared by all the SetTrie objects. supersets_idx() and subsets_idx() move its result out,
+	/// so what they return belongs to the caller.
+	static inline QueryContext &query_context() {
+		static thread_local QueryContext ctx;
+
+		return ctx;
+	}
+
+	inline void sort_children() {
+
+		IdList chain;
+
+		int size = tree.size();
+
+		for (int i = 0; i < size; i++) {
+			if (state[i] == STATE_IS_GARBAGE || child(i) == 0)
+				continue;
+
+			chain.clear();
+
+			bool sorted = true;
+
+			for (int j = child(i); j != 0; j = tree[j].idx_next) {
+				if (!chain.empty() && tree[chain.back()].value > tree[j].value)
+					sorted = false;
+
+				chain.push_back(j);
+			}
+
+			if (sorted)
+				continue;
+
+			std::sort(chain.begin(), chain.end(), [this](int a, int b) { return tree[a].value < tree[b].value; });
+
+			int n = chain.size();
+
+			set_child(i, chain[0]);
+
+			for (int j = 0; j < n; j++)
+				tree[chain[j]].idx_next = j + 1 < n ? chain[j + 1] : 0;
+		}
+	}
+
+	inline ElementId assign_element(ElementHash hh, String &name) {
+		ElementTable::iterator it = hh_nam.find(hh);
+
+		if (it != hh_nam.end()) {
+			names[it->second].count++;
+
+			return it->second;
+		}
+
+		ElementId e;
+
+		if (free_elements.empty()) {
+			e = names.size();
+			names.push_back({name_arena.add(name), hh, 1});
+		} else {
+			e = free_elements.back();
+			free_elements.pop_back();
+			names[e] = {name_arena.add(name), hh, 1};
+		}
+		hh_nam[hh] = e;
+
+		return e;
+	}
+
+	/// Registers the elements of a set and returns their ids sorted and without repetitions. The empty set uses the element of hash 0.
+	inline BinarySet assign_set(StringSet &set) {
+		std::vector<ElementHash> hashes = {};
+
+		hash_set(set, hashes);
+
+		BinarySet b_set = assign_set(set, hashes);
+
+		sort_set(b_set);
+
+		return b_set;
+	}
+
+	/// Registers the elements of a set given their hashes and returns their ids, not sorted yet.
+	inline BinarySet assign_set(StringSet &set, std::vector<ElementHash> &hashes) {
+		BinarySet b_set = {};
+
+		int size = set.size();
+
+		if (size == 0) {
+			String empty = {""};
+			assign_element(0, empty);
+
+			return b_set;
+		}
+
+		for (int i = 0; i < size; i++)
+			b_set.push_back(assign_element(hashes[i], set[i]));
+
+		return b_set;
+	}
+
+	static inline void hash_set(StringSet &set, std::vector<ElementHash> &hashes) {
+		hashes.resize(set.size());
+
+		for (int i = 0; i < set.size(); i++)
+			hashes[i] = MurmurHash64A(set[i].c_str(), set[i].length());
+	}
+
+	static inline void sort_set(BinarySet &b_set) {
+		std::sort(b_set.begin(), b_set.end());
+
+		b_set.erase(unique(b_set.begin(), b_set.end()), b_set.end());
+	}
+
+	inline void release_element(ElementId e) {
+		hh_nam.erase(names[e].hash);
+
+		names[e] = {{0, 0}, 0, 0};
+		free_elements.push_back(e);
+	}
+
+	// Copies the names in use to a new arena, dropping the ones released since the last call.
+	inline void compact_names() {
+		StringArena arena = {};
+
+		for (NameList::iterator it = names.begin(); it != names.end(); ++it)
+			it->name = arena.add(name_arena.data(it->name), name_arena.length(it->name));
+
+		std::swap(name_arena, arena);
+	}
+
+	bool prepare_query (StringSet &set, bool strict, QueryContext &ctx) const;
+	bool prepare_query (StringSet &set, bool strict, BinarySet &q, SignatureList &mask) const;
+	int	 find_set	   (StringSet &set) const;
+	void parallel_query (int kind, int t_idx, int s_idx, QueryContext &ctx) const;
+	void run_query	   (int kind, BinarySet &q, SignatureList &mask, int limit, CursorStack &stk, IdList &found) const;
+	QueryBatch query_batch (int kind, std::vector<StringSet> &sets, int limit, int num_threads) const;
+	void build		   (std::vector<BinarySet> &sets, StringSet &str_ids, IdList &order);
+	void build_parallel (std::vector<BinarySet> &sets, StringSet &str_ids, int num_threads);
+
+	mutable RWLock rw_lock;
+
+	BinaryTree	  tree			= {};
+	IdList		  parent		= {};
+	StateList	  state			= {};
+	SummaryList	  summary		= {};
+	SignatureList signature		= {};
+	ElementTable  hh_nam		= {};
+	NameList	  names			= {};
+	StringArena	  name_arena	= {};
+	BinarySet	  free_elements = {};
+	RunList		  runs			= {};
+	IdList		  free_runs		= {};
+};
+
+
+/** A supersets() or subsets() query over a SetTrie that returns the results one at a time.
+
+The state of the traversal is an explicit stack of pending sibling chains, so the memory does not depend on the number of results and
+the first result is returned as soon as it is found. Any change to the SetTrie makes next() return CURSOR_INVALID.
+*/
+class SetTrieCursor {
+
+	public:
+
+		SetTrieCursor(SetTrie &st, int kind, StringSet set);
+
+		/// Returns the index of the node of the next result (the set_id of the set), CURSOR_END or CURSOR_INVALID.
+		inline int next() {
+
+			RWGuard guard(st.rw_lock, false);
 
-struct Name {
-	String name;
-	int count;
-};
+			if (num_changes != st.num_changes)
+				return CURSOR_INVALID;
 
-typedef std::map<ElementHash, Name>	StringName;
-typedef std::map<int, String>		IdMap;
+			if (emit_root) {
+				emit_root = false;
 
-struct SetNode {
-	ElementHash value;
+				return 0;
+			}
 
-	int idx_next, idx_child, idx_parent;
+			if (kind == CURSOR_SUPERSETS)
+				return st.next_superset(stack, query, query_mask, last_query_idx);
 
-	uint8_t state;
-};
+			return st.next_subset(stack, query, last_query_idx);
+		}
 
-typedef std::vector<SetNode>		BinaryTree;
+		int kind;
 
-// This structure is 64encoded to 8K (3 input bytes == 24 bit -> 4 output chars == 24 bit). Therefore, its size is 6K.
-struct ImageBlock {
-	int size, block_num;
+#ifndef TEST
+	private:
+#endif
 
-	uint8_t buffer[IMAGE_BUFF_SIZE];		// makes sizeof(ImageBlock) == 6K
+	SetTrie &st;
+
+	int	 num_changes, last_query_idx;
+	bool emit_root;
+
+	BinarySet	  query		 = {};
+	SignatureList query_mask = {};
+	CursorStack	  stack		 = {};
 };
 
-typedef std::vector<ImageBlock>		BinaryImage;
-typedef BinaryImage				   *pBinaryImage;
 
+typedef std::shared_ptr<const SetTrie> SetTrieSnapshot;
 
-class SetTrie {
+/** A SetTrie whose readers never wait for its writers.
+
+The current version is an immutable SetTrie published through an atomic shared_ptr. A reader pins a version with snapshot() and
+queries it without any lock for as long as it holds it, even while newer versions are published. A version is freed when its last
+reader drops it. The writers change a private draft, a copy of the current version made by the first update() after a publish(), and
+publish() makes the draft the current version at once. Between publish() calls the memory is about twice the size of a SetTrie.
+*/
+class VersionedSetTrie {
 
 	public:
 
-		SetTrie() {
-			SetNode root = {0, 0, 0, -1, STATE_IN_USE};
-			tree.push_back(root);
-			num_dirty_nodes = 0;
-		}
+		VersionedSetTrie() : current(std::make_shared<const SetTrie>()) {}
 
-		void	  insert	(StringSet set, String id);
-		void	  insert	(String str, String str_id, char split);
-		String	  find		(StringSet set);
-		String	  find		(String str, char split);
-		StringSet supersets	(StringSet set);
-		StringSet supersets	(String str, char split);
-		StringSet subsets	(StringSet set);
-		StringSet subsets	(String str, char split);
-		StringSet elements	(int idx);
+		/// The current version. It never changes, so it can be queried from any thread without waiting.
+		inline SetTrieSnapshot snapshot() const { return std::atomic_load(&current); }
+
+		/// The number of versions published, starting at 0 for the empty SetTrie.
+		inline uint64_t version() const { return num_version; }
+
+		void	 update	 (const std::function<void(SetTrie &)> &fun);
+		uint64_t publish ();
+		bool	 swap_in (pBinaryImage &p_bi);
+
+#ifndef TEST
+	private:
+#endif
+
+	std::mutex				 writer;
+	SetTrieSnapshot			 current;
+	std::unique_ptr<SetTrie> p_draft;
+	std::atomic<uint64_t>	 num_version{0};
+};
+
+
+/** A SetTrie split in shards, each one a SetTrie holding part of the sets.
+
+A set always goes to the shard given by a hash of its canonical form (the sorted hashes of its distinct elements), so find() asks a
+single shard. Each shard has its own lock, the inserts of a batch run on the shards in parallel, and supersets() and subsets() ask all
+the shards on num_threads threads and merge the results in shard order (within a shard, in the order of its own query, which is not
+defined when set_query_threads() splits it). The set_id of a set in shard k is local_id*num_shards + k.
+
+The set_ids are int, so a shard holds at most (INT32_MAX - k)/num_shards + 1 nodes, about 2^31 nodes in all, and an insert that could
+go past the cap of its shard is refused. load() replaces the shards and save() reads them one after another, so neither of them can run
+while other threads use the ShardedSetTrie.
+*/
+class ShardedSetTrie {
+
+	public:
+
+		ShardedSetTrie(int num_shards = 4, int num_threads = 4)
+			: shard(std::min(MAX_SHARDS, std::max(1, num_shards))), num_threads(std::max(1, num_threads)) {}
+
+		bool	  insert	(StringSet set, String id);
+		int		  insert_many (std::vector<StringSet> &sets, StringSet &str_ids);
+		String	  find		(StringSet set) const;
+		int		  find_idx	(StringSet set) const;
+		StringSet supersets	(StringSet set, int limit = -1) const;
+		StringSet subsets	(StringSet set, int limit = -1) const;
+		IdList	  supersets_idx (StringSet set, int limit = -1) const;
+		IdList	  subsets_idx	(StringSet set, int limit = -1) const;
+		int		  count_supersets (StringSet set) const;
+		int		  count_subsets	  (StringSet set) const;
+		QueryBatch supersets_batch (std::vector<StringSet> &sets, int limit = -1) const;
+		QueryBatch subsets_batch   (std::vector<StringSet> &sets, int limit = -1) const;
+		IdList	  find_batch	  (std::vector<StringSet> &sets) const;
+		StringSet elements	(int idx) const;
+		String	  set_name	(int idx) const;
+		int		  next_set_id (int idx) const;
+		int		  size		() const;
 		int		  remove	(int idx);
+		int		  find_by_id   (String str_id) const;
+		int		  remove_by_id (String str_id);
 		int		  purge		();
+		int		  num_dirty_nodes () const;
+		bool	  set_element_order (int order);
+		void	  set_signatures (bool enable);
+		bool	  set_query_threads (int num_threads);
 		bool	  load		(pBinaryImage &p_bi);
 		bool	  save		(pBinaryImage &p_bi);
 
-		IdMap id			  = {};
-		int	  num_dirty_nodes;
+		inline int num_shards() const { return shard.size(); }
 
 #ifndef TEST
 	private:
 #endif
 
-	inline int insert(int idx, ElementHash value) {
+	int shard_of (StringSet &set) const;
+
+	inline int global_id(int local_id, int k) const { return local_id*(int) shard.size() + k; }
+
+	/// True if shard k can take num_nodes new nodes and still give every node a set_id that fits in an int.
+	inline bool has_room(int k, int64_t num_nodes) const {
+		return (int64_t) shard[k].tree.size() + num_nodes <= ((int64_t) INT32_MAX - k)/(int64_t) shard.size() + 1;
+	}
 
-		if (tree[idx].idx_child == 0) {
-			SetNode node = {value, 0, 0, idx, STATE_IN_USE};
+	QueryBatch query_batch (int kind, std::vector<StringSet> &sets, int limit) const;
 
-			tree.push_back(node);
+	std::vector<SetTrie> shard;
+	int					 num_threads;
+};
 
-			int idx_c = tree.size() - 1;
 
-			tree[idx].idx_child = idx_c;
+/** A bit vector with a rank directory (the number of ones before each 512 bit block) supporting rank and select.
+*/
+class BitVector {
 
-			return idx_c;
+	public:
+
+		inline void push_back(bool bit) {
+			if ((num_bits & 63) == 0)
+				words.push_back(0);
+
+			if (bit)
+				words.back() |= (uint64_t) 1 << (num_bits & 63);
+
+			num_bits++;
 		}
 
-		idx	= tree[idx].idx_child;
+		inline bool get(int i) const {
+			return (words[i >> 6] >> (i & 63)) & 1;
+		}
 
-		while (true) {
-			if (tree[idx].value == value)
-				return idx;
+		inline void build() {
+			int n_words = words.size(), ones = 0;
 
-			if (tree[idx].idx_next == 0) {
-				SetNode node = {value, 0, 0, tree[idx].idx_parent, STATE_IN_USE};
+			ranks.clear();
 
-				tree.push_back(node);
+			for (int w = 0; w < n_words; w++) {
+				if ((w & 7) == 0)
+					ranks.push_back(ones);
 
-				int idx_c = tree.size() - 1;
+				ones += __builtin_popcountll(words[w]);
+			}
+			ranks.push_back(ones);
+		}
 
-				tree[idx].idx_next = idx_c;
+		/// Number of ones in [0, i)
+		inline int rank1(int i) const {
+			int w = (i >> 9) << 3, r = ranks[i >> 9];
 
-				return idx_c;
+			for (; w < (i >> 6); w++)
+				r += __builtin_popcountll(words[w]);
+
+			if (i & 63)
+				r += __builtin_popcountll(words[w] & (((uint64_t) 1 << (i & 63)) - 1));
+
+			return r;
+		}
+
+		/// Number of zeros in [0, i)
+		inline int rank0(int i) const {
+			return i - rank1(i);
+		}
+
+		/// Position of the k-th one (k >= 1)
+		inline int select1(int k) const {
+			int lo = 0, hi = ranks.size() - 2;
+
+			while (lo < hi) {
+				int mid = (lo + hi + 1) >> 1;
+
+				if (ranks[mid] < k)
+					lo = mid;
+				else
+					hi = mid - 1;
 			}
+			k -= ranks[lo];
 
-			idx = tree[idx].idx_next;
+			for (int w = lo << 3;; w++) {
+				int c = __builtin_popcountll(words[w]);
+
+				if (k <= c)
+					return (w << 6) + select_in_word(words[w], k);
+
+				k -= c;
+			}
 		}
-	}
 
-	inline int insert(BinarySet set) {
+		/// Position of the k-th zero (k >= 1)
+		inline int select0(int k) const {
+			int lo = 0, hi = ranks.size() - 2;
 
-		int idx	 = 0;
-		int size = set.size();
+			while (lo < hi) {
+				int mid = (lo + hi + 1) >> 1;
 
-		if (size == 0) {
-			tree[0].state = STATE_HAS_SET_ID;
+				if ((mid << 9) - ranks[mid] < k)
+					lo = mid;
+				else
+					hi = mid - 1;
+			}
+			k -= (lo << 9) - ranks[lo];
 
-			return 0;
+			for (int w = lo << 3;; w++) {
+				int c = 64 - __builtin_popcountll(words[w]);
+
+				if (k <= c)
+					return (w << 6) + select_in_word(~words[w], k);
+
+				k -= c;
+			}
 		}
 
-		for (int i = 0; i < size; i++)
-			idx	= insert(idx, set[i]);
+		inline size_t num_bytes() const {
+			return words.size()*sizeof(uint64_t) + ranks.size()*sizeof(int);
+		}
 
-		tree[idx].state = STATE_HAS_SET_ID;
+		int num_bits = 0;
 
-		return idx;
+		std::vector<uint64_t> words = {};
+		std::vector<int>	  ranks = {};
+
+	private:
+
+		inline int select_in_word(uint64_t w, int k) const {
+			while (--k > 0)
+				w &= w - 1;
+
+			return __builtin_ctzll(w);
+		}
+};
+
+
+/** An array of unsigned integers stored with a fixed number of bits each.
+*/
+class PackedArray {
+
+	public:
+
+		inline void push_back(uint64_t value) {
+			uint64_t bit = (uint64_t) size*width;
+
+			int ofs = bit & 63;
+
+			if (ofs == 0)
+				words.push_back(0);
+
+			words.back() |= value << ofs;
+
+			if (ofs + width > 64)
+				words.push_back(value >> (64 - ofs));
+
+			size++;
+		}
+
+		inline uint64_t get(int i) const {
+			uint64_t bit = (uint64_t) i*width;
+
+			int w = bit >> 6, ofs = bit & 63;
+
+			uint64_t value = words[w] >> ofs;
+
+			if (ofs + width > 64)
+				value |= words[w + 1] << (64 - ofs);
+
+			return value & mask;
+		}
+
+		inline void set_width(int bits) {
+			width = bits;
+			mask  = bits == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << bits) - 1;
+		}
+
+		inline size_t num_bytes() const {
+			return words.size()*sizeof(uint64_t);
+		}
+
+		int		 size  = 0;
+		int		 width = 1;
+		uint64_t mask  = 1;
+
+		std::vector<uint64_t> words = {};
+};
+
+
+// A range of siblings pending in the stack of a FrozenSetTrie or DawgSetTrie query: [t_idx, last) are the nodes (or edges) still to
+// visit, s_idx is the first pending query value and rank the number of the first set reached through t_idx (DawgSetTrie only). When all
+// is set, the query is already matched and all the sets below the range are results.
+struct SnapshotFrame {
+	int t_idx, last, s_idx, rank;
+
+	bool all;
+};
+
+typedef std::vector<SnapshotFrame>	SnapshotStack;
+
+// The scratch state of a FrozenSetTrie or DawgSetTrie query: the sorted codes of the query, the results and the stack of the traversal.
+// Each thread has its own (see FrozenSetTrie::query_context()), so many threads can query the same snapshot at once.
+struct SnapshotContext {
+	IdList		  query	 = {};
+	IdList		  result = {};
+	SnapshotStack stack	 = {};
+
+	int last_query_idx = 0;
+};
+
+
+/** A read-only snapshot of a SetTrie stored as a succinct LOUDS (level-order unary degree sequence) encoding.
+
+	The nodes are numbered in breadth first order (the root is 0). Each node writes as many ones as it has children followed by a zero
+	in the bit vector louds, so the children of a node are consecutive numbers. Their values are stored in a PackedArray as codes of
+	as many bits as required for the number of elements. The codes are the ElementId of the SetTrie, so the children keep the order of
+	the SetTrie siblings.
+
+	The queries are const and keep their scratch in a thread local SnapshotContext, many threads can query the same object at once.
+*/
+class FrozenSetTrie {
+
+	public:
+
+		FrozenSetTrie() {}
+		FrozenSetTrie(SetTrie &st) { build(st); }
+
+		void	  build		(SetTrie &st);
+		String	  find		(StringSet set) const;
+		String	  find		(String str, char split) const;
+		StringSet supersets	(StringSet set) const;
+		StringSet supersets	(String str, char split) const;
+		StringSet subsets	(StringSet set) const;
+		StringSet subsets	(String str, char split) const;
+		StringSet elements	(int idx) const;
+		bool	  load		(pBinaryImage &p_bi);
+		bool	  save		(pBinaryImage &p_bi);
+
+		inline int num_sets() const	 { return ids.size(); }
+		inline int num_nodes() const { return values.size; }
+
+		/// The bytes of the tree, the terminals, the values and the element codes. The element names and the set ids are not included.
+		inline size_t num_bytes() const {
+			return louds.num_bytes() + terminal.num_bytes() + values.num_bytes() + hashes.size()*(sizeof(ElementHash) + sizeof(int));
+		}
+
+#ifndef TEST
+	private:
+#endif
+
+	/// The nodes [first, last) are the children of v.
+	inline void children(int v, int &first, int &last) const {
+		int start = v == 0 ? 0 : louds.select0(v) + 1;
+
+		first = start - v + 1;
+		last  = louds.select0(v + 1) - v + 1;
 	}
 
-	inline int find(int idx, ElementHash value) {
+	inline int parent(int v) const {
+		return louds.rank0(louds.select1(v));
+	}
 
-		if ((idx = tree[idx].idx_child) == 0)
-			return 0;
+	inline int code(ElementHash hh) const {
+		std::vector<ElementHash>::const_iterator it = std::lower_bound(hashes.begin(), hashes.end(), hh);
 
-		while (true) {
-			if (tree[idx].value == value)
-				return idx;
+		if (it == hashes.end() || *it != hh)
+			return -1;
 
-			if ((idx = tree[idx].idx_next) == 0)
-				return 0;
+		return codes[it - hashes.begin()];
+	}
+
+	/// Pushes the children of t to the stack of ctx, if it has any.
+	inline void push_children(SnapshotContext &ctx, int t, int s_idx, bool all) const {
+		int first, last;
+		children(t, first, last);
+
+		if (first < last)
+			ctx.stack.push_back({first, last, s_idx, 0, all});
+	}
+
+	/// Appends to ctx.result the nodes of the supersets of ctx.query below the ranges in ctx.stack, in depth first order.
+	inline void supersets(SnapshotContext &ctx) const {
+
+		SnapshotStack &stack = ctx.stack;
+		IdList		  &query = ctx.query;
+
+		while (!stack.empty()) {
+			SnapshotFrame &f = stack.back();
+
+			if (f.t_idx == f.last) {
+				stack.pop_back();
+
+				continue;
+			}
+
+			int t = f.t_idx++, s_idx = f.s_idx;
+
+			// The query is already matched: every terminal below is a result.
+			if (f.all) {
+				if (terminal.get(t))
+					ctx.result.push_back(t);
+
+				push_children(ctx, t, 0, true);
+
+				continue;
+			}
+
+			int t_value, q_value;
+
+			if ((t_value = values.get(t)) > (q_value = query[s_idx])) {
+				stack.pop_back();
+
+				continue;
+			}
+
+			int found = 0;
+
+			if (t_value == q_value) {
+				if (s_idx == ctx.last_query_idx) {
+					if (terminal.get(t))
+						ctx.result.push_back(t);
+
+					push_children(ctx, t, 0, true);
+
+					continue;
+				}
+
+				found	= 1;
+				q_value = query[s_idx + 1];
+			}
+
+			if (t_value < q_value)
+				push_children(ctx, t, s_idx + found, false);
 		}
 	}
 
-	inline int find(BinarySet set) {
+	/// Appends to ctx.result the nodes of the subsets of ctx.query below the ranges in ctx.stack, in depth first order.
+	inline void subsets(SnapshotContext &ctx) const {
 
-		int idx	 = 0;
-		int size = set.size();
+		SnapshotStack &stack = ctx.stack;
+		IdList		  &query = ctx.query;
 
-		for (int i = 0; i < size; i++)
-			if ((idx = find(idx, set[i])) == 0)
-				return 0;
+		while (!stack.empty()) {
+			SnapshotFrame &f = stack.back();
 
-		return idx;
+			if (f.t_idx == f.last) {
+				stack.pop_back();
+
+				continue;
+			}
+
+			int t = f.t_idx++, t_value = values.get(t);
+
+			// The siblings grow, so the query values skipped for one are skipped for the next ones too.
+			while (f.s_idx < ctx.last_query_idx && query[f.s_idx] < t_value)
+				f.s_idx++;
+
+			int s_idx = f.s_idx;
+
+			if (query[s_idx] < t_value) {
+				stack.pop_back();
+
+				continue;
+			}
+
+			if (query[s_idx] == t_value) {
+				if (terminal.get(t))
+					ctx.result.push_back(t);
+
+				if (s_idx < ctx.last_query_idx)
+					push_children(ctx, t, s_idx + 1, false);
+			}
+		}
+	}
+
+	/// The SnapshotContext of the calling thread, shared by all the FrozenSetTrie objects.
+	static inline SnapshotContext &query_context() {
+		static thread_local SnapshotContext ctx;
+
+		return ctx;
 	}
 
-	inline void all_supersets(int t_idx) {
+	BitVector	louds, terminal;
+	PackedArray values;
+
+	std::vector<ElementHash> hashes = {};		///< All the element hashes, sorted.
+	IdList					 codes	= {};		///< The code of each hash in hashes.
+
+	StringSet names = {};
+	StringSet ids	= {};
+};
+
+typedef std::map<BinarySet, int>	StateRegister;
+
+// A subtree of the SetTrie being reduced by DawgSetTrie::reduce(): the value of node i at position pos of its run (-1 for the value of
+// the node itself). j is the next child to reduce (0 when done, -1 for the next value of the run), key the key of the state so far and
+// n the number of sets below.
+struct ReduceFrame {
+	int i, pos, j, n;
+
+	BinarySet key;
+};
+
+
+/** A read-only snapshot of a SetTrie minimized into a directed acyclic word graph (DAWG).
+
+	Identical subtrees (same values, same terminals, same shape) are stored once, so sets sharing suffixes also share states. Since
+	a state is reached by many paths, the set ids cannot be attached to the states. The sets are numbered in depth first order instead:
+	each edge stores how many sets come before the ones reached through it (the terminal of its source state and the sets below its
+	previous siblings) and the number of a set is the sum of the edges of its path. The sets below a state have consecutive numbers.
+
+	As in FrozenSetTrie, the queries are const and keep their scratch in a thread local SnapshotContext.
+*/
+class DawgSetTrie {
+
+	public:
+
+		DawgSetTrie() {}
+		DawgSetTrie(SetTrie &st) { build(st); }
+
+		void	  build		(SetTrie &st);
+		String	  find		(StringSet set) const;
+		String	  find		(String str, char split) const;
+		StringSet supersets	(StringSet set) const;
+		StringSet supersets	(String str, char split) const;
+		StringSet subsets	(StringSet set) const;
+		StringSet subsets	(String str, char split) const;
+		StringSet elements	(int idx) const;
+		bool	  load		(pBinaryImage &p_bi);
+		bool	  save		(pBinaryImage &p_bi);
+
+		inline int num_sets() const	  { return ids.size(); }
+		inline int num_states() const { return terminal.num_bits; }
+		inline int num_edges() const  { return values.size; }
+
+		/// The bytes of the states, the edges and the element codes. The element names and the set ids are not included.
+		inline size_t num_bytes() const {
+			return terminal.num_bytes() + first.num_bytes() + values.num_bytes() + targets.num_bytes() + ranks.num_bytes()
+				 + counts.num_bytes() + hashes.size()*(sizeof(ElementHash) + sizeof(int));
+		}
+
+#ifndef TEST
+	private:
+#endif
+
+	int reduce(SetTrie &st, StateRegister &reg, std::vector<BinarySet> &keys, IdList &count);
+
+	inline int code(ElementHash hh) const {
+		std::vector<ElementHash>::const_iterator it = std::lower_bound(hashes.begin(), hashes.end(), hh);
 
-		while (t_idx != 0) {
-			if (tree[t_idx].state == STATE_HAS_SET_ID)
-				result.push_back(t_idx);
+		if (it == hashes.end() || *it != hh)
+			return -1;
 
-			if (int ci = tree[t_idx].idx_child)
-				all_supersets(ci);
+		return codes[it - hashes.begin()];
+	}
+
+	/// The edge of state s with the given value or -1.
+	inline int edge(int s, int value) const {
+		int lo = first.get(s), hi = first.get(s + 1);
 
-			t_idx = tree[t_idx].idx_next;
+		while (lo < hi) {
+			int mid = (lo + hi) >> 1;
+
+			if ((int) values.get(mid) < value)
+				lo = mid + 1;
+			else
+				hi = mid;
 		}
+
+		if (lo == (int) first.get(s + 1) || (int) values.get(lo) != value)
+			return -1;
+
+		return lo;
 	}
 
-	inline void supersets(int t_idx, int s_idx) {
+	/// Pushes the edges of state s, whose first set is number rank, to the stack of ctx.
+	inline void push_edges(SnapshotContext &ctx, int s, int rank, int s_idx) const {
+		int e = first.get(s), last = first.get(s + 1);
 
-		while (t_idx != 0) {
-			ElementHash t_value, q_value;
+		if (e < last)
+			ctx.stack.push_back({e, last, s_idx, rank, false});
+	}
 
-			int found = 0;
+	/// Appends to ctx.result the numbers of the supersets of ctx.query below the edges in ctx.stack, in depth first order.
+	inline void supersets(SnapshotContext &ctx) const {
 
-			if ((t_value = tree[t_idx].value) == (q_value = query[s_idx])) {
-				if (s_idx == last_query_idx) {
+		SnapshotStack &stack = ctx.stack;
+		IdList		  &query = ctx.query;
 
-					if (tree[t_idx].state == STATE_HAS_SET_ID)
-						result.push_back(t_idx);
+		while (!stack.empty()) {
+			SnapshotFrame &f = stack.back();
 
-					if (int ci = tree[t_idx].idx_child)
-						all_supersets(ci);
+			if (f.t_idx == f.last) {
+				stack.pop_back();
 
-				} else {
-					found = 1;
-					q_value = query[s_idx + 1];
-				}
+				continue;
+			}
+
+			int e = f.t_idx++, s_idx = f.s_idx, t_value, q_value;
+
+			if ((t_value = values.get(e)) > (q_value = query[s_idx])) {
+				stack.pop_back();
+
+				continue;
 			}
 
-			int ni;
-			if (t_value < q_value && (ni = tree[t_idx].idx_child) != 0)
-				supersets(ni, s_idx + found);
+			int t = targets.get(e), r = f.rank + ranks.get(e);
 
-			t_idx = tree[t_idx].idx_next;
+			if (t_value == q_value) {
+				// The sets below a state have consecutive numbers.
+				if (s_idx == ctx.last_query_idx) {
+					int n = counts.get(t);
+
+					for (int k = 0; k < n; k++)
+						ctx.result.push_back(r + k);
+
+				} else
+					push_edges(ctx, t, r, s_idx + 1);
+
+			} else
+				push_edges(ctx, t, r, s_idx);
 		}
 	}
 
-	inline void subsets(int t_idx, int s_idx) {
+	/// Appends to ctx.result the numbers of the subsets of ctx.query below the edges in ctx.stack, in depth first order.
+	inline void subsets(SnapshotContext &ctx) const {
+
+		SnapshotStack &stack = ctx.stack;
+		IdList		  &query = ctx.query;
 
-		while (t_idx != 0) {
-			ElementHash t_value;
-			if ((t_value = tree[t_idx].value) >= query[s_idx]) {
-				int ns_idx = s_idx;
+		while (!stack.empty()) {
+			SnapshotFrame &f = stack.back();
 
-				while (ns_idx < last_query_idx && query[ns_idx] < t_value)
-					ns_idx++;
+			if (f.t_idx == f.last) {
+				stack.pop_back();
 
-				if (query[ns_idx] == t_value) {
-					if (tree[t_idx].state == STATE_HAS_SET_ID)
-						result.push_back(t_idx);
+				continue;
+			}
 
-					int ni;
-					if ((ni = tree[t_idx].idx_child) != 0) {
-						ns_idx++;
+			int e = f.t_idx++, t_value = values.get(e);
 
-						if (ns_idx <= last_query_idx)
-							subsets(ni, ns_idx);
-					}
-				}
+			while (f.s_idx < ctx.last_query_idx && query[f.s_idx] < t_value)
+				f.s_idx++;
+
+			int s_idx = f.s_idx;
+
+			if (query[s_idx] < t_value) {
+				stack.pop_back();
+
+				continue;
 			}
 
-			t_idx = tree[t_idx].idx_next;
+			if (query[s_idx] == t_value) {
+				int t = targets.get(e), r = f.rank + ranks.get(e);
+
+				if (terminal.get(t))
+					ctx.result.push_back(r);
+
+				if (s_idx < ctx.last_query_idx)
+					push_edges(ctx, t, r, s_idx + 1);
+			}
 		}
 	}
 
-	inline void assign_hh_nam(ElementHash hh, String &name) {
-		StringName::iterator it = hh_nam.find(hh);
+	/// The SnapshotContext of the calling thread, shared by all the DawgSetTrie objects.
+	static inline SnapshotContext &query_context() {
+		static thread_local SnapshotContext ctx;
 
-		if (it == hh_nam.end()) {
-			hh_nam[hh].count = 1;
-			hh_nam[hh].name  = name; }
-		else
-			hh_nam[hh].count++;
+		return ctx;
 	}
 
-	int last_query_idx;
+	int root = 0;
+
+	BitVector	terminal;			///< One bit per state.
+	PackedArray first;				///< The edges of state s are [first[s], first[s + 1]).
+	PackedArray values, targets;	///< The value and the target state of each edge.
+	PackedArray ranks;				///< The number of the first set reached through each edge, relative to its source state.
+	PackedArray counts;				///< The number of sets below each state, including itself.
+
+	std::vector<ElementHash> hashes = {};		///< All the element hashes, sorted.
+	IdList					 codes	= {};		///< The code of each hash in hashes.
 
-	BinarySet  query  = {};
-	IdList	   result = {};
-	BinaryTree tree	  = {};
-	StringName hh_nam = {};
+	StringSet names = {};
+	StringSet ids	= {};
 };
 #endif
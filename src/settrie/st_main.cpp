@@ -8,7 +8,95 @@
 
 #include "st_main.h"
 
-#if !defined TEST
+#if defined SETTRIE_BENCH
+
+#include <chrono>
+
+using namespace std;
+
+typedef std::chrono::steady_clock Clock;
+
+
+double ns_per_op(Clock::time_point t0, uint64_t n) {
+	return std::chrono::duration<double, std::nano>(Clock::now() - t0).count()/n;
+}
+
+
+/** Element registry benchmark: std::map vs. ElementTable, inserting and then looking up a vocabulary of n element hashes.
+
+	Usage: settrie_bench [n], n defaults to 10M. Half of the lookups are misses, like the query elements that are not in a SetTrie.
+*/
+int main(int argc, char* argv[]) {
+
+	uint64_t n = argc > 1 ? atoll(argv[1]) : 10000000;
+
+	std::vector<ElementHash> keys(2*n);
+
+	uint64_t rnd = 12345;
+
+	for (uint64_t i = 0; i < 2*n; i++) {
+		rnd = rnd*6364136223846793005 + 1442695040888963407;
+
+		uint64_t z = rnd;
+		z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27))*0x94d049bb133111eb;
+
+		keys[i] = z ^ (z >> 31);
+	}
+
+	uint64_t found = 0;
+
+	std::map<ElementHash, ElementId> tree;
+
+	Clock::time_point t0 = Clock::now();
+
+	for (uint64_t i = 0; i < n; i++)
+		tree[keys[i]] = i;
+
+	double map_insert = ns_per_op(t0, n);
+
+	t0 = Clock::now();
+
+	for (uint64_t i = 0; i < 2*n; i++) {
+		std::map<ElementHash, ElementId>::iterator it = tree.find(keys[(i*7) % (2*n)]);
+
+		if (it != tree.end())
+			found += it->second;
+	}
+
+	double map_find = ns_per_op(t0, 2*n);
+
+	tree.clear();
+
+	ElementTable table;
+
+	t0 = Clock::now();
+
+	for (uint64_t i = 0; i < n; i++)
+		table[keys[i]] = i;
+
+	double table_insert = ns_per_op(t0, n);
+
+	t0 = Clock::now();
+
+	for (uint64_t i = 0; i < 2*n; i++) {
+		ElementTable::iterator it = table.find(keys[(i*7) % (2*n)]);
+
+		if (it != table.end())
+			found -= it->second;
+	}
+
+	double table_find = ns_per_op(t0, 2*n);
+
+	printf("%llu elements\n\n", (unsigned long long) n);
+	printf("               insert (ns)  find (ns)\n");
+	printf("std::map       %11.1f %10.1f\n", map_insert, map_find);
+	printf("ElementTable   %11.1f %10.1f\n", table_insert, table_find);
+
+	return found == 0 ? 0 : 1;
+}
+
+#elif !defined TEST
 
 using namespace std;
 
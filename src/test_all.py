@@ -18,11 +18,13 @@
 #     See the License for the specific language governing permissions and
 #     limitations under the License.
 
-import copy, os, pickle, shutil
+import copy, os, pickle, pytest, shutil
+
+from array import array
 
 from unittest.mock import patch
 
-from settrie import SetTrie, Result, destroy_settrie, next_set_id, elements, set_name, create_tutorials
+from settrie import SetTrie, ShardedSetTrie, Result, destroy_settrie, next_set_id, elements, set_name, create_tutorials
 
 
 def test_basic():
@@ -389,6 +391,37 @@ def test_remove_purge():
     assert stt.purge() == 0
 
 
+def test_element_order():
+    stt = SetTrie()
+
+    for i in range(200):
+        stt.insert({'common', 'w%i' % (i % 7), 'x%i' % i}, 's%i' % i)
+
+    supersets = sorted(stt.supersets({'w3'}))
+    subsets	  = sorted(stt.subsets({'common', 'w3', 'x3', 'x10'}))
+
+    assert stt.set_element_order('sorted') < 0
+
+    for order in ['frequent_first', 'rare_first', 'insertion']:
+        assert stt.set_element_order(order) == 0
+
+        assert len(stt) == 200
+        assert stt.find({'common', 'w5', 'x12'}) == 's12'
+        assert sorted(stt.supersets({'w3'})) == supersets
+        assert sorted(stt.subsets({'common', 'w3', 'x3', 'x10'})) == subsets
+
+    stt.set_element_order('frequent_first')
+
+    assert stt.remove('s3') == 0
+    assert stt.purge() > 0
+
+    tt = pickle.loads(pickle.dumps(stt))
+
+    assert len(tt) == 199
+    assert tt.find({'common', 'w3', 'x10'}) == 's10'
+    assert sorted(tt.subsets({'common', 'w3', 'x3', 'x10'})) == ['s10']
+
+
 def test_issue_23():
     for i in [29487, 29488]:
         x = SetTrie()
@@ -413,3 +446,336 @@ def test_create_tutorials():
 # test_remove_purge()
 # test_issue_23()
 # test_create_tutorials()
+
+
+def test_signatures():
+    stt = SetTrie()
+
+    for i in range(300):
+        stt.insert({'w%i' % (i % 11), 'x%i' % (i % 17), 'y%i' % i}, 's%i' % i)
+
+    queries = [{'w3'}, {'w3', 'x5'}, {'x2', 'y2'}, {'w1', 'x1', 'y1'}, {'w0', 'y5'}]
+    results = [sorted(stt.supersets(q)) for q in queries]
+
+    assert stt.set_signatures(True) == 0
+    assert [sorted(stt.supersets(q)) for q in queries] == results
+
+    assert stt.remove('s2') == 0
+    assert stt.purge() > 0
+    assert sorted(stt.supersets({'x2', 'y2'})) == []
+
+    tt = pickle.loads(pickle.dumps(stt))
+
+    assert sorted(tt.supersets({'w3', 'x5'})) == results[1]
+    assert tt.set_signatures(False) == 0
+    assert sorted(tt.supersets({'w3', 'x5'})) == results[1]
+
+
+def test_count():
+    stt = SetTrie()
+
+    for i in range(300):
+        stt.insert({'w%i' % (i % 11), 'x%i' % (i % 17), 'y%i' % i}, 's%i' % i)
+
+    for q in [{'w3'}, {'w3', 'x5'}, {'x2', 'y2'}, {'w1', 'x1', 'y1'}, {'w0', 'y5'}, {'z'}, set()]:
+        assert stt.count_supersets(q) == len(list(stt.supersets(q)))
+
+    for q in [{'w3', 'x3', 'y3', 'y4'}, {'w3', 'x5', 'y80', 'y25'}, {'z'}]:
+        assert stt.count_subsets(q) == len(list(stt.subsets(q)))
+
+    assert stt.count_supersets({'w3'}) == 27
+
+    assert stt.remove('s3') == 0
+    assert stt.count_supersets({'w3'}) == 26
+
+
+def test_limit():
+    stt = SetTrie()
+
+    for i in range(300):
+        stt.insert({'w%i' % (i % 11), 'x%i' % (i % 17), 'y%i' % i}, 's%i' % i)
+
+    everything = set(stt.supersets({'w3'}))
+
+    first = list(stt.supersets({'w3'}, limit=5))
+
+    assert len(first) == 5
+    assert set(first) <= everything
+    assert len(list(stt.supersets({'w3'}, limit=1000))) == len(everything)
+    assert len(list(stt.supersets(set(), limit=7))) == 7
+    assert len(list(stt.supersets({'z'}, limit=7))) == 0
+
+    query = {'w3', 'x3', 'y3', 'w4', 'x4', 'y4'}
+
+    assert len(list(stt.subsets(query))) == 2
+    assert len(list(stt.subsets(query, limit=1))) == 1
+    assert len(list(stt.subsets(query, limit=0))) == 0
+
+
+def test_lazy():
+    stt = SetTrie()
+
+    for i in range(300):
+        stt.insert({'w%i' % (i % 11), 'x%i' % (i % 17), 'y%i' % i}, 's%i' % i)
+
+    stt.insert(set(), 'empty')
+
+    for q in [{'w3'}, {'w3', 'x5'}, {'z'}, set()]:
+        assert sorted(stt.supersets(q, lazy=True)) == sorted(stt.supersets(q))
+
+    query = {'w3', 'x3', 'y3', 'w4', 'x4', 'y4'}
+
+    assert sorted(stt.subsets(query, lazy=True)) == sorted(stt.subsets(query))
+    assert len(list(stt.supersets(set(), limit=10, lazy=True))) == 10
+
+    res = stt.supersets({'w3'}, lazy=True)
+
+    with pytest.raises(TypeError):
+        len(res)
+
+    assert next(res) in set(stt.supersets({'w3'}))
+
+    stt.insert({'w3'}, 'new')
+
+    with pytest.raises(RuntimeError):
+        next(res)
+
+
+def test_idx():
+    stt = SetTrie()
+
+    for i in range(300):
+        stt.insert({'w%i' % (i % 11), 'x%i' % (i % 17), 'y%i' % i}, 's%i' % i)
+
+    names = {ts.id : ts.set_id for ts in stt}
+
+    assert stt.find_idx({'w3', 'x3', 'y3'}) == names['s3']
+    assert stt.find_idx({'w3', 'x3'}) == -1
+    assert stt.find_idx({'nothere'}) == -1
+    assert stt.find_idx(set()) == -1
+
+    for q in [{'w3'}, {'w3', 'x5'}, {'z'}, set()]:
+        idx = stt.supersets_idx(q)
+
+        assert isinstance(idx, array)
+        assert sorted(idx) == sorted(names[s] for s in stt.supersets(q))
+
+    query = {'w3', 'x3', 'y3', 'w4', 'x4', 'y4'}
+
+    assert sorted(stt.subsets_idx(query)) == sorted(names[s] for s in stt.subsets(query))
+    assert len(stt.subsets_idx(query, limit=1)) == 1
+    assert len(stt.supersets_idx({'w3'}, limit=3)) == 3
+
+    assert stt.remove(stt.find_idx({'w3', 'x3', 'y3'})) == 0
+    assert stt.find({'w3', 'x3', 'y3'}) == ''
+
+
+def test_remove_by_id():
+    stt = SetTrie()
+
+    for i in range(200):
+        stt.insert({'a%i' % (i % 7), 'b%i' % i}, 's%i' % i)
+
+    names = {ts.id : ts.set_id for ts in stt}
+
+    assert stt.find_by_id('s5') == names['s5']
+    assert stt.find_by_id('nothere') == -1
+
+    # Interleaved inserts and removals, the index follows them without rebuilding.
+    for i in range(0, 200, 2):
+        assert stt.remove('s%i' % i) == 0
+        stt.insert({'c%i' % i}, 't%i' % i)
+        assert stt.find_by_id('s%i' % i) == -1
+        assert stt.find({'c%i' % i}) == 't%i' % i
+
+    assert stt.remove('s0') == -1
+    assert len(stt) == 200
+
+    stt.purge()
+
+    for ts in stt:
+        assert stt.find_by_id(ts.id) == ts.set_id
+
+    stt.insert({'x'}, 'dup')
+    stt.insert({'y'}, 'dup')
+
+    assert stt.remove('dup') == 0
+    assert stt.find({'x'}) == 'dup'
+    assert stt.remove('dup') == 0
+    assert stt.remove('dup') == -1
+
+
+def test_query_threads():
+    sets = [{'a%i' % (i % 7), 'b%i' % (i % 11), 'c%i' % i, 'common'} for i in range(800)] + [{'a1'}, {'a1', 'b1'}]
+
+    stt = SetTrie()
+    ref = SetTrie()
+
+    for i, s in enumerate(sets):
+        stt.insert(s, 's%i' % i)
+        ref.insert(s, 's%i' % i)
+
+    assert stt.set_query_threads(0) == -2
+    assert stt.set_query_threads(4) == 0
+
+    for query in [{'common'}, {'a1'}, {'a1', 'b1'}, {'a1', 'b1', 'c1', 'common'}]:
+        assert sorted(stt.supersets(query)) == sorted(ref.supersets(query))
+        assert sorted(stt.subsets(query)) == sorted(ref.subsets(query))
+
+    assert len(stt.supersets({'common'})) == 800
+    assert len(stt.supersets({'common'}, limit = 5)) == 5
+
+
+def test_batch():
+    stt = SetTrie()
+
+    sets = [{'a%i' % (i % 7), 'b%i' % (i % 11), 'c%i' % i} for i in range(300)] + [set(), {'a1'}, {"it's", 'a, b'}]
+
+    for i, s in enumerate(sets):
+        stt.insert(s, 's%i' % i)
+
+    queries = [{'a1'}, {'a1', 'b1'}, set(), {'zz'}, {'a1'}, {"it's", 'a, b'}, {'a1', 'b1', 'c1', 'c2'}]
+
+    sup = stt.supersets_batch(queries, num_threads = 3)
+    sub = stt.subsets_batch(queries)
+
+    assert len(sup) == len(queries) and len(sub) == len(queries)
+
+    for i, q in enumerate(queries):
+        assert list(sup[i]) == list(stt.supersets_idx(q))
+        assert list(sub[i]) == list(stt.subsets_idx(q))
+        assert sorted(sup.ids(i)) == sorted(stt.supersets(q))
+
+    assert list(stt.supersets_batch(queries, limit = 2)[0]) == list(stt.supersets_idx({'a1'}, limit = 2))
+
+    found = stt.find_batch(queries + [{'c5', 'a5', 'b5'}], num_threads = 2)
+
+    assert list(found) == [stt.find_idx(q) for q in queries + [{'c5', 'a5', 'b5'}]]
+    assert found[3] == -1 and found[7] >= 0
+
+    assert len(stt.supersets_batch([])) == 0
+    assert len(stt.find_batch([])) == 0
+
+
+def test_insert_many():
+    sets = [{'a%i' % (i % 5), 'b%i' % (i % 13), 'c%i' % i} for i in range(500)] + [set(), {'a1'}, {'a1', 'b1'}]
+    ids  = ['s%i' % i for i in range(len(sets))]
+
+    stt = SetTrie()
+
+    assert stt.insert_many(sets, ids) == len(sets)
+    assert len(stt) == len(sets)
+
+    ref = SetTrie()
+
+    for s, i in zip(sets, ids):
+        ref.insert(s, i)
+
+    for s in sets:
+        assert stt.find(s) == ref.find(s)
+
+    assert sorted(stt.supersets({'a1'})) == sorted(ref.supersets({'a1'}))
+    assert sorted(stt.subsets({'a1', 'b1', 'c1'})) == sorted(ref.subsets({'a1', 'b1', 'c1'}))
+
+    # A SetTrie that is not empty.
+    assert stt.insert_many([{'x', 'y'}, {'x'}], ['xy', 'x']) == 2
+    assert stt.find({'x'}) == 'x'
+    assert stt.find({'y', 'x'}) == 'xy'
+    assert stt.insert_many([], []) == 0
+
+    # The result does not depend on the number of threads.
+    par = SetTrie()
+
+    assert par.insert_many(sets, ids, num_threads = 4) == len(sets)
+    assert len(par) == len(sets)
+
+    for s in sets:
+        assert par.find(s) == ref.find(s)
+
+    assert sorted(par.supersets({'a1'})) == sorted(ref.supersets({'a1'}))
+
+
+def test_sharded():
+    sets = [{'a%i' % (i % 7), 'b%i' % (i % 11), 'c%i' % i} for i in range(400)] + [set(), {'a1'}, {"it's", 'a, b'}, {1, 2.5}]
+    ids  = ['s%i' % i for i in range(len(sets))]
+
+    ref = SetTrie()
+    sht = ShardedSetTrie(num_shards = 3, num_threads = 2)
+
+    ref.insert_many(sets, ids)
+
+    assert sht.insert_many(sets[:200], ids[:200]) == 200
+
+    for s, i in zip(sets[200:], ids[200:]):
+        sht.insert(s, i)
+
+    assert len(sht) == len(ref)
+
+    for s in sets:
+        assert sht.find(s) == ref.find(s)
+        assert sht.find_idx(s) >= 0
+
+    assert sht.find({'zz'}) == '' and sht.find_idx({'zz'}) == -1
+
+    queries = [{'a1'}, {'a1', 'b1'}, set(), {'zz'}, {"it's", 'a, b'}, {1}]
+
+    for q in queries:
+        assert sorted(sht.supersets(q)) == sorted(ref.supersets(q))
+        assert sorted(sht.supersets(q, lazy = True)) == sorted(ref.supersets(q))
+        assert sht.count_supersets(q) == ref.count_supersets(q)
+        assert len(sht.supersets_idx(q)) == ref.count_supersets(q)
+        assert len(list(sht.supersets(q, limit = 3))) == min(3, ref.count_supersets(q))
+
+        big = q | {'a1', 'b1', 'c1', 'c12', 'a3'}
+
+        assert sorted(sht.subsets(big)) == sorted(ref.subsets(big))
+        assert sht.count_subsets(big) == ref.count_subsets(big)
+        assert len(sht.subsets_idx(big)) == ref.count_subsets(big)
+
+    sup = sht.supersets_batch(queries)
+    sub = sht.subsets_batch(queries, limit = 2)
+
+    for i, q in enumerate(queries):
+        assert list(sup[i]) == list(sht.supersets_idx(q))
+        assert list(sub[i]) == list(sht.subsets_idx(q, limit = 2))
+        assert sorted(sup.ids(i)) == sorted(ref.supersets(q))
+
+    assert list(sht.find_batch(sets[:50])) == [sht.find_idx(s) for s in sets[:50]]
+    assert len(sht.find_batch([])) == 0 and len(sht.supersets_batch([])) == 0
+
+    assert sorted(st.id for st in sht) == sorted(ids)
+
+    for st in sht:
+        if st.id == 's7':
+            assert set(st.elements) == sets[7]
+
+    assert sht.find_by_id('s5') == sht.find_idx(sets[5])
+    assert sht.remove('s5') == 0 and sht.remove('s5') < 0
+    assert sht.remove(sht.find_idx(sets[6])) == 0
+    assert sht.find(sets[5]) == '' and sht.find(sets[6]) == ''
+    assert sht.purge() > 0 and sht.purge() == 0
+
+    assert sht.set_element_order('rare_first') == 0 and sht.set_element_order('nope') < 0
+    assert sht.set_signatures(True) == 0
+    assert sht.set_query_threads(2) == 0 and sht.set_query_threads(0) < 0
+
+    assert sorted(sht.supersets({'a1'})) == sorted(i for i in ref.supersets({'a1'}) if i not in {'s5', 's6'})
+
+    tt = pickle.loads(pickle.dumps(sht))
+    cp = copy.deepcopy(sht)
+
+    for t in [tt, cp]:
+        assert t.num_shards == 3 and t.num_threads == 2
+        assert len(t) == len(sht)
+        assert sorted(t.supersets({'b3'})) == sorted(sht.supersets({'b3'}))
+        assert t.find({'a, b', "it's"}) == sht.find({"it's", 'a, b'})
+
+    assert not ShardedSetTrie().load_from_binary_image(['bad'])
+
+    assert ShardedSetTrie(num_shards = 100000).num_shards == 4096
+
+    other = ShardedSetTrie(num_shards = 5)
+
+    assert other.load_from_binary_image(sht.save_as_binary_image())
+    assert other.num_shards == 3 and other.num_threads == 4
+    assert sorted(other.supersets({'b3'})) == sorted(sht.supersets({'b3'}))